@@ -29,6 +29,7 @@ static ScheduleEvent schedule[] = {
   {20000000, 1, true,  255, TEMP,    50.0, true,  false}  // 20s or temp > 50°C, PWM 1 to 255
 };
 static uint8_t scheduleCount = sizeof(schedule) / sizeof(schedule[0]);
+uint8_t actuatorMaxPwm; // Default in Settings.cpp
 
 void initActuation() {
   for (uint8_t i = 0; i < ACTUATOR_COUNT; i++) {
@@ -55,7 +56,7 @@ void toggleActuator(uint8_t actuatorId) {
         Serial.print(" toggled to: ");
         Serial.println(actuators[i].state ? "HIGH" : "LOW");
       } else if (actuators[i].type == PWM) {
-        actuators[i].pwmValue = (actuators[i].pwmValue == 0) ? 128 : 0;
+        actuators[i].pwmValue = (actuators[i].pwmValue == 0) ? min((uint8_t)128, actuatorMaxPwm) : 0;
         analogWrite(actuators[i].pin, actuators[i].pwmValue);
         Serial.print("PWM ");
         Serial.print(actuatorId);
@@ -75,6 +76,7 @@ void setActuator(uint8_t actuatorId, bool state, uint8_t pwmValue) {
         actuators[i].state = state;
         digitalWrite(actuators[i].pin, state);
       } else if (actuators[i].type == PWM) {
+        pwmValue = min(pwmValue, actuatorMaxPwm);
         actuators[i].state = (pwmValue > 0);
         actuators[i].pwmValue = pwmValue;
         analogWrite(actuators[i].pin, pwmValue);
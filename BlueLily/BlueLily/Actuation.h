@@ -8,6 +8,7 @@
 // External declarations from Config.h
 extern Actuator actuators[];
 extern const uint8_t ACTUATOR_COUNT;
+extern uint8_t actuatorMaxPwm; // PWM outputs are clamped to this, set through Settings.cpp
 
 void initActuation();
 void toggleActuator(uint8_t actuatorId);
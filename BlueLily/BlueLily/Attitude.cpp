@@ -0,0 +1,124 @@
+#include "Attitude.h"
+#include "Sensors.h"
+
+// Filter tuning
+float attitudeBeta;                              // Gradient-descent gain (rad/s)
+static const float ACCEL_CORRECTION_WINDOW = 0.2; // Only trust accel when |a| is within 20% of 1 g
+static const float MAX_DT = 0.1;                 // s, larger gaps are clamped
+
+static AttitudeState state;
+static uint32_t lastTimestampUs = 0;
+static bool initialized = false;
+
+// Fast inverse square root with a fixed two Newton iterations: branch-free
+// relative error below 5e-6, well under the sensor noise
+static inline float invSqrt(float x) {
+  float halfx = 0.5f * x;
+  uint32_t i;
+  memcpy(&i, &x, sizeof(i));
+  i = 0x5F3759DF - (i >> 1);
+  float y;
+  memcpy(&y, &i, sizeof(y));
+  y *= 1.5f - halfx * y * y;
+  y *= 1.5f - halfx * y * y;
+  return y;
+}
+
+// Level the quaternion from a gravity measurement (yaw is unobservable)
+static void initFromAccel(const float accel[3]) {
+  float roll = atan2f(accel[1], accel[2]);
+  float pitch = atan2f(-accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
+  float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+  float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+  state.q[0] = cr * cp;
+  state.q[1] = sr * cp;
+  state.q[2] = cr * sp;
+  state.q[3] = -sr * sp;
+}
+
+static void rotateToWorld(const float accel[3]) {
+  float w = state.q[0], x = state.q[1], y = state.q[2], z = state.q[3];
+  float ax = accel[0], ay = accel[1], az = accel[2];
+  state.worldAccel[0] = (1 - 2 * (y * y + z * z)) * ax + 2 * (x * y - w * z) * ay + 2 * (x * z + w * y) * az;
+  state.worldAccel[1] = 2 * (x * y + w * z) * ax + (1 - 2 * (x * x + z * z)) * ay + 2 * (y * z - w * x) * az;
+  state.worldAccel[2] = 2 * (x * z - w * y) * ax + 2 * (y * z + w * x) * ay + (1 - 2 * (x * x + y * y)) * az
+                        - STANDARD_GRAVITY;
+}
+
+void initAttitude() {
+  state.q[0] = 1.0;
+  state.q[1] = state.q[2] = state.q[3] = 0.0;
+  state.worldAccel[0] = state.worldAccel[1] = state.worldAccel[2] = 0.0;
+  initialized = false;
+}
+
+const AttitudeState& updateAttitude(uint32_t timestampUs, const float accel[3], const float gyro[3]) {
+  if (!initialized) {
+    initFromAccel(accel);
+    lastTimestampUs = timestampUs;
+    initialized = true;
+    rotateToWorld(accel);
+    return state;
+  }
+
+  float dt = (timestampUs - lastTimestampUs) * 1e-6f;
+  lastTimestampUs = timestampUs;
+  if (dt <= 0.0f) return state;
+  if (dt > MAX_DT) dt = MAX_DT;
+
+  float q0 = state.q[0], q1 = state.q[1], q2 = state.q[2], q3 = state.q[3];
+  float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+
+  // Rate of change of quaternion from gyroscope
+  float qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  // Gradient-descent correction towards measured gravity, skipped under
+  // thrust or in free fall where the accelerometer does not see gravity
+  float ax = accel[0], ay = accel[1], az = accel[2];
+  float normSq = ax * ax + ay * ay + az * az;
+  float gLow = (1.0f - ACCEL_CORRECTION_WINDOW) * STANDARD_GRAVITY;
+  float gHigh = (1.0f + ACCEL_CORRECTION_WINDOW) * STANDARD_GRAVITY;
+  if (normSq > gLow * gLow && normSq < gHigh * gHigh) {
+    float recipNorm = invSqrt(normSq);
+    ax *= recipNorm; ay *= recipNorm; az *= recipNorm;
+
+    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+    float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+    float sNormSq = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (sNormSq > 0.0f) {
+      recipNorm = invSqrt(sNormSq);
+      qDot1 -= attitudeBeta * s0 * recipNorm;
+      qDot2 -= attitudeBeta * s1 * recipNorm;
+      qDot3 -= attitudeBeta * s2 * recipNorm;
+      qDot4 -= attitudeBeta * s3 * recipNorm;
+    }
+  }
+
+  q0 += qDot1 * dt;
+  q1 += qDot2 * dt;
+  q2 += qDot3 * dt;
+  q3 += qDot4 * dt;
+
+  float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  state.q[0] = q0 * recipNorm;
+  state.q[1] = q1 * recipNorm;
+  state.q[2] = q2 * recipNorm;
+  state.q[3] = q3 * recipNorm;
+
+  rotateToWorld(accel);
+  return state;
+}
+
+const AttitudeState& getAttitude() {
+  return state;
+}
@@ -0,0 +1,23 @@
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Madgwick IMU (accel + gyro) orientation filter, run once per IMU sample
+
+struct AttitudeState {
+  float q[4];          // Body-to-world quaternion (w, x, y, z), world Z up
+  float worldAccel[3]; // m/s^2 in the world frame with gravity removed
+};
+
+extern float attitudeBeta; // Gradient-descent gain (rad/s), set through Settings.cpp
+
+void initAttitude();
+
+// Accel in m/s^2, gyro in rad/s. Returns the updated state.
+const AttitudeState& updateAttitude(uint32_t timestampUs, const float accel[3], const float gyro[3]);
+
+const AttitudeState& getAttitude();
+
+#endif
@@ -1,19 +1,41 @@
 #include "Config.h"
 #include "Sensors.h"
+#include "Sampler.h"
 #include "Communication.h"
+#include "Configurator.h"
+#include "CanTelemetry.h"
+#include "CanTransport.h"
 #include "Logger.h"
 #include "Actuation.h"
 #include "HID.h"
+#include "DisplayFlush.h"
 #include "FlightController.h"
 #include "ROS2Bridge.h"
+#include "Simulation.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "Bus.h"
+#include "Settings.h"
+#include "ConfigStore.h"
 
 void setup() {
   Serial.begin(115200);
   delay(1000);
+  initSettings(); // Module tunables start at their registry defaults
 
+  #if ENABLE_SIMULATION
+  initSimulation(defaultSimFlightConfig()); // Virtual clock must be in place before the sampler starts
+  #endif
+
+  initProfiler();
+  initBus();
   initSensors();
+  initSampler();
   initCommunication();
+  initCanTelemetry();
+  initCanTransport();
   initLogger();
+  initConfigStore(); // Saved settings replace the defaults before anything uses them
   initActuation();
   initHID();
   initFlightController();
@@ -22,13 +44,37 @@ void setup() {
   initROS2Bridge();
   #endif
 
+  // Period 0 runs on every pass; lower priority numbers run first
+  initTaskScheduler();
+  addTask("adc", updateADC, 0, 0, 0);
+  addTask("sampler", updateSampler, 0, 0, 0);
+  addTask("flight", runFlightController, LOOP_INTERVAL_MS * 1000UL, LOOP_INTERVAL_MS * 1000UL, 1);
+  addTask("logger", updateLogger, 0, 0, 2);
+  #if ENABLE_ROS2_BRIDGE
+  addTask("ros2", updateROS2Bridge, ros2PublishRateMs * 1000UL, ros2PublishRateMs * 1000UL, 3);
+  addTask("heartbeat", publishHeartbeat, 1000000UL, 0, 4);
+  #endif
+  addTask("comms", processCommunication, COMMS_POLL_MS * 1000UL, 0, 4);
+  #if ENABLE_CANBUS
+  addTask("isotp", updateCanTransport, 0, 0, 4); // Polls every ISOTP_POLL_US unless sending
+  #endif
+  #if ENABLE_CAN_TELEMETRY
+  addTask("cantx", updateCanTelemetry, 1000UL, 0, 4);
+  #endif
+  addTask("hid", updateHID, HID_REFRESH_MS * 1000UL, HID_REFRESH_MS * 1000UL, 5);
+  #if ENABLE_HID
+  addTask("oled", updateDisplayFlush, OLED_FLUSH_PERIOD_US, 0, 6);
+  #endif
+  addTask("config", updateConfigStore, CONFIG_STORE_POLL_MS * 1000UL, 0, 7);
+
   Serial.println("BlueLily Flight Computer Initialized");
 }
 
 void loop() {
-  runFlightController();
-  
-  #if ENABLE_ROS2_BRIDGE
-  updateROS2Bridge();
+  #if ENABLE_SIMULATION
+  updateSimulation();
   #endif
+
+  PROFILE_SCOPE(PROBE_LOOP);
+  runTasks();
 }
\ No newline at end of file
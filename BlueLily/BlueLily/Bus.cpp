@@ -0,0 +1,114 @@
+#include "Bus.h"
+#include "Hal.h"
+
+struct BusDeviceInfo {
+  const char* name;
+  BusId bus;
+  BusPriority priority;
+};
+
+static const BusDeviceInfo devices[BUS_DEVICE_COUNT] = {
+  {"imu", BUS_I2C, BUS_CRITICAL},
+  {"adc", BUS_I2C, BUS_NORMAL},
+  {"oled", BUS_I2C, BUS_BULK},
+  {"thermocouple", BUS_SPI, BUS_NORMAL},
+  {"flash", BUS_SPI, BUS_BULK},
+  {"can", BUS_SPI, BUS_NORMAL}
+};
+
+struct BusDeviceState {
+  bool reserved;
+  uint32_t dueUs;
+  bool waiting;       // Deferred at least once since the last grant
+  uint32_t requestUs; // When the pending transaction was wanted
+  uint32_t grantUs;
+  BusDeviceStats stats;
+};
+
+static BusDeviceState state[BUS_DEVICE_COUNT];
+
+// True if a more urgent device on the same bus is due before a transfer of
+// durationUs starting now would finish
+static bool mustYield(BusDevice device, uint32_t now, uint32_t durationUs) {
+  const BusDeviceInfo& info = devices[device];
+  for (uint8_t i = 0; i < BUS_DEVICE_COUNT; i++) {
+    if (devices[i].bus != info.bus || devices[i].priority >= info.priority) continue;
+    if (state[i].reserved && (int32_t)(state[i].dueUs - (now + durationUs)) < 0) return true;
+  }
+  return false;
+}
+
+void initBus() {
+  memset(state, 0, sizeof(state));
+}
+
+void busReserve(BusDevice device, uint32_t dueUs) {
+  state[device].reserved = true;
+  state[device].dueUs = dueUs;
+}
+
+bool busBegin(BusDevice device, uint32_t durationUs) {
+  BusDeviceState& s = state[device];
+  uint32_t now = halMicros();
+  if (!s.waiting) {
+    s.waiting = true;
+    // A reserved device has been waiting since it fell due
+    s.requestUs = (s.reserved && (int32_t)(now - s.dueUs) > 0) ? s.dueUs : now;
+  }
+
+  if (mustYield(device, now, durationUs)) {
+    if (now - s.requestUs < BUS_STARVATION_US) {
+      s.stats.deferrals++;
+      return false;
+    }
+    s.stats.forced++;
+  }
+
+  uint32_t wait = now - s.requestUs;
+  if (wait > s.stats.maxWaitUs) s.stats.maxWaitUs = wait;
+  s.waiting = false;
+  s.reserved = false;
+  s.grantUs = now;
+  return true;
+}
+
+void busEnd(BusDevice device) {
+  BusDeviceState& s = state[device];
+  uint32_t hold = halMicros() - s.grantUs;
+  s.stats.transactions++;
+  if (hold > s.stats.maxHoldUs) s.stats.maxHoldUs = hold;
+}
+
+const char* getBusDeviceName(BusDevice device) {
+  return device < BUS_DEVICE_COUNT ? devices[device].name : "";
+}
+
+BusDeviceStats getBusStats(BusDevice device) {
+  BusDeviceStats none = {};
+  return device < BUS_DEVICE_COUNT ? state[device].stats : none;
+}
+
+void resetBusStats() {
+  for (uint8_t i = 0; i < BUS_DEVICE_COUNT; i++) {
+    memset(&state[i].stats, 0, sizeof(state[i].stats));
+  }
+}
+
+void printBusStats() {
+  // Format: BUS,device,transactions,deferrals,forced,max_wait_us,max_hold_us
+  for (uint8_t i = 0; i < BUS_DEVICE_COUNT; i++) {
+    const BusDeviceStats& stats = state[i].stats;
+    Serial.print("BUS,");
+    Serial.print(devices[i].name);
+    Serial.print(",");
+    Serial.print(stats.transactions);
+    Serial.print(",");
+    Serial.print(stats.deferrals);
+    Serial.print(",");
+    Serial.print(stats.forced);
+    Serial.print(",");
+    Serial.print(stats.maxWaitUs);
+    Serial.print(",");
+    Serial.println(stats.maxHoldUs);
+  }
+}
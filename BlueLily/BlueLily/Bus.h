@@ -0,0 +1,58 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Arbitration of the shared Wire (MPU6500, ADS1115, SSD1306) and SPI
+// (MAX31855, W25Q128, MCP2515) buses. The loop is cooperative, so nothing
+// is ever preempted mid-transfer; what matters is that a long bulk transfer
+// does not start just before a time-critical read is due.
+//
+// Periodic readers post their next due time with busReserve(). Every
+// transaction is bracketed by busBegin()/busEnd(); busBegin() with the
+// expected duration returns false (defer and retry on a later tick) when a
+// higher-priority device on the same bus is due before the transfer would
+// end. A request deferred for BUS_STARVATION_US is granted regardless, so
+// bulk traffic always makes progress.
+
+enum BusId {
+  BUS_I2C = 0,
+  BUS_SPI
+};
+
+enum BusPriority {
+  BUS_CRITICAL = 0, // Sample timing depends on it
+  BUS_NORMAL,
+  BUS_BULK          // Large transfers that can wait a tick
+};
+
+enum BusDevice {
+  BUS_DEV_IMU = 0,
+  BUS_DEV_ADC,
+  BUS_DEV_OLED,
+  BUS_DEV_THERMOCOUPLE,
+  BUS_DEV_FLASH,
+  BUS_DEV_CAN,
+  BUS_DEVICE_COUNT
+};
+
+struct BusDeviceStats {
+  uint32_t transactions;
+  uint32_t deferrals;  // busBegin() calls that were told to wait
+  uint32_t forced;     // Grants made by the starvation bound
+  uint32_t maxWaitUs;  // Worst delay from due time (or first request) to grant
+  uint32_t maxHoldUs;  // Longest transaction
+};
+
+void initBus();
+void busReserve(BusDevice device, uint32_t dueUs); // Next time the device will need its bus
+bool busBegin(BusDevice device, uint32_t durationUs);
+void busEnd(BusDevice device);
+
+const char* getBusDeviceName(BusDevice device);
+BusDeviceStats getBusStats(BusDevice device);
+void resetBusStats();
+void printBusStats(); // One BUS line per device on Serial
+
+#endif
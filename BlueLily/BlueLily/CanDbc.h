@@ -0,0 +1,152 @@
+#ifndef CANDBC_H
+#define CANDBC_H
+
+// BlueLily CAN telemetry database, in the spirit of a DBC file: each message
+// has an ID, length and cycle time, and each signal a bit position, length,
+// scale and offset (physical = raw * scale + offset). The firmware packs
+// frames from this table and host-side tools include the same header to
+// decode them. Only depends on the C standard library.
+//
+// Signals use Intel (little-endian) byte order: startBit is the bit number
+// of the least significant bit, counting from bit 0 of byte 0.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "CanDbc.h assumes a little-endian target"
+#endif
+
+struct CanSignal {
+  const char* name;
+  uint8_t startBit;
+  uint8_t length;   // 1..32 bits
+  bool isSigned;
+  float scale;
+  float offset;
+  const char* unit;
+};
+
+struct CanMessageDef {
+  uint16_t id;       // 11-bit standard ID
+  const char* name;
+  uint8_t dlc;
+  uint16_t cycleMs;  // Transmit period
+  const CanSignal* signals;
+  uint8_t signalCount;
+};
+
+// Messages, in the order of BLUELILY_CAN_MESSAGES
+enum BlueLilyCanMessage {
+  CAN_MSG_IMU_ACCEL = 0,
+  CAN_MSG_IMU_GYRO,
+  CAN_MSG_STATE,
+  CAN_MSG_TEMP,
+  CAN_MSG_ADC,
+  CAN_MSG_COUNT
+};
+
+inline constexpr CanSignal CAN_SIGNALS_IMU_ACCEL[] = {
+  {"AccelX", 0, 16, true, 0.01f, 0.0f, "m/s2"},
+  {"AccelY", 16, 16, true, 0.01f, 0.0f, "m/s2"},
+  {"AccelZ", 32, 16, true, 0.01f, 0.0f, "m/s2"}
+};
+
+inline constexpr CanSignal CAN_SIGNALS_IMU_GYRO[] = {
+  {"GyroX", 0, 16, true, 0.001f, 0.0f, "rad/s"},
+  {"GyroY", 16, 16, true, 0.001f, 0.0f, "rad/s"},
+  {"GyroZ", 32, 16, true, 0.001f, 0.0f, "rad/s"}
+};
+
+inline constexpr CanSignal CAN_SIGNALS_STATE[] = {
+  {"FlightState", 0, 8, false, 1.0f, 0.0f, ""}, // FlightState enum
+  {"Counter", 8, 8, false, 1.0f, 0.0f, ""}      // Increments per frame
+};
+
+inline constexpr CanSignal CAN_SIGNALS_TEMP[] = {
+  {"Temperature", 0, 16, true, 0.1f, 0.0f, "degC"}
+};
+
+inline constexpr CanSignal CAN_SIGNALS_ADC[] = {
+  {"Voltage0", 0, 16, true, 0.0002f, 0.0f, "V"},
+  {"Voltage1", 16, 16, true, 0.0002f, 0.0f, "V"},
+  {"Voltage2", 32, 16, true, 0.0002f, 0.0f, "V"},
+  {"Voltage3", 48, 16, true, 0.0002f, 0.0f, "V"}
+};
+
+#define CAN_SIGNAL_COUNT(signals) (uint8_t)(sizeof(signals) / sizeof(signals[0]))
+
+inline constexpr CanMessageDef BLUELILY_CAN_MESSAGES[CAN_MSG_COUNT] = {
+  {0x200, "BL_ImuAccel", 6, 10, CAN_SIGNALS_IMU_ACCEL, CAN_SIGNAL_COUNT(CAN_SIGNALS_IMU_ACCEL)},
+  {0x201, "BL_ImuGyro", 6, 10, CAN_SIGNALS_IMU_GYRO, CAN_SIGNAL_COUNT(CAN_SIGNALS_IMU_GYRO)},
+  {0x202, "BL_State", 2, 100, CAN_SIGNALS_STATE, CAN_SIGNAL_COUNT(CAN_SIGNALS_STATE)},
+  {0x203, "BL_Temp", 2, 500, CAN_SIGNALS_TEMP, CAN_SIGNAL_COUNT(CAN_SIGNALS_TEMP)},
+  {0x204, "BL_Adc", 8, 100, CAN_SIGNALS_ADC, CAN_SIGNAL_COUNT(CAN_SIGNALS_ADC)}
+};
+
+// Worst-case bits on the wire for a standard data frame, stuff bits included
+constexpr uint32_t canFrameBits(uint8_t dlc) {
+  return 47 + 8 * dlc + (34 + 8 * dlc - 1) / 4;
+}
+
+// Worst-case bus load of a message set, in bits per second
+constexpr uint32_t canBusLoadBps(const CanMessageDef* messages, size_t count) {
+  uint32_t bps = 0;
+  for (size_t i = 0; i < count; i++) bps += canFrameBits(messages[i].dlc) * 1000 / messages[i].cycleMs;
+  return bps;
+}
+
+// Signals are at most 32 bits inside an 8-byte payload, so every signal
+// is a mask and shift of one 64-bit word.
+inline uint64_t canLoadPayload(const uint8_t* data) {
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+inline void canPackRaw(uint8_t* data, const CanSignal& signal, uint32_t raw) {
+  uint64_t mask = ((1ULL << signal.length) - 1) << signal.startBit;
+  uint64_t word = canLoadPayload(data);
+  word = (word & ~mask) | (((uint64_t)raw << signal.startBit) & mask);
+  memcpy(data, &word, sizeof(word));
+}
+
+inline uint32_t canUnpackRaw(const uint8_t* data, const CanSignal& signal) {
+  return (canLoadPayload(data) >> signal.startBit) & ((1ULL << signal.length) - 1);
+}
+
+// Converts to raw, rounding and saturating to the signal's range. `data`
+// must be 8 bytes.
+inline void canPackSignal(uint8_t* data, const CanSignal& signal, float physical) {
+  double raw = floor((physical - signal.offset) / signal.scale + 0.5);
+  double high = signal.isSigned ? (double)((1LL << (signal.length - 1)) - 1) : (double)((1LL << signal.length) - 1);
+  double low = signal.isSigned ? -high - 1 : 0;
+  if (!(raw >= low)) raw = low; // NaN packs as the minimum
+  if (raw > high) raw = high;
+  canPackRaw(data, signal, (uint32_t)(int64_t)raw);
+}
+
+inline float canUnpackSignal(const uint8_t* data, const CanSignal& signal) {
+  uint32_t raw = canUnpackRaw(data, signal);
+  int64_t value = raw;
+  if (signal.isSigned && (raw >> (signal.length - 1)) & 1) value -= 1LL << signal.length;
+  return value * signal.scale + signal.offset;
+}
+
+// Packs values[i] into signal i of `message`. `data` must be 8 bytes.
+inline void canPackMessage(uint8_t* data, const CanMessageDef& message, const float* values) {
+  memset(data, 0, 8);
+  for (uint8_t i = 0; i < message.signalCount; i++) canPackSignal(data, message.signals[i], values[i]);
+}
+
+// Index into BLUELILY_CAN_MESSAGES for a received ID, or -1
+inline int canFindMessage(uint32_t id) {
+  for (int i = 0; i < CAN_MSG_COUNT; i++) {
+    if (BLUELILY_CAN_MESSAGES[i].id == id) return i;
+  }
+  return -1;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "CanTelemetry.h"
+
+#if ENABLE_CAN_TELEMETRY
+#include "CanDbc.h"
+#include "Communication.h"
+#include "Sampler.h"
+#include "FlightController.h"
+#include "Hal.h"
+
+#define CAN_MAX_SIGNALS 4
+
+constexpr uint8_t maxSignalCount() {
+  uint8_t count = 0;
+  for (const CanMessageDef& message : BLUELILY_CAN_MESSAGES) {
+    if (message.signalCount > count) count = message.signalCount;
+  }
+  return count;
+}
+
+static_assert(maxSignalCount() <= CAN_MAX_SIGNALS, "Raise CAN_MAX_SIGNALS");
+static_assert(canBusLoadBps(BLUELILY_CAN_MESSAGES, CAN_MSG_COUNT) * 100ULL <= (uint64_t)CANBUS_BITRATE * CAN_BUS_LOAD_BUDGET_PERCENT,
+              "CAN telemetry exceeds CAN_BUS_LOAD_BUDGET_PERCENT");
+
+static uint32_t nextDueMs[CAN_MSG_COUNT];
+static CanTelemetryStats stats;
+static uint8_t stateCounter = 0;
+
+// Physical values in signal order. Returns false until the message's
+// sensor has produced a sample.
+static bool fillSignals(uint8_t message, float* values) {
+  SensorSample sample;
+  switch (message) {
+    case CAN_MSG_IMU_ACCEL:
+      if (!latestSample(SAMPLE_IMU, sample)) return false;
+      memcpy(values, sample.imu.accel, sizeof(sample.imu.accel));
+      return true;
+    case CAN_MSG_IMU_GYRO:
+      if (!latestSample(SAMPLE_IMU, sample)) return false;
+      memcpy(values, sample.imu.gyro, sizeof(sample.imu.gyro));
+      return true;
+    case CAN_MSG_STATE:
+      values[0] = getFlightState();
+      values[1] = stateCounter++;
+      return true;
+    case CAN_MSG_TEMP:
+      if (!latestSample(SAMPLE_TEMP, sample)) return false;
+      values[0] = sample.temperature;
+      return true;
+    case CAN_MSG_ADC:
+      if (!latestSample(SAMPLE_ADC, sample)) return false;
+      for (uint8_t i = 0; i < 4; i++) values[i] = adcToVoltage(sample.adc[i]);
+      return true;
+  }
+  return false;
+}
+
+void initCanTelemetry() {
+  memset(&stats, 0, sizeof(stats));
+  stats.loadBps = canBusLoadBps(BLUELILY_CAN_MESSAGES, CAN_MSG_COUNT);
+  // Stagger the first frames so messages with the same cycle time don't
+  // queue up behind each other
+  uint32_t now = halMillis();
+  for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) nextDueMs[i] = now + i;
+}
+
+void updateCanTelemetry() {
+  uint32_t now = halMillis();
+  for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+    if ((int32_t)(now - nextDueMs[i]) < 0) continue;
+    const CanMessageDef& message = BLUELILY_CAN_MESSAGES[i];
+    float values[CAN_MAX_SIGNALS];
+    if (fillSignals(i, values)) {
+      uint8_t data[8];
+      canPackMessage(data, message, values);
+      if (!sendCANBUS(message.id, data, message.dlc)) {
+        // The MCP2515 has three TX buffers: what did not fit stays due and
+        // goes out on the next tick
+        stats.txFull++;
+        return;
+      }
+      stats.frames++;
+    }
+
+    nextDueMs[i] += message.cycleMs;
+    if ((int32_t)(now - nextDueMs[i]) >= 0) {
+      // Whole cycles were missed: skip them on the same grid instead of
+      // sending a burst, so the messages stay staggered
+      uint32_t skipped = (now - nextDueMs[i]) / message.cycleMs + 1;
+      stats.late += skipped;
+      nextDueMs[i] += skipped * message.cycleMs;
+    }
+  }
+}
+
+CanTelemetryStats getCanTelemetryStats() {
+  return stats;
+}
+
+void printCanTelemetryStats() {
+  // Format: CANTX,frames,late,load_bps,tx_full
+  Serial.print("CANTX,");
+  Serial.print(stats.frames);
+  Serial.print(",");
+  Serial.print(stats.late);
+  Serial.print(",");
+  Serial.print(stats.loadBps);
+  Serial.print(",");
+  Serial.println(stats.txFull);
+}
+#endif
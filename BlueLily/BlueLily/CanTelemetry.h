@@ -0,0 +1,28 @@
+#ifndef CANTELEMETRY_H
+#define CANTELEMETRY_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Periodic binary telemetry on CAN. Messages, signal layout and cycle
+// times come from the table in CanDbc.h.
+struct CanTelemetryStats {
+  uint32_t frames;
+  uint32_t late;    // Cycles skipped because the task ran late
+  uint32_t loadBps; // Worst-case bus load of the message set
+  uint32_t txFull;  // Sends put off a tick with every MCP2515 TX buffer pending
+};
+
+#if ENABLE_CAN_TELEMETRY
+void initCanTelemetry();
+void updateCanTelemetry(); // Sends each message whose cycle time has elapsed
+CanTelemetryStats getCanTelemetryStats();
+void printCanTelemetryStats(); // CANTX line on Serial
+#else
+inline void initCanTelemetry() {}
+inline void updateCanTelemetry() {}
+inline CanTelemetryStats getCanTelemetryStats() { return CanTelemetryStats(); }
+inline void printCanTelemetryStats() {}
+#endif
+
+#endif
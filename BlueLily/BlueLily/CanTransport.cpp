@@ -0,0 +1,147 @@
+#include "CanTransport.h"
+
+#if ENABLE_CANBUS
+#include "Communication.h"
+#include "Configurator.h"
+#include "Settings.h"
+#include "FlashLog.h"
+#include "Bus.h"
+#include "Hal.h"
+
+static IsoTpLink transport;
+static char pendingReply[CONFIG_BUFFER_SIZE]; // Short reply held while a log page goes out
+static uint32_t lastPollUs = 0;
+
+#if ENABLE_W25Q128
+static bool downloading = false;
+static uint32_t downloadCursor = 0;
+static uint32_t downloadPages = 0;
+static uint8_t nextPage[FLASH_PAGE_SIZE]; // Read while the previous page goes out
+static bool nextPageReady = false;
+#endif
+
+static bool sendTransportFrame(const uint8_t* data, uint8_t length) {
+  return sendCANBUS(CAN_RESPONSE_ID, data, length);
+}
+
+static void handleTransportCommand(const char* command) {
+  if (strcmp(command, "PARAMS") == 0) {
+    char text[ISOTP_MAX_MESSAGE];
+    formatSettings(text, sizeof(text));
+    canTransportSend(text);
+#if ENABLE_W25Q128
+  } else if (strcmp(command, "LOG,STOP") == 0) {
+    downloading = nextPageReady = false;
+    canTransportSend("ACK");
+  } else if (strncmp(command, "LOG", 3) == 0 && (command[3] == '\0' || command[3] == ',')) {
+    downloadCursor = command[3] ? strtoul(command + 4, nullptr, 10) : 0;
+    downloadPages = 0;
+    downloading = true;
+    nextPageReady = false;
+#endif
+  } else {
+    handleConfigCommand(METHOD_CANBUS, SENSOR_TYPE_CONFIG, 0, 0, PAYLOAD_TYPE_STRING, command);
+  }
+}
+
+static void receiveTransportFrame(const CanFrame& frame) {
+  if (!isoTpReceiveFrame(transport, frame.data, frame.length, halMicros())) return;
+  char command[CONFIG_BUFFER_SIZE];
+  if (transport.rxLength >= sizeof(command)) {
+    canTransportSend("NACK - Too long");
+    return;
+  }
+  memcpy(command, transport.rxBuffer, transport.rxLength);
+  command[transport.rxLength] = '\0';
+  handleTransportCommand(command);
+}
+
+#if ENABLE_W25Q128
+// Reads the next valid log page ahead, whenever the logger leaves the flash
+// idle, so it is ready the moment the page before it has gone out
+static void readNextLogPage() {
+  if (downloadCursor < flashLogOldestSequence()) downloadCursor = flashLogOldestSequence();
+  if (downloadCursor >= flashLogNextSequence()) return;
+  if (!flashLogIdle() || !busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US)) return;
+  int16_t length = readFlashLogPage(downloadCursor, nextPage);
+  busEnd(BUS_DEV_FLASH);
+  downloadCursor++;
+  nextPageReady = length >= 0; // Void or corrupt pages are not sent
+}
+
+// Queues the page read ahead once the previous message has gone out, or
+// ends the download when there is none left
+static void sendNextLogPage() {
+  if (!nextPageReady) readNextLogPage();
+  if (!isoTpTxIdle(transport) || pendingReply[0]) return;
+  if (nextPageReady) {
+    isoTpSend(transport, nextPage, sizeof(nextPage), halMicros());
+    nextPageReady = false;
+    downloadPages++;
+    readNextLogPage();
+  } else if (downloadCursor >= flashLogNextSequence()) {
+    char text[32];
+    snprintf(text, sizeof(text), "LOG,END,%lu", (unsigned long)downloadPages);
+    if (canTransportSend(text)) downloading = false;
+  }
+}
+#endif
+
+void initCanTransport() {
+  isoTpInit(transport, sendTransportFrame, ISOTP_BLOCK_SIZE, ISOTP_ST_MIN, ISOTP_TIMEOUT_MS * 1000UL);
+  pendingReply[0] = '\0';
+  lastPollUs = halMicros();
+  subscribeCAN(CAN_CONFIG_ID, receiveTransportFrame);
+}
+
+// Something to send: a message in progress, a reply or the next log page
+static bool transportBusy() {
+#if ENABLE_W25Q128
+  if (downloading) return true;
+#endif
+  return !isoTpTxIdle(transport) || pendingReply[0];
+}
+
+void updateCanTransport() {
+  // Idle, the controller is polled every ISOTP_POLL_US. While sending, every
+  // pass refills the TX buffers as frames leave and picks up the peer's flow
+  // control as soon as it arrives, so the bus does not wait for a poll.
+  uint32_t now = halMicros();
+  if (!transportBusy() && now - lastPollUs < ISOTP_POLL_US) return;
+  lastPollUs = now;
+  receiveCANBUS();
+  isoTpPoll(transport, halMicros(), ISOTP_FRAMES_PER_POLL);
+  if (pendingReply[0] && isoTpSend(transport, pendingReply, strlen(pendingReply), halMicros())) pendingReply[0] = '\0';
+#if ENABLE_W25Q128
+  if (downloading) sendNextLogPage();
+#endif
+}
+
+bool canTransportSend(const char* text) {
+  if (isoTpSend(transport, text, strlen(text), halMicros())) return true;
+  if (!pendingReply[0] && strlen(text) < sizeof(pendingReply)) {
+    strcpy(pendingReply, text); // Goes out after the message in progress
+    return true;
+  }
+  Serial.println("CAN transport busy");
+  return false;
+}
+
+IsoTpStats getCanTransportStats() {
+  return transport.stats;
+}
+
+void printCanTransportStats() {
+  // Format: ISOTP,rx_messages,tx_messages,rx_errors,overflows,timeouts
+  Serial.print("ISOTP,");
+  Serial.print(transport.stats.rxMessages);
+  Serial.print(",");
+  Serial.print(transport.stats.txMessages);
+  Serial.print(",");
+  Serial.print(transport.stats.rxErrors);
+  Serial.print(",");
+  Serial.print(transport.stats.overflows);
+  Serial.print(",");
+  Serial.println(transport.stats.timeouts);
+}
+#endif
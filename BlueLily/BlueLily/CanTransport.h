@@ -0,0 +1,31 @@
+#ifndef CANTRANSPORT_H
+#define CANTRANSPORT_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "IsoTp.h"
+
+// Segmented request/response messages over CAN (see IsoTp.h). Requests
+// arrive on CAN_CONFIG_ID and replies go out on CAN_RESPONSE_ID:
+//   KEY=VALUE     Configurator setting, answered with ACK/NACK
+//   PARAMS        All settings, one KEY=VALUE line each
+//   LOG[,seq]     Flash log download from page `seq` (default: oldest).
+//                 Each valid page is sent as a FLASH_PAGE_SIZE-byte message
+//                 (header and CRC included), then LOG,END,<pages>.
+//   LOG,STOP      Ends a download early
+
+#if ENABLE_CANBUS
+void initCanTransport();
+void updateCanTransport(); // Sends due frames and the next log page; call on every pass
+bool canTransportSend(const char* text); // Short replies wait for the message in progress; long ones fail
+IsoTpStats getCanTransportStats();
+void printCanTransportStats(); // ISOTP line on Serial
+#else
+inline void initCanTransport() {}
+inline void updateCanTransport() {}
+inline bool canTransportSend(const char*) { return false; }
+inline IsoTpStats getCanTransportStats() { return IsoTpStats(); }
+inline void printCanTransportStats() {}
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef CHYAPPY_H
+#define CHYAPPY_H
+
+// chYAPpy v1.2 framing, shared by every link that carries it (RS485, LoRa)
+// and by host-side tools. Only depends on the C standard library.
+//
+// Frame layout (7 + CHYAPPY_CRC_SIZE bytes of overhead):
+//   [0]    start        0x7D
+//   [1]    length       payload length in bytes
+//   [2]    sensor type
+//   [3]    sensor id
+//   [4..5] seq          big-endian
+//   [6]    payload type PAYLOAD_TYPE_*
+//   [7..]  payload      `length` bytes
+//   [..]   crc          over bytes [1 .. end of payload], big-endian
+//
+// v1.2 frames carry a 1-byte CRC-8 (poly 0x31). Links with larger binary
+// payloads can build both ends with CHYAPPY_CRC_SIZE 2 (CRC-16/CCITT-FALSE)
+// or 4 (CRC-32); the layout is otherwise unchanged.
+//
+// ChYAPpyParser is an incremental parser fed one byte at a time. It buffers
+// only the frame in progress and hands out a view into that buffer, so a
+// payload is never copied again. A bad length or CRC drops just the start
+// byte and rescans the buffered bytes for the next one, so a noise byte
+// costs at most one frame.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Crc.h"
+
+#define CHYAPPY_START 0x7D
+#ifndef CHYAPPY_CRC_SIZE
+#define CHYAPPY_CRC_SIZE 1
+#endif
+#define CHYAPPY_OVERHEAD (7 + CHYAPPY_CRC_SIZE)
+#ifndef CHYAPPY_MAX_PAYLOAD
+#define CHYAPPY_MAX_PAYLOAD 56 // Bounds how long a corrupt length byte can stall the parser
+#endif
+#define CHYAPPY_MAX_FRAME (CHYAPPY_MAX_PAYLOAD + CHYAPPY_OVERHEAD)
+
+inline uint32_t chyappyCrc(const uint8_t* data, size_t length) {
+#if CHYAPPY_CRC_SIZE == 4
+  return crc32(data, length);
+#elif CHYAPPY_CRC_SIZE == 2
+  return crc16Ccitt(data, length);
+#else
+  return crc8(data, length);
+#endif
+}
+
+inline void chyappyPutCrc(uint8_t* out, uint32_t crc) {
+  for (int i = CHYAPPY_CRC_SIZE - 1; i >= 0; i--, crc >>= 8) out[i] = crc & 0xFF;
+}
+
+inline bool chyappyCheckCrc(const uint8_t* frame, uint8_t length) {
+  uint8_t expected[CHYAPPY_CRC_SIZE];
+  chyappyPutCrc(expected, chyappyCrc(frame + 1, length + 6));
+  return memcmp(expected, frame + 7 + length, CHYAPPY_CRC_SIZE) == 0;
+}
+
+// Writes a frame to `out` (CHYAPPY_MAX_FRAME bytes) and returns its size,
+// or 0 if the payload is too long
+inline size_t chyappyEncode(uint8_t* out, uint8_t sensorType, uint8_t sensorId, uint16_t seqNum,
+                            uint8_t payloadType, const void* payload, uint8_t length) {
+  if (length > CHYAPPY_MAX_PAYLOAD) return 0;
+  out[0] = CHYAPPY_START;
+  out[1] = length;
+  out[2] = sensorType;
+  out[3] = sensorId;
+  out[4] = seqNum >> 8;
+  out[5] = seqNum & 0xFF;
+  out[6] = payloadType;
+  if (length) memcpy(out + 7, payload, length);
+  chyappyPutCrc(out + 7 + length, chyappyCrc(out + 1, length + 6));
+  return length + CHYAPPY_OVERHEAD;
+}
+
+struct ChYAPpyStats {
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t lengthErrors; // Length byte above CHYAPPY_MAX_PAYLOAD
+  uint32_t droppedBytes; // Bytes discarded while looking for a start byte
+};
+
+// A decoded frame. `payload` points into the parser and is NUL-terminated
+// (over the first CRC byte); it stays valid until the next chyappyFeed() call.
+struct ChYAPpyFrame {
+  uint8_t sensorType;
+  uint8_t sensorId;
+  uint16_t seqNum;
+  uint8_t payloadType;
+  uint8_t length;
+  const char* payload;
+};
+
+struct ChYAPpyParser {
+  uint8_t buffer[CHYAPPY_MAX_FRAME];
+  uint16_t count;     // Bytes buffered, buffer[0] is a start byte when count > 0
+  uint16_t frameSize; // Frame handed out by the last call, dropped on the next
+  ChYAPpyStats stats;
+};
+
+inline void chyappyReset(ChYAPpyParser& p) {
+  p.count = 0;
+  p.frameSize = 0;
+  memset(&p.stats, 0, sizeof(p.stats));
+}
+
+inline void chyappyDrop(ChYAPpyParser& p, uint16_t n) {
+  p.count -= n;
+  memmove(p.buffer, p.buffer + n, p.count);
+}
+
+// True when the buffer starts with a complete, valid frame
+inline bool chyappyScan(ChYAPpyParser& p) {
+  while (p.count) {
+    if (p.buffer[0] != CHYAPPY_START) {
+      uint16_t n = 1;
+      while (n < p.count && p.buffer[n] != CHYAPPY_START) n++;
+      p.stats.droppedBytes += n;
+      chyappyDrop(p, n);
+      continue;
+    }
+    if (p.count < 2) return false;
+    uint8_t length = p.buffer[1];
+    if (length > CHYAPPY_MAX_PAYLOAD) {
+      p.stats.lengthErrors++;
+      chyappyDrop(p, 1); // Rescan from the next start byte
+      continue;
+    }
+    uint16_t size = length + CHYAPPY_OVERHEAD;
+    if (p.count < size) return false;
+    if (chyappyCheckCrc(p.buffer, length)) {
+      p.frameSize = size;
+      return true;
+    }
+    p.stats.crcErrors++;
+    chyappyDrop(p, 1); // Rescan from the next start byte
+  }
+  return false;
+}
+
+// Feeds one received byte. Returns true and fills `frame` when it completes
+// a frame.
+inline bool chyappyFeed(ChYAPpyParser& p, uint8_t byte, ChYAPpyFrame& frame) {
+  if (p.frameSize) {
+    chyappyDrop(p, p.frameSize);
+    p.frameSize = 0;
+  }
+  p.buffer[p.count++] = byte;
+  if (!chyappyScan(p)) return false;
+
+  uint8_t* f = p.buffer;
+  frame.sensorType = f[2];
+  frame.sensorId = f[3];
+  frame.seqNum = (f[4] << 8) | f[5];
+  frame.payloadType = f[6];
+  frame.length = f[1];
+  f[7 + frame.length] = '\0';
+  frame.payload = (const char*)(f + 7);
+  p.stats.frames++;
+  return true;
+}
+
+#endif
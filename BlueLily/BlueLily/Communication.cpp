@@ -1,6 +1,9 @@
 #include <SPI.h>
 #include "Communication.h"
 #include "Configurator.h" // For passing received data
+#include "Bus.h"
+#include "Hal.h"
+#include "SampleRing.h"
 
 #if ENABLE_LORA
 #include <LoRa.h>
@@ -10,48 +13,31 @@ LoRaClass LoRaModule;
 #if ENABLE_CANBUS
 #include <mcp_canbus.h>
 MCP_CAN CAN(CAN_CS_PIN);
+static void startCANReceive();
 #endif
 
 #if ENABLE_RS485
 #define rs485 Serial2
 #endif
 
-// chYAPpy v1.2 CRC-8
+#if ENABLE_RS485
+// Frames are queued in the UART's software TX buffer and sent from its
+// interrupt. The core raises DE/RE on the first byte and drops it from the
+// transmit-complete interrupt once the buffer has drained, so back-to-back
+// frames share one DE assertion and the caller never waits.
+static uint8_t rs485TxMemory[RS485_TX_BUFFER_SIZE];
+static int rs485TxCapacity = 0;
+static RS485TxStats rs485TxStats;
+#define RS485_BYTE_US (10 * 1000000UL / RS485_BAUD) // 8N1
+#endif
+
 #if ENABLE_RS485 || ENABLE_LORA
-uint8_t crc8(const uint8_t* data, uint8_t len) {
-  uint8_t crc = 0;
-  for (uint8_t i = 0; i < len; i++) {
-    crc ^= data[i];
-    for (uint8_t j = 0; j < 8; j++) {
-      if (crc & 0x80) crc = (crc << 1) ^ 0x31;
-      else crc <<= 1;
-    }
-  }
-  return crc;
-}
-
-void sendChYAPpyV12(Stream& output, uint8_t sensorType, uint8_t sensorId, uint16_t seqNum, uint8_t payloadType, const uint8_t* payload, uint8_t length, bool useTxEnable = false) {
-  uint8_t message[length + 8];
-  message[0] = CHYAPPY_V1_2_START;
-  message[1] = length;
-  message[2] = sensorType;
-  message[3] = sensorId;
-  message[4] = seqNum >> 8;
-  message[5] = seqNum & 0xFF;
-  message[6] = payloadType;
-  for (uint8_t i = 0; i < length; i++) {
-    message[7 + i] = payload[i];
-  }
-  message[length + 7] = crc8(&message[1], length + 6);
-
-  if (useTxEnable) digitalWrite(RS485_TX_EN_PIN, HIGH);
-  delayMicroseconds(10);
-  output.write(message, length + 8);
-  output.flush();
-  if (useTxEnable) {
-    delayMicroseconds(10);
-    digitalWrite(RS485_TX_EN_PIN, LOW);
-  }
+// Returns the encoded size, 0 if the payload does not fit a frame
+static size_t encodeChYAPpyV12(uint8_t* message, uint8_t sensorType, uint8_t sensorId, uint16_t seqNum, uint8_t payloadType, const char* data) {
+  uint8_t length = (payloadType == PAYLOAD_TYPE_STRING) ? strlen(data) : (payloadType == PAYLOAD_TYPE_FLOAT ? 4 : 0);
+  size_t size = chyappyEncode(message, sensorType, sensorId, seqNum, payloadType, data, length);
+  if (!size) Serial.println("chYAPpy payload too long");
+  return size;
 }
 #endif
 
@@ -59,9 +45,10 @@ void initCommunication() {
   Serial.begin(115200);
 
 #if ENABLE_RS485
-  pinMode(RS485_TX_EN_PIN, OUTPUT);
-  digitalWrite(RS485_TX_EN_PIN, LOW);
   rs485.begin(RS485_BAUD);
+  rs485.transmitterEnable(RS485_TX_EN_PIN);
+  rs485.addMemoryForWrite(rs485TxMemory, sizeof(rs485TxMemory));
+  rs485TxCapacity = rs485.availableForWrite();
   Serial.println("RS485 Initialized");
 #endif
 
@@ -70,6 +57,7 @@ void initCommunication() {
     Serial.println("CAN BUS FAIL!");
     delay(100);
   }
+  startCANReceive();
   Serial.println("CAN BUS OK!");
 #endif
 
@@ -95,76 +83,174 @@ void initCommunication() {
 
 #if ENABLE_RS485
 void sendRS485(uint8_t sensorType, uint8_t sensorId, uint16_t seqNum, const char* data, uint8_t payloadType) {
-  uint8_t length = (payloadType == PAYLOAD_TYPE_STRING) ? strlen(data) : (payloadType == PAYLOAD_TYPE_FLOAT ? 4 : 0);
-  sendChYAPpyV12(rs485, sensorType, sensorId, seqNum, payloadType, (const uint8_t*)data, length, true);
+  uint8_t message[CHYAPPY_MAX_FRAME];
+  size_t size = encodeChYAPpyV12(message, sensorType, sensorId, seqNum, payloadType, data);
+  if (!size) return;
+
+  // Never block the loop: a frame that does not fit is dropped whole
+  int space = rs485.availableForWrite();
+  if (space < (int)size) {
+    rs485TxStats.dropped++;
+    return;
+  }
+  uint32_t queued = rs485TxCapacity - space + size;
+  if (queued > rs485TxStats.maxQueuedBytes) rs485TxStats.maxQueuedBytes = queued;
+  uint32_t latency = queued * RS485_BYTE_US; // Until the frame's last bit is on the wire
+  if (latency > rs485TxStats.maxLatencyUs) rs485TxStats.maxLatencyUs = latency;
+  rs485.write(message, size);
+  rs485TxStats.frames++;
 }
 
+RS485TxStats getRS485TxStats() {
+  return rs485TxStats;
+}
+
+static ChYAPpyParser rs485Parser;
+
 void receiveRS485() {
-  static uint8_t buffer[CONFIG_BUFFER_SIZE];
-  static uint8_t pos = 0;
-  while (rs485.available() && pos < CONFIG_BUFFER_SIZE) {
-    buffer[pos++] = rs485.read();
-    if (pos >= 8 && buffer[0] == CHYAPPY_V1_2_START) { // Minimum chYAPpy v1.2 size
-      uint8_t length = buffer[1];
-      if (pos >= length + 8) { // Full message received
-        uint8_t crc = crc8(&buffer[1], length + 6);
-        if (crc == buffer[length + 7]) {
-          uint8_t sensorType = buffer[2];
-          uint8_t sensorId = buffer[3];
-          uint16_t seqNum = (buffer[4] << 8) | buffer[5];
-          uint8_t payloadType = buffer[6];
-          char payload[CONFIG_BUFFER_SIZE];
-          memcpy(payload, &buffer[7], length);
-          payload[length] = '\0';
-
-          Serial.print("RS485 Parsed - Type: ");
-          Serial.print((char)sensorType);
-          Serial.print(", ID: ");
-          Serial.print(sensorId);
-          Serial.print(", Seq: ");
-          Serial.print(seqNum);
-          Serial.print(", Payload: ");
-          if (payloadType == PAYLOAD_TYPE_STRING) Serial.println(payload);
-          else if (payloadType == PAYLOAD_TYPE_FLOAT) Serial.println(*(float*)payload);
-
-          handleConfigCommand(METHOD_RS485, sensorType, sensorId, seqNum, payloadType, payload);
-          pos = 0; // Reset buffer
-        } else {
-          Serial.println("RS485 CRC Error");
-          pos = 0; // Reset on error
-        }
-      }
+  ChYAPpyFrame frame;
+  while (rs485.available()) {
+    if (chyappyFeed(rs485Parser, rs485.read(), frame)) {
+      handleConfigCommand(METHOD_RS485, frame.sensorType, frame.sensorId, frame.seqNum, frame.payloadType, frame.payload);
     }
   }
 }
 #endif
 
 #if ENABLE_CANBUS
-void sendCANBUS(uint32_t id, const uint8_t* data, uint8_t len) {
-  CAN.sendMsgBuf(id, 0, len, (unsigned char*)data);
+bool sendCANBUS(uint32_t id, const uint8_t* data, uint8_t len) {
+  busBegin(BUS_DEV_CAN, 0);
+  bool sent = CAN.sendMsgBuf(id, 0, len, (unsigned char*)data) == CAN_OK;
+  busEnd(BUS_DEV_CAN);
+  return sent;
+}
+
+// Received frames wait here for receiveCANBUS(). The ring overwrites the
+// oldest frame when full, which shows up as dropped frames on the cursor.
+static SampleRing<CanFrame, CAN_RX_QUEUE_SIZE> canRxQueue;
+static SampleCursor canRxCursor;
+static volatile uint32_t canReceived = 0;
+static uint32_t canDispatched = 0;
+static uint32_t canUnhandled = 0;
+
+// Sorted by ID for a binary search on dispatch
+struct CanSubscription {
+  uint32_t id;
+  CanHandler handler;
+};
+static CanSubscription canSubscriptions[CAN_MAX_SUBSCRIPTIONS];
+static uint8_t canSubscriptionCount = 0;
+static bool canStarted = false;
+
+#define CAN_HW_FILTERS 6 // RXF0-1 behind RXM0, RXF2-5 behind RXM1
+#define CAN_STD_MASK 0x7FF
+
+void queueCANFrame(const CanFrame& frame) {
+  canRxQueue.push(frame);
+  canReceived++;
+}
+
+// Empties both RX buffers. INT stays low until they are both read, so a
+// frame that lands during the loop is picked up by the same pass.
+static void drainCANController() {
+  while (CAN_MSGAVAIL == CAN.checkReceive()) {
+    CanFrame frame;
+    unsigned long id = 0;
+    CAN.readMsgBufID(&id, &frame.length, frame.data);
+    frame.id = id;
+    frame.timestampUs = halMicros();
+    queueCANFrame(frame);
+  }
+}
+
+#if CAN_INT_PIN >= 0
+static void canISR() {
+  drainCANController();
+}
+#endif
+
+// Exact-match filters while the subscribed IDs fit in the six hardware
+// filters, so other traffic never reaches the CPU. Unused filters repeat
+// the last ID. Beyond six the masks open and dispatch does the filtering.
+static void applyCANFilters() {
+  bool exact = canSubscriptionCount <= CAN_HW_FILTERS;
+  unsigned long mask = exact ? CAN_STD_MASK : 0;
+  CAN.init_Mask(0, 0, mask);
+  CAN.init_Mask(1, 0, mask);
+  for (uint8_t i = 0; i < CAN_HW_FILTERS; i++) {
+    uint8_t n = canSubscriptionCount ? min(i, (uint8_t)(canSubscriptionCount - 1)) : 0;
+    CAN.init_Filt(i, 0, canSubscriptionCount ? canSubscriptions[n].id : 0);
+  }
+}
+
+bool subscribeCAN(uint32_t id, CanHandler handler) {
+  if (canSubscriptionCount >= CAN_MAX_SUBSCRIPTIONS || !handler) return false;
+  uint8_t pos = 0;
+  while (pos < canSubscriptionCount && canSubscriptions[pos].id < id) pos++;
+  if (pos < canSubscriptionCount && canSubscriptions[pos].id == id) return false;
+  memmove(canSubscriptions + pos + 1, canSubscriptions + pos, (canSubscriptionCount - pos) * sizeof(CanSubscription));
+  canSubscriptions[pos] = {id, handler};
+  canSubscriptionCount++;
+  if (canStarted) {
+    busBegin(BUS_DEV_CAN, 0);
+    applyCANFilters();
+    busEnd(BUS_DEV_CAN);
+  }
+  return true;
+}
+
+static CanHandler findCANHandler(uint32_t id) {
+  int low = 0;
+  int high = canSubscriptionCount - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (canSubscriptions[mid].id == id) return canSubscriptions[mid].handler;
+    if (canSubscriptions[mid].id < id) low = mid + 1;
+    else high = mid - 1;
+  }
+  return nullptr;
+}
+
+static void startCANReceive() {
+  canRxQueue.reset();
+  canRxQueue.openCursor(canRxCursor);
+  applyCANFilters();
+  canStarted = true;
+#if CAN_INT_PIN >= 0
+  pinMode(CAN_INT_PIN, INPUT_PULLUP);
+  SPI.usingInterrupt(digitalPinToInterrupt(CAN_INT_PIN)); // Other SPI transactions hold off the ISR
+  attachInterrupt(digitalPinToInterrupt(CAN_INT_PIN), canISR, FALLING);
+  drainCANController(); // Frames received before attach would keep INT low
+#endif
 }
 
 void receiveCANBUS() {
-  unsigned char len = 0;
-  unsigned char buf[8];
-  unsigned long canId;
-  if (CAN_MSGAVAIL == CAN.checkReceive()) {
-    CAN.readMsgBuf(&len, buf);
-    canId = CAN.getCanId();
-    Serial.print("CAN Received - ID: 0x");
-    Serial.print(canId, HEX);
-    Serial.print(", Data: ");
-    for (int i = 0; i < len; i++) {
-      Serial.print(buf[i], HEX);
-      Serial.print(" ");
+#if CAN_INT_PIN < 0
+  if (busBegin(BUS_DEV_CAN, 0)) {
+    drainCANController();
+    busEnd(BUS_DEV_CAN);
+  }
+#endif
+  CanFrame frame;
+  while (canRxQueue.read(canRxCursor, frame)) {
+    CanHandler handler = findCANHandler(frame.id);
+    if (handler) {
+      handler(frame);
+      canDispatched++;
+    } else {
+      canUnhandled++;
     }
-    Serial.println();
-    char payload[CONFIG_BUFFER_SIZE];
-    memcpy(payload, buf, len);
-    payload[len] = '\0';
-    handleConfigCommand(METHOD_CANBUS, 0, 0, 0, PAYLOAD_TYPE_STRING, payload); // No chYAPpy for CAN
   }
 }
+
+CanRxStats getCanRxStats() {
+  CanRxStats stats;
+  stats.received = canReceived;
+  stats.dispatched = canDispatched;
+  stats.unhandled = canUnhandled;
+  stats.overruns = canRxCursor.dropped;
+  return stats;
+}
 #endif
 
 #if ENABLE_BLUETOOTH
@@ -192,49 +278,76 @@ void receiveBluetooth() {
 
 #if ENABLE_LORA
 void sendLoRa(uint8_t sensorType, uint8_t sensorId, uint16_t seqNum, const char* data, uint8_t payloadType) {
+  uint8_t message[CHYAPPY_MAX_FRAME];
+  size_t size = encodeChYAPpyV12(message, sensorType, sensorId, seqNum, payloadType, data);
+  if (!size) return;
   LoRaModule.beginPacket();
-  uint8_t length = (payloadType == PAYLOAD_TYPE_STRING) ? strlen(data) : (payloadType == PAYLOAD_TYPE_FLOAT ? 4 : 0);
-  sendChYAPpyV12(LoRaModule, sensorType, sensorId, seqNum, payloadType, (const uint8_t*)data, length, false);
+  LoRaModule.write(message, size);
   LoRaModule.endPacket();
 }
 
+static ChYAPpyParser loraParser;
+
 void receiveLoRa() {
-  int packetSize = LoRaModule.parsePacket();
-  if (packetSize) {
-    static uint8_t buffer[CONFIG_BUFFER_SIZE];
-    uint8_t pos = 0;
-    while (LoRaModule.available() && pos < CONFIG_BUFFER_SIZE) {
-      buffer[pos++] = LoRaModule.read();
-    }
-    if (pos >= 8 && buffer[0] == CHYAPPY_V1_2_START) {
-      uint8_t length = buffer[1];
-      if (pos >= length + 8) {
-        uint8_t crc = crc8(&buffer[1], length + 6);
-        if (crc == buffer[length + 7]) {
-          uint8_t sensorType = buffer[2];
-          uint8_t sensorId = buffer[3];
-          uint16_t seqNum = (buffer[4] << 8) | buffer[5];
-          uint8_t payloadType = buffer[6];
-          char payload[CONFIG_BUFFER_SIZE];
-          memcpy(payload, &buffer[7], length);
-          payload[length] = '\0';
-
-          Serial.print("LoRa Parsed - Type: ");
-          Serial.print((char)sensorType);
-          Serial.print(", ID: ");
-          Serial.print(sensorId);
-          Serial.print(", Seq: ");
-          Serial.print(seqNum);
-          Serial.print(", Payload: ");
-          if (payloadType == PAYLOAD_TYPE_STRING) Serial.println(payload);
-          else if (payloadType == PAYLOAD_TYPE_FLOAT) Serial.println(*(float*)payload);
-
-          handleConfigCommand(METHOD_LORA, sensorType, sensorId, seqNum, payloadType, payload);
-        } else {
-          Serial.println("LoRa CRC Error");
-        }
-      }
+  if (!LoRaModule.parsePacket()) return;
+  ChYAPpyFrame frame;
+  while (LoRaModule.available()) {
+    if (chyappyFeed(loraParser, LoRaModule.read(), frame)) {
+      handleConfigCommand(METHOD_LORA, frame.sensorType, frame.sensorId, frame.seqNum, frame.payloadType, frame.payload);
     }
   }
 }
-#endif
\ No newline at end of file
+#endif
+
+ChYAPpyStats getChYAPpyStats(uint8_t method) {
+  ChYAPpyStats none = {};
+#if ENABLE_RS485
+  if (method == METHOD_RS485) return rs485Parser.stats;
+#endif
+#if ENABLE_LORA
+  if (method == METHOD_LORA) return loraParser.stats;
+#endif
+  return none;
+}
+
+void printLinkStats() {
+  // Format: LINK,name,frames,crc_errors,length_errors,dropped_bytes
+  const uint8_t methods[] = {METHOD_RS485, METHOD_LORA};
+  const char* const names[] = {"rs485", "lora"};
+  for (uint8_t i = 0; i < 2; i++) {
+    ChYAPpyStats stats = getChYAPpyStats(methods[i]);
+    Serial.print("LINK,");
+    Serial.print(names[i]);
+    Serial.print(",");
+    Serial.print(stats.frames);
+    Serial.print(",");
+    Serial.print(stats.crcErrors);
+    Serial.print(",");
+    Serial.print(stats.lengthErrors);
+    Serial.print(",");
+    Serial.println(stats.droppedBytes);
+  }
+#if ENABLE_RS485
+  // Format: RS485TX,frames,dropped,max_queued_bytes,max_latency_us
+  Serial.print("RS485TX,");
+  Serial.print(rs485TxStats.frames);
+  Serial.print(",");
+  Serial.print(rs485TxStats.dropped);
+  Serial.print(",");
+  Serial.print(rs485TxStats.maxQueuedBytes);
+  Serial.print(",");
+  Serial.println(rs485TxStats.maxLatencyUs);
+#endif
+#if ENABLE_CANBUS
+  // Format: CANRX,received,dispatched,unhandled,overruns
+  CanRxStats can = getCanRxStats();
+  Serial.print("CANRX,");
+  Serial.print(can.received);
+  Serial.print(",");
+  Serial.print(can.dispatched);
+  Serial.print(",");
+  Serial.print(can.unhandled);
+  Serial.print(",");
+  Serial.println(can.overruns);
+#endif
+}
@@ -3,10 +3,22 @@
 
 #include <Arduino.h>
 #include "Config.h"
+#include "ChYAPpy.h"
 
 void initCommunication();
+ChYAPpyStats getChYAPpyStats(uint8_t method); // Parser counters for METHOD_RS485 / METHOD_LORA
+void printLinkStats(); // One LINK line per chYAPpy link on Serial
+
+// Asynchronous RS485 transmit queue
+struct RS485TxStats {
+  uint32_t frames;
+  uint32_t dropped;        // Frames that did not fit in the TX buffer
+  uint32_t maxQueuedBytes; // Deepest TX buffer after queueing a frame
+  uint32_t maxLatencyUs;   // Worst queue-to-last-bit time at the line rate
+};
 
 #if ENABLE_RS485
+RS485TxStats getRS485TxStats();
 void sendRS485(uint8_t sensorType, uint8_t sensorId, uint16_t seqNum, const char* data, uint8_t payloadType = PAYLOAD_TYPE_STRING);
 void receiveRS485();
 #else
@@ -14,12 +26,39 @@ inline void sendRS485(uint8_t, uint8_t, uint16_t, const char*, uint8_t = PAYLOAD
 inline void receiveRS485() {}
 #endif
 
+// CAN receive: frames are drained from both MCP2515 RX buffers (from the
+// INT pin interrupt, or polled when CAN_INT_PIN is -1) into a queue, and
+// receiveCANBUS() dispatches them by ID to the subscribed handlers.
+struct CanFrame {
+  uint32_t id;
+  uint32_t timestampUs;
+  uint8_t length;
+  uint8_t data[8];
+};
+
+typedef void (*CanHandler)(const CanFrame& frame);
+
+struct CanRxStats {
+  uint32_t received;   // Frames taken from the controller
+  uint32_t dispatched; // Frames passed to a handler
+  uint32_t unhandled;  // Frames with no subscribed handler
+  uint32_t overruns;   // Frames lost because the queue was full
+};
+
 #if ENABLE_CANBUS
-void sendCANBUS(uint32_t id, const uint8_t* data, uint8_t len);
+bool sendCANBUS(uint32_t id, const uint8_t* data, uint8_t len); // False with all three TX buffers pending
 void receiveCANBUS();
+// Adds a handler for a standard ID and reprograms the acceptance filters.
+// Returns false when the table is full or the ID is already taken.
+bool subscribeCAN(uint32_t id, CanHandler handler);
+void queueCANFrame(const CanFrame& frame); // Receive path entry, also for feeding a virtual bus
+CanRxStats getCanRxStats();
 #else
-inline void sendCANBUS(uint32_t, const uint8_t*, uint8_t) {}
+inline bool sendCANBUS(uint32_t, const uint8_t*, uint8_t) { return false; }
 inline void receiveCANBUS() {}
+inline bool subscribeCAN(uint32_t, CanHandler) { return false; }
+inline void queueCANFrame(const CanFrame&) {}
+inline CanRxStats getCanRxStats() { return CanRxStats(); }
 #endif
 
 #if ENABLE_BLUETOOTH
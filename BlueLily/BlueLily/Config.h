@@ -9,18 +9,26 @@
 // Sensor Pins and Addresses
 #if ENABLE_ADS1115
 #define ADS1115_I2C_ADDR 0x48
+#define ADS1115_ALERT_PIN -1 // ALERT/RDY pin, -1 = poll on conversion time
 #endif
 #if ENABLE_MPU6500
 #define MPU6500_I2C_ADDR 0x68
+#define MPU6500_USE_FIFO 1 // 1 = 1 kHz hardware FIFO drained in bursts, 0 = poll one sample per read
 #endif
 #if ENABLE_MAX31855
 #define MAX31855_CS_PIN 10
 #endif
 
 // Communication Enable/Disable Flags
+#ifndef ENABLE_RS485
 #define ENABLE_RS485    1
+#endif
+#ifndef ENABLE_CANBUS
 #define ENABLE_CANBUS   1
+#endif
+#ifndef ENABLE_BLUETOOTH
 #define ENABLE_BLUETOOTH 1
+#endif
 #define ENABLE_LORA     0
 
 // Communication Pins
@@ -31,6 +39,9 @@
 #endif
 #if ENABLE_CANBUS
 #define CAN_CS_PIN 9
+#ifndef CAN_INT_PIN
+#define CAN_INT_PIN -1 // MCP2515 INT pin, -1 = poll the controller from the comms task
+#endif
 #endif
 #if ENABLE_BLUETOOTH
 #define BLUETOOTH_RX_PIN 0
@@ -45,9 +56,27 @@
 // Communication Settings
 #if ENABLE_RS485
 #define RS485_BAUD 115200
+#define RS485_TX_BUFFER_SIZE 512 // Added to the UART TX buffer; frames queue here instead of blocking
 #endif
 #if ENABLE_CANBUS
 #define CANBUS_BAUD CAN_500KBPS
+#define CAN_RX_QUEUE_SIZE 32       // Received frames awaiting dispatch, power of two
+#define CAN_MAX_SUBSCRIPTIONS 8    // IDs with a handler; up to 6 are filtered by the MCP2515
+#define CAN_CONFIG_ID 0x100        // Segmented requests to BlueLily, see CanTransport.h
+#define CAN_RESPONSE_ID 0x101      // Segmented replies and log pages from BlueLily
+#define ISOTP_MAX_MESSAGE 1024     // Longest segmented message either way (<= 4095)
+#define ISOTP_BLOCK_SIZE 8         // Frames a sender may send per flow control frame, 0 = no limit
+#if CAN_INT_PIN >= 0
+#define ISOTP_ST_MIN 0             // Gap requested between a sender's frames (0-127 ms)
+#else
+#define ISOTP_ST_MIN 1             // Polled: one frame per ISOTP_POLL_US, or the two RX buffers overflow
+#endif
+#define ISOTP_TIMEOUT_MS 1000      // Transfer abandoned after this long without a frame
+#define ISOTP_POLL_US 1000         // Controller poll period while the transport has nothing to send
+#define ISOTP_FRAMES_PER_POLL 3    // One per MCP2515 TX buffer; a refused frame waits for the next pass
+#define CANBUS_BITRATE 500000UL    // Must match CANBUS_BAUD
+#define ENABLE_CAN_TELEMETRY 1     // Periodic IMU/state/temperature/ADC frames, see CanDbc.h
+#define CAN_BUS_LOAD_BUDGET_PERCENT 30 // Build fails if the telemetry table needs more
 #endif
 #if ENABLE_BLUETOOTH
 #define BLUETOOTH_BAUD 9600
@@ -67,12 +96,11 @@
 
 // Configurator Constants
 #define CONFIG_BUFFER_SIZE 64
-#define MAX_SETTINGS 10
-#define KEY_MAX_LEN 16
-#define VALUE_MAX_LEN 32
 
 // Logger Enable/Disable Flags
+#ifndef ENABLE_SD
 #define ENABLE_SD       1
+#endif
 #define ENABLE_W25Q128  1
 
 // Logger Settings
@@ -84,6 +112,21 @@
 #if ENABLE_W25Q128
 #define W25Q128_CS_PIN 25
 #define W25Q128_CAPACITY 16777216
+#define FLASH_LOG_START 0                  // Start of the log region (sector aligned)
+#define CONFIG_STORE_START (W25Q128_CAPACITY - 2 * 4096) // Config slots A and B, one sector each
+#ifndef FLASH_LOG_SIZE // The host tests use a small log to exercise the wrap
+#define FLASH_LOG_SIZE CONFIG_STORE_START  // Log region size (multiple of 4 KB)
+#endif
+#ifndef FLASH_LOG_CIRCULAR
+#define FLASH_LOG_CIRCULAR 0               // 1 = overwrite the oldest sector when full (~10 min at 27 KB/s)
+#endif
+#define FLASH_LOG_PAGE_QUEUE 16            // Full pages buffered while the chip is busy
+#define FLASH_ERASE_AHEAD_SECTORS 2        // Sectors kept erased ahead of the write head
+#endif
+#if ENABLE_SD && ENABLE_W25Q128
+#define FLASH_SYNC_BUDGET_US 500           // Max time per loop spent copying flash pages to SD
+#define FLASH_SYNC_FLUSH_MS 1000           // How often the SD image size is committed
+#define FLASH_SYNC_REPORT_MS 1000          // Progress report interval while catching up
 #endif
 
 // Actuation Enable/Disable Flag
@@ -119,7 +162,9 @@ const uint8_t ACTUATOR_COUNT =
 #endif
 
 // HID Enable/Disable Flag
+#ifndef ENABLE_HID
 #define ENABLE_HID 1
+#endif
 
 // HID Pins
 #if ENABLE_HID
@@ -132,8 +177,53 @@ const uint8_t ACTUATOR_COUNT =
 #define LED_4_PIN 36  // Blue
 #endif
 
+// HID Display Settings
+#if ENABLE_HID
+#define SCREEN_WIDTH 128
+#define SCREEN_HEIGHT 64
+#define SCREEN_ADDRESS 0x3C
+#define OLED_CHUNK_BYTES 31        // Framebuffer bytes per I2C transaction: with the control byte, fills the Wire buffer
+#define OLED_FLUSH_PERIOD_US 2000  // One chunk per period while a frame is being sent
+#define HID_FLIGHT_REFRESH_MS 0    // Default hidFlightRefreshMs, 0 = only on state changes
+#endif
+
 // Timing
-#define LOOP_INTERVAL_MS 50
+#define LOOP_INTERVAL_MS 50      // Flight controller task period
+#define HID_REFRESH_MS 50        // Display/input task period
+#define COMMS_POLL_MS 5          // Link receive task period
+#define CONFIG_STORE_POLL_MS 10  // Config commit task period
+#define SCHEDULER_MAX_TASKS 16
+
+// Bus Arbiter Settings (see Bus.h)
+#define BUS_STARVATION_US 20000   // A deferred transfer is granted anyway after this long
+#define BUS_I2C_BYTE_US 23        // One byte plus ACK at 400 kHz
+#define BUS_ADC_TRANSFER_US 300   // ADS1115 result read plus mux write
+#define BUS_FLASH_PAGE_US 100     // 256-byte W25Q128 page over SPI
+
+// Profiler Enable/Disable Flag. Cycle-count probes around the module
+// entry points, see Profiler.h.
+#define ENABLE_PROFILER 1
+
+// ADS1115 Continuous Conversion Settings
+#if ENABLE_ADS1115
+#define ADS1115_DATA_RATE RATE_ADS1115_860SPS
+#define ADS1115_CONVERSION_US 1300           // 1/860SPS plus oscillator tolerance
+#ifndef ADS1115_CHANNEL_RATES
+#define ADS1115_CHANNEL_RATES {50, 50, 50, 50} // Hz per channel, 0 = channel off
+#endif
+#endif
+
+// MPU6500 FIFO Settings
+#if ENABLE_MPU6500
+#define MPU6500_FIFO_RATE_HZ 1000
+#define MPU6500_FIFO_BURST_BYTES 24 // Multiple of 12 that fits the Wire buffer
+#endif
+
+// Sampling Engine Settings
+#define SAMPLE_RATE_IMU_HZ   100  // IMU read rate, or FIFO drain rate when MPU6500_USE_FIFO
+#define SAMPLE_RATE_TEMP_HZ  10
+#define SAMPLE_RATE_ADC_HZ   20
+#define SAMPLE_RING_CAPACITY 256 // Must be a power of two
 
 #endif
 
@@ -141,9 +231,22 @@ const uint8_t ACTUATOR_COUNT =
 #define ENABLE_FLIGHTCONTROLLER 1
 
 // ROS2 Bridge Enable/Disable Flag
+#ifndef ENABLE_ROS2_BRIDGE
 #define ENABLE_ROS2_BRIDGE 1
+#endif
 
 // ROS2 Bridge Settings
 #if ENABLE_ROS2_BRIDGE
 #define ROS2_PUBLISH_RATE_MS 10  // 100Hz IMU publishing
-#endif
\ No newline at end of file
+#define ROS2_BINARY_MODE 0       // 1 = packed binary frames (see ROS2Frame.h), 0 = CSV text
+#endif
+// Software-in-the-loop Simulation Enable/Disable Flag. Replaces the sensors
+// and the clock with a simulated flight, see Simulation.h. The host build
+// (Testing/Host) sets it from the compiler command line.
+#ifndef ENABLE_SIMULATION
+#define ENABLE_SIMULATION 0
+#endif
+
+#if ENABLE_SIMULATION
+#define SIM_STEP_US 1000 // Virtual time advanced per loop iteration
+#endif
@@ -0,0 +1,292 @@
+#include "ConfigStore.h"
+#include "Settings.h"
+#include "FlightController.h"
+#include "Hal.h"
+#include "Bus.h"
+#include "Crc.h"
+#if ENABLE_SD
+#include <SdFat.h>
+#endif
+
+#define CONFIG_BLOB_MAGIC 0x46434C42UL // "BLCF"
+#define CONFIG_BLOB_VERSION 1
+#define CONFIG_BLOB_MAX_SIZE 256       // One flash page
+#define CONFIG_SLOT_SIZE 4096
+
+struct __attribute__((packed)) ConfigBlobHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t generation;
+  uint32_t crc;
+};
+
+struct __attribute__((packed)) ConfigBlobEntry {
+  uint32_t keyHash;
+  float value;
+};
+
+#define CONFIG_MAX_ENTRIES ((CONFIG_BLOB_MAX_SIZE - sizeof(ConfigBlobHeader)) / sizeof(ConfigBlobEntry))
+
+struct ConfigBlob {
+  ConfigBlobHeader header;
+  ConfigBlobEntry entries[CONFIG_MAX_ENTRIES];
+};
+
+static_assert(sizeof(ConfigBlob) <= CONFIG_BLOB_MAX_SIZE, "ConfigBlob must fit a flash page");
+
+enum CommitStep : uint8_t {
+  COMMIT_IDLE = 0,
+  COMMIT_ERASE,
+  COMMIT_PROGRAM,
+  COMMIT_VERIFY
+};
+
+static ConfigBlob blob; // Being committed
+static ConfigStoreStats stats;
+static bool commitPending = false;
+static CommitStep step = COMMIT_IDLE;
+static int8_t targetSlot = 0;
+#if ENABLE_W25Q128
+static bool flashReady = false;
+#endif
+
+static uint32_t keyHash(const char* key) {
+  return settingHash(key, settingKeyLength(key), 0);
+}
+
+static size_t blobSize(const ConfigBlob& b) {
+  return sizeof(ConfigBlobHeader) + b.header.count * sizeof(ConfigBlobEntry);
+}
+
+static uint32_t blobCrc(const ConfigBlob& b) {
+  uint32_t crc = crc32((const uint8_t*)&b.header, offsetof(ConfigBlobHeader, crc));
+  return crc32((const uint8_t*)b.entries, b.header.count * sizeof(ConfigBlobEntry), crc);
+}
+
+static bool blobValid(const ConfigBlob& b) {
+  return b.header.magic == CONFIG_BLOB_MAGIC && b.header.version == CONFIG_BLOB_VERSION &&
+         b.header.count <= CONFIG_MAX_ENTRIES && blobCrc(b) == b.header.crc;
+}
+
+static void buildBlob(uint32_t generation) {
+  uint8_t count = min(getSettingCount(), (uint8_t)CONFIG_MAX_ENTRIES);
+  blob.header.magic = CONFIG_BLOB_MAGIC;
+  blob.header.version = CONFIG_BLOB_VERSION;
+  blob.header.count = count;
+  blob.header.generation = generation;
+  for (uint8_t i = 0; i < count; i++) {
+    blob.entries[i].keyHash = keyHash(getSetting(i)->key);
+    blob.entries[i].value = readSetting(i);
+  }
+  blob.header.crc = blobCrc(blob);
+}
+
+// Values go through setSetting(), so out-of-range entries keep the default
+static void applyBlob(const ConfigBlob& b) {
+  uint8_t count = getSettingCount();
+  uint32_t hashes[SETTING_NONE];
+  for (uint8_t i = 0; i < count; i++) hashes[i] = keyHash(getSetting(i)->key);
+  for (uint16_t e = 0; e < b.header.count; e++) {
+    for (uint8_t i = 0; i < count; i++) {
+      if (hashes[i] != b.entries[e].keyHash) continue;
+      setSetting(i, b.entries[e].value);
+      break;
+    }
+  }
+}
+
+#if ENABLE_W25Q128
+static uint32_t slotAddress(int8_t slot) {
+  return CONFIG_STORE_START + slot * CONFIG_SLOT_SIZE;
+}
+
+static bool readSlot(int8_t slot, ConfigBlob& b) {
+  halFlash.read(slotAddress(slot), &b, sizeof(b));
+  return blobValid(b);
+}
+#endif
+
+#if ENABLE_SD
+static bool readSDMirror(ConfigBlob& b) {
+  FsFile file;
+  if (!file.open("config.bin", O_READ)) return false;
+  int length = file.read((uint8_t*)&b, sizeof(b));
+  file.close();
+  return length >= (int)sizeof(ConfigBlobHeader) && blobValid(b);
+}
+
+static void writeSDMirror(const ConfigBlob& b) {
+  FsFile file;
+  if (!file.open("config.bin", O_RDWR | O_CREAT | O_TRUNC)) {
+    Serial.println("Config SD mirror write failed");
+    return;
+  }
+  file.write((const uint8_t*)&b, blobSize(b));
+  file.close();
+}
+
+// settings.txt written by the HID before the config store: one "NAME=0|1"
+// line per hardware toggle
+static const char* const legacyKeys[][2] = {
+  {"MAX31855", "en_max31855"}, {"MPU6500", "en_mpu6500"}, {"ADS1115", "en_ads1115"},
+  {"RS485", "en_rs485"},       {"CANBUS", "en_canbus"},   {"Bluetooth", "en_bluetooth"},
+  {"LoRa", "en_lora"},         {"SD", "en_sd"},           {"W25Q128", "en_w25q128"},
+  {"Relay0", "en_relay0"},     {"PWM1", "en_pwm1"}
+};
+
+// Applies a legacy settings.txt, returns true if it set anything
+static bool migrateLegacySettings() {
+  FsFile file;
+  if (!file.open("settings.txt", O_READ)) return false;
+  char line[32];
+  bool migrated = false;
+  while (file.available()) {
+    if (file.fgets(line, sizeof(line)) <= 0) break;
+    const char* equals = strchr(line, '=');
+    if (!equals) continue;
+    size_t nameLength = equals - line;
+    for (const auto& key : legacyKeys) {
+      if (strlen(key[0]) != nameLength || strncmp(line, key[0], nameLength)) continue;
+      const char* value = equals[1] == '1' ? "1" : "0";
+      if (setSettingText(key[1], strlen(key[1]), value) == SETTING_OK) migrated = true;
+      break;
+    }
+  }
+  file.close();
+  return migrated;
+}
+#endif
+
+void initConfigStore() {
+  uint32_t start = halMicros();
+  if (getSettingCount() > CONFIG_MAX_ENTRIES) Serial.println("Config blob too small, some settings won't persist");
+  memset(&stats, 0, sizeof(stats));
+  stats.slot = -1;
+  ConfigBlob candidate;
+  bool loaded = false;
+
+#if ENABLE_W25Q128
+  flashReady = halFlash.begin();
+  if (flashReady) {
+    for (int8_t slot = 0; slot < 2; slot++) {
+      if (!readSlot(slot, candidate)) continue;
+      if (loaded && (int32_t)(candidate.header.generation - stats.generation) <= 0) continue;
+      blob = candidate;
+      stats.generation = candidate.header.generation;
+      stats.slot = slot;
+      loaded = true;
+    }
+  }
+#endif
+#if ENABLE_SD
+  if (!loaded && readSDMirror(candidate)) {
+    blob = candidate;
+    stats.generation = candidate.header.generation;
+    loaded = true;
+    commitPending = true; // Restore the flash copy
+  }
+  if (!loaded && migrateLegacySettings()) {
+    Serial.println("Config migrated from settings.txt");
+    commitPending = true;
+  }
+#endif
+
+  if (loaded) applyBlob(blob);
+  stats.loadUs = halMicros() - start;
+  Serial.print("Config loaded: generation ");
+  Serial.print(stats.generation);
+  Serial.print(" in ");
+  Serial.print(stats.loadUs);
+  Serial.println(" us");
+}
+
+void requestConfigCommit() {
+  commitPending = true;
+}
+
+bool configCommitIdle() {
+  return !commitPending && step == COMMIT_IDLE;
+}
+
+static bool inFlight() {
+  FlightState state = getFlightState();
+  return state != IDLE && state != LANDED;
+}
+
+static void finishCommit(bool ok) {
+  step = COMMIT_IDLE;
+  if (!ok) {
+    stats.failures++;
+    Serial.println("Config commit failed");
+    return;
+  }
+  stats.commits++;
+  stats.generation = blob.header.generation;
+  stats.slot = targetSlot;
+#if ENABLE_SD
+  writeSDMirror(blob);
+#endif
+}
+
+void updateConfigStore() {
+  if (step == COMMIT_IDLE) {
+    if (!commitPending || inFlight()) return;
+    commitPending = false;
+    // The snapshot is the commit point: later changes wait for the next one
+    buildBlob(stats.generation + 1);
+#if ENABLE_W25Q128
+    if (!flashReady) {
+      finishCommit(true);
+      return;
+    }
+    targetSlot = stats.slot == 0 ? 1 : 0; // Never overwrite the newest blob
+    step = COMMIT_ERASE;
+#else
+    finishCommit(true);
+    return;
+#endif
+  }
+
+#if ENABLE_W25Q128
+  // One flash operation per call, shared with the flash log
+  if (halFlash.busy() || !busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US)) return;
+  switch (step) {
+    case COMMIT_ERASE:
+      halFlash.eraseSector(slotAddress(targetSlot));
+      step = COMMIT_PROGRAM;
+      break;
+    case COMMIT_PROGRAM:
+      halFlash.program(slotAddress(targetSlot), &blob, blobSize(blob));
+      step = COMMIT_VERIFY;
+      break;
+    case COMMIT_VERIFY: {
+      ConfigBlob check;
+      bool ok = readSlot(targetSlot, check) && check.header.generation == blob.header.generation;
+      finishCommit(ok);
+      break;
+    }
+    default:
+      break;
+  }
+  busEnd(BUS_DEV_FLASH);
+#endif
+}
+
+ConfigStoreStats getConfigStoreStats() {
+  return stats;
+}
+
+void printConfigStoreStats() {
+  // Format: CONFIG,generation,slot,load_us,commits,failures
+  Serial.print("CONFIG,");
+  Serial.print(stats.generation);
+  Serial.print(",");
+  Serial.print(stats.slot);
+  Serial.print(",");
+  Serial.print(stats.loadUs);
+  Serial.print(",");
+  Serial.print(stats.commits);
+  Serial.print(",");
+  Serial.println(stats.failures);
+}
@@ -0,0 +1,44 @@
+#ifndef CONFIGSTORE_H
+#define CONFIGSTORE_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Persistent copy of the settings registry (Settings.h).
+//
+// The values are kept as one binary blob, CRC-protected, in two reserved
+// W25Q128 sectors (slots A and B) after the log region, with a copy in
+// config.bin on the SD card:
+//   header:  magic "BLCF" (u32) | version (u16) | entry count (u16) |
+//            generation (u32) | CRC-32 (u32) over everything but itself
+//   entries: key hash (u32, FNV-1a of the key) | value (float32)
+//
+// A commit snapshots every setting, erases the slot that does not hold the
+// newest blob, programs the new blob with a higher generation and reads it
+// back. The previous blob is untouched until the new one verifies, so a
+// power cut at any point leaves one valid copy. At boot the valid slot
+// with the highest generation is loaded (the SD copy if neither is valid,
+// or else the hardware toggles of a legacy settings.txt, which are then
+// committed as the first blob).
+// Keys missing from the blob keep their defaults and unknown keys are
+// skipped, so blobs survive settings being added or removed.
+//
+// Commits run in steps from updateConfigStore() and wait while the flight
+// is in progress, so a sector erase never stalls the flight log.
+
+struct ConfigStoreStats {
+  uint32_t generation; // Of the blob in use, 0 = defaults
+  int8_t slot;         // Flash slot it came from, -1 = none (SD or defaults)
+  uint32_t loadUs;     // Boot load time
+  uint32_t commits;
+  uint32_t failures;   // Commits that failed read-back
+};
+
+void initConfigStore(); // Loads the newest valid blob; call after initLogger()
+void requestConfigCommit(); // Saves the current settings at the next opportunity
+void updateConfigStore(); // Scheduler task, advances a pending commit
+bool configCommitIdle();
+ConfigStoreStats getConfigStoreStats();
+void printConfigStoreStats(); // CONFIG line on Serial
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CRC_H
+#define CRC_H
+
+// Table-driven CRCs used by the wire and storage formats. Tables are built
+// at compile time and live in flash. Only depends on the C standard
+// library, so host-side tools can include it alongside ROS2Frame.h and
+// ChYAPpy.h.
+//
+//   crc8()        CRC-8, poly 0x31, init 0, no reflection (chYAPpy v1.2)
+//   crc16Ccitt()  CRC-16/CCITT-FALSE, poly 0x1021, init 0xFFFF (ROS2 frames, flash log pages)
+//   crc32()       CRC-32 (IEEE 802.3, reflected), init/xorout 0xFFFFFFFF
+//
+// crc8() runs slice-by-4: four table lookups per 32-bit word instead of one
+// dependent lookup per byte. Each function takes the running CRC so data
+// can be processed in pieces.
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Crc8Tables {
+  // t[k][x] = CRC of byte x followed by k zero bytes
+  uint8_t t[4][256];
+  constexpr Crc8Tables() : t() {
+    for (int x = 0; x < 256; x++) {
+      uint8_t crc = x;
+      for (int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+      t[0][x] = crc;
+    }
+    for (int k = 1; k < 4; k++) {
+      for (int x = 0; x < 256; x++) t[k][x] = t[0][t[k - 1][x]];
+    }
+  }
+};
+
+struct Crc16Table {
+  uint16_t t[256];
+  constexpr Crc16Table() : t() {
+    for (int x = 0; x < 256; x++) {
+      uint16_t crc = x << 8;
+      for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      t[x] = crc;
+    }
+  }
+};
+
+struct Crc32Table {
+  uint32_t t[256];
+  constexpr Crc32Table() : t() {
+    for (uint32_t x = 0; x < 256; x++) {
+      uint32_t crc = x;
+      for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+      t[x] = crc;
+    }
+  }
+};
+
+inline constexpr Crc8Tables CRC8_TABLES{};
+inline constexpr Crc16Table CRC16_TABLE{};
+inline constexpr Crc32Table CRC32_TABLE{};
+
+inline uint8_t crc8(const uint8_t* data, size_t length, uint8_t crc = 0) {
+  const auto& t = CRC8_TABLES.t;
+  for (; length >= 4; length -= 4, data += 4) {
+    crc = t[3][data[0] ^ crc] ^ t[2][data[1]] ^ t[1][data[2]] ^ t[0][data[3]];
+  }
+  while (length--) crc = t[0][*data++ ^ crc];
+  return crc;
+}
+
+inline uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+  while (length--) crc = (crc << 8) ^ CRC16_TABLE.t[(crc >> 8) ^ *data++];
+  return crc;
+}
+
+// Pass the previous return value to continue a CRC over several pieces
+inline uint32_t crc32(const uint8_t* data, size_t length, uint32_t previous = 0) {
+  uint32_t crc = ~previous;
+  while (length--) crc = (crc >> 8) ^ CRC32_TABLE.t[(crc ^ *data++) & 0xFF];
+  return ~crc;
+}
+
+#endif
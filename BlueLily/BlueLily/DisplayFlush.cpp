@@ -0,0 +1,129 @@
+#include "DisplayFlush.h"
+
+#if ENABLE_HID
+#include <Wire.h>
+#include "Profiler.h"
+#include "Bus.h"
+
+#define SSD1306_COLUMN_ADDR 0x21
+#define SSD1306_PAGE_ADDR 0x22
+
+static const uint8_t* frame = nullptr;
+static uint8_t shown[OLED_PAGES * SCREEN_WIDTH]; // What the panel displays
+static DisplayFlushStats stats;
+
+// Span being sent: columns [column, lastColumn] of `page`
+static bool inFlight = false;
+static bool spanOpen = false;
+static uint8_t page = 0;
+static uint8_t column = 0;
+static uint8_t lastColumn = 0;
+static uint32_t frameBytes = 0;
+
+static void wireWrite(uint8_t control, const uint8_t* bytes, uint8_t length) {
+  Wire.beginTransmission(SCREEN_ADDRESS);
+  Wire.write(control);
+  Wire.write(bytes, length);
+  Wire.endTransmission();
+}
+
+static void wireCommand(const uint8_t* bytes, uint8_t length) {
+  wireWrite(0x00, bytes, length);
+}
+
+static void wireData(const uint8_t* bytes, uint8_t length) {
+  wireWrite(0x40, bytes, length);
+}
+
+static DisplayTransport transport = {wireCommand, wireData};
+
+// Finds the changed column span of the next page from `page` on. Returns
+// false when the rest of the frame matches the panel.
+static bool findNextSpan() {
+  for (; page < OLED_PAGES; page++) {
+    const uint8_t* now = frame + page * SCREEN_WIDTH;
+    const uint8_t* old = shown + page * SCREEN_WIDTH;
+    int first = 0;
+    while (first < SCREEN_WIDTH && now[first] == old[first]) first++;
+    if (first == SCREEN_WIDTH) continue;
+    int last = SCREEN_WIDTH - 1;
+    while (now[last] == old[last]) last--;
+    column = first;
+    lastColumn = last;
+    return true;
+  }
+  return false;
+}
+
+static void finishFrame() {
+  inFlight = false;
+  stats.frames++;
+  stats.lastFrameBytes = frameBytes;
+  if (frameBytes > stats.maxFrameBytes) stats.maxFrameBytes = frameBytes;
+  stats.totalBytes += frameBytes;
+}
+
+void initDisplayFlush(const uint8_t* framebuffer) {
+  frame = framebuffer;
+  memcpy(shown, framebuffer, sizeof(shown));
+  memset(&stats, 0, sizeof(stats));
+  inFlight = spanOpen = false;
+}
+
+void displayFlushFrame() {
+  if (!frame || inFlight) return;
+  inFlight = true;
+  spanOpen = false;
+  page = 0;
+  frameBytes = 0;
+}
+
+bool displayFlushIdle() {
+  return !inFlight;
+}
+
+void updateDisplayFlush() {
+  if (!inFlight) return;
+  if (!spanOpen && !findNextSpan()) {
+    finishFrame();
+    return;
+  }
+  // Window command plus one chunk; deferred while a sensor read is due
+  if (!busBegin(BUS_DEV_OLED, OLED_CHUNK_BUS_US)) return;
+  PROFILE_SCOPE(PROBE_OLED_DISPLAY);
+
+  if (!spanOpen) {
+    // Horizontal addressing: the window wraps the data writes that follow
+    uint8_t window[] = {SSD1306_COLUMN_ADDR, column, lastColumn, SSD1306_PAGE_ADDR, page, page};
+    transport.command(window, sizeof(window));
+    frameBytes += sizeof(window);
+    spanOpen = true;
+  }
+
+  uint16_t offset = page * SCREEN_WIDTH + column;
+  uint8_t length = min(lastColumn - column + 1, OLED_CHUNK_BYTES);
+  transport.data(frame + offset, length);
+  memcpy(shown + offset, frame + offset, length);
+  frameBytes += length;
+
+  if (column + length > lastColumn) {
+    spanOpen = false;
+    page++;
+  } else {
+    column += length;
+  }
+  busEnd(BUS_DEV_OLED);
+}
+
+void setDisplayTransport(const DisplayTransport& newTransport) {
+  transport = newTransport;
+}
+
+void resetDisplayTransport() {
+  transport = {wireCommand, wireData};
+}
+
+DisplayFlushStats getDisplayFlushStats() {
+  return stats;
+}
+#endif
@@ -0,0 +1,50 @@
+#ifndef DISPLAY_FLUSH_H
+#define DISPLAY_FLUSH_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Incremental SSD1306 framebuffer transfer. A shadow copy holds what the
+// panel currently shows; displayFlushFrame() compares the framebuffer
+// against it and queues, for each 8-row page, the span of columns that
+// changed. updateDisplayFlush() then sends at most OLED_CHUNK_BYTES of that
+// per call, so a redraw costs the loop a few short I2C transactions spread
+// over several ticks instead of one 1 KB blocking transfer.
+//
+// The framebuffer must not be redrawn while a frame is in flight; check
+// displayFlushIdle() first.
+
+#define OLED_PAGES (SCREEN_HEIGHT / 8)
+// Bus time of one updateDisplayFlush() call: the window command and one
+// chunk, each with its address and control byte, plus starts and stops
+#define OLED_CHUNK_BUS_US ((2 * 2 + 6 + OLED_CHUNK_BYTES + 1) * BUS_I2C_BYTE_US)
+
+// Byte sink for the panel. The default writes to the SSD1306 over Wire; a
+// host backend can count or mirror the bytes instead.
+struct DisplayTransport {
+  void (*command)(const uint8_t* bytes, uint8_t length);
+  void (*data)(const uint8_t* bytes, uint8_t length);
+};
+
+struct DisplayFlushStats {
+  uint32_t frames;         // Frames completed
+  uint32_t lastFrameBytes; // Command and data bytes of the last frame
+  uint32_t maxFrameBytes;
+  uint32_t totalBytes;
+};
+
+#if ENABLE_HID
+// The panel must already show the framebuffer's contents (e.g. right after
+// a full display.display())
+void initDisplayFlush(const uint8_t* framebuffer);
+void displayFlushFrame(); // Queue the framebuffer's changes
+bool displayFlushIdle();  // Previous frame fully sent
+void updateDisplayFlush(); // Sends the next chunk; run as its own scheduler task
+void setDisplayTransport(const DisplayTransport& transport);
+void resetDisplayTransport(); // Back to the SSD1306 on Wire
+DisplayFlushStats getDisplayFlushStats();
+#else
+inline void updateDisplayFlush() {}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#include "Estimator.h"
+
+// Filter tuning
+static const float ACCEL_NOISE = 0.5;        // m/s^2, vertical accel process noise
+static const float BIAS_DRIFT = 0.01;        // m/s^2/sqrt(s), bias random walk
+static const float BARO_NOISE = 1.0;         // m, barometer measurement noise
+static const float PAD_VELOCITY_NOISE = 0.05; // m/s
+static const float PAD_ALTITUDE_NOISE = 0.1;  // m
+static const float MAX_DT = 0.1;             // s, larger gaps are clamped
+
+// State vector [altitude, velocity, accelBias] and row-major covariance.
+// Kept as flat float arrays so the 3x3 products unroll into straight-line
+// FPU code.
+static float x[3];
+static float P[9];
+
+static float verticalAccel = 0.0;
+static uint32_t lastTimestampUs = 0;
+static bool haveTimestamp = false;
+
+// Scalar measurement of state component `idx` (H is a unit row vector)
+static void scalarUpdate(uint8_t idx, float z, float r) {
+  float s = P[idx * 3 + idx] + r;
+  if (s <= 0.0f) return;
+  float k[3] = {P[0 * 3 + idx] / s, P[1 * 3 + idx] / s, P[2 * 3 + idx] / s};
+  float y = z - x[idx];
+  float row[3] = {P[idx * 3 + 0], P[idx * 3 + 1], P[idx * 3 + 2]};
+  for (uint8_t i = 0; i < 3; i++) {
+    x[i] += k[i] * y;
+    for (uint8_t j = 0; j < 3; j++) {
+      P[i * 3 + j] -= k[i] * row[j];
+    }
+  }
+}
+
+void initEstimator() {
+  memset(x, 0, sizeof(x));
+  memset(P, 0, sizeof(P));
+  P[0] = 1.0;
+  P[4] = 1.0;
+  P[8] = 0.25;
+  haveTimestamp = false;
+  verticalAccel = 0.0;
+}
+
+void estimatorPredict(uint32_t timestampUs, float worldAccelZ) {
+  if (!haveTimestamp) {
+    lastTimestampUs = timestampUs;
+    haveTimestamp = true;
+    return;
+  }
+  float dt = (timestampUs - lastTimestampUs) * 1e-6f;
+  lastTimestampUs = timestampUs;
+  if (dt <= 0.0f) return;
+  if (dt > MAX_DT) dt = MAX_DT;
+
+  float a = worldAccelZ - x[2];
+  verticalAccel = a;
+
+  float h = 0.5f * dt * dt;
+  x[0] += x[1] * dt + a * h;
+  x[1] += a * dt;
+
+  // P = F P F^T + Q with F = [1 dt -h; 0 1 -dt; 0 0 1]
+  float A[9];
+  for (uint8_t j = 0; j < 3; j++) {
+    A[0 * 3 + j] = P[0 * 3 + j] + dt * P[1 * 3 + j] - h * P[2 * 3 + j];
+    A[1 * 3 + j] = P[1 * 3 + j] - dt * P[2 * 3 + j];
+    A[2 * 3 + j] = P[2 * 3 + j];
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    P[i * 3 + 0] = A[i * 3 + 0] + dt * A[i * 3 + 1] - h * A[i * 3 + 2];
+    P[i * 3 + 1] = A[i * 3 + 1] - dt * A[i * 3 + 2];
+    P[i * 3 + 2] = A[i * 3 + 2];
+  }
+
+  float q = ACCEL_NOISE * ACCEL_NOISE;
+  P[0] += q * h * h;
+  P[1] += q * h * dt;
+  P[3] += q * h * dt;
+  P[4] += q * dt * dt;
+  P[8] += BIAS_DRIFT * BIAS_DRIFT * dt;
+}
+
+void estimatorUpdateBaro(float altitude) {
+  scalarUpdate(0, altitude, BARO_NOISE * BARO_NOISE);
+}
+
+void estimatorPadUpdate() {
+  scalarUpdate(1, 0.0, PAD_VELOCITY_NOISE * PAD_VELOCITY_NOISE);
+  scalarUpdate(0, 0.0, PAD_ALTITUDE_NOISE * PAD_ALTITUDE_NOISE);
+}
+
+EstimatorState getEstimatorState() {
+  EstimatorState state = {x[0], x[1], x[2], verticalAccel};
+  return state;
+}
@@ -0,0 +1,34 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Vertical-channel Kalman filter: state is altitude, vertical velocity and
+// accelerometer bias along the vertical axis. All storage is fixed-size and
+// static; an update never allocates.
+
+struct EstimatorState {
+  float altitude;       // m above the pad
+  float velocity;       // m/s, positive up
+  float accelBias;      // m/s^2, estimated vertical accelerometer bias
+  float verticalAccel;  // m/s^2, gravity-compensated, bias-corrected
+};
+
+void initEstimator();
+
+// Propagates with one IMU sample's world-frame vertical acceleration
+// (m/s^2, gravity removed, see Attitude.h). The step size is taken from the
+// sample timestamps, not the loop interval.
+void estimatorPredict(uint32_t timestampUs, float worldAccelZ);
+
+// Optional barometric altitude measurement (m above the pad)
+void estimatorUpdateBaro(float altitude);
+
+// Pad constraint: vehicle is stationary at zero altitude. Call while
+// IDLE/ARMED so the filter converges and learns the accelerometer bias.
+void estimatorPadUpdate();
+
+EstimatorState getEstimatorState();
+
+#endif
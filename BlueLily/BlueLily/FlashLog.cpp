@@ -0,0 +1,289 @@
+#include "FlashLog.h"
+
+#if ENABLE_W25Q128
+#include "Crc.h"
+#include "Profiler.h"
+#include "Bus.h"
+
+struct FlashPage {
+  FlashPageHeader header;
+  uint8_t payload[FLASH_PAGE_PAYLOAD];
+};
+
+static_assert(sizeof(FlashPage) == FLASH_PAGE_SIZE, "FlashPage must fill one flash page");
+
+// Pages waiting to be programmed, oldest first. The slot after the last
+// queued page is the one being filled.
+static FlashPage queue[FLASH_LOG_PAGE_QUEUE];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+static uint16_t fillLength = 0;
+
+static uint32_t logStart = 0;          // First page of the retained log
+static uint32_t nextSequence = 0;      // Sequence for the next sealed page
+static uint32_t programmedThrough = 0; // Pages below this are in flash
+static uint32_t erasedThrough = 0;     // Pages from programmedThrough up to this are erased
+static bool ready = false;
+static bool fullReported = false;
+static FlashLogStats stats;
+
+enum PageState : uint8_t {
+  PAGE_VALID,
+  PAGE_BLANK,   // Erased
+  PAGE_VOID,    // Zeroed by recovery
+  PAGE_CORRUPT  // Torn program, partial erase or foreign data
+};
+
+static uint32_t pageAddress(uint32_t sequence) {
+  return FLASH_LOG_START + (sequence % FLASH_LOG_PAGES) * FLASH_PAGE_SIZE;
+}
+
+static uint16_t pageCrc(const FlashPage& page) {
+  uint16_t crc = crc16Ccitt((const uint8_t*)&page.header.sequence, sizeof(page.header.sequence));
+  return crc16Ccitt(page.payload, page.header.length, crc);
+}
+
+static bool pageFilled(const FlashPage& page, uint8_t value) {
+  const uint8_t* bytes = (const uint8_t*)&page;
+  for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++) {
+    if (bytes[i] != value) return false;
+  }
+  return true;
+}
+
+// Reads the page at region index `index` (not sequence)
+static PageState readPage(uint32_t index, FlashPage& page) {
+  halFlash.read(FLASH_LOG_START + index * FLASH_PAGE_SIZE, &page, FLASH_PAGE_SIZE);
+  if (page.header.magic == FLASH_PAGE_MAGIC && page.header.length <= FLASH_PAGE_PAYLOAD &&
+      page.header.sequence % FLASH_LOG_PAGES == index && page.header.crc == pageCrc(page)) {
+    return PAGE_VALID;
+  }
+  if (pageFilled(page, 0xFF)) return PAGE_BLANK;
+  if (pageFilled(page, 0x00)) return PAGE_VOID;
+  return PAGE_CORRUPT;
+}
+
+// Whether the page at `index` continues the log that has `baseSequence`
+// at `base`. A void page carries no sequence and may be left from an older
+// lap, so it counts only if the first non-void page after it continues.
+static bool continuesLog(uint32_t index, uint32_t base, uint32_t baseSequence, FlashPage& page) {
+  for (; index < FLASH_LOG_PAGES; index++) {
+    PageState state = readPage(index, page);
+    if (state == PAGE_VOID) continue;
+    return state == PAGE_VALID && page.header.sequence == baseSequence + (index - base);
+  }
+  return false;
+}
+
+static void waitWhileBusy() {
+  while (halFlash.busy()) {}
+}
+
+static void sealPage() {
+  FlashPage& page = queue[(queueHead + queueCount) % FLASH_LOG_PAGE_QUEUE];
+  if (fillLength < FLASH_PAGE_PAYLOAD) {
+    memset(page.payload + fillLength, 0xFF, FLASH_PAGE_PAYLOAD - fillLength); // Leave the tail erased
+  }
+  page.header.magic = FLASH_PAGE_MAGIC;
+  page.header.length = fillLength;
+  page.header.sequence = nextSequence++;
+  page.header.crc = pageCrc(page);
+  fillLength = 0;
+  queueCount++;
+  if (queueCount > stats.maxQueued) stats.maxQueued = queueCount;
+}
+
+static void programPage() {
+  const FlashPage& page = queue[queueHead];
+  if (page.header.sequence != logStart && pageAddress(page.header.sequence) == FLASH_LOG_START) stats.wraps++;
+  halFlash.program(pageAddress(page.header.sequence), &page, FLASH_PAGE_SIZE);
+  programmedThrough = page.header.sequence + 1;
+  queueHead = (queueHead + 1) % FLASH_LOG_PAGE_QUEUE;
+  queueCount--;
+  stats.pagesProgrammed++;
+}
+
+static void eraseNextSector() {
+  halFlash.eraseSector(pageAddress(erasedThrough));
+  erasedThrough += FLASH_PAGES_PER_SECTOR;
+  stats.sectorsErased++;
+}
+
+// Rebuilds the write head from the pages in flash. Costs O(log pages) page
+// reads plus a few sectors' worth (the head sector, and any run of void
+// pages a probe lands in), never a linear scan of the chip.
+// Returns false if no log was found.
+static bool recoverFlashLog() {
+  FlashPage page;
+
+  // A log starts at index 0, except when a wrapped circular log has its
+  // erased zone there; then the oldest data starts a few sectors later.
+  uint32_t base = FLASH_LOG_PAGES;
+  for (uint32_t index = 0; index < FLASH_LOG_PAGES && index <= (FLASH_ERASE_AHEAD_SECTORS + 1) * FLASH_PAGES_PER_SECTOR;
+       index += FLASH_PAGES_PER_SECTOR) {
+    if (readPage(index, page) == PAGE_VALID) {
+      base = index;
+      break;
+    }
+  }
+  if (base == FLASH_LOG_PAGES) return false;
+  uint32_t baseSequence = page.header.sequence;
+
+  // Pages [base, head) continue the base sequence; everything after is
+  // erased, torn, or an older lap of the circular log
+  uint32_t low = base + 1, high = FLASH_LOG_PAGES;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (continuesLog(mid, base, baseSequence, page)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  uint32_t head = low;
+
+  // Void anything a power loss left behind in the rest of the head sector
+  // so the next search does not stop early and pages are never programmed
+  // over non-erased bits.
+  uint32_t sectorEnd = min((uint32_t)FLASH_LOG_PAGES, (head / FLASH_PAGES_PER_SECTOR + 1) * FLASH_PAGES_PER_SECTOR);
+  uint32_t firstFree = head;
+  for (uint32_t index = head; index < sectorEnd; index++) {
+    PageState state = readPage(index, page);
+    if (state == PAGE_BLANK) continue;
+    firstFree = index + 1;
+    if (state == PAGE_VOID) continue; // Voided by an earlier recovery
+    memset(&page, 0, sizeof(page));
+    halFlash.program(FLASH_LOG_START + index * FLASH_PAGE_SIZE, &page, FLASH_PAGE_SIZE);
+    waitWhileBusy(); // Before the next page is read
+    stats.voidedPages++;
+  }
+
+  nextSequence = programmedThrough = baseSequence + (firstFree - base);
+  erasedThrough = baseSequence + (sectorEnd - base);
+  logStart = baseSequence;
+
+  // A wrapped circular log keeps its previous lap after the erased zone
+  // ahead of the head, less one sector if the power loss tore its erase
+  if (FLASH_LOG_CIRCULAR) {
+    for (uint8_t k = 0; k <= FLASH_ERASE_AHEAD_SECTORS + 1; k++) {
+      uint32_t candidate = erasedThrough + k * FLASH_PAGES_PER_SECTOR;
+      if (candidate < FLASH_LOG_PAGES || candidate - FLASH_LOG_PAGES >= logStart) break;
+      uint32_t index = candidate % FLASH_LOG_PAGES;
+      if (readPage(index, page) == PAGE_VALID && page.header.sequence == candidate - FLASH_LOG_PAGES) {
+        logStart = candidate - FLASH_LOG_PAGES;
+        break;
+      }
+    }
+  }
+  stats.recoveredPages = programmedThrough - logStart;
+  return true;
+}
+
+bool initFlashLog() {
+  ready = false;
+  if (!halFlash.begin()) { // Check if flash chip is present
+    Serial.println("W25Q128 init failed! Check wiring or chip ID.");
+    return false;
+  }
+  queueHead = queueCount = 0;
+  fillLength = 0;
+  fullReported = false;
+  memset(&stats, 0, sizeof(stats));
+  if (!recoverFlashLog()) {
+    logStart = nextSequence = programmedThrough = erasedThrough = 0;
+  }
+  ready = true;
+  return true;
+}
+
+void clearFlashLog() {
+  if (!ready) return;
+  flushFlashLog();
+  uint32_t start = (nextSequence + FLASH_LOG_PAGES - 1) / FLASH_LOG_PAGES * FLASH_LOG_PAGES;
+  // Skip a further lap in circular mode so no page of the old log can pass
+  // for the previous lap of the new one during recovery
+  if (FLASH_LOG_CIRCULAR) start += FLASH_LOG_PAGES;
+  logStart = nextSequence = programmedThrough = erasedThrough = start;
+  fullReported = false;
+}
+
+void flashLogWrite(const uint8_t* data, size_t length) {
+  if (!ready) return;
+  while (length) {
+    if (!FLASH_LOG_CIRCULAR && nextSequence - logStart >= FLASH_LOG_PAGES) {
+      if (!fullReported) Serial.println("W25Q128 full");
+      fullReported = true;
+      stats.bytesDropped += length;
+      return;
+    }
+    if (queueCount == FLASH_LOG_PAGE_QUEUE) {
+      stats.bytesDropped += length; // Chip has fallen behind; the decoder resyncs at the next sync marker
+      return;
+    }
+    FlashPage& page = queue[(queueHead + queueCount) % FLASH_LOG_PAGE_QUEUE];
+    size_t chunk = min(length, (size_t)(FLASH_PAGE_PAYLOAD - fillLength));
+    memcpy(page.payload + fillLength, data, chunk);
+    fillLength += chunk;
+    data += chunk;
+    length -= chunk;
+    if (fillLength == FLASH_PAGE_PAYLOAD) sealPage();
+  }
+}
+
+// One operation per call: the chip stays busy until it completes. Steps
+// taken from the loop go through the bus arbiter; a blocking flush does not.
+static void stepFlashLog(bool arbitrate) {
+  if (!ready || halFlash.busy()) return;
+
+  bool program = queueCount && queue[queueHead].header.sequence < erasedThrough;
+  uint32_t eraseLimit = programmedThrough + FLASH_ERASE_AHEAD_SECTORS * FLASH_PAGES_PER_SECTOR;
+  bool erase = !program && erasedThrough < eraseLimit &&
+               (FLASH_LOG_CIRCULAR || erasedThrough - logStart < FLASH_LOG_PAGES);
+  if (!program && !erase) return;
+  if (arbitrate && !busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US)) return;
+  PROFILE_SCOPE(PROBE_FLASH_LOG);
+
+  if (program) {
+    programPage();
+  } else {
+    eraseNextSector();
+  }
+  if (arbitrate) busEnd(BUS_DEV_FLASH);
+}
+
+void updateFlashLog() {
+  stepFlashLog(true);
+}
+
+void flushFlashLog() {
+  if (!ready) return;
+  while (queueCount == FLASH_LOG_PAGE_QUEUE) stepFlashLog(false);
+  if (fillLength) sealPage();
+  while (queueCount) stepFlashLog(false);
+  waitWhileBusy();
+}
+
+bool flashLogIdle() {
+  return ready && !halFlash.busy();
+}
+
+uint32_t flashLogOldestSequence() {
+  if (!FLASH_LOG_CIRCULAR || erasedThrough - logStart <= FLASH_LOG_PAGES) return logStart;
+  return erasedThrough - FLASH_LOG_PAGES;
+}
+
+uint32_t flashLogNextSequence() {
+  return programmedThrough;
+}
+
+int16_t readFlashLogPage(uint32_t sequence, uint8_t* page) {
+  if (!ready || sequence < flashLogOldestSequence() || sequence >= programmedThrough) return -1;
+  FlashPage& raw = *(FlashPage*)page;
+  if (readPage(sequence % FLASH_LOG_PAGES, raw) != PAGE_VALID || raw.header.sequence != sequence) return -1;
+  return raw.header.length;
+}
+
+FlashLogStats getFlashLogStats() {
+  return stats;
+}
+#endif
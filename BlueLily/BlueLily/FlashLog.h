@@ -0,0 +1,73 @@
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Hal.h"
+
+// Page-oriented log writer for the W25Q128 NOR flash.
+//
+// The log byte stream is cut into 256-byte pages, each written with a
+// single page program:
+//   header:  magic (u8) | payload length (u8) | CRC-16 (u16) | sequence (u32)
+//   payload: up to FLASH_PAGE_PAYLOAD bytes of the log stream
+//
+// Page `sequence` lives at FLASH_LOG_START + (sequence % FLASH_LOG_PAGES) * 256
+// and keeps counting across logs (a new log starts at the next multiple of
+// FLASH_LOG_PAGES), so a page left over from an older log never looks like
+// part of the current one. Sectors are erased in the background ahead of
+// the write head, so neither erases nor page programs block the loop. In
+// circular mode the head wraps and the oldest sector is erased to make
+// room; otherwise logging stops when the region is full.
+//
+// At boot the write head is recovered instead of restarting at zero: a
+// binary search finds the last page that continues the sequence of the
+// first valid page, and any torn page left in the head sector by a power
+// loss is programmed to all zeros (a "void" page) before appending resumes.
+
+#define FLASH_PAGE_SIZE 256
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define FLASH_PAGE_HEADER_SIZE 8
+#define FLASH_PAGE_PAYLOAD (FLASH_PAGE_SIZE - FLASH_PAGE_HEADER_SIZE)
+#define FLASH_PAGE_MAGIC 0x5A // Erased flash reads 0xFF
+#define FLASH_LOG_PAGES (FLASH_LOG_SIZE / FLASH_PAGE_SIZE)
+
+struct __attribute__((packed)) FlashPageHeader {
+  uint8_t magic;
+  uint8_t length;    // Payload bytes used, < FLASH_PAGE_PAYLOAD only for a flushed page
+  uint16_t crc;      // CRC-16/CCITT-FALSE over sequence and payload
+  uint32_t sequence;
+};
+
+static_assert(sizeof(FlashPageHeader) == FLASH_PAGE_HEADER_SIZE, "FlashPageHeader must be packed");
+
+struct FlashLogStats {
+  uint32_t pagesProgrammed;
+  uint32_t sectorsErased;
+  uint32_t wraps;          // Times the circular log wrapped to the start
+  uint32_t bytesDropped;   // Log bytes lost to a full queue or a full (linear) log
+  uint32_t recoveredPages; // Pages of an existing log found at boot
+  uint32_t voidedPages;    // Torn pages voided during recovery
+  uint8_t maxQueued;       // High-water mark of pages waiting to be programmed
+};
+
+#if ENABLE_W25Q128
+bool initFlashLog();     // Recovers the write head from flash, or starts an empty log
+void clearFlashLog();    // Flushes, then starts a new, empty log (old pages are erased lazily)
+void flashLogWrite(const uint8_t* data, size_t length); // Appends to the staged page
+void updateFlashLog();   // Call every loop; programs queued pages and erases ahead
+void flushFlashLog();    // Pads out the staged page and waits until everything is programmed
+
+bool flashLogIdle();     // True when the chip can be read without waiting
+uint32_t flashLogOldestSequence(); // First page of the log still held in flash
+uint32_t flashLogNextSequence();   // One past the last programmed page
+// Reads the raw FLASH_PAGE_SIZE-byte page with the given sequence into
+// `page` and validates it. Returns the payload length (the payload starts
+// at page + FLASH_PAGE_HEADER_SIZE), or -1 if the page is missing, void or
+// corrupt.
+int16_t readFlashLogPage(uint32_t sequence, uint8_t* page);
+FlashLogStats getFlashLogStats();
+#endif
+
+#endif
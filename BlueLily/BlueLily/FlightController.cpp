@@ -3,60 +3,154 @@
 #include "Communication.h"
 #include "Logger.h"
 #include "Actuation.h"
-#include "HID.h"
+#include "Sampler.h"
+#include "Estimator.h"
+#include "Hal.h"
+#include "Profiler.h"
 
 #if ENABLE_FLIGHTCONTROLLER
 
-// Flight states
-enum FlightState {
-  IDLE,
-  ARMED,
-  ASCENT,
-  APOGEE,
-  DESCENT,
-  LANDED
-};
-
 // State variables
 static FlightState currentState = IDLE;
 static unsigned long startTime = 0;
 static float maxAltitude = 0.0;
-static float lastAltitude = 0.0;
 static uint16_t telemetrySeqNum = 0;
+static SampleCursor sampleCursor;
+static uint32_t eventTimeUs[FLIGHT_STATE_COUNT];
+static bool liftoffCandidate = false; // Vertical accel above the threshold
+static uint32_t liftoffCandidateUs = 0; // Sample time it first went above
+static bool liftoffConfirmed = false;
+static uint32_t lastImuUs = 0;
+static float recentAccel[3];       // Last three world-frame vertical accels, for a median
+static float impactVelocity = 0.0; // m/s, vertical velocity gained over about LANDING_IMPACT_WINDOW_S
+static bool impactSeen = false;    // Touchdown-sized deceleration during DESCENT
+static bool restCandidate = false; // Vehicle still since restCandidateUs
+static uint32_t restCandidateUs = 0;
+static uint8_t motionSamples = 0;  // Consecutive samples not at rest
+static bool landingConfirmed = false;
+
+// Latest values drained from the sample ring
+static float temp = -1.0;
+static float ax = 0.0, ay = 0.0, az = 0.0, gx = 0.0, gy = 0.0, gz = 0.0;
+static int16_t adc0 = 0;
+
+// Configuration thresholds, defaults in Settings.cpp
+float liftoffAccelThreshold;
+float apogeeVelocityThreshold;
+float landingImpactVelocity;
+uint32_t landingRestMs;
+uint32_t armDelayMs;
+uint32_t liftoffHoldMs;
+
+static const float LANDING_IMPACT_WINDOW_S = 0.25; // s, decay time of impactVelocity
+static const float LANDING_REST_ACCEL = 1.0;       // m/s^2, |accel| - g while at rest
+static const float LANDING_REST_GYRO = 0.2;        // rad/s, body rate while at rest
+static const uint8_t LANDING_MOTION_SAMPLES = 2;   // Consecutive samples in motion that end a rest
+
+// Liftoff needs the world-frame vertical acceleration (gravity removed) to
+// stay above the threshold for liftoffHoldMs of consecutive IMU samples, so
+// a knock on the pad or a single-sample spike does not launch
+static void trackLiftoff(uint32_t timestampUs, float verticalAccel) {
+  if (verticalAccel <= liftoffAccelThreshold) {
+    liftoffCandidate = false;
+    return;
+  }
+  if (!liftoffCandidate) {
+    liftoffCandidate = true;
+    liftoffCandidateUs = timestampUs;
+  }
+  if (timestampUs - liftoffCandidateUs >= liftoffHoldMs * 1000UL) liftoffConfirmed = true;
+}
 
-// Configuration thresholds
-static const float LIFTOFF_ACCEL_THRESHOLD = 20.0; // m/s^2 (2g)
-static const float APOGEE_VELOCITY_THRESHOLD = 0.0; // m/s (near zero at peak)
-static const float LANDING_ALTITUDE_THRESHOLD = 10.0; // meters above start
-static const unsigned long ARM_DELAY = 5000; // ms to arm
+// Landing needs the touchdown itself, then rest. Without a barometer the
+// estimated altitude drifts by tens of metres over a descent, and a steady
+// descent under the parachute reads the same 1 g as lying on the ground, so
+// neither tells touchdown apart. The ground stopping the vehicle does: the
+// vertical velocity gained within a quarter second must reach
+// landingImpactVelocity, and afterwards the accelerometer must read 1 g in
+// any orientation and the gyro stay still for landingRestMs. A single
+// dropout or spike neither makes an impact (the median of three samples is
+// integrated) nor ends a rest.
+static void trackLanding(uint32_t timestampUs, const SensorSample& sample) {
+  float dt = (timestampUs - lastImuUs) * 1e-6f;
+  lastImuUs = timestampUs;
+  if (dt > LANDING_IMPACT_WINDOW_S) dt = LANDING_IMPACT_WINDOW_S;
+  recentAccel[0] = recentAccel[1];
+  recentAccel[1] = recentAccel[2];
+  recentAccel[2] = sample.imu.worldAccel[2];
+  float median = max(min(recentAccel[0], recentAccel[1]), min(max(recentAccel[0], recentAccel[1]), recentAccel[2]));
+  impactVelocity = impactVelocity * (1.0f - dt / LANDING_IMPACT_WINDOW_S) + median * dt;
+  if (impactVelocity >= landingImpactVelocity) impactSeen = true;
+
+  const float* a = sample.imu.accel;
+  const float* g = sample.imu.gyro;
+  float accel = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+  float rate = sqrtf(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+  if (!impactSeen || fabsf(accel - STANDARD_GRAVITY) > LANDING_REST_ACCEL || rate > LANDING_REST_GYRO) {
+    if (!impactSeen || ++motionSamples >= LANDING_MOTION_SAMPLES) restCandidate = false;
+    return;
+  }
+  motionSamples = 0;
+  if (!restCandidate) {
+    restCandidate = true;
+    restCandidateUs = timestampUs;
+  }
+  if (timestampUs - restCandidateUs >= landingRestMs * 1000UL) landingConfirmed = true;
+}
+
+static void enterState(FlightState state) {
+  currentState = state;
+  eventTimeUs[state] = halMicros();
+}
 
 void initFlightController() {
   // Initialize all dependent modules (assumed called in main.ino)
   currentState = IDLE;
   startTime = 0;
   maxAltitude = 0.0;
-  lastAltitude = 0.0;
   telemetrySeqNum = 0;
+  liftoffCandidate = liftoffConfirmed = false;
+  lastImuUs = 0;
+  memset(recentAccel, 0, sizeof(recentAccel));
+  impactVelocity = 0.0;
+  motionSamples = 0;
+  impactSeen = restCandidate = landingConfirmed = false;
+  memset(eventTimeUs, 0, sizeof(eventTimeUs));
+  initEstimator();
+  openSampleCursor(sampleCursor);
   Serial.println("Flight Controller Initialized");
 }
 
 void runFlightController() {
-  static unsigned long lastUpdate = 0;
-  if (millis() - lastUpdate < LOOP_INTERVAL_MS) return;
-  lastUpdate = millis();
-
-  // Read sensor data
-  float temp = readTemperature();
-  float ax, ay, az, gx, gy, gz;
-  readIMU(ax, ay, az, gx, gy, gz);
-  int16_t adc0 = readADC(0);
-
-  // Estimate altitude and velocity (simplified, using accel Z integration)
-  static float velocity = 0.0;
-  static float altitude = 0.0;
-  float dt = LOOP_INTERVAL_MS / 1000.0; // Convert to seconds
-  velocity += az * dt; // Integrate accel to get velocity
-  altitude += velocity * dt; // Integrate velocity to get altitude
+  // Consume sensor data published by the sampler since the last tick
+  SensorSample sample;
+  while (readSample(sampleCursor, sample)) {
+    switch (sample.type) {
+      case SAMPLE_IMU:
+        ax = sample.imu.accel[0]; ay = sample.imu.accel[1]; az = sample.imu.accel[2];
+        gx = sample.imu.gyro[0]; gy = sample.imu.gyro[1]; gz = sample.imu.gyro[2];
+        estimatorPredict(sample.timestampUs, sample.imu.worldAccel[2]);
+        if (currentState == ARMED) trackLiftoff(sample.timestampUs, sample.imu.worldAccel[2]);
+        if (currentState == DESCENT) trackLanding(sample.timestampUs, sample);
+        else lastImuUs = sample.timestampUs;
+        break;
+      case SAMPLE_TEMP:
+        temp = sample.temperature;
+        break;
+      case SAMPLE_ADC:
+        adc0 = sample.adc[0];
+        break;
+    }
+  }
+
+  // Hold the estimator on the pad until liftoff so it learns the accel bias.
+  // Not while a liftoff is being confirmed: the thrust would be learned as bias.
+  if (currentState == IDLE || (currentState == ARMED && !liftoffCandidate)) {
+    estimatorPadUpdate();
+  }
+  EstimatorState estimate = getEstimatorState();
+  float velocity = estimate.velocity;
+  float altitude = estimate.altitude;
 
   // Update max altitude
   if (altitude > maxAltitude) maxAltitude = altitude;
@@ -64,23 +158,23 @@ void runFlightController() {
   // State machine
   switch (currentState) {
     case IDLE:
-      if (millis() > ARM_DELAY) { // Wait before arming
-        currentState = ARMED;
+      if (halMillis() > armDelayMs) { // Wait before arming
+        enterState(ARMED);
         Serial.println("State: ARMED");
       }
       break;
 
     case ARMED:
-      if (az > LIFTOFF_ACCEL_THRESHOLD) { // Detect liftoff
-        currentState = ASCENT;
-        startTime = micros();
+      if (liftoffConfirmed) { // Detect liftoff
+        enterState(ASCENT);
+        startTime = halMicros();
         Serial.println("State: ASCENT");
       }
       break;
 
     case ASCENT:
-      if (velocity <= APOGEE_VELOCITY_THRESHOLD && altitude > 50.0) { // Detect apogee
-        currentState = APOGEE;
+      if (velocity <= apogeeVelocityThreshold && altitude > 50.0) { // Detect apogee
+        enterState(APOGEE);
         setActuator(0, true); // Trigger relay (e.g., parachute)
         Serial.println("State: APOGEE");
       }
@@ -88,44 +182,47 @@ void runFlightController() {
 
     case APOGEE:
       if (velocity < 0) { // Start descending
-        currentState = DESCENT;
+        enterState(DESCENT);
         Serial.println("State: DESCENT");
       }
       break;
 
     case DESCENT:
-      if (altitude < LANDING_ALTITUDE_THRESHOLD && velocity < 5.0) { // Detect landing
-        currentState = LANDED;
+      if (landingConfirmed) { // Detect landing
+        enterState(LANDED);
         Serial.println("State: LANDED");
+        // Once, on touchdown; the flash-to-SD copy finishes in the background
+        logProfile();
+        closeLogger();
+        requestLogPreview();
       }
       break;
 
     case LANDED:
       setActuator(0, false); // Turn off relay
-      flushLogger();
-      syncFlashToSD();
-      closeLogger();
-      previewLoggedData();
       break;
   }
 
-  // Log data
-  char logBuffer[128];
-  snprintf(logBuffer, sizeof(logBuffer), "%lu,%.2f,%.2f,%.2f,%.2f,%d",
-           micros() - startTime, temp, az, velocity, altitude, currentState);
-  logData(logBuffer);
+  logFlightState(currentState, altitude, velocity, estimate.verticalAccel, temp, adc0);
 
   // Send telemetry (e.g., via LoRa)
   char telemetryBuffer[64];
-  snprintf(telemetryBuffer, sizeof(telemetryBuffer), "%.2f,%.2f,%.2f,%d",
-           az, velocity, altitude, currentState);
+  {
+    PROFILE_SCOPE(PROBE_TELEMETRY_FMT);
+    snprintf(telemetryBuffer, sizeof(telemetryBuffer), "%.2f,%.2f,%.2f,%d",
+             az, velocity, altitude, currentState);
+  }
   sendLoRa('F', 1, telemetrySeqNum++, telemetryBuffer);
 
   // Update actuators
-  runScheduler(micros() - startTime, az, temp);
+  runScheduler(halMicros() - startTime, az, temp);
+}
 
-  // Update HID
-  updateHID();
+FlightState getFlightState() {
+  return currentState;
 }
 
+uint32_t getFlightEventTime(FlightState state) {
+  return state < FLIGHT_STATE_COUNT ? eventTimeUs[state] : 0;
+}
 #endif
\ No newline at end of file
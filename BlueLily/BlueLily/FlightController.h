@@ -4,12 +4,37 @@
 #include <Arduino.h>
 #include "Config.h"
 
+// Flight states
+enum FlightState {
+  IDLE,
+  ARMED,
+  ASCENT,
+  APOGEE,
+  DESCENT,
+  LANDED
+};
+
+#define FLIGHT_STATE_COUNT (LANDED + 1)
+
 #if ENABLE_FLIGHTCONTROLLER
+// Detection thresholds, set through the settings registry (Settings.cpp)
+extern float liftoffAccelThreshold;    // m/s^2, world-frame vertical, gravity removed
+extern uint32_t liftoffHoldMs;         // ms the threshold must hold before liftoff
+extern float apogeeVelocityThreshold;  // m/s (near zero at peak)
+extern float landingImpactVelocity;    // m/s the touchdown must stop within a quarter second
+extern uint32_t landingRestMs;         // ms at rest after the touchdown before landing
+extern uint32_t armDelayMs;            // ms after boot before arming
+
 void initFlightController();
 void runFlightController();
+FlightState getFlightState();
+// halMicros() when `state` was entered, 0 if it has not been reached yet
+uint32_t getFlightEventTime(FlightState state);
 #else
 inline void initFlightController() {}
 inline void runFlightController() {}
+inline FlightState getFlightState() { return IDLE; }
+inline uint32_t getFlightEventTime(FlightState) { return 0; }
 #endif
 
 #endif
\ No newline at end of file
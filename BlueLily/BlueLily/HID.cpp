@@ -7,6 +7,11 @@
 #include "Communication.h"
 #include "Logger.h"
 #include "Actuation.h"
+#include "ConfigStore.h"
+#include "Sampler.h"
+#include "Hal.h"
+#include "DisplayFlush.h"
+#include "FlightController.h"
 
 #if ENABLE_HID
 
@@ -17,12 +22,10 @@ const uint8_t canbusIcon[] PROGMEM = {0b00111100, 0b01000010, 0b10011001, 0b1011
 const uint8_t loraIcon[] PROGMEM = {0b00001000, 0b00010100, 0b00100010, 0b01000001, 0b01000001, 0b00100010, 0b00010100, 0b00001000};
 const uint8_t rocketBitmap[] PROGMEM = {0b00011000, 0b00111100, 0b01111110, 0b11111111, 0b01111110, 0b00111100, 0b00011000, 0b00011000};
 
-// Display setup
-#define SCREEN_WIDTH 128
-#define SCREEN_HEIGHT 64
+// Display setup. Keep Wire at 400 kHz after the library's own transfers,
+// the IMU and ADC share the bus.
 #define OLED_RESET    -1
-#define SCREEN_ADDRESS 0x3C
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, 400000UL, 400000UL);
 
 // Menu Definitions
 const char* mainMenuItems[] = {"Sensors", "Communication", "Logger", "Actuation", "HID", "FlightController", "Config"};
@@ -54,6 +57,8 @@ static int lastPotValue = 0;
 static unsigned long lastInteractionTime = 0;
 static const unsigned long screensaverTimeout = 30000;
 static const int deadbandThreshold = 50;
+static unsigned long lastButtonTime = 0;
+static const unsigned long buttonLockout = 300; // ms a press is held off for, without blocking the loop
 static bool inScreensaver = false;
 static bool inPreview = false;
 static int selectedModule = -1;
@@ -75,18 +80,27 @@ static const int ANIMATION_DELAY = 200;
 static int rocketY = SCREEN_HEIGHT - 10;
 static const int rocketX = SCREEN_WIDTH / 2 - 4;
 
-// Enable/Disable states
-static bool max31855Enabled = true;
-static bool mpu6500Enabled = true;
-static bool ads1115Enabled = true;
-static bool rs485Enabled = true;
-static bool canbusEnabled = false;
-static bool bluetoothEnabled = true;
-static bool loraEnabled = true;
-static bool sdEnabled = true;
-static bool w25q128Enabled = true;
-static bool relay0Enabled = true;
-static bool pwm1Enabled = true;
+// Enable/Disable states, defaults and persistence in Settings.cpp
+bool max31855Enabled;
+bool mpu6500Enabled;
+bool ads1115Enabled;
+bool rs485Enabled;
+bool canbusEnabled;
+bool bluetoothEnabled;
+bool loraEnabled;
+bool sdEnabled;
+bool w25q128Enabled;
+bool relay0Enabled;
+bool pwm1Enabled;
+
+// Flight mode: state shown on the LEDs (bits 0-3 = red, yellow, green, blue)
+// and, without input polling, on a display that only redraws on state changes
+static const char* const stateNames[FLIGHT_STATE_COUNT] = {"IDLE", "ARMED", "ASCENT", "APOGEE", "DESCENT", "LANDED"};
+static const uint8_t stateLeds[FLIGHT_STATE_COUNT] = {0x8, 0x2, 0x1, 0x3, 0x6, 0x4};
+static int8_t ledState = -1;
+static int8_t flightScreenState = -1;
+static unsigned long lastFlightDraw = 0;
+uint32_t hidFlightRefreshMs; // Default in Settings.cpp
 
 // Communication stats (placeholder)
 static uint32_t rs485Packets = 0;
@@ -97,12 +111,14 @@ static uint32_t loraPackets = 0;
 // Forward declarations
 static void handleInput();
 static void checkForInteraction();
+static bool buttonsLocked();
+static void pushDisplay();
 static void drawMenu();
+static void showStateLeds(FlightState state);
+static void drawFlightScreen(FlightState state);
 static void drawScreensaver();
 static void drawPreview();
 static void toggleEnableDisable();
-static void saveSettingsToSD();
-static void loadSettingsFromSD();
 static void bootAnimation();
 
 void initHID() {
@@ -124,31 +140,51 @@ void initHID() {
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
   display.display();
-  lastInteractionTime = millis();
-  loadSettingsFromSD();
+  initDisplayFlush(display.getBuffer());
+  lastInteractionTime = halMillis();
   Serial.println("HID Initialized");
 }
 
 void updateHID() {
+  FlightState state = getFlightState();
+  showStateLeds(state);
+
+  // Nobody reads the panel in flight, and its I2C traffic delays the IMU and
+  // ADC on the same bus: stop polling input and redraw only on state changes
+  if (state != IDLE && state != LANDED) {
+    drawFlightScreen(state);
+    return;
+  }
+  flightScreenState = -1;
+
+  if (inScreensaver || inPreview) {
+    checkForInteraction();
+  } else {
+    handleInput();
+  }
+
+  // Redraw only once the previous frame has reached the panel
+  if (!displayFlushIdle()) return;
   if (inScreensaver) {
     drawScreensaver();
-    checkForInteraction();
   } else if (inPreview) {
     drawPreview();
-    checkForInteraction();
   } else {
-    handleInput();
     drawMenu();
   }
 }
 
+static bool buttonsLocked() {
+  return halMillis() - lastButtonTime < buttonLockout;
+}
+
 static void handleInput() {
   int potValue = analogRead(POT_PIN);
   int mappedIndex = map(potValue, 0, 1023, 0, currentMenuSize - 1);
 
   if (mappedIndex != menuIndex) {
     menuIndex = mappedIndex;
-    lastInteractionTime = millis();
+    lastInteractionTime = halMillis();
     scrollOffset = 0;
     if (menuIndex < menuScrollOffset) {
       menuScrollOffset = menuIndex;
@@ -159,8 +195,8 @@ static void handleInput() {
 
   lastPotValue = potValue;
 
-  if (digitalRead(BTN_SELECT) == LOW) {
-    lastInteractionTime = millis();
+  if (!buttonsLocked() && digitalRead(BTN_SELECT) == LOW) {
+    lastInteractionTime = halMillis();
     if (subMenuLevel == 0) {
       selectedModule = menuIndex;
       switch (menuIndex) {
@@ -205,17 +241,17 @@ static void handleInput() {
         }
       } else if (menuIndex == 0) {
         toggleEnableDisable();
-        saveSettingsToSD();
+        requestConfigCommit();
       } else if (menuIndex == 1) {
         inPreview = true;
         scrollOffset = 0;
       }
     }
-    delay(300);
+    lastButtonTime = halMillis();
   }
 
-  if (digitalRead(BTN_BACK) == LOW && subMenuLevel > 0) {
-    lastInteractionTime = millis();
+  if (!buttonsLocked() && digitalRead(BTN_BACK) == LOW && subMenuLevel > 0) {
+    lastInteractionTime = halMillis();
     if (subMenuLevel == 2) {
       subMenuLevel = 1;
       menuIndex = selectedHardware;
@@ -234,10 +270,10 @@ static void handleInput() {
       subMenuLevel = 0;
       menuIndex = selectedModule;
     }
-    delay(300);
+    lastButtonTime = halMillis();
   }
 
-  if (millis() - lastInteractionTime > screensaverTimeout) {
+  if (halMillis() - lastInteractionTime > screensaverTimeout) {
     inScreensaver = true;
   }
 }
@@ -267,6 +303,7 @@ static void toggleEnableDisable() {
 }
 
 static void checkForInteraction() {
+  if (buttonsLocked()) return;
   int potValue = analogRead(POT_PIN);
 
   if (abs(potValue - lastPotValue) > deadbandThreshold ||
@@ -274,13 +311,47 @@ static void checkForInteraction() {
       digitalRead(BTN_BACK) == LOW) {
     inScreensaver = false;
     inPreview = false;
-    lastInteractionTime = millis();
-    delay(300);
+    lastInteractionTime = halMillis();
+    lastButtonTime = halMillis();
   }
 
   lastPotValue = potValue;
 }
 
+// Queues the changed parts of the frame buffer; updateDisplayFlush() sends them
+static void pushDisplay() {
+  displayFlushFrame();
+}
+
+// GPIO only, no bus traffic; pins change only when the state does
+static void showStateLeds(FlightState state) {
+  if (ledState == state) return;
+  int leds[] = {LED_1_PIN, LED_2_PIN, LED_3_PIN, LED_4_PIN};
+  for (int i = 0; i < 4; i++) {
+    digitalWrite(leds[i], (stateLeds[state] >> i) & 1 ? HIGH : LOW);
+  }
+  ledState = state;
+}
+
+static void drawFlightScreen(FlightState state) {
+  bool due = flightScreenState != state ||
+             (hidFlightRefreshMs && halMillis() - lastFlightDraw >= hidFlightRefreshMs);
+  if (!due || !displayFlushIdle()) return;
+
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setCursor(10, 2);
+  display.print("Flight");
+  display.setTextSize(2);
+  display.setCursor(10, 26);
+  display.print(stateNames[state]);
+  display.setTextSize(1);
+  pushDisplay();
+
+  flightScreenState = state;
+  lastFlightDraw = halMillis();
+}
+
 static void drawMenu() {
   display.clearDisplay();
 
@@ -309,7 +380,7 @@ static void drawMenu() {
     display.fillRect(scrollbarX, scrollBarPosition, 3, scrollbarHeight, SSD1306_WHITE);
   }
 
-  display.display();
+  pushDisplay();
 }
 
 static void drawScreensaver() {
@@ -328,8 +399,7 @@ static void drawScreensaver() {
     rocketY = SCREEN_HEIGHT - 10;
   }
 
-  display.display();
-  delay(50);
+  pushDisplay();
 }
 
 static void drawPreview() {
@@ -341,17 +411,19 @@ static void drawPreview() {
 
   char buffer[64];
   int textWidth;
+  SensorSample sample;
   switch (selectedModule) {
     case 0: // Sensors
-      if (selectedHardware == 0 && max31855Enabled) {
-        snprintf(buffer, sizeof(buffer), "Temp: %.2f C", readTemperature());
-      } else if (selectedHardware == 1 && mpu6500Enabled) {
-        float ax, ay, az, gx, gy, gz;
-        readIMU(ax, ay, az, gx, gy, gz);
-        snprintf(buffer, sizeof(buffer), "AX:%.1f AY:%.1f AZ:%.1f GX:%.1f GY:%.1f GZ:%.1f", ax, ay, az, gx, gy, gz);
-      } else if (selectedHardware == 2 && ads1115Enabled) {
+      if (selectedHardware == 0 && max31855Enabled && latestSample(SAMPLE_TEMP, sample)) {
+        snprintf(buffer, sizeof(buffer), "Temp: %.2f C", sample.temperature);
+      } else if (selectedHardware == 1 && mpu6500Enabled && latestSample(SAMPLE_IMU, sample)) {
+        snprintf(buffer, sizeof(buffer), "AX:%.1f AY:%.1f AZ:%.1f GX:%.1f GY:%.1f GZ:%.1f",
+                 sample.imu.accel[0], sample.imu.accel[1], sample.imu.accel[2],
+                 sample.imu.gyro[0], sample.imu.gyro[1], sample.imu.gyro[2]);
+      } else if (selectedHardware == 2 && ads1115Enabled && latestSample(SAMPLE_ADC, sample)) {
         snprintf(buffer, sizeof(buffer), "V0: %.3f V1: %.3f V2: %.3f V3: %.3f",
-                 readADCVoltage(0), readADCVoltage(1), readADCVoltage(2), readADCVoltage(3));
+                 adcToVoltage(sample.adc[0]), adcToVoltage(sample.adc[1]),
+                 adcToVoltage(sample.adc[2]), adcToVoltage(sample.adc[3]));
       } else {
         snprintf(buffer, sizeof(buffer), "Disabled");
       }
@@ -380,7 +452,7 @@ static void drawPreview() {
       else snprintf(buffer, sizeof(buffer), "N/A");
       break;
     case 5: // FlightController
-      snprintf(buffer, sizeof(buffer), "State: N/A");
+      snprintf(buffer, sizeof(buffer), "State: %s", stateNames[getFlightState()]);
       break;
     case 6: // Config
       snprintf(buffer, sizeof(buffer), "Screen Timeout: %lu s", screensaverTimeout / 1000);
@@ -391,10 +463,10 @@ static void drawPreview() {
 
   textWidth = strlen(buffer) * 6;
   if (textWidth > SCREEN_WIDTH - 10) {
-    if (millis() - lastScrollTime > scrollDelay) {
+    if (halMillis() - lastScrollTime > scrollDelay) {
       scrollOffset += 6; // Scroll by one character width
       if (scrollOffset > textWidth - (SCREEN_WIDTH - 10)) scrollOffset = 0;
-      lastScrollTime = millis();
+      lastScrollTime = halMillis();
     }
     display.setCursor(10 - scrollOffset, 20);
   } else {
@@ -403,7 +475,7 @@ static void drawPreview() {
   }
   display.print(buffer);
 
-  display.display();
+  pushDisplay();
 }
 
 void drawStatusIcons(bool bluetooth, bool rs485, bool canbus, bool lora) {
@@ -443,48 +515,4 @@ static void bootAnimation() {
   }
 }
 
-static void saveSettingsToSD() {
-#if ENABLE_SD
-  FsFile settingsFile;
-  if (settingsFile.open("settings.txt", O_RDWR | O_CREAT | O_TRUNC)) {
-    settingsFile.print("MAX31855="); settingsFile.println(max31855Enabled ? "1" : "0");
-    settingsFile.print("MPU6500="); settingsFile.println(mpu6500Enabled ? "1" : "0");
-    settingsFile.print("ADS1115="); settingsFile.println(ads1115Enabled ? "1" : "0");
-    settingsFile.print("RS485="); settingsFile.println(rs485Enabled ? "1" : "0");
-    settingsFile.print("CANBUS="); settingsFile.println(canbusEnabled ? "1" : "0");
-    settingsFile.print("Bluetooth="); settingsFile.println(bluetoothEnabled ? "1" : "0");
-    settingsFile.print("LoRa="); settingsFile.println(loraEnabled ? "1" : "0");
-    settingsFile.print("SD="); settingsFile.println(sdEnabled ? "1" : "0");
-    settingsFile.print("W25Q128="); settingsFile.println(w25q128Enabled ? "1" : "0");
-    settingsFile.print("Relay0="); settingsFile.println(relay0Enabled ? "1" : "0");
-    settingsFile.print("PWM1="); settingsFile.println(pwm1Enabled ? "1" : "0");
-    settingsFile.close();
-  }
-#endif
-}
-
-static void loadSettingsFromSD() {
-#if ENABLE_SD
-  FsFile settingsFile;
-  if (settingsFile.open("settings.txt", O_READ)) {
-    char line[32];
-    while (settingsFile.available()) {
-      settingsFile.fgets(line, sizeof(line));
-      if (strncmp(line, "MAX31855=", 9) == 0) max31855Enabled = (line[9] == '1');
-      else if (strncmp(line, "MPU6500=", 8) == 0) mpu6500Enabled = (line[8] == '1');
-      else if (strncmp(line, "ADS1115=", 8) == 0) ads1115Enabled = (line[8] == '1');
-      else if (strncmp(line, "RS485=", 6) == 0) rs485Enabled = (line[6] == '1');
-      else if (strncmp(line, "CANBUS=", 7) == 0) canbusEnabled = (line[7] == '1');
-      else if (strncmp(line, "Bluetooth=", 10) == 0) bluetoothEnabled = (line[10] == '1');
-      else if (strncmp(line, "LoRa=", 5) == 0) loraEnabled = (line[5] == '1');
-      else if (strncmp(line, "SD=", 3) == 0) sdEnabled = (line[3] == '1');
-      else if (strncmp(line, "W25Q128=", 8) == 0) w25q128Enabled = (line[8] == '1');
-      else if (strncmp(line, "Relay0=", 7) == 0) relay0Enabled = (line[7] == '1');
-      else if (strncmp(line, "PWM1=", 5) == 0) pwm1Enabled = (line[5] == '1');
-    }
-    settingsFile.close();
-  }
-#endif
-}
-
 #endif
\ No newline at end of file
@@ -5,6 +5,12 @@
 #include "Config.h"
 
 #if ENABLE_HID
+extern uint32_t hidFlightRefreshMs; // Display refresh outside IDLE/LANDED, 0 = only on state changes
+// Module toggles from the menu
+extern bool max31855Enabled, mpu6500Enabled, ads1115Enabled;
+extern bool rs485Enabled, canbusEnabled, bluetoothEnabled, loraEnabled;
+extern bool sdEnabled, w25q128Enabled, relay0Enabled, pwm1Enabled;
+
 void initHID();
 void updateHID();
 void drawStatusIcons(bool bluetooth, bool rs485, bool canbus, bool lora);
@@ -0,0 +1,64 @@
+#include "Hal.h"
+
+static uint32_t hardwareMicros() {
+  return micros();
+}
+
+static uint32_t hardwareMillis() {
+  return millis();
+}
+
+static const HalClock hardwareClock = {hardwareMicros, hardwareMillis};
+
+HalClock halClock = hardwareClock;
+
+void setHalClock(const HalClock& clock) {
+  halClock = clock;
+}
+
+void resetHalClock() {
+  halClock = hardwareClock;
+}
+
+#if ENABLE_W25Q128
+#include <SPIFlash.h>
+static SPIFlash w25q128(W25Q128_CS_PIN);
+
+static bool w25q128Begin() {
+  return w25q128.initialize(); // Checks the chip ID
+}
+
+static bool w25q128Busy() {
+  return w25q128.busy();
+}
+
+static void w25q128Read(uint32_t address, void* data, uint16_t length) {
+  w25q128.readBytes(address, data, length);
+}
+
+static void w25q128Program(uint32_t address, const void* data, uint16_t length) {
+  w25q128.writeBytes(address, data, length);
+}
+
+static void w25q128Erase(uint32_t address) {
+  w25q128.blockErase4K(address);
+}
+
+static const HalFlash hardwareFlash = {w25q128Begin, w25q128Busy, w25q128Read, w25q128Program, w25q128Erase};
+#else
+static bool noFlashBegin() {
+  return false;
+}
+
+static const HalFlash hardwareFlash = {noFlashBegin, nullptr, nullptr, nullptr, nullptr};
+#endif
+
+HalFlash halFlash = hardwareFlash;
+
+void setHalFlash(const HalFlash& flash) {
+  halFlash = flash;
+}
+
+void resetHalFlash() {
+  halFlash = hardwareFlash;
+}
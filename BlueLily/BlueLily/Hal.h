@@ -0,0 +1,44 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Thin hardware abstraction for the services the firmware modules share.
+// Each one defaults to the Teensy hardware and can be swapped at runtime,
+// e.g. for a virtual clock or a file-backed flash image when running the
+// firmware off-target. Sensors are swapped through SamplerBackend instead.
+
+// Time source. All timing in the firmware modules goes through
+// halMicros()/halMillis() so one call switches everything to another clock.
+struct HalClock {
+  uint32_t (*micros)();
+  uint32_t (*millis)();
+};
+
+extern HalClock halClock;
+
+inline uint32_t halMicros() { return halClock.micros(); }
+inline uint32_t halMillis() { return halClock.millis(); }
+
+void setHalClock(const HalClock& clock);
+void resetHalClock(); // Back to the hardware clock
+
+// NOR flash device (W25Q128 by default). Addresses are byte offsets;
+// program() must not cross a 256-byte page and eraseSector() takes a 4 KB
+// aligned address. program() and eraseSector() return once the operation
+// has started; busy() reports when it has finished.
+struct HalFlash {
+  bool (*begin)();
+  bool (*busy)();
+  void (*read)(uint32_t address, void* data, uint16_t length);
+  void (*program)(uint32_t address, const void* data, uint16_t length);
+  void (*eraseSector)(uint32_t address);
+};
+
+extern HalFlash halFlash;
+
+void setHalFlash(const HalFlash& flash);
+void resetHalFlash(); // Back to the W25Q128
+
+#endif
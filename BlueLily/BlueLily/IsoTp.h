@@ -0,0 +1,282 @@
+#ifndef ISOTP_H
+#define ISOTP_H
+
+// ISO 15765-2 (ISO-TP) style segmented transport over 8-byte CAN frames,
+// normal addressing, shared by the firmware and host-side tools. Only
+// depends on the C standard library.
+//
+// Frame types (high nibble of byte 0):
+//   0 single      [0x0L] data          L = 1..7 bytes
+//   1 first       [0x1H LL] data       12-bit message length, 6 data bytes
+//   2 consecutive [0x2N] data          N = sequence number mod 16, 7 data bytes
+//   3 flow ctrl   [0x3S BS STmin]      S: 0 continue, 1 wait, 2 overflow
+//
+// After a first frame the receiver answers with a flow control frame. The
+// sender then sends BS consecutive frames (0 = all of them) at least STmin
+// apart, and waits for the next flow control frame. STmin is 0x00-0x7F ms,
+// or 0xF1-0xF9 for 100-900 us.
+//
+// An IsoTpLink handles one ID pair. Frames for its receive ID go to
+// isoTpReceiveFrame(); isoTpPoll() sends due consecutive frames and
+// expires stalled transfers. Frames go out through the sendFrame callback,
+// which returns false when the controller has no free TX buffer; the frame
+// is then retried on the next poll.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef ISOTP_MAX_MESSAGE
+#define ISOTP_MAX_MESSAGE 1024 // Up to 4095
+#endif
+
+#define ISOTP_SINGLE 0x00
+#define ISOTP_FIRST 0x10
+#define ISOTP_CONSECUTIVE 0x20
+#define ISOTP_FLOW_CONTROL 0x30
+#define ISOTP_FC_CONTINUE 0
+#define ISOTP_FC_WAIT 1
+#define ISOTP_FC_OVERFLOW 2
+
+struct IsoTpStats {
+  uint32_t rxMessages;
+  uint32_t txMessages;
+  uint32_t rxErrors;   // Out-of-sequence or unexpected frames
+  uint32_t overflows;  // Messages longer than ISOTP_MAX_MESSAGE (either way)
+  uint32_t timeouts;   // Transfers abandoned waiting for the peer
+};
+
+enum IsoTpTxState : uint8_t {
+  ISOTP_TX_IDLE = 0,
+  ISOTP_TX_FIRST,   // Single or first frame not yet accepted by the controller
+  ISOTP_TX_WAIT_FC,
+  ISOTP_TX_SENDING
+};
+
+struct IsoTpLink {
+  bool (*sendFrame)(const uint8_t* data, uint8_t length);
+  uint8_t blockSize;   // Advertised to senders, 0 = no flow control pauses
+  uint8_t stMin;       // Advertised to senders, ISO-TP encoding
+  uint32_t timeoutUs;  // N_Bs / N_Cr: longest wait for the peer's next frame
+
+  // Receive
+  uint8_t rxBuffer[ISOTP_MAX_MESSAGE];
+  uint16_t rxLength;
+  uint16_t rxReceived;
+  uint8_t rxSequence;
+  uint8_t rxBlockCount;
+  bool rxActive;
+  uint32_t rxLastUs;
+  uint8_t rxFlowPending;    // Flow control frame still to send, status + 1
+
+  // Transmit
+  uint8_t txBuffer[ISOTP_MAX_MESSAGE];
+  uint16_t txLength;
+  uint16_t txSent;
+  uint8_t txSequence;
+  IsoTpTxState txState;
+  uint8_t txBlockSize;      // From the peer's flow control
+  uint8_t txBlockRemaining;
+  uint32_t txStMinUs;
+  uint32_t txLastUs;        // Last frame sent, or flow control wait start
+
+  IsoTpStats stats;
+};
+
+inline void isoTpInit(IsoTpLink& link, bool (*sendFrame)(const uint8_t*, uint8_t),
+                      uint8_t blockSize, uint8_t stMin, uint32_t timeoutUs) {
+  memset(&link, 0, sizeof(link));
+  link.sendFrame = sendFrame;
+  link.blockSize = blockSize;
+  link.stMin = stMin;
+  link.timeoutUs = timeoutUs;
+}
+
+inline uint32_t isoTpStMinUs(uint8_t stMin) {
+  if (stMin <= 0x7F) return stMin * 1000UL;
+  if (stMin >= 0xF1 && stMin <= 0xF9) return (stMin - 0xF0) * 100UL;
+  return 127000UL; // Reserved values mean the longest time
+}
+
+inline bool isoTpTxIdle(const IsoTpLink& link) {
+  return link.txState == ISOTP_TX_IDLE;
+}
+
+inline void isoTpSendFlowControl(IsoTpLink& link, uint8_t status) {
+  uint8_t frame[3] = {(uint8_t)(ISOTP_FLOW_CONTROL | status), link.blockSize, link.stMin};
+  link.rxFlowPending = link.sendFrame(frame, sizeof(frame)) ? 0 : status + 1;
+}
+
+// Sends the single or first frame of the message in txBuffer
+inline void isoTpSendFirst(IsoTpLink& link, uint32_t nowUs) {
+  uint8_t frame[8];
+  if (link.txLength <= 7) {
+    frame[0] = ISOTP_SINGLE | link.txLength;
+    memcpy(frame + 1, link.txBuffer, link.txLength);
+    if (!link.sendFrame(frame, link.txLength + 1)) return;
+    link.txState = ISOTP_TX_IDLE;
+    link.stats.txMessages++;
+    return;
+  }
+  frame[0] = ISOTP_FIRST | (link.txLength >> 8);
+  frame[1] = link.txLength & 0xFF;
+  memcpy(frame + 2, link.txBuffer, 6);
+  if (!link.sendFrame(frame, 8)) return;
+  link.txSent = 6;
+  link.txSequence = 1;
+  link.txState = ISOTP_TX_WAIT_FC;
+  link.txLastUs = nowUs;
+}
+
+// Starts sending a message (copied into the link). Returns false while a
+// previous message is still going out, or if it is too long.
+inline bool isoTpSend(IsoTpLink& link, const void* data, uint16_t length, uint32_t nowUs) {
+  if (link.txState != ISOTP_TX_IDLE) return false;
+  if (length > ISOTP_MAX_MESSAGE) {
+    link.stats.overflows++;
+    return false;
+  }
+  memcpy(link.txBuffer, data, length);
+  link.txLength = length;
+  link.txState = ISOTP_TX_FIRST;
+  link.txLastUs = nowUs;
+  isoTpSendFirst(link, nowUs);
+  return true;
+}
+
+// Sends up to maxFrames consecutive frames that are due and expires
+// stalled transfers. Call often; maxFrames bounds the time per call.
+inline void isoTpPoll(IsoTpLink& link, uint32_t nowUs, uint8_t maxFrames) {
+  if (link.rxFlowPending && link.rxActive) isoTpSendFlowControl(link, link.rxFlowPending - 1);
+  if (link.rxActive && nowUs - link.rxLastUs > link.timeoutUs) {
+    link.rxActive = false;
+    link.stats.timeouts++;
+  }
+  if (link.txState == ISOTP_TX_FIRST) isoTpSendFirst(link, nowUs);
+  if (link.txState == ISOTP_TX_FIRST || link.txState == ISOTP_TX_WAIT_FC) {
+    if (nowUs - link.txLastUs > link.timeoutUs) {
+      link.txState = ISOTP_TX_IDLE;
+      link.stats.timeouts++;
+    }
+    return;
+  }
+  while (link.txState == ISOTP_TX_SENDING && maxFrames--) {
+    if (nowUs - link.txLastUs < link.txStMinUs) return;
+    uint8_t frame[8];
+    uint16_t chunk = link.txLength - link.txSent;
+    if (chunk > 7) chunk = 7;
+    frame[0] = ISOTP_CONSECUTIVE | (link.txSequence & 0x0F);
+    memcpy(frame + 1, link.txBuffer + link.txSent, chunk);
+    if (!link.sendFrame(frame, chunk + 1)) return;
+    link.txSent += chunk;
+    link.txSequence++;
+    link.txLastUs = nowUs;
+    if (link.txSent == link.txLength) {
+      link.txState = ISOTP_TX_IDLE;
+      link.stats.txMessages++;
+    } else if (link.txBlockSize && --link.txBlockRemaining == 0) {
+      link.txState = ISOTP_TX_WAIT_FC;
+    }
+  }
+}
+
+inline void isoTpHandleFlowControl(IsoTpLink& link, const uint8_t* data, uint8_t length, uint32_t nowUs) {
+  if (link.txState != ISOTP_TX_WAIT_FC || length < 3) {
+    link.stats.rxErrors++;
+    return;
+  }
+  switch (data[0] & 0x0F) {
+    case ISOTP_FC_CONTINUE:
+      link.txBlockSize = data[1];
+      link.txBlockRemaining = data[1];
+      link.txStMinUs = isoTpStMinUs(data[2]);
+      link.txState = ISOTP_TX_SENDING;
+      link.txLastUs = nowUs - link.txStMinUs; // First frame of the block may go now
+      break;
+    case ISOTP_FC_WAIT:
+      link.txLastUs = nowUs;
+      break;
+    default:
+      link.txState = ISOTP_TX_IDLE;
+      link.stats.overflows++;
+  }
+}
+
+// Feeds one received CAN frame. Returns true when it completes a message,
+// which is then in rxBuffer[0 .. rxLength) until the next call.
+inline bool isoTpReceiveFrame(IsoTpLink& link, const uint8_t* data, uint8_t length, uint32_t nowUs) {
+  if (length == 0) return false;
+  switch (data[0] & 0xF0) {
+    case ISOTP_SINGLE: {
+      uint8_t size = data[0] & 0x0F;
+      if (size == 0 || size > 7 || size + 1 > length) {
+        link.stats.rxErrors++;
+        return false;
+      }
+      if (link.rxActive) link.stats.rxErrors++; // Aborts the message in progress
+      link.rxActive = false;
+      memcpy(link.rxBuffer, data + 1, size);
+      link.rxLength = size;
+      link.stats.rxMessages++;
+      return true;
+    }
+    case ISOTP_FIRST: {
+      uint16_t size = ((data[0] & 0x0F) << 8) | data[1];
+      if (length < 8 || size <= 7) {
+        link.stats.rxErrors++;
+        return false;
+      }
+      if (link.rxActive) link.stats.rxErrors++;
+      link.rxActive = false;
+      if (size > ISOTP_MAX_MESSAGE) {
+        link.stats.overflows++;
+        isoTpSendFlowControl(link, ISOTP_FC_OVERFLOW);
+        return false;
+      }
+      memcpy(link.rxBuffer, data + 2, 6);
+      link.rxLength = size;
+      link.rxReceived = 6;
+      link.rxSequence = 1;
+      link.rxBlockCount = 0;
+      link.rxActive = true;
+      link.rxLastUs = nowUs;
+      isoTpSendFlowControl(link, ISOTP_FC_CONTINUE);
+      return false;
+    }
+    case ISOTP_CONSECUTIVE: {
+      if (!link.rxActive || (data[0] & 0x0F) != (link.rxSequence & 0x0F)) {
+        if (link.rxActive) link.rxActive = false; // Lost a frame, drop the message
+        link.stats.rxErrors++;
+        return false;
+      }
+      uint16_t chunk = link.rxLength - link.rxReceived;
+      if (chunk > 7) chunk = 7;
+      if (length < chunk + 1) {
+        link.rxActive = false;
+        link.stats.rxErrors++;
+        return false;
+      }
+      memcpy(link.rxBuffer + link.rxReceived, data + 1, chunk);
+      link.rxReceived += chunk;
+      link.rxSequence++;
+      link.rxLastUs = nowUs;
+      if (link.rxReceived == link.rxLength) {
+        link.rxActive = false;
+        link.stats.rxMessages++;
+        return true;
+      }
+      if (link.blockSize && ++link.rxBlockCount == link.blockSize) {
+        link.rxBlockCount = 0;
+        isoTpSendFlowControl(link, ISOTP_FC_CONTINUE);
+      }
+      return false;
+    }
+    case ISOTP_FLOW_CONTROL:
+      isoTpHandleFlowControl(link, data, length, nowUs);
+      return false;
+  }
+  link.stats.rxErrors++;
+  return false;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+// Binary flight log format, shared by the Logger and host-side tools.
+// Only depends on the C standard library.
+//
+// File = header, then a stream of records:
+//   header:  "BLOG" | version (u8) | schema length (u16) | schema text
+//   record:  tag (u8) | timestamp delta in us (LEB128 varint) | payload
+//   sync:    A5 5A A5 5A | absolute timestamp in us (u32)
+//
+// A sync marker is emitted before the first record and every
+// LOG_SYNC_INTERVAL records. Deltas are relative to the previous record or
+// sync, so a decoder that hits corruption scans for the next sync marker
+// and continues from its absolute timestamp. All multi-byte values are
+// little-endian.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "LogFormat.h assumes a little-endian target"
+#endif
+
+#define LOG_VERSION 1
+#define LOG_SYNC_INTERVAL 64
+#define LOG_SYNC_SIZE 8
+#define LOG_MAX_TEXT 64
+#define LOG_MAX_RECORD_SIZE (LOG_SYNC_SIZE + 1 + 5 + 1 + LOG_MAX_TEXT)
+
+enum LogTag : uint8_t {
+  LOG_TAG_IMU = 1,
+  LOG_TAG_TEMP = 2,
+  LOG_TAG_ADC = 3,
+  LOG_TAG_FLIGHT = 4,
+  LOG_TAG_TEXT = 5,   // u8 length + characters
+  LOG_TAG_SYNC = 0xA5
+};
+
+struct __attribute__((packed)) LogImuRecord {
+  float accel[3]; // m/s^2
+  float gyro[3];  // rad/s
+};
+
+struct __attribute__((packed)) LogTempRecord {
+  float temperature;
+};
+
+struct __attribute__((packed)) LogAdcRecord {
+  int16_t adc[4];
+};
+
+struct __attribute__((packed)) LogFlightRecord {
+  uint8_t state;
+  float altitude;
+  float velocity;
+  float verticalAccel;
+  float temperature;
+  int16_t adc0;
+};
+
+// Self-description written into the header so tools can label columns
+static const char LOG_SCHEMA[] =
+  "1=IMU:f32 ax,f32 ay,f32 az,f32 gx,f32 gy,f32 gz;"
+  "2=TEMP:f32 temp;"
+  "3=ADC:i16 a0,i16 a1,i16 a2,i16 a3;"
+  "4=FC:u8 state,f32 alt,f32 vel,f32 accel,f32 temp,i16 adc0;"
+  "5=TEXT:str text;";
+
+static const uint8_t LOG_MAGIC[4] = {'B', 'L', 'O', 'G'};
+static const uint8_t LOG_SYNC_PATTERN[4] = {0xA5, 0x5A, 0xA5, 0x5A};
+
+// Fixed payload size for a tag, 0 for variable-length or unknown tags
+inline uint8_t logPayloadSize(uint8_t tag) {
+  switch (tag) {
+    case LOG_TAG_IMU: return sizeof(LogImuRecord);
+    case LOG_TAG_TEMP: return sizeof(LogTempRecord);
+    case LOG_TAG_ADC: return sizeof(LogAdcRecord);
+    case LOG_TAG_FLIGHT: return sizeof(LogFlightRecord);
+    default: return 0;
+  }
+}
+
+#define LOG_HEADER_SIZE (4 + 1 + 2 + sizeof(LOG_SCHEMA) - 1)
+
+// Writes the file header into `out` (at least LOG_HEADER_SIZE bytes)
+inline size_t logEncodeHeader(uint8_t* out) {
+  uint16_t schemaLength = sizeof(LOG_SCHEMA) - 1;
+  memcpy(out, LOG_MAGIC, 4);
+  out[4] = LOG_VERSION;
+  out[5] = schemaLength & 0xFF;
+  out[6] = schemaLength >> 8;
+  memcpy(out + 7, LOG_SCHEMA, schemaLength);
+  return LOG_HEADER_SIZE;
+}
+
+struct LogEncoder {
+  uint32_t lastTimestampUs;
+  uint16_t sinceSync;
+};
+
+inline void logEncoderReset(LogEncoder& enc) {
+  enc.lastTimestampUs = 0;
+  enc.sinceSync = 0;
+}
+
+// Encodes one record (plus a sync marker when due) into `out`, which must
+// hold LOG_MAX_RECORD_SIZE bytes. Returns the number of bytes written.
+inline size_t logEncodeRecord(LogEncoder& enc, uint8_t* out, uint8_t tag, uint32_t timestampUs,
+                              const void* payload, uint8_t length) {
+  size_t pos = 0;
+  if (enc.sinceSync == 0) {
+    memcpy(out, LOG_SYNC_PATTERN, 4);
+    memcpy(out + 4, &timestampUs, 4);
+    pos = LOG_SYNC_SIZE;
+    enc.lastTimestampUs = timestampUs;
+  }
+  enc.sinceSync = (enc.sinceSync + 1) % LOG_SYNC_INTERVAL;
+
+  out[pos++] = tag;
+  uint32_t delta = timestampUs - enc.lastTimestampUs;
+  enc.lastTimestampUs = timestampUs;
+  do {
+    uint8_t byte = delta & 0x7F;
+    delta >>= 7;
+    out[pos++] = delta ? (byte | 0x80) : byte;
+  } while (delta);
+
+  if (tag == LOG_TAG_TEXT) {
+    if (length > LOG_MAX_TEXT) length = LOG_MAX_TEXT;
+    out[pos++] = length;
+  }
+  memcpy(out + pos, payload, length);
+  return pos + length;
+}
+
+// Decoded view into the input buffer (no copy)
+struct LogRecordView {
+  uint8_t tag;         // 0 when nothing was produced
+  uint32_t timestampUs;
+  const uint8_t* payload;
+  uint8_t length;
+};
+
+struct LogDecoder {
+  uint32_t timestampUs;
+  bool synced;
+  uint32_t records;
+  uint32_t resyncs;    // Times sync was lost and re-acquired
+};
+
+inline void logDecoderReset(LogDecoder& dec) {
+  dec.timestampUs = 0;
+  dec.synced = false;
+  dec.records = 0;
+  dec.resyncs = 0;
+}
+
+// Decodes at most one record from data[0..len). Returns the number of
+// bytes consumed; `rec.tag` is 0 if those bytes were a sync marker or
+// skipped garbage. Returns 0 when more input is needed.
+inline size_t logDecodeRecord(LogDecoder& dec, const uint8_t* data, size_t len, LogRecordView& rec) {
+  rec.tag = 0;
+  if (!dec.synced) {
+    for (size_t i = 0; i + 4 <= len; i++) {
+      if (memcmp(data + i, LOG_SYNC_PATTERN, 4) == 0) {
+        if (i + LOG_SYNC_SIZE > len) return i;
+        memcpy(&dec.timestampUs, data + i + 4, 4);
+        dec.synced = true;
+        return i + LOG_SYNC_SIZE;
+      }
+    }
+    return len > 3 ? len - 3 : 0;
+  }
+
+  if (len < 1) return 0;
+  uint8_t tag = data[0];
+  if (tag == LOG_TAG_SYNC) {
+    if (len < LOG_SYNC_SIZE) return 0;
+    if (memcmp(data, LOG_SYNC_PATTERN, 4) != 0) {
+      dec.synced = false;
+      dec.resyncs++;
+      return 1;
+    }
+    memcpy(&dec.timestampUs, data + 4, 4);
+    return LOG_SYNC_SIZE;
+  }
+  if (tag != LOG_TAG_TEXT && logPayloadSize(tag) == 0) {
+    dec.synced = false;
+    dec.resyncs++;
+    return 1;
+  }
+
+  size_t pos = 1;
+  uint32_t delta = 0;
+  for (uint8_t shift = 0;; shift += 7) {
+    if (pos >= len) return 0;
+    if (shift > 28) {
+      dec.synced = false;
+      dec.resyncs++;
+      return 1;
+    }
+    uint8_t byte = data[pos++];
+    delta |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) break;
+  }
+
+  uint8_t length = logPayloadSize(tag);
+  if (tag == LOG_TAG_TEXT) {
+    if (pos >= len) return 0;
+    length = data[pos++];
+  }
+  if (pos + length > len) return 0;
+
+  dec.timestampUs += delta;
+  dec.records++;
+  rec.tag = tag;
+  rec.timestampUs = dec.timestampUs;
+  rec.payload = data + pos;
+  rec.length = length;
+  return pos + length;
+}
+
+// Formats a decoded record as one CSV line (no newline), using the same
+// column order as LOG_SCHEMA. Returns the snprintf result.
+inline int logRecordToCsv(const LogRecordView& rec, char* out, size_t size) {
+  switch (rec.tag) {
+    case LOG_TAG_IMU: {
+      LogImuRecord r;
+      memcpy(&r, rec.payload, sizeof(r));
+      return snprintf(out, size, "IMU,%lu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f", (unsigned long)rec.timestampUs,
+                      r.accel[0], r.accel[1], r.accel[2], r.gyro[0], r.gyro[1], r.gyro[2]);
+    }
+    case LOG_TAG_TEMP: {
+      LogTempRecord r;
+      memcpy(&r, rec.payload, sizeof(r));
+      return snprintf(out, size, "TEMP,%lu,%.2f", (unsigned long)rec.timestampUs, r.temperature);
+    }
+    case LOG_TAG_ADC: {
+      LogAdcRecord r;
+      memcpy(&r, rec.payload, sizeof(r));
+      return snprintf(out, size, "ADC,%lu,%d,%d,%d,%d", (unsigned long)rec.timestampUs,
+                      r.adc[0], r.adc[1], r.adc[2], r.adc[3]);
+    }
+    case LOG_TAG_FLIGHT: {
+      LogFlightRecord r;
+      memcpy(&r, rec.payload, sizeof(r));
+      return snprintf(out, size, "FC,%lu,%u,%.2f,%.2f,%.2f,%.2f,%d", (unsigned long)rec.timestampUs,
+                      r.state, r.altitude, r.velocity, r.verticalAccel, r.temperature, r.adc0);
+    }
+    case LOG_TAG_TEXT:
+      return snprintf(out, size, "TEXT,%lu,%.*s", (unsigned long)rec.timestampUs, rec.length,
+                      (const char*)rec.payload);
+    default:
+      return 0;
+  }
+}
+
+#endif // LOGFORMAT_H
@@ -1,23 +1,219 @@
 #include <SdFat.h>
 #include "Logger.h"
 #include "Config.h"
+#include "Hal.h"
+#include "Sampler.h"
+#include "LogFormat.h"
+#include "Profiler.h"
+#include "Bus.h"
 
 #if ENABLE_SD
 #include "RingBuf.h"
 SdFs sd;
 FsFile file;
 RingBuf<FsFile, RING_BUF_CAPACITY> rb;
-#define LOG_FILENAME "FlightLog.csv"
+#define LOG_FILENAME "FlightLog.bin"
 #endif
 
+#include "FlashLog.h"
+
+#if ENABLE_SD && ENABLE_W25Q128
+// Raw flash pages (headers included) copied to SD in sequence order
+#define FLASH_IMAGE_FILENAME "FlashLog.img"
+static FsFile image;
+static uint32_t syncCursor = 0; // Next flash page sequence to copy
+static FlashSyncProgress syncProgress;
+static bool syncUnflushed = false;
+static bool syncCatchingUp = false;
+static uint32_t lastSyncFlush = 0;
+static uint32_t lastSyncReport = 0;
+#endif
+
+static SampleCursor sampleCursor;
+static LogEncoder encoder;
+
+// Log preview requested at landing, gathered one flash page per
+// updateLogger() call through the bus arbiter and printed when complete
+static bool previewPending = false;
 #if ENABLE_W25Q128
-#include <SPIFlash.h>
-SPIFlash flash(W25Q128_CS_PIN); // Constructor initializes with CS pin
-uint32_t flashAddress = 0;      // Global variable for flash write position
+static uint32_t previewCursor = 0;
+static uint8_t previewBuffer[4 * FLASH_PAGE_PAYLOAD];
+static uint32_t previewLength = 0;
 #endif
 
-void initLogger() {
 #if ENABLE_SD
+static void writeSD(const uint8_t* data, size_t length) {
+  if (!file.isOpen()) return;
+  PROFILE_SCOPE(PROBE_SD_WRITE);
+  if (rb.bytesUsed() + file.curPosition() + length < SD_LOG_FILE_SIZE) {
+    rb.write(data, length);
+    if (rb.getWriteError()) {
+      Serial.println("SD RingBuf write error");
+    }
+    if (rb.bytesUsed() >= 512 && !file.isBusy()) {
+      if (512 != rb.writeOut(512)) {
+        Serial.println("SD writeOut failed");
+      }
+    }
+  } else {
+    Serial.println("SD file full");
+  }
+}
+#endif
+
+// Appends encoded bytes to every enabled log target
+static void writeLog(const uint8_t* data, size_t length) {
+#if ENABLE_SD
+  writeSD(data, length);
+#endif
+#if ENABLE_W25Q128
+  flashLogWrite(data, length);
+#endif
+}
+
+#if ENABLE_SD && ENABLE_W25Q128
+// Opens the SD image and resumes after the last whole page already in it,
+// so a reboot neither re-copies nor skips flash pages. Pages copied after
+// the last flush before a power loss are simply copied again.
+static void openSyncImage() {
+  syncCursor = flashLogOldestSequence();
+  if (!image.open(FLASH_IMAGE_FILENAME, O_RDWR | O_CREAT)) {
+    Serial.println("SD image open failed!");
+    return;
+  }
+  uint64_t size = image.fileSize() / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
+  image.truncate(size); // Drop a page torn by a power loss during sync
+  FlashPageHeader header;
+  if (size >= FLASH_PAGE_SIZE && image.seekSet(size - FLASH_PAGE_SIZE) &&
+      image.read(&header, sizeof(header)) == sizeof(header)) {
+    uint32_t next = header.sequence + 1;
+    if (next > syncCursor && next <= flashLogNextSequence()) syncCursor = next;
+  }
+  image.seekSet(size);
+}
+
+// Copies flash pages to the SD image until the time budget is spent, the
+// flash chip is busy writing or the card is busy
+static void updateFlashSync() {
+  if (!image.isOpen()) return;
+  PROFILE_SCOPE(PROBE_FLASH_SYNC);
+  uint32_t start = halMicros();
+  uint8_t page[FLASH_PAGE_SIZE];
+
+  if (syncCursor < flashLogOldestSequence()) syncCursor = flashLogOldestSequence();
+  while (syncCursor < flashLogNextSequence() && halMicros() - start < FLASH_SYNC_BUDGET_US) {
+    if (!flashLogIdle() || image.isBusy()) break;
+    if (!busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US)) break;
+    int16_t state = readFlashLogPage(syncCursor, page);
+    busEnd(BUS_DEV_FLASH);
+    if (state < 0) {
+      syncProgress.skippedPages++;
+    } else if (image.write(page, FLASH_PAGE_SIZE) == FLASH_PAGE_SIZE) {
+      syncProgress.copiedPages++;
+      syncUnflushed = true;
+    } else {
+      Serial.println("SD write failed during sync");
+      break;
+    }
+    syncCursor++;
+  }
+
+  if (syncUnflushed && halMillis() - lastSyncFlush >= FLASH_SYNC_FLUSH_MS && !image.isBusy()) {
+    image.flush();
+    syncUnflushed = false;
+    lastSyncFlush = halMillis();
+  }
+
+  uint32_t elapsed = halMicros() - start;
+  if (elapsed > syncProgress.maxTickUs) syncProgress.maxTickUs = elapsed;
+
+  // Report only a real backlog (e.g. after a reboot or landing), not the
+  // page or two the copy normally trails the write head by
+  uint32_t pending = flashLogNextSequence() - syncCursor;
+  if (pending > FLASH_PAGES_PER_SECTOR && halMillis() - lastSyncReport >= FLASH_SYNC_REPORT_MS) {
+    Serial.print("Flash sync pages pending: ");
+    Serial.println(pending);
+    syncCatchingUp = true;
+    lastSyncReport = halMillis();
+  } else if (syncCatchingUp && pending == 0) {
+    Serial.println("Flash sync caught up");
+    syncCatchingUp = false;
+  }
+}
+#endif
+
+static void logRecord(uint8_t tag, uint32_t timestampUs, const void* payload, uint8_t length) {
+  uint8_t buffer[LOG_MAX_RECORD_SIZE];
+  size_t size = logEncodeRecord(encoder, buffer, tag, timestampUs, payload, length);
+  writeLog(buffer, size);
+}
+
+// Decodes the start of a log image and prints it as CSV
+static void printRecords(const uint8_t* data, size_t length, uint8_t maxRecords) {
+  LogDecoder decoder;
+  logDecoderReset(decoder);
+  size_t pos = (length >= LOG_HEADER_SIZE && memcmp(data, LOG_MAGIC, 4) == 0) ? LOG_HEADER_SIZE : 0;
+  char line[128];
+  uint8_t printed = 0;
+  while (pos < length && printed < maxRecords) {
+    LogRecordView rec;
+    size_t used = logDecodeRecord(decoder, data + pos, length - pos, rec);
+    if (!used) break;
+    pos += used;
+    if (rec.tag && logRecordToCsv(rec, line, sizeof(line)) > 0) {
+      Serial.println(line);
+      printed++;
+    }
+  }
+}
+
+static void printPreview() {
+#if ENABLE_SD
+  if (!file.open(LOG_FILENAME, O_READ)) {
+    Serial.println("SD file reopen failed for preview!");
+  } else {
+    Serial.println("SD Data Preview (first 20 records):");
+    uint8_t sdBuffer[1024];
+    int bytesRead = file.read(sdBuffer, sizeof(sdBuffer));
+    if (bytesRead > 0) printRecords(sdBuffer, bytesRead, 20);
+    Serial.println("--- End SD Preview ---");
+    file.close();
+  }
+#endif
+
+#if ENABLE_W25Q128
+  Serial.println("W25Q128 Data Preview (first 20 records):");
+  printRecords(previewBuffer, previewLength, 20);
+  Serial.println("--- End W25Q128 Preview ---");
+#endif
+
+#if !ENABLE_SD && !ENABLE_W25Q128
+  Serial.println("No loggers enabled for preview");
+#endif
+}
+
+static void updatePreview() {
+  if (!previewPending) return;
+#if ENABLE_W25Q128
+  if (previewCursor < flashLogNextSequence() && previewLength + FLASH_PAGE_PAYLOAD <= sizeof(previewBuffer)) {
+    if (!flashLogIdle() || !busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US)) return;
+    uint8_t page[FLASH_PAGE_SIZE];
+    int16_t length = readFlashLogPage(previewCursor++, page);
+    busEnd(BUS_DEV_FLASH);
+    if (length > 0) {
+      memcpy(previewBuffer + previewLength, page + FLASH_PAGE_HEADER_SIZE, length);
+      previewLength += length;
+    }
+    return;
+  }
+#endif
+  previewPending = false;
+  printPreview();
+}
+
+#if ENABLE_SD
+// A card that fails leaves the flash log running on its own
+static void initSD() {
   if (!sd.begin(SD_CONFIG)) {
     Serial.println("SD init failed!");
     return;
@@ -33,45 +229,94 @@ void initLogger() {
   }
   rb.begin(&file);
   Serial.println("SD Logger Initialized");
+}
+#endif
+
+void initLogger() {
+  openSampleCursor(sampleCursor);
+  logEncoderReset(encoder);
+
+#if ENABLE_SD
+  initSD();
 #endif
 
 #if ENABLE_W25Q128
-  if (!flash.initialize()) { // Check if flash chip is present
-    Serial.println("W25Q128 init failed! Check wiring or chip ID.");
-    return;
+  if (!initFlashLog()) return;
+  if (getFlashLogStats().recoveredPages) {
+    Serial.print("W25Q128 log recovered, pages: ");
+    Serial.println(getFlashLogStats().recoveredPages);
   }
-  flashAddress = 0; // Reset position
   Serial.println("W25Q128 Logger Initialized");
 #endif
+
+#if ENABLE_SD && ENABLE_W25Q128
+  if (file.isOpen()) openSyncImage();
+#endif
+
+  // A recovered flash log already has its header; the encoder's leading
+  // sync marker lets a decoder pick the stream up again after the gap
+  uint8_t header[LOG_HEADER_SIZE];
+  size_t headerSize = logEncodeHeader(header);
+#if ENABLE_SD
+  writeSD(header, headerSize);
+#endif
+#if ENABLE_W25Q128
+  if (flashLogNextSequence() == flashLogOldestSequence()) flashLogWrite(header, headerSize);
+#endif
+}
+
+void startNewFlashLog() {
+#if ENABLE_W25Q128
+  clearFlashLog();
+  logEncoderReset(encoder);
+  uint8_t header[LOG_HEADER_SIZE];
+  flashLogWrite(header, logEncodeHeader(header));
+  Serial.println("W25Q128 new log started");
+#endif
 }
 
 void logData(const char* data) {
-#if ENABLE_SD
-  if (rb.bytesUsed() + file.curPosition() < SD_LOG_FILE_SIZE - 20) {
-    rb.println(data);
-    if (rb.getWriteError()) {
-      Serial.println("SD RingBuf write error");
-    }
-    if (rb.bytesUsed() >= 512 && !file.isBusy()) {
-      if (512 != rb.writeOut(512)) {
-        Serial.println("SD writeOut failed");
+  logRecord(LOG_TAG_TEXT, halMicros(), data, min(strlen(data), (size_t)LOG_MAX_TEXT));
+}
+
+void logFlightState(uint8_t state, float altitude, float velocity, float verticalAccel,
+                    float temperature, int16_t adc0) {
+  LogFlightRecord record = {state, altitude, velocity, verticalAccel, temperature, adc0};
+  logRecord(LOG_TAG_FLIGHT, halMicros(), &record, sizeof(record));
+}
+
+void updateLogger() {
+  SensorSample sample;
+  while (readSample(sampleCursor, sample)) {
+    switch (sample.type) {
+      case SAMPLE_IMU: {
+        LogImuRecord record;
+        memcpy(record.accel, sample.imu.accel, sizeof(record.accel));
+        memcpy(record.gyro, sample.imu.gyro, sizeof(record.gyro));
+        logRecord(LOG_TAG_IMU, sample.timestampUs, &record, sizeof(record));
+        break;
+      }
+      case SAMPLE_TEMP: {
+        LogTempRecord record = {sample.temperature};
+        logRecord(LOG_TAG_TEMP, sample.timestampUs, &record, sizeof(record));
+        break;
+      }
+      case SAMPLE_ADC: {
+        LogAdcRecord record;
+        memcpy(record.adc, sample.adc, sizeof(record.adc));
+        logRecord(LOG_TAG_ADC, sample.timestampUs, &record, sizeof(record));
+        break;
       }
     }
-  } else {
-    Serial.println("SD file full");
   }
-#endif
 
 #if ENABLE_W25Q128
-  if (flashAddress < W25Q128_CAPACITY - strlen(data) - 2) {
-    flash.writeBytes(flashAddress, (uint8_t*)data, strlen(data));
-    flashAddress += strlen(data);
-    flash.writeByte(flashAddress++, '\r');
-    flash.writeByte(flashAddress++, '\n');
-  } else {
-    Serial.println("W25Q128 full");
-  }
+  updateFlashLog();
 #endif
+#if ENABLE_SD && ENABLE_W25Q128
+  updateFlashSync();
+#endif
+  updatePreview();
 }
 
 void flushLogger() {
@@ -80,93 +325,40 @@ void flushLogger() {
   file.flush();
 #endif
 #if ENABLE_W25Q128
-  // Flash writes are immediate
+  flushFlashLog();
 #endif
 }
 
 void closeLogger() {
+  flushLogger(); // Also programs the flash log's partly filled page
 #if ENABLE_SD
-  flushLogger();
   file.truncate();
   file.close();
   Serial.println("SD Logger Closed");
 #endif
+#if ENABLE_SD && ENABLE_W25Q128
+  image.flush(); // The image stays open so the offload can finish
+  syncUnflushed = false;
+#endif
 #if ENABLE_W25Q128
   Serial.println("W25Q128 Logger Closed");
 #endif
 }
 
-void previewLoggedData() {
-#if ENABLE_SD
-  if (!file.open(LOG_FILENAME, O_READ)) {
-    Serial.println("SD file reopen failed for preview!");
-    return;
-  }
-  Serial.println("SD Data Preview (first 20 lines):");
-  uint8_t lineCount = 0;
-  while (file.available() && lineCount < 20) {
-    int c = file.read();
-    if (c < 0) break;
-    Serial.write(c);
-    if (c == '\n') lineCount++;
-  }
-  Serial.println("--- End SD Preview ---");
-  file.close();
-#endif
-
+void requestLogPreview() {
+  previewPending = true;
 #if ENABLE_W25Q128
-  Serial.println("W25Q128 Data Preview (first 256 bytes or until end):");
-  uint8_t buffer[256];
-  uint32_t bytesToRead = min(256, flashAddress);
-  flash.readBytes(0, buffer, bytesToRead);
-  for (uint32_t i = 0; i < bytesToRead; i++) {
-    Serial.write(buffer[i]);
-  }
-  Serial.println("--- End W25Q128 Preview ---");
-#endif
-
-#if !ENABLE_SD && !ENABLE_W25Q128
-  Serial.println("No loggers enabled for preview");
+  previewCursor = flashLogOldestSequence();
+  previewLength = 0;
 #endif
 }
 
-void syncFlashToSD() {
+FlashSyncProgress getFlashSyncProgress() {
 #if ENABLE_SD && ENABLE_W25Q128
-  if (!file.open(LOG_FILENAME, O_RDWR | O_APPEND)) {
-    Serial.println("SD file reopen failed for sync!");
-    return;
-  }
-  Serial.println("Syncing W25Q128 to SD...");
-  uint8_t buffer[512];
-  uint32_t bytesRead = 0;
-  uint32_t totalBytes = flashAddress;
-
-  while (bytesRead < totalBytes) {
-    uint32_t chunkSize = min(512, totalBytes - bytesRead);
-    flash.readBytes(bytesRead, buffer, chunkSize);
-    if (rb.bytesUsed() + file.curPosition() + chunkSize < SD_LOG_FILE_SIZE) {
-      rb.write(buffer, chunkSize);
-      if (rb.getWriteError()) {
-        Serial.println("SD RingBuf write error during sync");
-        break;
-      }
-      if (rb.bytesUsed() >= 512 && !file.isBusy()) {
-        if (512 != rb.writeOut(512)) {
-          Serial.println("SD writeOut failed during sync");
-          break;
-        }
-      }
-    } else {
-      Serial.println("SD file full during sync");
-      break;
-    }
-    bytesRead += chunkSize;
-  }
-  rb.sync();
-  file.flush();
-  file.close();
-  Serial.println("Sync complete");
+  syncProgress.pendingPages = flashLogNextSequence() - max(syncCursor, flashLogOldestSequence());
+  return syncProgress;
 #else
-  Serial.println("Sync requires both SD and W25Q128 enabled");
+  FlashSyncProgress progress = {};
+  return progress;
 #endif
-}
\ No newline at end of file
+}
@@ -4,11 +4,24 @@
 #include <Arduino.h>
 #include "Config.h"
 
+// Background copy of the W25Q128 log to FlashLog.img on the SD card. Runs
+// inside updateLogger() within FLASH_SYNC_BUDGET_US per call.
+struct FlashSyncProgress {
+  uint32_t copiedPages;  // Copied since boot
+  uint32_t skippedPages; // Corrupt or void pages not copied
+  uint32_t pendingPages; // Programmed but not yet on SD
+  uint32_t maxTickUs;    // Longest time a single call spent copying
+};
+
 void initLogger();
-void logData(const char* data);
+void logData(const char* data); // Free-text event record
+void logFlightState(uint8_t state, float altitude, float velocity, float verticalAccel,
+                    float temperature, int16_t adc0);
+void updateLogger(); // Logs raw samples published by the sampler since the last call; call every loop
 void flushLogger();
 void closeLogger();
-void previewLoggedData();
-void syncFlashToSD(); // Declaration added
+void requestLogPreview(); // Prints the first records from updateLogger() once read, without blocking
+FlashSyncProgress getFlashSyncProgress();
+void startNewFlashLog(); // Ends the current flash log; its pages are overwritten as the new one grows
 
 #endif
\ No newline at end of file
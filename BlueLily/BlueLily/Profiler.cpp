@@ -0,0 +1,101 @@
+#include "Profiler.h"
+
+#if ENABLE_PROFILER
+#include "Logger.h"
+#include "LogFormat.h"
+
+static const char* const probeNames[PROBE_COUNT] = {
+  "loop", "imu", "temp", "adc", "attitude", "sd", "flash", "sync", "telemetry", "oled", "ros2"
+};
+
+static ProfileStats stats[PROBE_COUNT];
+
+void initProfiler() {
+#if defined(__IMXRT1062__)
+  // The core normally starts the cycle counter; make sure it is running
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+  resetProfile();
+  Serial.println("Profiler Initialized");
+}
+
+void profileRecord(ProfileProbe probe, uint32_t cycles) {
+  ProfileStats& s = stats[probe];
+  s.count++;
+  s.totalCycles += cycles;
+  if (cycles < s.minCycles) s.minCycles = cycles;
+  if (cycles > s.maxCycles) s.maxCycles = cycles;
+  s.histogram[cycles ? 31 - __builtin_clz(cycles) : 0]++;
+}
+
+uint32_t profileCyclesPerUs() {
+#if defined(__IMXRT1062__)
+  return F_CPU_ACTUAL / 1000000;
+#else
+  return 1000; // Nanosecond clock
+#endif
+}
+
+const char* getProfileName(ProfileProbe probe) {
+  return probe < PROBE_COUNT ? probeNames[probe] : "";
+}
+
+ProfileStats getProfileStats(ProfileProbe probe) {
+  ProfileStats none = {};
+  return probe < PROBE_COUNT ? stats[probe] : none;
+}
+
+void resetProfile() {
+  memset(stats, 0, sizeof(stats));
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) stats[i].minCycles = UINT32_MAX;
+}
+
+// Emits the profile as lines short enough for a log text record:
+//   PROFCLK,cycles_per_us
+//   PROF,name,count,min_cycles,mean_cycles,max_cycles
+//   PROFH,name,bucket:count;...   (non-empty buckets, split over lines)
+static void emitProfile(void (*emit)(const char*)) {
+  char line[LOG_MAX_TEXT + 1];
+  snprintf(line, sizeof(line), "PROFCLK,%lu", (unsigned long)profileCyclesPerUs());
+  emit(line);
+
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    const ProfileStats& s = stats[i];
+    if (!s.count) continue;
+    snprintf(line, sizeof(line), "PROF,%s,%lu,%lu,%lu,%lu", probeNames[i], (unsigned long)s.count,
+             (unsigned long)s.minCycles, (unsigned long)(s.totalCycles / s.count),
+             (unsigned long)s.maxCycles);
+    emit(line);
+
+    int prefix = snprintf(line, sizeof(line), "PROFH,%s,", probeNames[i]);
+    int length = prefix;
+    for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) {
+      if (!s.histogram[b]) continue;
+      char entry[16];
+      int n = snprintf(entry, sizeof(entry), "%s%u:%lu", length > prefix ? ";" : "", b,
+                       (unsigned long)s.histogram[b]);
+      if (length + n > LOG_MAX_TEXT) {
+        emit(line);
+        length = prefix;
+        n = snprintf(entry, sizeof(entry), "%u:%lu", b, (unsigned long)s.histogram[b]);
+      }
+      memcpy(line + length, entry, n + 1);
+      length += n;
+    }
+    if (length > prefix) emit(line);
+  }
+}
+
+static void printLine(const char* line) {
+  Serial.println(line);
+}
+
+void printProfile() {
+  emitProfile(printLine);
+}
+
+void logProfile() {
+  emitProfile(logData);
+}
+#endif
@@ -0,0 +1,82 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Cycle-accurate probes around the expensive module entry points. Each
+// probe keeps a count, min/max/total and a log2 histogram of its durations
+// in fixed RAM: bucket b counts durations in [2^b, 2^(b+1)) cycles. On the
+// Teensy the DWT cycle counter is the time base; elsewhere it is
+// clock_gettime(CLOCK_MONOTONIC) in nanoseconds.
+//
+// Wrap a block with PROFILE_SCOPE(PROBE_...); the probe covers the rest of
+// the enclosing block, so use at most one per block. With ENABLE_PROFILER
+// 0 the probes compile away.
+
+enum ProfileProbe {
+  PROBE_LOOP = 0,       // One scheduler pass
+  PROBE_IMU_READ,       // IMU I2C read or FIFO drain
+  PROBE_TEMP_READ,      // MAX31855 SPI read
+  PROBE_ADC_READ,       // ADS1115 conversion reads
+  PROBE_ATTITUDE,       // Attitude filter update
+  PROBE_SD_WRITE,       // RingBuf write and writeOut
+  PROBE_FLASH_LOG,      // W25Q128 page queue step
+  PROBE_FLASH_SYNC,     // Flash-to-SD copy step
+  PROBE_TELEMETRY_FMT,  // Flight telemetry snprintf
+  PROBE_OLED_DISPLAY,   // SSD1306 framebuffer chunk transfer
+  PROBE_ROS2_PUBLISH,   // ROS2 IMU/attitude serial output
+  PROBE_COUNT
+};
+
+#define PROFILE_BUCKETS 32
+
+struct ProfileStats {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t histogram[PROFILE_BUCKETS];
+};
+
+#if ENABLE_PROFILER
+#if defined(__IMXRT1062__)
+inline uint32_t profileCycles() { return ARM_DWT_CYCCNT; }
+#else
+#include <time.h>
+inline uint32_t profileCycles() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
+
+void initProfiler();
+void profileRecord(ProfileProbe probe, uint32_t cycles);
+uint32_t profileCyclesPerUs();
+const char* getProfileName(ProfileProbe probe);
+ProfileStats getProfileStats(ProfileProbe probe);
+void resetProfile();
+void printProfile(); // One PROF line per probe on Serial
+void logProfile();   // The same lines as log event records
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileProbe probe) : probe(probe), start(profileCycles()) {}
+  ~ProfileScope() { profileRecord(probe, profileCycles() - start); }
+
+private:
+  ProfileProbe probe;
+  uint32_t start;
+};
+
+#define PROFILE_SCOPE(probe) ProfileScope profileScope(probe)
+#else
+inline void initProfiler() {}
+inline void resetProfile() {}
+inline void printProfile() {}
+inline void logProfile() {}
+#define PROFILE_SCOPE(probe) do {} while (0)
+#endif
+
+#endif
@@ -1,36 +1,45 @@
 #include "ROS2Bridge.h"
+#include "Sampler.h"
+#include "Logger.h"
+#include "Hal.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "Bus.h"
+#include "Communication.h"
+#include "CanTelemetry.h"
+#include "CanTransport.h"
+#include "Settings.h"
+#include "ConfigStore.h"
 
 #if ENABLE_ROS2_BRIDGE
 
-// Timing variables
-static unsigned long lastIMUPublish = 0;
-static unsigned long lastHeartbeat = 0;
-
 // Sequence counter for message tracking
 static uint32_t messageSequence = 0;
 
-void initROS2Bridge() {
-  ROS2_SERIAL.begin(ROS2_BAUD);
-  
-  // Wait for serial to be ready
-  delay(100);
-  
-  // Send initialization message
-  ROS2_SERIAL.println("# BlueLily ROS2 Bridge Initialized");
-  ROS2_SERIAL.print("# Firmware Version: ");
-  ROS2_SERIAL.println("1.0.0");
-  ROS2_SERIAL.print("# IMU Rate: ");
-  ROS2_SERIAL.print(1000 / ROS2_PUBLISH_RATE_MS);
-  ROS2_SERIAL.println(" Hz");
-  ROS2_SERIAL.println("# Message Format: TYPE,timestamp,seq,data...");
-  ROS2_SERIAL.println("# Ready");
+static SampleCursor sampleCursor;
+
+// Wire format, switchable at runtime via CMD,FORMAT,...
+static bool binaryMode = ROS2_BINARY_MODE;
+
+// Encode into a single buffer so each message costs one write() call
+static void writeBinaryFrame(uint8_t type, const void* payload, uint8_t length,
+                             uint32_t timestampUs = halMicros()) {
+  uint8_t frame[ROS2_FRAME_MAX_SIZE];
+  size_t size = ros2EncodeFrame(frame, type, messageSequence++, timestampUs, payload, length);
+  if (size) ROS2_SERIAL.write(frame, size);
 }
 
-void publishIMU(float accelX, float accelY, float accelZ, 
-                float gyroX, float gyroY, float gyroZ) {
+static void publishIMUAt(uint32_t timestampUs, float accelX, float accelY, float accelZ,
+                         float gyroX, float gyroY, float gyroZ) {
+  if (binaryMode) {
+    ROS2ImuPayload imu = {{accelX, accelY, accelZ}, {gyroX, gyroY, gyroZ}};
+    writeBinaryFrame(ROS2_IMU, &imu, sizeof(imu), timestampUs);
+    return;
+  }
+
   // Format: IMU,timestamp,seq,ax,ay,az,gx,gy,gz
   ROS2_SERIAL.print("IMU,");
-  ROS2_SERIAL.print(millis());
+  ROS2_SERIAL.print(timestampUs / 1000);
   ROS2_SERIAL.print(",");
   ROS2_SERIAL.print(messageSequence++);
   ROS2_SERIAL.print(",");
@@ -47,10 +56,76 @@ void publishIMU(float accelX, float accelY, float accelZ,
   ROS2_SERIAL.println(gyroZ, 6);
 }
 
+static void publishAttitudeAt(uint32_t timestampUs, const float q[4], const float worldAccel[3]) {
+  if (binaryMode) {
+    ROS2AttitudePayload att;
+    memcpy(att.q, q, sizeof(att.q));
+    memcpy(att.worldAccel, worldAccel, sizeof(att.worldAccel));
+    writeBinaryFrame(ROS2_ATTITUDE, &att, sizeof(att), timestampUs);
+    return;
+  }
+
+  // Format: ATT,timestamp,seq,qw,qx,qy,qz,wax,way,waz
+  ROS2_SERIAL.print("ATT,");
+  ROS2_SERIAL.print(timestampUs / 1000);
+  ROS2_SERIAL.print(",");
+  ROS2_SERIAL.print(messageSequence++);
+  for (int i = 0; i < 4; i++) {
+    ROS2_SERIAL.print(",");
+    ROS2_SERIAL.print(q[i], 6);
+  }
+  for (int i = 0; i < 3; i++) {
+    ROS2_SERIAL.print(",");
+    ROS2_SERIAL.print(worldAccel[i], 4);
+  }
+  ROS2_SERIAL.println();
+}
+
+void initROS2Bridge() {
+  ROS2_SERIAL.begin(ROS2_BAUD);
+  openSampleCursor(sampleCursor);
+  
+  // Wait for serial to be ready
+  delay(100);
+  
+  // Send initialization message
+  ROS2_SERIAL.println("# BlueLily ROS2 Bridge Initialized");
+  ROS2_SERIAL.print("# Firmware Version: ");
+  ROS2_SERIAL.println("1.0.0");
+  ROS2_SERIAL.print("# IMU Rate: ");
+  ROS2_SERIAL.print(1000 / ros2PublishRateMs);
+  ROS2_SERIAL.println(" Hz");
+  if (binaryMode) {
+    ROS2_SERIAL.println("# Message Format: BINARY (ROS2Frame.h)");
+  } else {
+    ROS2_SERIAL.println("# Message Format: TYPE,timestamp,seq,data...");
+  }
+  ROS2_SERIAL.println("# Ready");
+}
+
+void setROS2BinaryMode(bool enabled) {
+  binaryMode = enabled;
+}
+
+void publishIMU(float accelX, float accelY, float accelZ, 
+                float gyroX, float gyroY, float gyroZ) {
+  publishIMUAt(halMicros(), accelX, accelY, accelZ, gyroX, gyroY, gyroZ);
+}
+
+void publishAttitude(const float q[4], const float worldAccel[3]) {
+  publishAttitudeAt(halMicros(), q, worldAccel);
+}
+
 void publishTemperature(float temperature) {
+  if (binaryMode) {
+    ROS2TempPayload temp = {temperature};
+    writeBinaryFrame(ROS2_TEMP, &temp, sizeof(temp));
+    return;
+  }
+
   // Format: TEMP,timestamp,seq,temperature
   ROS2_SERIAL.print("TEMP,");
-  ROS2_SERIAL.print(millis());
+  ROS2_SERIAL.print(halMillis());
   ROS2_SERIAL.print(",");
   ROS2_SERIAL.print(messageSequence++);
   ROS2_SERIAL.print(",");
@@ -58,9 +133,16 @@ void publishTemperature(float temperature) {
 }
 
 void publishADC(float voltages[4]) {
+  if (binaryMode) {
+    ROS2AdcPayload adc;
+    memcpy(adc.voltages, voltages, sizeof(adc.voltages));
+    writeBinaryFrame(ROS2_ADC, &adc, sizeof(adc));
+    return;
+  }
+
   // Format: ADC,timestamp,seq,ch0,ch1,ch2,ch3
   ROS2_SERIAL.print("ADC,");
-  ROS2_SERIAL.print(millis());
+  ROS2_SERIAL.print(halMillis());
   ROS2_SERIAL.print(",");
   ROS2_SERIAL.print(messageSequence++);
   for (int i = 0; i < 4; i++) {
@@ -71,9 +153,15 @@ void publishADC(float voltages[4]) {
 }
 
 void publishState(const char* stateName) {
+  if (binaryMode) {
+    size_t length = min(strlen(stateName), (size_t)ROS2_FRAME_MAX_PAYLOAD);
+    writeBinaryFrame(ROS2_STATE, stateName, length);
+    return;
+  }
+
   // Format: STATE,timestamp,seq,state_name
   ROS2_SERIAL.print("STATE,");
-  ROS2_SERIAL.print(millis());
+  ROS2_SERIAL.print(halMillis());
   ROS2_SERIAL.print(",");
   ROS2_SERIAL.print(messageSequence++);
   ROS2_SERIAL.print(",");
@@ -81,9 +169,14 @@ void publishState(const char* stateName) {
 }
 
 void publishHeartbeat() {
+  if (binaryMode) {
+    writeBinaryFrame(ROS2_HEARTBEAT, nullptr, 0);
+    return;
+  }
+
   // Format: HEARTBEAT,timestamp,seq
   ROS2_SERIAL.print("HEARTBEAT,");
-  ROS2_SERIAL.print(millis());
+  ROS2_SERIAL.print(halMillis());
   ROS2_SERIAL.print(",");
   ROS2_SERIAL.println(messageSequence++);
 }
@@ -99,38 +192,79 @@ void receiveROS2Commands() {
     if (command.startsWith("CMD,")) {
       // Remove "CMD," prefix
       command = command.substring(4);
+
+      // FORMAT and LOG switch the output and flash log, SET and PARAMS go
+      // to the settings registry, the rest print statistics
+      if (command == "FORMAT,BIN") {
+        setROS2BinaryMode(true);
+      } else if (command == "FORMAT,CSV") {
+        setROS2BinaryMode(false);
+      } else if (command == "LOG,NEWFLASH") {
+        startNewFlashLog();
+      } else if (command == "TASKS") {
+        printTaskStats();
+      } else if (command == "LINKS") {
+        printLinkStats();
+        printCanTelemetryStats();
+        printCanTransportStats();
+      } else if (command == "BUS") {
+        printBusStats();
+      } else if (command == "PROFILE") {
+        printProfile();
+      } else if (command == "PROFILE,LOG") {
+        logProfile();
+      } else if (command == "PROFILE,RESET") {
+        resetProfile();
+      } else if (command == "CONFIG") {
+        printConfigStoreStats();
+      } else if (command == "PARAMS") {
+        printSettings();
+      } else if (command.startsWith("SET,")) {
+        SettingResult result = applySettingCommand(command.c_str() + 4);
+        if (result == SETTING_OK) {
+          requestConfigCommit();
+        } else {
+          ROS2_SERIAL.print("# ");
+          ROS2_SERIAL.println(getSettingResultText(result));
+        }
+      }
       
       // Send acknowledgment
       ROS2_SERIAL.print("ACK,");
-      ROS2_SERIAL.print(millis());
+      ROS2_SERIAL.print(halMillis());
       ROS2_SERIAL.print(",");
       ROS2_SERIAL.println(command);
-      
-      // TODO: Process commands (actuator control, config changes, etc.)
-      // This can be integrated with existing Configurator module
     }
   }
 }
 
+uint32_t ros2PublishRateMs; // Default in Settings.cpp
+
+void applyROS2PublishRate() {
+  setTaskPeriod("ros2", ros2PublishRateMs * 1000UL, ros2PublishRateMs * 1000UL);
+}
+
 void updateROS2Bridge() {
-  unsigned long currentTime = millis();
-  
-  // Publish IMU at configured rate (default 100Hz)
-  if (currentTime - lastIMUPublish >= ROS2_PUBLISH_RATE_MS) {
-    #if ENABLE_MPU6500
-    float ax, ay, az, gx, gy, gz;
-    readIMU(ax, ay, az, gx, gy, gz);
-    publishIMU(ax, ay, az, gx, gy, gz);
-    #endif
-    lastIMUPublish = currentTime;
+  // Drain the sample ring, keeping the newest IMU sample
+  static SensorSample imuSample;
+  static bool imuPending = false;
+  SensorSample sample;
+  while (readSample(sampleCursor, sample)) {
+    if (sample.type == SAMPLE_IMU) {
+      imuSample = sample;
+      imuPending = true;
+    }
   }
-  
-  // Publish heartbeat every second
-  if (currentTime - lastHeartbeat >= 1000) {
-    publishHeartbeat();
-    lastHeartbeat = currentTime;
+
+  // Runs every ros2PublishRateMs as a scheduler task; publish the newest IMU sample
+  if (imuPending) {
+    PROFILE_SCOPE(PROBE_ROS2_PUBLISH);
+    publishIMUAt(imuSample.timestampUs, imuSample.imu.accel[0], imuSample.imu.accel[1], imuSample.imu.accel[2],
+                 imuSample.imu.gyro[0], imuSample.imu.gyro[1], imuSample.imu.gyro[2]);
+    publishAttitudeAt(imuSample.timestampUs, imuSample.imu.q, imuSample.imu.worldAccel);
+    imuPending = false;
   }
-  
+
   // Check for incoming commands
   receiveROS2Commands();
 }
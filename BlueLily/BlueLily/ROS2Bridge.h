@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "Config.h"
+#include "ROS2Frame.h"
 
 // ROS2 Bridge Enable/Disable (add this to Config.h later)
 #ifndef ENABLE_ROS2_BRIDGE
@@ -15,15 +16,11 @@
 #define ROS2_SERIAL Serial  // Use main USB serial
 #define ROS2_BAUD 115200
 #define ROS2_PUBLISH_RATE_MS 10  // 100Hz IMU publishing
+#ifndef ROS2_BINARY_MODE
+#define ROS2_BINARY_MODE 0
+#endif
 
-// Message types
-enum ROS2MessageType {
-  ROS2_IMU = 0,
-  ROS2_TEMP = 1,
-  ROS2_ADC = 2,
-  ROS2_STATE = 3,
-  ROS2_HEARTBEAT = 4
-};
+// Message types are defined in ROS2Frame.h (shared with the host decoder)
 
 /**
  * Initialize ROS2 bridge
@@ -31,6 +28,13 @@ enum ROS2MessageType {
  */
 void initROS2Bridge();
 
+/**
+ * Select the publish format
+ *
+ * @param enabled true for packed binary frames (see ROS2Frame.h), false for CSV text
+ */
+void setROS2BinaryMode(bool enabled);
+
 /**
  * Publish IMU data to ROS2
  * Format: IMU,timestamp,ax,ay,az,gx,gy,gz
@@ -45,6 +49,16 @@ void initROS2Bridge();
 void publishIMU(float accelX, float accelY, float accelZ, 
                 float gyroX, float gyroY, float gyroZ);
 
+/**
+ * Publish attitude estimate to ROS2
+ * Format: ATT,timestamp,seq,qw,qx,qy,qz,wax,way,waz
+ * Binary: ROS2_ATTITUDE frame with ROS2AttitudePayload
+ *
+ * @param q Orientation quaternion (w, x, y, z), body to world
+ * @param worldAccel World-frame acceleration with gravity removed (m/s²)
+ */
+void publishAttitude(const float q[4], const float worldAccel[3]);
+
 /**
  * Publish temperature data to ROS2
  * Format: TEMP,timestamp,temperature
@@ -78,19 +92,33 @@ void publishHeartbeat();
 /**
  * Check for incoming ROS2 commands
  * Processes commands like actuator control, configuration changes
+ * CMD,FORMAT,BIN / CMD,FORMAT,CSV switches the publish format
  */
 void receiveROS2Commands();
 
 /**
- * Update ROS2 bridge (call in main loop)
- * Handles periodic publishing and command reception
+ * IMU publish period in ms (ros2_rate_ms setting, default ROS2_PUBLISH_RATE_MS)
+ */
+extern uint32_t ros2PublishRateMs;
+
+/**
+ * Re-times the "ros2" task after ros2PublishRateMs changes
+ */
+void applyROS2PublishRate();
+
+/**
+ * Update ROS2 bridge (scheduler task, every ros2PublishRateMs)
+ * Publishes the newest IMU/attitude sample and handles command reception.
+ * The heartbeat is its own 1 s task.
  */
 void updateROS2Bridge();
 
 #else
 // Stub functions when ROS2 bridge is disabled
 inline void initROS2Bridge() {}
+inline void setROS2BinaryMode(bool) {}
 inline void publishIMU(float, float, float, float, float, float) {}
+inline void publishAttitude(const float[4], const float[3]) {}
 inline void publishTemperature(float) {}
 inline void publishADC(float[4]) {}
 inline void publishState(const char*) {}
@@ -0,0 +1,147 @@
+#ifndef ROS2FRAME_H
+#define ROS2FRAME_H
+
+// Binary frame format shared by the firmware and the host-side bridge node.
+// This header only depends on the C standard library so the bluelily_bridge
+// ROS2 node can include it directly to decode frames.
+//
+// Frame layout (little-endian, 14 bytes of overhead):
+//   [0]     sync 0          0xB1
+//   [1]     sync 1          0x1E
+//   [2]     type            ROS2MessageType
+//   [3]     length          payload length in bytes
+//   [4..7]  seq             uint32 message sequence number
+//   [8..11] timestamp       uint32 micros() at publish time
+//   [12..]  payload         `length` bytes, see ROS2*Payload structs
+//   [..+2]  crc             CRC-16/CCITT-FALSE over bytes [2 .. end of payload]
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Crc.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "ROS2Frame.h assumes a little-endian target"
+#endif
+
+#define ROS2_FRAME_SYNC0 0xB1
+#define ROS2_FRAME_SYNC1 0x1E
+#define ROS2_FRAME_HEADER_SIZE 12
+#define ROS2_FRAME_CRC_SIZE 2
+#define ROS2_FRAME_MAX_PAYLOAD 64
+#define ROS2_FRAME_MAX_SIZE (ROS2_FRAME_HEADER_SIZE + ROS2_FRAME_MAX_PAYLOAD + ROS2_FRAME_CRC_SIZE)
+
+// Message types
+enum ROS2MessageType {
+  ROS2_IMU = 0,
+  ROS2_TEMP = 1,
+  ROS2_ADC = 2,
+  ROS2_STATE = 3,
+  ROS2_HEARTBEAT = 4,
+  ROS2_ATTITUDE = 5
+};
+
+struct __attribute__((packed)) ROS2FrameHeader {
+  uint8_t sync0;
+  uint8_t sync1;
+  uint8_t type;
+  uint8_t length;
+  uint32_t seq;
+  uint32_t timestampUs;
+};
+
+struct __attribute__((packed)) ROS2ImuPayload {
+  float accel[3]; // X/Y/Z
+  float gyro[3];  // X/Y/Z
+};
+
+struct __attribute__((packed)) ROS2TempPayload {
+  float temperature;
+};
+
+struct __attribute__((packed)) ROS2AdcPayload {
+  float voltages[4];
+};
+
+struct __attribute__((packed)) ROS2AttitudePayload {
+  float q[4];          // w, x, y, z (body to world, world Z up)
+  float worldAccel[3]; // m/s^2, gravity removed
+};
+
+// STATE carries the state name as raw characters (no terminator),
+// HEARTBEAT has an empty payload.
+
+static_assert(sizeof(ROS2FrameHeader) == ROS2_FRAME_HEADER_SIZE, "ROS2FrameHeader must be packed");
+static_assert(sizeof(ROS2ImuPayload) == 24, "ROS2ImuPayload must be packed");
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+inline uint16_t ros2FrameCrc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+  return crc16Ccitt(data, len, crc);
+}
+
+// Encodes a complete frame into `out` (at least ROS2_FRAME_MAX_SIZE bytes).
+// Returns the frame size, or 0 if the payload is too large.
+inline size_t ros2EncodeFrame(uint8_t* out, uint8_t type, uint32_t seq, uint32_t timestampUs,
+                              const void* payload, uint8_t length) {
+  if (length > ROS2_FRAME_MAX_PAYLOAD) return 0;
+  ROS2FrameHeader header = {ROS2_FRAME_SYNC0, ROS2_FRAME_SYNC1, type, length, seq, timestampUs};
+  memcpy(out, &header, ROS2_FRAME_HEADER_SIZE);
+  if (length) memcpy(out + ROS2_FRAME_HEADER_SIZE, payload, length);
+  uint16_t crc = ros2FrameCrc16(out + 2, ROS2_FRAME_HEADER_SIZE - 2 + length);
+  out[ROS2_FRAME_HEADER_SIZE + length] = crc & 0xFF;
+  out[ROS2_FRAME_HEADER_SIZE + length + 1] = crc >> 8;
+  return ROS2_FRAME_HEADER_SIZE + length + ROS2_FRAME_CRC_SIZE;
+}
+
+// Streaming decoder for the host side. Feed received bytes one at a time;
+// ros2DecodeByte() returns true when `frame` holds a complete, CRC-valid
+// frame. Text lines (e.g. "# Ready") interleaved on the link are skipped
+// by the sync search.
+struct ROS2FrameDecoder {
+  uint8_t frame[ROS2_FRAME_MAX_SIZE];
+  uint16_t pos;
+  uint32_t crcErrors;
+  uint32_t lengthErrors;
+};
+
+inline void ros2DecoderReset(ROS2FrameDecoder& dec) {
+  dec.pos = 0;
+  dec.crcErrors = 0;
+  dec.lengthErrors = 0;
+}
+
+inline bool ros2DecodeByte(ROS2FrameDecoder& dec, uint8_t byte) {
+  if (dec.pos == 0 && byte != ROS2_FRAME_SYNC0) return false;
+  if (dec.pos == 1 && byte != ROS2_FRAME_SYNC1) {
+    dec.pos = (byte == ROS2_FRAME_SYNC0) ? 1 : 0;
+    return false;
+  }
+  dec.frame[dec.pos++] = byte;
+  if (dec.pos == 4 && dec.frame[3] > ROS2_FRAME_MAX_PAYLOAD) {
+    dec.lengthErrors++;
+    dec.pos = 0;
+    return false;
+  }
+  if (dec.pos < ROS2_FRAME_HEADER_SIZE) return false;
+
+  uint16_t total = ROS2_FRAME_HEADER_SIZE + dec.frame[3] + ROS2_FRAME_CRC_SIZE;
+  if (dec.pos < total) return false;
+
+  dec.pos = 0;
+  uint16_t crc = ros2FrameCrc16(dec.frame + 2, total - ROS2_FRAME_CRC_SIZE - 2);
+  if (dec.frame[total - 2] != (crc & 0xFF) || dec.frame[total - 1] != (crc >> 8)) {
+    dec.crcErrors++;
+    return false;
+  }
+  return true;
+}
+
+inline const ROS2FrameHeader* ros2FrameHeader(const ROS2FrameDecoder& dec) {
+  return (const ROS2FrameHeader*)dec.frame;
+}
+
+inline const uint8_t* ros2FramePayload(const ROS2FrameDecoder& dec) {
+  return dec.frame + ROS2_FRAME_HEADER_SIZE;
+}
+
+#endif // ROS2FRAME_H
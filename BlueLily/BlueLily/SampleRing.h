@@ -0,0 +1,92 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+// Single-producer / multi-consumer broadcast ring.
+// The producer never blocks: it always overwrites the oldest slot. Each
+// consumer owns a SampleCursor and reads at its own pace; a consumer that
+// falls more than Capacity items behind skips ahead and has the skipped
+// items added to its drop counter. Slots carry a sequence stamp so a read
+// that races with the producer overwriting the same slot is detected and
+// discarded instead of returning a torn copy.
+//
+// Only depends on GCC/Clang atomic builtins, so it builds for the Teensy
+// and for the host.
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SampleCursor {
+  uint32_t next;     // Index of the next item to read
+  uint32_t dropped;  // Items lost because this consumer fell behind
+};
+
+template <typename T, uint32_t Capacity>
+class SampleRing {
+  static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  void reset() {
+    for (uint32_t i = 0; i < Capacity; i++) slots[i].seq = 0;
+    __atomic_store_n(&head, 0, __ATOMIC_RELEASE);
+  }
+
+  // Producer side. Returns the index the item was published under.
+  uint32_t push(const T& item) {
+    uint32_t index = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    Slot& slot = slots[index & (Capacity - 1)];
+    __atomic_store_n(&slot.seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot.item = item;
+    __atomic_store_n(&slot.seq, index + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, index + 1, __ATOMIC_RELEASE);
+    return index;
+  }
+
+  uint32_t published() const {
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  }
+
+  // Positions a cursor at the current head (only new items will be read)
+  void openCursor(SampleCursor& cursor) const {
+    cursor.next = published();
+    cursor.dropped = 0;
+  }
+
+  // Consumer side. Returns false when the cursor has caught up.
+  bool read(SampleCursor& cursor, T& out) const {
+    for (;;) {
+      uint32_t h = published();
+      if (cursor.next == h) return false;
+      if (h - cursor.next > Capacity) {
+        cursor.dropped += h - cursor.next - Capacity;
+        cursor.next = h - Capacity;
+      }
+      if (readAt(cursor.next, out)) {
+        cursor.next++;
+        return true;
+      }
+      // Overwritten while we were copying it
+      cursor.dropped++;
+      cursor.next++;
+    }
+  }
+
+  // Reads the item published under `index` if it is still in the ring
+  bool readAt(uint32_t index, T& out) const {
+    const Slot& slot = slots[index & (Capacity - 1)];
+    if (__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != index + 1) return false;
+    out = slot.item;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) == index + 1;
+  }
+
+private:
+  struct Slot {
+    uint32_t seq;  // index + 1 once published, 0 while being written
+    T item;
+  };
+  Slot slots[Capacity];
+  uint32_t head = 0;
+};
+
+#endif // SAMPLERING_H
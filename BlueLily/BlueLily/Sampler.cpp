@@ -0,0 +1,150 @@
+#include "Sampler.h"
+#include "Attitude.h"
+#include "Hal.h"
+#include "Profiler.h"
+#include "Bus.h"
+
+static SampleRing<SensorSample, SAMPLE_RING_CAPACITY> ring;
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+static SamplerBackend backend = {readIMU, readTemperature, readADC, readIMUBatch};
+#else
+static SamplerBackend backend = {readIMU, readTemperature, readADC, nullptr};
+#endif
+static SamplerStats stats;
+
+// Most recent sample of each type, kept outside the main ring so slow
+// sensors are not evicted by fast ones
+static SampleRing<SensorSample, 2> latest[SAMPLE_TYPE_COUNT];
+
+struct SampleSchedule {
+  uint32_t periodUs;
+  uint32_t nextDueUs;
+};
+
+static SampleSchedule schedule[SAMPLE_TYPE_COUNT] = {
+  {1000000UL / SAMPLE_RATE_IMU_HZ, 0},
+  {1000000UL / SAMPLE_RATE_TEMP_HZ, 0},
+  {1000000UL / SAMPLE_RATE_ADC_HZ, 0}
+};
+
+static void publish(SensorSample& sample) {
+  ring.push(sample);
+  latest[sample.type].push(sample);
+  stats.samples[sample.type]++;
+}
+
+// Returns true when the sensor is due, advancing its deadline on a fixed
+// grid so the long-term rate does not drift with loop jitter
+static bool isDue(SampleSchedule& s, uint32_t now) {
+  if ((int32_t)(now - s.nextDueUs) < 0) return false;
+  s.nextDueUs += s.periodUs;
+  return true;
+}
+
+static void publishIMUSample(uint32_t timestampUs, const float accel[3], const float gyro[3]) {
+  SensorSample sample;
+  sample.timestampUs = timestampUs;
+  sample.type = SAMPLE_IMU;
+  memcpy(sample.imu.accel, accel, sizeof(sample.imu.accel));
+  memcpy(sample.imu.gyro, gyro, sizeof(sample.imu.gyro));
+  // Attitude runs here so it sees every IMU sample and all consumers
+  // get the orientation that matches the raw data
+  {
+    PROFILE_SCOPE(PROBE_ATTITUDE);
+    const AttitudeState& attitude = updateAttitude(timestampUs, accel, gyro);
+    memcpy(sample.imu.q, attitude.q, sizeof(sample.imu.q));
+    memcpy(sample.imu.worldAccel, attitude.worldAccel, sizeof(sample.imu.worldAccel));
+  }
+  publish(sample);
+}
+
+static void sampleIMU(uint32_t now) {
+  if (backend.readIMUBatch) {
+    IMUSample batch[MPU6500_FIFO_MAX_SAMPLES];
+    uint16_t count;
+    {
+      PROFILE_SCOPE(PROBE_IMU_READ);
+      count = backend.readIMUBatch(batch, MPU6500_FIFO_MAX_SAMPLES);
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      publishIMUSample(batch[i].timestampUs, batch[i].accel, batch[i].gyro);
+    }
+    return;
+  }
+  float accel[3], gyro[3];
+  {
+    PROFILE_SCOPE(PROBE_IMU_READ);
+    backend.readIMU(accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2]);
+  }
+  publishIMUSample(now, accel, gyro);
+}
+
+void initSampler() {
+  ring.reset();
+  memset(&stats, 0, sizeof(stats));
+  initAttitude();
+  uint32_t now = halMicros();
+  for (uint8_t i = 0; i < SAMPLE_TYPE_COUNT; i++) {
+    latest[i].reset();
+    schedule[i].nextDueUs = now;
+  }
+  Serial.println("Sampler Initialized");
+}
+
+void setSamplerBackend(const SamplerBackend& newBackend) {
+  backend = newBackend;
+}
+
+void updateSampler() {
+  for (uint8_t type = 0; type < SAMPLE_TYPE_COUNT; type++) {
+    uint32_t now = halMicros();
+    if (!isDue(schedule[type], now)) continue;
+
+    // Drop whole periods if the loop stalled, rather than bursting reads
+    uint32_t late = now - schedule[type].nextDueUs;
+    if ((int32_t)late >= 0) {
+      uint32_t skipped = late / schedule[type].periodUs + 1;
+      stats.missed[type] += skipped;
+      schedule[type].nextDueUs += skipped * schedule[type].periodUs;
+    }
+
+    if (type == SAMPLE_IMU) {
+      sampleIMU(now);
+      continue;
+    }
+
+    SensorSample sample;
+    sample.timestampUs = now;
+    sample.type = type;
+    if (type == SAMPLE_TEMP) {
+      PROFILE_SCOPE(PROBE_TEMP_READ);
+      sample.temperature = backend.readTemperature();
+    } else {
+      PROFILE_SCOPE(PROBE_ADC_READ);
+      for (uint8_t ch = 0; ch < 4; ch++) sample.adc[ch] = backend.readADC(ch);
+    }
+    publish(sample);
+  }
+
+  // Bulk transfers on the shared buses steer clear of the next reads
+  busReserve(BUS_DEV_IMU, schedule[SAMPLE_IMU].nextDueUs);
+  busReserve(BUS_DEV_THERMOCOUPLE, schedule[SAMPLE_TEMP].nextDueUs);
+}
+
+void openSampleCursor(SampleCursor& cursor) {
+  ring.openCursor(cursor);
+}
+
+bool readSample(SampleCursor& cursor, SensorSample& sample) {
+  return ring.read(cursor, sample);
+}
+
+bool latestSample(uint8_t type, SensorSample& sample) {
+  if (type >= SAMPLE_TYPE_COUNT) return false;
+  uint32_t count = latest[type].published();
+  return count && latest[type].readAt(count - 1, sample);
+}
+
+SamplerStats getSamplerStats() {
+  return stats;
+}
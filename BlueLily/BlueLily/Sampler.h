@@ -0,0 +1,57 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "SampleRing.h"
+#include "Sensors.h"
+
+// Sample types published into the ring
+enum SampleType : uint8_t {
+  SAMPLE_IMU = 0,
+  SAMPLE_TEMP,
+  SAMPLE_ADC,
+  SAMPLE_TYPE_COUNT
+};
+
+struct SensorSample {
+  uint32_t timestampUs;
+  uint8_t type;
+  union {
+    struct {
+      float accel[3];      // X/Y/Z, m/s^2
+      float gyro[3];       // X/Y/Z, rad/s
+      float q[4];          // Attitude after this sample (w, x, y, z)
+      float worldAccel[3]; // World frame, gravity removed
+    } imu;
+    float temperature;
+    int16_t adc[4];
+  };
+};
+
+// Sensor read functions used by the sampler. Defaults to the Sensors module;
+// a simulated backend can be swapped in to run the firmware off-target.
+struct SamplerBackend {
+  void (*readIMU)(float &accelX, float &accelY, float &accelZ, float &gyroX, float &gyroY, float &gyroZ);
+  float (*readTemperature)();
+  int16_t (*readADC)(uint8_t channel);
+  // Optional batch IMU source (e.g. the MPU6500 FIFO). When set, it is
+  // drained at SAMPLE_RATE_IMU_HZ instead of calling readIMU.
+  uint16_t (*readIMUBatch)(IMUSample* samples, uint16_t maxSamples);
+};
+
+struct SamplerStats {
+  uint32_t samples[SAMPLE_TYPE_COUNT];  // Samples published per type
+  uint32_t missed[SAMPLE_TYPE_COUNT];   // Sample periods skipped because the loop ran late
+};
+
+void initSampler();
+void updateSampler(); // Call every loop; reads each sensor when its period is due
+void setSamplerBackend(const SamplerBackend& backend);
+
+void openSampleCursor(SampleCursor& cursor);
+bool readSample(SampleCursor& cursor, SensorSample& sample);
+bool latestSample(uint8_t type, SensorSample& sample);
+SamplerStats getSamplerStats();
+
+#endif
@@ -0,0 +1,148 @@
+#include "Scheduler.h"
+#include "Hal.h"
+
+struct Task {
+  const char* name;
+  TaskFunction run;
+  uint32_t periodUs;
+  uint32_t deadlineUs;
+  uint8_t priority;
+  uint32_t releaseUs; // Current release; the next one for periodic tasks
+  bool pending;       // Background (period 0) task not yet run this pass
+  bool ran;           // Already run this pass
+  TaskStats stats;
+};
+
+static Task tasks[SCHEDULER_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+static bool isDue(const Task& task, uint32_t now) {
+  if (task.ran) return false;
+  if (task.periodUs == 0) return task.pending;
+  return (int32_t)(now - task.releaseUs) >= 0;
+}
+
+static void runTask(Task& task) {
+  uint32_t start = halMicros();
+  uint32_t jitter = start - task.releaseUs;
+  task.run();
+  uint32_t end = halMicros();
+
+  TaskStats& stats = task.stats;
+  stats.runs++;
+  stats.lastExecUs = end - start;
+  if (stats.lastExecUs > stats.wcetUs) stats.wcetUs = stats.lastExecUs;
+  if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+  if (task.deadlineUs && end - task.releaseUs > task.deadlineUs) stats.overruns++;
+
+  if (task.periodUs == 0) {
+    task.pending = false;
+    return;
+  }
+  task.releaseUs += task.periodUs;
+  if ((int32_t)(end - task.releaseUs) >= 0) {
+    uint32_t behind = (end - task.releaseUs) / task.periodUs + 1;
+    stats.skipped += behind;
+    task.releaseUs += behind * task.periodUs;
+  }
+}
+
+void initTaskScheduler() {
+  taskCount = 0;
+}
+
+int8_t addTask(const char* name, TaskFunction run, uint32_t periodUs, uint32_t deadlineUs, uint8_t priority) {
+  if (taskCount >= SCHEDULER_MAX_TASKS) {
+    Serial.println("Scheduler task table full");
+    return -1;
+  }
+  Task& task = tasks[taskCount];
+  task.name = name;
+  task.run = run;
+  task.periodUs = periodUs;
+  task.deadlineUs = deadlineUs;
+  task.priority = priority;
+  task.releaseUs = halMicros();
+  task.pending = false;
+  task.ran = false;
+  memset(&task.stats, 0, sizeof(task.stats));
+  return taskCount++;
+}
+
+bool setTaskPeriod(const char* name, uint32_t periodUs, uint32_t deadlineUs) {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (strcmp(tasks[i].name, name) != 0) continue;
+    tasks[i].periodUs = periodUs;
+    tasks[i].deadlineUs = deadlineUs;
+    tasks[i].releaseUs = halMicros() + periodUs;
+    return true;
+  }
+  return false;
+}
+
+void runTasks() {
+  uint32_t passStart = halMicros();
+  for (uint8_t i = 0; i < taskCount; i++) {
+    tasks[i].ran = false;
+    if (tasks[i].periodUs == 0) {
+      tasks[i].pending = true;
+      tasks[i].releaseUs = passStart;
+    }
+  }
+
+  // At most one run per task and pass: a periodic task that fell behind
+  // again while others ran waits for the next pass
+  while (true) {
+    uint32_t now = halMicros();
+    Task* next = nullptr;
+    for (uint8_t i = 0; i < taskCount; i++) {
+      Task& task = tasks[i];
+      if (!isDue(task, now)) continue;
+      if (!next || task.priority < next->priority ||
+          (task.priority == next->priority && (int32_t)(task.releaseUs - next->releaseUs) < 0)) {
+        next = &task;
+      }
+    }
+    if (!next) break;
+    next->ran = true;
+    runTask(*next);
+  }
+}
+
+uint8_t getTaskCount() {
+  return taskCount;
+}
+
+const char* getTaskName(uint8_t id) {
+  return id < taskCount ? tasks[id].name : "";
+}
+
+TaskStats getTaskStats(uint8_t id) {
+  TaskStats none = {};
+  return id < taskCount ? tasks[id].stats : none;
+}
+
+void resetTaskStats() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+  }
+}
+
+void printTaskStats() {
+  // Format: TASK,name,runs,overruns,skipped,max_jitter_us,wcet_us
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const TaskStats& stats = tasks[i].stats;
+    Serial.print("TASK,");
+    Serial.print(tasks[i].name);
+    Serial.print(",");
+    Serial.print(stats.runs);
+    Serial.print(",");
+    Serial.print(stats.overruns);
+    Serial.print(",");
+    Serial.print(stats.skipped);
+    Serial.print(",");
+    Serial.print(stats.maxJitterUs);
+    Serial.print(",");
+    Serial.println(stats.wcetUs);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Cooperative task scheduler for the main loop. Each task has a period,
+// a deadline relative to its release and a priority (lower runs first).
+// runTasks() runs every task that is due, most urgent first, re-checking
+// after each one so a long task delays the others by at most its own run
+// time. Time comes from halMicros(), so the same schedule runs on the
+// hardware clock and on a virtual one.
+//
+// Releases follow a fixed grid (release += period). A task that starts
+// more than a whole period late drops the releases it missed rather than
+// running back-to-back to catch up.
+
+typedef void (*TaskFunction)();
+
+struct TaskStats {
+  uint32_t runs;
+  uint32_t overruns;    // Runs that finished after release + deadline
+  uint32_t skipped;     // Releases dropped because the task fell a period behind
+  uint32_t maxJitterUs; // Worst start delay after release
+  uint32_t wcetUs;      // Worst-case execution time
+  uint32_t lastExecUs;
+};
+
+void initTaskScheduler();
+// periodUs 0 runs the task once on every pass. deadlineUs 0 disables the
+// overrun check. Returns the task id, or -1 when SCHEDULER_MAX_TASKS is reached.
+int8_t addTask(const char* name, TaskFunction run, uint32_t periodUs, uint32_t deadlineUs, uint8_t priority);
+void runTasks(); // Call from loop()
+// Changes a task's timing; the next release moves to one new period from now
+bool setTaskPeriod(const char* name, uint32_t periodUs, uint32_t deadlineUs);
+
+uint8_t getTaskCount();
+const char* getTaskName(uint8_t id);
+TaskStats getTaskStats(uint8_t id);
+void resetTaskStats();
+void printTaskStats(); // One line per task on Serial
+
+#endif
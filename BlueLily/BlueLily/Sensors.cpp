@@ -2,6 +2,8 @@
 #include <SPI.h>
 #include "Sensors.h"
 #include "Config.h"
+#include "Hal.h"
+#include "Bus.h"
 
 #if ENABLE_MAX31855
 #include <Adafruit_MAX31855.h>
@@ -14,17 +16,105 @@ MPU6500 IMU;
 calData calib = {0};
 AccelData accelData;
 GyroData gyroData;
+
+#if MPU6500_USE_FIFO
+// MPU6500 registers used by the FIFO driver
+#define MPU_REG_SMPLRT_DIV    0x19
+#define MPU_REG_CONFIG        0x1A
+#define MPU_REG_GYRO_CONFIG   0x1B
+#define MPU_REG_ACCEL_CONFIG  0x1C
+#define MPU_REG_ACCEL_CONFIG2 0x1D
+#define MPU_REG_FIFO_EN       0x23
+#define MPU_REG_INT_ENABLE    0x38
+#define MPU_REG_INT_STATUS    0x3A
+#define MPU_REG_USER_CTRL     0x6A
+#define MPU_REG_FIFO_COUNTH   0x72
+#define MPU_REG_FIFO_R_W      0x74
+
+#define MPU_FIFO_EN_GYRO_ACCEL 0x78 // XG, YG, ZG, ACCEL
+#define MPU_USER_CTRL_FIFO_EN  0x40
+#define MPU_USER_CTRL_FIFO_RST 0x04
+#define MPU_INT_FIFO_OFLOW     0x10
+
+static IMUFifoStats fifoStats;
+#endif
 #endif
 
+#define IMU_ACCEL_LSB_PER_G   2048.0f // ±16 g
+#define IMU_GYRO_LSB_PER_DPS  16.4f   // ±2000 dps
+
 #if ENABLE_ADS1115
 #include <Adafruit_ADS1X15.h>
 Adafruit_ADS1115 ads;
+
+// Continuous-conversion pipeline state
+static const uint16_t adcMux[4] = {
+  ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+  ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3
+};
+static const uint16_t adcChannelRates[4] = ADS1115_CHANNEL_RATES;
+static int16_t adcCache[4] = {0, 0, 0, 0};
+static uint32_t adcNextDueUs[4] = {0, 0, 0, 0};
+static int8_t adcChannel = -1;        // Channel the ADC is converting, -1 = idle
+static int8_t adcRunningChannel = -1; // Mux currently programmed in continuous mode
+static uint8_t adcLastChannel = 3;    // Round-robin position
+static uint32_t adcStartUs = 0;
+static volatile bool adcReady = false;
+
+#if ADS1115_ALERT_PIN >= 0
+static void adcAlertISR() {
+  adcReady = true;
+}
+#endif
+#endif
+
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+static bool writeIMURegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(MPU6500_I2C_ADDR);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+static bool readIMURegisters(uint8_t reg, uint8_t* data, uint8_t length) {
+  Wire.beginTransmission(MPU6500_I2C_ADDR);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom((uint8_t)MPU6500_I2C_ADDR, length) != length) return false;
+  for (uint8_t i = 0; i < length; i++) data[i] = Wire.read();
+  return true;
+}
+
+static bool resetIMUFifo() {
+  return writeIMURegister(MPU_REG_USER_CTRL, MPU_USER_CTRL_FIFO_RST) &&
+         writeIMURegister(MPU_REG_USER_CTRL, MPU_USER_CTRL_FIFO_EN);
+}
+
+// Runs after FastIMU init: 1 kHz internal rate, DLPF on, full-scale
+// ranges for flight, accel + gyro routed into the FIFO
+static bool initIMUFifo() {
+  memset(&fifoStats, 0, sizeof(fifoStats));
+  return writeIMURegister(MPU_REG_CONFIG, 0x01) &&          // Gyro DLPF 184 Hz, 1 kHz
+         writeIMURegister(MPU_REG_SMPLRT_DIV, 1000 / MPU6500_FIFO_RATE_HZ - 1) &&
+         writeIMURegister(MPU_REG_GYRO_CONFIG, 0x18) &&     // ±2000 dps
+         writeIMURegister(MPU_REG_ACCEL_CONFIG, 0x18) &&    // ±16 g
+         writeIMURegister(MPU_REG_ACCEL_CONFIG2, 0x01) &&   // Accel DLPF 184 Hz
+         writeIMURegister(MPU_REG_INT_ENABLE, MPU_INT_FIFO_OFLOW) &&
+         writeIMURegister(MPU_REG_FIFO_EN, MPU_FIFO_EN_GYRO_ACCEL) &&
+         resetIMUFifo();
+}
 #endif
 
 void initSensors() {
   Wire.begin();
   SPI.begin();
 
+#if ENABLE_SIMULATION
+  // The simulated SamplerBackend replaces every sensor, so none needs to be fitted
+  Serial.println("Sensors simulated");
+  return;
+#endif
+
 #if ENABLE_MAX31855
   if (!thermocouple.begin()) {
     Serial.println("ERROR: MAX31855 not detected!");
@@ -57,6 +147,13 @@ void initSensors() {
   Serial.println(calib.gyroBias[2]);
   delay(5000);
   IMU.init(calib, MPU6500_I2C_ADDR);
+#endif
+#if MPU6500_USE_FIFO
+  if (!initIMUFifo()) {
+    Serial.println("Error configuring MPU6500 FIFO");
+    while (1);
+  }
+  Serial.println("MPU6500 FIFO enabled");
 #endif
   Serial.println("MPU6500 Initialized");
 #endif
@@ -67,13 +164,20 @@ void initSensors() {
     while (1);
   }
   ads.setGain(GAIN_ONE);
+  ads.setDataRate(ADS1115_DATA_RATE);
+#if ADS1115_ALERT_PIN >= 0
+  pinMode(ADS1115_ALERT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ADS1115_ALERT_PIN), adcAlertISR, FALLING);
+#endif
   Serial.println("ADS1115 Initialized");
 #endif
 }
 
 #if ENABLE_MAX31855
 float readTemperature() {
+  busBegin(BUS_DEV_THERMOCOUPLE, 0);
   float tempC = thermocouple.readCelsius();
+  busEnd(BUS_DEV_THERMOCOUPLE);
   if (isnan(tempC)) {
     Serial.println("Error reading thermocouple!");
     return -1.0;
@@ -84,26 +188,161 @@ float readTemperature() {
 
 #if ENABLE_MPU6500
 void readIMU(float &accelX, float &accelY, float &accelZ, float &gyroX, float &gyroY, float &gyroZ) {
+  busBegin(BUS_DEV_IMU, 0); // Highest priority, always granted
   IMU.update();
+  busEnd(BUS_DEV_IMU);
   IMU.getAccel(&accelData);
   IMU.getGyro(&gyroData);
-  accelX = accelData.accelX;
-  accelY = accelData.accelY;
-  accelZ = accelData.accelZ;
-  gyroX = gyroData.gyroX;
-  gyroY = gyroData.gyroY;
-  gyroZ = gyroData.gyroZ;
+  // FastIMU reports g and deg/s
+  accelX = accelData.accelX * STANDARD_GRAVITY;
+  accelY = accelData.accelY * STANDARD_GRAVITY;
+  accelZ = accelData.accelZ * STANDARD_GRAVITY;
+  gyroX = gyroData.gyroX * DEG_TO_RAD;
+  gyroY = gyroData.gyroY * DEG_TO_RAD;
+  gyroZ = gyroData.gyroZ * DEG_TO_RAD;
+}
+#endif
+
+static inline int16_t fifoWord(const uint8_t* p) {
+  return (int16_t)((p[0] << 8) | p[1]);
+}
+
+uint16_t parseIMUFifo(const uint8_t* data, uint16_t length, IMUSample* samples, uint16_t maxSamples,
+                      uint32_t firstTimestampUs, uint32_t periodUs) {
+  uint16_t count = min((uint16_t)(length / MPU6500_FIFO_RECORD_SIZE), maxSamples);
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t* record = data + i * MPU6500_FIFO_RECORD_SIZE;
+    IMUSample& s = samples[i];
+    s.timestampUs = firstTimestampUs + i * periodUs;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      s.accel[axis] = fifoWord(record + axis * 2) * (STANDARD_GRAVITY / IMU_ACCEL_LSB_PER_G);
+      s.gyro[axis] = fifoWord(record + 6 + axis * 2) * (DEG_TO_RAD / IMU_GYRO_LSB_PER_DPS);
+    }
+  }
+  return count;
+}
+
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+static uint16_t drainIMUFifo(IMUSample* samples, uint16_t maxSamples) {
+  uint8_t status;
+  if (!readIMURegisters(MPU_REG_INT_STATUS, &status, 1)) return 0;
+  if (status & MPU_INT_FIFO_OFLOW) {
+    // The FIFO wraps mid-record on overflow, so realign by resetting it
+    fifoStats.overflows++;
+    resetIMUFifo();
+    return 0;
+  }
+
+  uint8_t countBytes[2];
+  if (!readIMURegisters(MPU_REG_FIFO_COUNTH, countBytes, 2)) return 0;
+  uint32_t now = halMicros();
+  uint16_t available = (((countBytes[0] & 0x1F) << 8) | countBytes[1]) / MPU6500_FIFO_RECORD_SIZE;
+  uint16_t records = min(available, maxSamples);
+  if (!records) return 0;
+
+  // The newest record in the FIFO was sampled within one period of now
+  const uint32_t periodUs = 1000000UL / MPU6500_FIFO_RATE_HZ;
+  uint32_t timestamp = now - (available - 1) * periodUs;
+
+  const uint8_t recordsPerBurst = MPU6500_FIFO_BURST_BYTES / MPU6500_FIFO_RECORD_SIZE;
+  uint8_t burst[MPU6500_FIFO_BURST_BYTES];
+  uint16_t produced = 0;
+  while (produced < records) {
+    uint8_t n = min((uint16_t)recordsPerBurst, (uint16_t)(records - produced));
+    if (!readIMURegisters(MPU_REG_FIFO_R_W, burst, n * MPU6500_FIFO_RECORD_SIZE)) break;
+    fifoStats.bursts++;
+    parseIMUFifo(burst, n * MPU6500_FIFO_RECORD_SIZE, samples + produced, n, timestamp, periodUs);
+    timestamp += n * periodUs;
+    produced += n;
+  }
+
+  // Apply the same biases FastIMU would (in g and dps)
+  for (uint16_t i = 0; i < produced; i++) {
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      samples[i].accel[axis] -= calib.accelBias[axis] * STANDARD_GRAVITY;
+      samples[i].gyro[axis] -= calib.gyroBias[axis] * DEG_TO_RAD;
+    }
+  }
+  fifoStats.samples += produced;
+  return produced;
+}
+
+uint16_t readIMUBatch(IMUSample* samples, uint16_t maxSamples) {
+  busBegin(BUS_DEV_IMU, 0); // Highest priority, always granted
+  uint16_t count = drainIMUFifo(samples, maxSamples);
+  busEnd(BUS_DEV_IMU);
+  return count;
+}
+
+IMUFifoStats getIMUFifoStats() {
+  return fifoStats;
 }
 #endif
 
 #if ENABLE_ADS1115
+// Round-robin over channels whose sample period has elapsed, starting
+// after the last converted channel. Returns -1 if none is due.
+static int8_t nextDueChannel(uint32_t now) {
+  for (uint8_t i = 1; i <= 4; i++) {
+    uint8_t ch = (adcLastChannel + i) & 3;
+    if (adcChannelRates[ch] && (int32_t)(now - adcNextDueUs[ch]) >= 0) return ch;
+  }
+  return -1;
+}
+
+static void startConversion(int8_t ch, uint32_t now) {
+  // Re-programming the mux restarts conversion; staying on the same channel
+  // in continuous mode just waits for the next result
+  if (ch != adcRunningChannel) {
+    ads.startADCReading(adcMux[ch], true);
+    adcRunningChannel = ch;
+  }
+  adcChannel = ch;
+  adcStartUs = now;
+  adcReady = false;
+  busReserve(BUS_DEV_ADC, now + ADS1115_CONVERSION_US);
+}
+
+void updateADC() {
+#if ENABLE_SIMULATION
+  return; // ADC values come from the simulated SamplerBackend
+#endif
+  uint32_t now = halMicros();
+
+  if (adcChannel >= 0) {
+#if ADS1115_ALERT_PIN >= 0
+    if (!adcReady) return;
+#else
+    if (now - adcStartUs < ADS1115_CONVERSION_US) return;
+#endif
+  } else if (nextDueChannel(now) < 0) {
+    return;
+  }
+  // Result read plus mux write; waits if the IMU is about to be read
+  if (!busBegin(BUS_DEV_ADC, BUS_ADC_TRANSFER_US)) return;
+
+  if (adcChannel >= 0) {
+    adcCache[adcChannel] = ads.getLastConversionResults();
+    adcLastChannel = adcChannel;
+    adcNextDueUs[adcChannel] += 1000000UL / adcChannelRates[adcChannel];
+    if ((int32_t)(now - adcNextDueUs[adcChannel]) > 0) adcNextDueUs[adcChannel] = now;
+  }
+
+  int8_t next = nextDueChannel(now);
+  if (next < 0) {
+    adcChannel = -1;
+  } else {
+    startConversion(next, now);
+  }
+  busEnd(BUS_DEV_ADC);
+}
+
 int16_t readADC(uint8_t channel) {
   if (channel > 3) return 0;
-  return ads.readADC_SingleEnded(channel);
+  return adcCache[channel];
 }
 
 float readADCVoltage(uint8_t channel) {
-  int16_t adcValue = readADC(channel);
-  return adcValue * 0.125 / 1000; // ±4.096V range
+  return adcToVoltage(readADC(channel));
 }
 #endif
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include "Config.h"
 
+#define STANDARD_GRAVITY 9.80665f
+
 void initSensors();
 
 #if ENABLE_MAX31855
@@ -12,7 +14,31 @@ float readTemperature(); // Returns temperature in Celsius
 inline float readTemperature() { return -1.0; } // Default error value
 #endif
 
+// Timestamped IMU sample, delivered in batches when the FIFO is enabled
+struct IMUSample {
+  uint32_t timestampUs;
+  float accel[3]; // m/s^2
+  float gyro[3];  // rad/s
+};
+
+struct IMUFifoStats {
+  uint32_t samples;   // Records parsed
+  uint32_t bursts;    // Burst reads issued
+  uint32_t overflows; // FIFO overflows (FIFO reset, data lost)
+};
+
+#define MPU6500_FIFO_SIZE 512
+#define MPU6500_FIFO_RECORD_SIZE 12 // Accel X/Y/Z then gyro X/Y/Z, big-endian int16
+#define MPU6500_FIFO_MAX_SAMPLES (MPU6500_FIFO_SIZE / MPU6500_FIFO_RECORD_SIZE)
+
+// Converts raw FIFO records (±16 g, ±2000 dps) into samples spaced
+// periodUs apart starting at firstTimestampUs. Partial trailing records are
+// ignored. Returns the number of samples written.
+uint16_t parseIMUFifo(const uint8_t* data, uint16_t length, IMUSample* samples, uint16_t maxSamples,
+                      uint32_t firstTimestampUs, uint32_t periodUs);
+
 #if ENABLE_MPU6500
+// Acceleration in m/s^2, angular rate in rad/s
 void readIMU(float &accelX, float &accelY, float &accelZ, float &gyroX, float &gyroY, float &gyroZ);
 #else
 inline void readIMU(float &accelX, float &accelY, float &accelZ, float &gyroX, float &gyroY, float &gyroZ) {
@@ -20,10 +46,22 @@ inline void readIMU(float &accelX, float &accelY, float &accelZ, float &gyroX, f
 }
 #endif
 
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+// Drains the hardware FIFO; returns the number of samples written
+uint16_t readIMUBatch(IMUSample* samples, uint16_t maxSamples);
+IMUFifoStats getIMUFifoStats();
+#endif
+
+inline float adcToVoltage(int16_t adcValue) {
+  return adcValue * 0.125 / 1000; // ±4.096V range
+}
+
 #if ENABLE_ADS1115
-int16_t readADC(uint8_t channel); // Raw ADC value
-float readADCVoltage(uint8_t channel); // Voltage
+void updateADC(); // Non-blocking; call every loop to advance the conversion pipeline
+int16_t readADC(uint8_t channel); // Latest raw ADC value (never blocks)
+float readADCVoltage(uint8_t channel); // Latest voltage (never blocks)
 #else
+inline void updateADC() {}
 inline int16_t readADC(uint8_t) { return 0; }
 inline float readADCVoltage(uint8_t) { return 0.0; }
 #endif
@@ -0,0 +1,151 @@
+#include "Settings.h"
+#include "FlightController.h"
+#include "Attitude.h"
+#include "ROS2Bridge.h"
+#include "HID.h"
+#include "Actuation.h"
+
+static constexpr SettingDef settings[] = {
+  // key                type            variable                   min      max      default                owner
+#if ENABLE_FLIGHTCONTROLLER
+  {"liftoff_accel",  SETTING_FLOAT,  &liftoffAccelThreshold,    2.0f,    100.0f,  10.0f,                 "flight", nullptr},
+  {"liftoff_ms",     SETTING_UINT32, &liftoffHoldMs,            0,       1000,    50,                    "flight", nullptr},
+  {"apogee_vel",     SETTING_FLOAT,  &apogeeVelocityThreshold,  -20.0f,  20.0f,   0.0f,                  "flight", nullptr},
+  {"landing_dv",     SETTING_FLOAT,  &landingImpactVelocity,    0.5f,    20.0f,   2.0f,                  "flight", nullptr},
+  {"landing_ms",     SETTING_UINT32, &landingRestMs,            0,       60000,   2000,                  "flight", nullptr},
+  {"arm_delay_ms",   SETTING_UINT32, &armDelayMs,               0.0f,    600000,  5000,                  "flight", nullptr},
+#endif
+  {"madgwick_beta",  SETTING_FLOAT,  &attitudeBeta,             0.0f,    1.0f,    0.1f,                  "attitude", nullptr},
+#if ENABLE_ROS2_BRIDGE
+  {"ros2_rate_ms",   SETTING_UINT32, &ros2PublishRateMs,        1,       1000,    ROS2_PUBLISH_RATE_MS,  "ros2", applyROS2PublishRate},
+#endif
+#if ENABLE_HID
+  {"hid_flight_ms",  SETTING_UINT32, &hidFlightRefreshMs,       0,       60000,   HID_FLIGHT_REFRESH_MS, "hid", nullptr},
+  // Module toggles from the HID menu
+  {"en_max31855",    SETTING_BOOL,   &max31855Enabled,          0,       1,       1,                     "hid", nullptr},
+  {"en_mpu6500",     SETTING_BOOL,   &mpu6500Enabled,           0,       1,       1,                     "hid", nullptr},
+  {"en_ads1115",     SETTING_BOOL,   &ads1115Enabled,           0,       1,       1,                     "hid", nullptr},
+  {"en_rs485",       SETTING_BOOL,   &rs485Enabled,             0,       1,       1,                     "hid", nullptr},
+  {"en_canbus",      SETTING_BOOL,   &canbusEnabled,            0,       1,       0,                     "hid", nullptr},
+  {"en_bluetooth",   SETTING_BOOL,   &bluetoothEnabled,         0,       1,       1,                     "hid", nullptr},
+  {"en_lora",        SETTING_BOOL,   &loraEnabled,              0,       1,       1,                     "hid", nullptr},
+  {"en_sd",          SETTING_BOOL,   &sdEnabled,                0,       1,       1,                     "hid", nullptr},
+  {"en_w25q128",     SETTING_BOOL,   &w25q128Enabled,           0,       1,       1,                     "hid", nullptr},
+  {"en_relay0",      SETTING_BOOL,   &relay0Enabled,            0,       1,       1,                     "hid", nullptr},
+  {"en_pwm1",        SETTING_BOOL,   &pwm1Enabled,              0,       1,       1,                     "hid", nullptr},
+#endif
+#if ENABLE_ACTUATION
+  {"act_max_pwm",    SETTING_UINT8,  &actuatorMaxPwm,           0,       255,     255,                   "actuation", nullptr},
+#endif
+};
+
+#define SETTING_COUNT (sizeof(settings) / sizeof(settings[0]))
+
+static constexpr SettingIndex settingIndex = buildSettingIndex(settings, SETTING_COUNT);
+static_assert(SETTING_COUNT < SETTING_NONE, "Too many settings");
+static_assert(settingIndex.seed != 0, "No perfect hash seed for the setting keys, raise SETTING_SLOTS");
+
+static void writeSetting(const SettingDef& def, float value) {
+  switch (def.type) {
+    case SETTING_FLOAT: *(float*)def.value = value; break;
+    case SETTING_UINT32: *(uint32_t*)def.value = (uint32_t)value; break;
+    case SETTING_UINT8: *(uint8_t*)def.value = (uint8_t)value; break;
+    case SETTING_BOOL: *(bool*)def.value = value != 0; break;
+  }
+}
+
+void initSettings() {
+  for (const SettingDef& def : settings) writeSetting(def, def.defaultValue);
+}
+
+uint8_t getSettingCount() {
+  return SETTING_COUNT;
+}
+
+const SettingDef* getSetting(uint8_t id) {
+  return id < SETTING_COUNT ? &settings[id] : nullptr;
+}
+
+int findSetting(const char* key, size_t length) {
+  uint8_t id = settingIndex.slots[settingHash(key, length, settingIndex.seed) & (SETTING_SLOTS - 1)];
+  if (id == SETTING_NONE) return -1;
+  const char* candidate = settings[id].key;
+  return (strncmp(candidate, key, length) == 0 && candidate[length] == '\0') ? id : -1;
+}
+
+SettingResult setSetting(uint8_t id, float value) {
+  if (id >= SETTING_COUNT) return SETTING_UNKNOWN_KEY;
+  const SettingDef& def = settings[id];
+  if (!(value >= def.min && value <= def.max)) return SETTING_OUT_OF_RANGE;
+  writeSetting(def, value);
+  if (def.apply) def.apply();
+  return SETTING_OK;
+}
+
+SettingResult setSettingText(const char* key, size_t keyLength, const char* value) {
+  int id = findSetting(key, keyLength);
+  if (id < 0) return SETTING_UNKNOWN_KEY;
+  char* end = nullptr;
+  float number = (settings[id].type == SETTING_FLOAT) ? strtof(value, &end) : (float)strtoul(value, &end, 10);
+  if (end == value || *end != '\0') return SETTING_BAD_VALUE;
+  return setSetting(id, number);
+}
+
+SettingResult applySettingCommand(const char* command) {
+  const char* equals = strchr(command, '=');
+  if (!equals) return SETTING_BAD_VALUE;
+  return setSettingText(command, equals - command, equals + 1);
+}
+
+float readSetting(uint8_t id) {
+  if (id >= SETTING_COUNT) return 0;
+  const SettingDef& def = settings[id];
+  switch (def.type) {
+    case SETTING_FLOAT: return *(const float*)def.value;
+    case SETTING_UINT32: return *(const uint32_t*)def.value;
+    case SETTING_UINT8: return *(const uint8_t*)def.value;
+    case SETTING_BOOL: return *(const bool*)def.value;
+  }
+  return 0;
+}
+
+const char* getSettingResultText(SettingResult result) {
+  switch (result) {
+    case SETTING_OK: return "ACK";
+    case SETTING_UNKNOWN_KEY: return "NACK - Unknown key";
+    case SETTING_BAD_VALUE: return "NACK - Invalid format";
+    case SETTING_OUT_OF_RANGE: return "NACK - Out of range";
+  }
+  return "NACK";
+}
+
+size_t formatSettings(char* out, size_t size) {
+  size_t used = 0;
+  out[0] = '\0';
+  for (uint8_t i = 0; i < SETTING_COUNT && used < size; i++) {
+    const SettingDef& def = settings[i];
+    if (def.type == SETTING_FLOAT) {
+      used += snprintf(out + used, size - used, "%s=%g\n", def.key, readSetting(i));
+    } else {
+      used += snprintf(out + used, size - used, "%s=%lu\n", def.key, (unsigned long)readSetting(i));
+    }
+  }
+  return used < size ? used : size - 1;
+}
+
+void printSettings() {
+  // Format: PARAM,key,value,min,max,owner
+  for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+    const SettingDef& def = settings[i];
+    Serial.print("PARAM,");
+    Serial.print(def.key);
+    Serial.print(",");
+    Serial.print(readSetting(i), def.type == SETTING_FLOAT ? 4 : 0);
+    Serial.print(",");
+    Serial.print(def.min, def.type == SETTING_FLOAT ? 4 : 0);
+    Serial.print(",");
+    Serial.print(def.max, def.type == SETTING_FLOAT ? 4 : 0);
+    Serial.print(",");
+    Serial.println(def.owner);
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Typed settings registry. Every runtime-tunable value is declared once in
+// the table in Settings.cpp with its key, type, range, default and owning
+// module, and points at the variable the module reads. Setting a key
+// writes that variable, so the change takes effect on the module's next
+// run without the module ever looking at strings.
+//
+// Keys are found with a perfect hash built at compile time: a seed for
+// FNV-1a is searched until every key lands in its own slot, so a lookup is
+// one hash, one slot read and one key compare.
+
+enum SettingType : uint8_t {
+  SETTING_FLOAT = 0,
+  SETTING_UINT32,
+  SETTING_UINT8,
+  SETTING_BOOL
+};
+
+struct SettingDef {
+  const char* key;
+  SettingType type;
+  void* value;         // The live variable
+  float min;
+  float max;
+  float defaultValue;
+  const char* owner;   // Module the variable belongs to
+  void (*apply)();     // Optional, called after the value changes
+};
+
+enum SettingResult : uint8_t {
+  SETTING_OK = 0,
+  SETTING_UNKNOWN_KEY,
+  SETTING_BAD_VALUE,
+  SETTING_OUT_OF_RANGE
+};
+
+#define SETTING_SLOTS 128 // Hash table size, power of two
+#define SETTING_NONE 0xFF
+
+constexpr size_t settingKeyLength(const char* key) {
+  size_t length = 0;
+  while (key[length]) length++;
+  return length;
+}
+
+constexpr uint32_t settingHash(const char* key, size_t length, uint32_t seed) {
+  uint32_t hash = 2166136261UL ^ seed;
+  for (size_t i = 0; i < length; i++) hash = (hash ^ (uint8_t)key[i]) * 16777619UL;
+  return hash;
+}
+
+struct SettingIndex {
+  uint32_t seed; // 0 if no collision-free seed was found
+  uint8_t slots[SETTING_SLOTS];
+};
+
+constexpr SettingIndex buildSettingIndex(const SettingDef* defs, size_t count) {
+  for (uint32_t seed = 1; seed < 10000; seed++) {
+    SettingIndex index = {seed, {}};
+    for (uint8_t& slot : index.slots) slot = SETTING_NONE;
+    bool unique = true;
+    for (size_t i = 0; i < count && unique; i++) {
+      uint32_t slot = settingHash(defs[i].key, settingKeyLength(defs[i].key), seed) & (SETTING_SLOTS - 1);
+      if (index.slots[slot] != SETTING_NONE) unique = false;
+      else index.slots[slot] = i;
+    }
+    if (unique) return index;
+  }
+  return SettingIndex{};
+}
+
+void initSettings(); // Writes every default; call first in setup()
+uint8_t getSettingCount();
+const SettingDef* getSetting(uint8_t id);
+int findSetting(const char* key, size_t length); // Setting id, or -1
+SettingResult setSetting(uint8_t id, float value);
+SettingResult setSettingText(const char* key, size_t keyLength, const char* value);
+// Parses "KEY=VALUE" and applies it
+SettingResult applySettingCommand(const char* command);
+float readSetting(uint8_t id);
+const char* getSettingResultText(SettingResult result);
+size_t formatSettings(char* out, size_t size); // KEY=VALUE lines, returns the length written
+void printSettings(); // PARAM lines on Serial
+
+#endif
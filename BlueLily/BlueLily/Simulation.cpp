@@ -0,0 +1,177 @@
+#include "Simulation.h"
+
+#if ENABLE_SIMULATION
+#include "Hal.h"
+#include "Sampler.h"
+#include "FlightController.h"
+
+static const float AIR_DENSITY = 1.225; // kg/m^3, sea level
+static const uint32_t IMPACT_US = 50000; // Time the ground takes to stop the vehicle
+
+static SimFlightConfig config;
+static uint32_t simTimeUs = 0;
+static uint32_t rngState = 1;
+
+// Ground truth
+static float altitude = 0.0;     // m above the pad
+static float velocity = 0.0;     // m/s, positive up
+static float acceleration = 0.0; // m/s^2, kinematic (gravity included)
+static bool chuteOpen = false;
+static bool landed = false;
+static uint32_t liftoffUs = 0, apogeeUs = 0, landingUs = 0;
+static float impactAccel = 0.0; // m/s^2 while the touchdown impact lasts
+
+static SimEventStats events;
+
+static uint32_t simMicros() {
+  return simTimeUs;
+}
+
+static uint32_t simMillis() {
+  return simTimeUs / 1000;
+}
+
+// xorshift32, uniform in [0, 1)
+static float uniform() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (rngState >> 8) * (1.0f / 16777216.0f);
+}
+
+// Sum of four uniforms scaled to zero mean, unit variance
+static float gaussian() {
+  return (uniform() + uniform() + uniform() + uniform() - 2.0f) * 1.7320508f;
+}
+
+static void simReadIMU(float &accelX, float &accelY, float &accelZ, float &gyroX, float &gyroY, float &gyroZ) {
+  if (uniform() < config.dropoutRate) {
+    accelX = accelY = accelZ = gyroX = gyroY = gyroZ = 0.0;
+    return;
+  }
+  // The IMU measures specific force: kinematic acceleration minus gravity
+  accelX = gaussian() * config.accelNoise;
+  accelY = gaussian() * config.accelNoise;
+  accelZ = acceleration + STANDARD_GRAVITY + gaussian() * config.accelNoise;
+  if (uniform() < config.spikeRate) accelZ += 5.0f * STANDARD_GRAVITY;
+  gyroX = gaussian() * config.gyroNoise;
+  gyroY = gaussian() * config.gyroNoise;
+  gyroZ = gaussian() * config.gyroNoise;
+}
+
+static float simReadTemperature() {
+  return 25.0 + gaussian() * 0.1f;
+}
+
+static int16_t simReadADC(uint8_t) {
+  return 0;
+}
+
+static void step(float dt) {
+  float t = simTimeUs * 1e-6f;
+  if (!liftoffUs && t >= config.ignitionTime) liftoffUs = simTimeUs;
+  if (!liftoffUs) {
+    acceleration = 0.0;
+    return;
+  }
+  if (landed) {
+    // The IMU feels the touchdown as a deceleration, then rest
+    acceleration = simTimeUs - landingUs < IMPACT_US ? impactAccel : 0.0f;
+    return;
+  }
+
+  // The parachute opens when the flight controller fires it at apogee
+  if (!chuteOpen && getFlightState() >= APOGEE) chuteOpen = true;
+
+  float thrust = (t - config.ignitionTime < config.burnTime) ? config.thrust : 0.0f;
+  float area = chuteOpen ? config.chuteDragArea : config.dragArea;
+  float drag = 0.5f * AIR_DENSITY * area * velocity * fabsf(velocity);
+  acceleration = (thrust - drag) / config.mass - STANDARD_GRAVITY;
+
+  float previousVelocity = velocity;
+  velocity += acceleration * dt;
+  altitude += velocity * dt;
+
+  if (!apogeeUs && previousVelocity > 0.0f && velocity <= 0.0f) apogeeUs = simTimeUs;
+  if (altitude <= 0.0f) {
+    if (apogeeUs) {
+      landed = true;
+      landingUs = simTimeUs;
+      impactAccel = -velocity / (IMPACT_US * 1e-6f);
+    }
+    altitude = velocity = 0.0;
+    acceleration = landed ? impactAccel : 0.0f;
+  }
+}
+
+static int32_t delayUs(FlightState state, uint32_t truthUs) {
+  uint32_t detectedUs = getFlightEventTime(state);
+  return (detectedUs && truthUs) ? (int32_t)(detectedUs - truthUs) : 0;
+}
+
+static void updateEventStats() {
+  uint32_t ascentUs = getFlightEventTime(ASCENT);
+  if (ascentUs && (!liftoffUs || ascentUs < liftoffUs)) events.falseLiftoff = true;
+  if (events.complete) return;
+  events.liftoffDelayUs = delayUs(ASCENT, liftoffUs);
+  events.apogeeDelayUs = delayUs(APOGEE, apogeeUs);
+  // Landing can be declared before touchdown, so wait for both
+  if (!getFlightEventTime(LANDED) || !landed) return;
+
+  events.landingDelayUs = delayUs(LANDED, landingUs);
+  events.complete = true;
+
+  // Format: SIM,liftoff_delay_us,apogee_delay_us,landing_delay_us,false_liftoff
+  Serial.print("SIM,");
+  Serial.print(events.liftoffDelayUs);
+  Serial.print(",");
+  Serial.print(events.apogeeDelayUs);
+  Serial.print(",");
+  Serial.print(events.landingDelayUs);
+  Serial.print(",");
+  Serial.println(events.falseLiftoff ? 1 : 0);
+}
+
+SimFlightConfig defaultSimFlightConfig() {
+  SimFlightConfig defaults;
+  defaults.mass = 1.5;
+  defaults.thrust = 60.0;
+  defaults.burnTime = 1.5;
+  defaults.ignitionTime = 10.0;
+  defaults.dragArea = 0.004;
+  defaults.chuteDragArea = 1.5;
+  defaults.accelNoise = 0.05;
+  defaults.gyroNoise = 0.005;
+  defaults.dropoutRate = 0.0;
+  defaults.spikeRate = 0.0;
+  defaults.seed = 1;
+  return defaults;
+}
+
+void initSimulation(const SimFlightConfig& flight) {
+  config = flight;
+  rngState = config.seed ? config.seed : 1;
+  simTimeUs = 0;
+  altitude = velocity = acceleration = 0.0;
+  chuteOpen = landed = false;
+  liftoffUs = apogeeUs = landingUs = 0;
+  impactAccel = 0.0;
+  memset(&events, 0, sizeof(events));
+
+  HalClock clock = {simMicros, simMillis};
+  setHalClock(clock);
+  SamplerBackend backend = {simReadIMU, simReadTemperature, simReadADC, nullptr};
+  setSamplerBackend(backend);
+  Serial.println("Simulation Initialized");
+}
+
+void updateSimulation() {
+  simTimeUs += SIM_STEP_US;
+  step(SIM_STEP_US * 1e-6f);
+  updateEventStats();
+}
+
+SimEventStats getSimEventStats() {
+  return events;
+}
+#endif
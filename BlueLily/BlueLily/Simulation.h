@@ -0,0 +1,46 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Software-in-the-loop flight. Installs a virtual clock (see Hal.h) and a
+// simulated SamplerBackend, then integrates a vertical thrust/drag/parachute
+// trajectory by SIM_STEP_US per loop, so the unmodified flight controller
+// runs faster than real time. The parachute opens when the flight
+// controller reaches APOGEE, closing the loop through its own decisions.
+// Sensor noise and faults (dropouts, spikes) come from a seeded generator
+// so a run is reproducible.
+
+struct SimFlightConfig {
+  float mass;           // kg
+  float thrust;         // N, constant over the burn
+  float burnTime;       // s
+  float ignitionTime;   // s after boot
+  float dragArea;       // m^2, Cd * A of the airframe
+  float chuteDragArea;  // m^2, Cd * A with the parachute open
+  float accelNoise;     // m/s^2 standard deviation
+  float gyroNoise;      // rad/s standard deviation
+  float dropoutRate;    // Probability an IMU read returns all zeros
+  float spikeRate;      // Probability an IMU read has a +5 g spike on Z
+  uint32_t seed;
+};
+
+// Detection delays relative to the simulated ground truth. Each is set once
+// both the event and its detection have happened, 0 until then.
+struct SimEventStats {
+  int32_t liftoffDelayUs;
+  int32_t apogeeDelayUs;
+  int32_t landingDelayUs;
+  bool falseLiftoff; // ASCENT entered before ignition
+  bool complete;     // Landing detected, stats are final
+};
+
+#if ENABLE_SIMULATION
+SimFlightConfig defaultSimFlightConfig();
+void initSimulation(const SimFlightConfig& config); // Call before initSampler()
+void updateSimulation(); // Call every loop; advances virtual time by SIM_STEP_US
+SimEventStats getSimEventStats();
+#endif
+
+#endif
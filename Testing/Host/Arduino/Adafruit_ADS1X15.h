@@ -0,0 +1,58 @@
+#ifndef ADAFRUIT_ADS1X15_H
+#define ADAFRUIT_ADS1X15_H
+
+// Host stand-in for the Adafruit ADS1X15 library. Register traffic goes
+// over the Wire stand-in to the ADS1115 model in HostSensors.cpp.
+
+#include <Arduino.h>
+
+#define ADS1X15_REG_POINTER_CONVERT 0x00
+#define ADS1X15_REG_POINTER_CONFIG 0x01
+#define ADS1X15_REG_CONFIG_OS_SINGLE 0x8000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 0x4000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 0x5000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 0x6000
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 0x7000
+#define ADS1X15_REG_CONFIG_MODE_CONTIN 0x0000
+#define ADS1X15_REG_CONFIG_MODE_SINGLE 0x0100
+#define ADS1X15_REG_CONFIG_CQUE_NONE 0x0003
+
+typedef enum {
+  GAIN_TWOTHIRDS = 0x0000,
+  GAIN_ONE = 0x0200,
+  GAIN_TWO = 0x0400,
+  GAIN_FOUR = 0x0600,
+  GAIN_EIGHT = 0x0800,
+  GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+#define RATE_ADS1115_8SPS 0x0000
+#define RATE_ADS1115_16SPS 0x0020
+#define RATE_ADS1115_32SPS 0x0040
+#define RATE_ADS1115_64SPS 0x0060
+#define RATE_ADS1115_128SPS 0x0080
+#define RATE_ADS1115_250SPS 0x00A0
+#define RATE_ADS1115_475SPS 0x00C0
+#define RATE_ADS1115_860SPS 0x00E0
+
+class Adafruit_ADS1115 {
+public:
+  bool begin(uint8_t address = 0x48);
+  void setGain(adsGain_t value) { gain = value; }
+  void setDataRate(uint16_t value) { rate = value; }
+  int16_t readADC_SingleEnded(uint8_t channel);
+  void startADCReading(uint16_t mux, bool continuous);
+  bool conversionComplete();
+  int16_t getLastConversionResults();
+  float computeVolts(int16_t counts);
+
+private:
+  void writeRegister(uint8_t reg, uint16_t value);
+  uint16_t readRegister(uint8_t reg);
+
+  uint8_t address = 0x48;
+  uint16_t gain = GAIN_TWOTHIRDS;
+  uint16_t rate = RATE_ADS1115_128SPS;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ADAFRUIT_GFX_H
+#define ADAFRUIT_GFX_H
+
+// Host stand-in for Adafruit GFX: draws into a 1-bit page-major
+// framebuffer like the SSD1306 driver's. Text uses a placeholder 5x7 glyph
+// per character (not the real font): same cell size and cursor movement,
+// so layouts and changed-byte counts are realistic.
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : w(w), h(h) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint16_t color);
+  void setTextSize(uint8_t size) { textSize = size ? size : 1; }
+  void setTextColor(uint16_t color) { textColor = color; }
+  void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int16_t width() const { return w; }
+  int16_t height() const { return h; }
+
+protected:
+  int16_t w, h;
+  int16_t cursorX = 0, cursorY = 0;
+  uint8_t textSize = 1;
+  uint16_t textColor = 1;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef ADAFRUIT_SSD1306_H
+#define ADAFRUIT_SSD1306_H
+
+// Host stand-in for the Adafruit SSD1306 driver. display() sends the whole
+// buffer over the Wire stand-in the way the library does, to the panel
+// model in HostDisplay.cpp (see hostOledPanel()).
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* wire, int8_t resetPin = -1,
+                   uint32_t clockDuring = 400000UL, uint32_t clockAfter = 100000UL);
+  ~Adafruit_SSD1306();
+
+  bool begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t address = 0x3C);
+  void clearDisplay();
+  void display();
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  uint8_t* getBuffer() { return buffer; }
+  void ssd1306_command(uint8_t command);
+  void dim(bool dim);
+
+private:
+  void commands(const uint8_t* bytes, size_t length);
+
+  TwoWire* wire;
+  uint32_t clockDuring, clockAfter;
+  uint8_t address = 0x3C;
+  uint8_t* buffer = nullptr;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Host stand-in for the parts of the Teensy core the firmware uses. Time,
+// pins and the serial ports are backed by the host model in
+// HostArduino.cpp; HostHardware.h has the controls for tests and the host
+// main.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define PROGMEM
+#define F(x) x
+
+#define HOST_PIN_COUNT 64
+
+template <class A, class B> typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <class A, class B> typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+template <class T, class L, class H> T constrain(T x, L low, H high) { return x < low ? low : (x > high ? high : x); }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+class String {
+public:
+  String(const char* text = "") : text(text ? text : "") {}
+  String(const std::string& text) : text(text) {}
+  const char* c_str() const { return text.c_str(); }
+  unsigned length() const { return text.size(); }
+  bool startsWith(const char* prefix) const { return text.compare(0, strlen(prefix), prefix) == 0; }
+  String substring(unsigned from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const { return from < text.size() ? String(text.substr(from, to - from)) : String(); }
+  void trim();
+  int indexOf(char c) const { size_t pos = text.find(c); return pos == std::string::npos ? -1 : (int)pos; }
+  bool operator==(const char* other) const { return text == other; }
+  bool operator!=(const char* other) const { return text != other; }
+  String& operator+=(char c) { text += c; return *this; }
+  char operator[](unsigned i) const { return i < text.size() ? text[i] : 0; }
+
+private:
+  std::string text;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t length);
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+  template <class T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <class T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { timeoutMs = ms; }
+  size_t readBytes(uint8_t* buffer, size_t length);
+  size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+  String readStringUntil(char terminator);
+
+protected:
+  // Waits up to the stream timeout for a byte, -1 if none came
+  virtual int timedRead();
+  unsigned long timeoutMs = 1000;
+};
+
+// UART (and USB serial) model. Written bytes queue in a TX buffer that
+// drains at the baud rate on the host clock, so availableForWrite(),
+// flush() and the RS485 DE/RE pin behave like the Teensy's interrupt
+// driven serial. Received bytes come from hostInject() or an attached pty.
+struct HostSerialStats {
+  uint64_t txBytes;
+  uint64_t rxBytes;
+  uint32_t writeCalls;
+  uint32_t writeStalls;     // write() calls that had to wait for TX space
+  uint32_t maxQueuedBytes;
+  uint32_t deAssertions;    // transmitterEnable() pin raised
+  uint32_t maxDeHighUs;     // Longest time the DE pin stayed high
+};
+
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(const char* name, bool usb = false);
+  ~HardwareSerial();
+
+  void begin(unsigned long baud);
+  void end() {}
+  operator bool() { return true; }
+  void transmitterEnable(uint8_t pin);
+  void addMemoryForWrite(void* buffer, size_t size);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+  int availableForWrite() override;
+  void flush() override; // Waits until the last byte has left the UART
+
+  // Host side
+  const char* hostName() const { return name; }
+  void hostInject(const void* data, size_t length); // Bytes arriving on RX
+  void hostInject(const char* text) { hostInject(text, strlen(text)); }
+  void hostCapture(bool enabled);                   // Keep TX bytes for hostTakeOutput()
+  std::string hostTakeOutput();                     // Captured TX bytes since the last call
+  void hostEcho(FILE* stream);                      // Copy TX bytes to a stdio stream, nullptr = off
+  bool hostOpenPty(char* path, size_t size);        // TX/RX through a new pseudo-terminal
+  void hostReset();                                 // Drop queued data and stats
+  HostSerialStats hostStats();
+  bool hostDeHigh();                                // DE pin state now
+
+private:
+  void drain();
+  void pollPty();
+  void setDe(bool high);
+
+  const char* name;
+  bool usb;
+  unsigned long baud = 0;
+  uint32_t txCapacity = 64;
+  uint32_t txQueued = 0;
+  uint64_t lastDrainUs = 0;
+  double drainCredit = 0;
+  int dePin = -1;
+  bool deHigh = false;
+  uint64_t deHighSinceUs = 0;
+  std::string rx;
+  size_t rxPos = 0;
+  bool capture = false;
+  std::string captured;
+  FILE* echo = nullptr;
+  int ptyFd = -1;
+  HostSerialStats stats = {};
+};
+
+extern HardwareSerial Serial;  // USB
+extern HardwareSerial Serial1; // Bluetooth
+extern HardwareSerial Serial2; // RS485
+
+class IntervalTimer {
+public:
+  bool begin(void (*)(), unsigned long) { return true; }
+  void end() {}
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FASTIMU_H
+#define FASTIMU_H
+
+// Host stand-in for the FastIMU MPU6500 driver. It talks to the MPU6500
+// register model over the Wire stand-in (see HostHardware.h), so reads cost
+// the same I2C time as on the board.
+
+#include <Arduino.h>
+
+struct calData {
+  bool valid;
+  float accelBias[3];
+  float gyroBias[3];
+  float magBias[3];
+  float magScale[3];
+};
+
+struct AccelData { float accelX, accelY, accelZ; };
+struct GyroData { float gyroX, gyroY, gyroZ; };
+
+class MPU6500 {
+public:
+  int init(calData cal, uint8_t address); // 0 on success
+  void update();
+  void getAccel(AccelData* out) { *out = accel; }
+  void getGyro(GyroData* out) { *out = gyro; }
+  void calibrateAccelGyro(calData* cal);
+  int setAccelRange(int g);
+  int setGyroRange(int dps);
+
+private:
+  uint8_t address = 0x68;
+  calData calibration = {};
+  float accelLsbPerG = 2048.0f;
+  float gyroLsbPerDps = 16.4f;
+  AccelData accel = {};
+  GyroData gyro = {};
+};
+
+#endif
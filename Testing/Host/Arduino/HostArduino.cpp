@@ -0,0 +1,445 @@
+#include "HostHardware.h"
+#include <stdarg.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
+// Clock
+
+static bool realTime = false;
+static uint64_t virtualUs = 0;
+static uint64_t realStartNs = 0;
+
+static uint64_t monotonicNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void hostUseRealTime(bool enabled) {
+  if (enabled && !realTime) realStartNs = monotonicNs() - virtualUs * 1000;
+  if (!enabled && realTime) virtualUs = hostTimeUs();
+  realTime = enabled;
+}
+
+bool hostRealTime() {
+  return realTime;
+}
+
+uint64_t hostTimeUs() {
+  return realTime ? (monotonicNs() - realStartNs) / 1000 : virtualUs;
+}
+
+void hostAdvanceUs(uint64_t us) {
+  if (!realTime) virtualUs += us;
+}
+
+void hostChargeUs(uint32_t us) {
+  if (!realTime) virtualUs += us;
+}
+
+unsigned long millis() {
+  return (uint32_t)(hostTimeUs() / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t)hostTimeUs();
+}
+
+void delay(unsigned long ms) {
+  if (realTime) {
+    timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, nullptr);
+  } else {
+    virtualUs += ms * 1000ULL;
+  }
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (realTime) {
+    uint64_t end = monotonicNs() + us * 1000ULL;
+    while (monotonicNs() < end) {}
+  } else {
+    virtualUs += us;
+  }
+}
+
+void yield() {}
+
+// Pins
+
+static uint8_t pinModes[HOST_PIN_COUNT];
+static int pinInputs[HOST_PIN_COUNT];
+static bool pinInputSet[HOST_PIN_COUNT];
+static int pinOutputs[HOST_PIN_COUNT];
+static int analogInputs[HOST_PIN_COUNT];
+static int analogOutputs[HOST_PIN_COUNT];
+static void (*isrs[HOST_PIN_COUNT])();
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < HOST_PIN_COUNT) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < HOST_PIN_COUNT) pinOutputs[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= HOST_PIN_COUNT) return LOW;
+  if (pinInputSet[pin]) return pinInputs[pin];
+  return pinModes[pin] == INPUT_PULLUP ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  return pin < HOST_PIN_COUNT ? analogInputs[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin < HOST_PIN_COUNT) analogOutputs[pin] = value;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int) {
+  if (interrupt < HOST_PIN_COUNT) isrs[interrupt] = isr;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  if (interrupt < HOST_PIN_COUNT) isrs[interrupt] = nullptr;
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+void hostSetPin(uint8_t pin, int value) {
+  if (pin >= HOST_PIN_COUNT) return;
+  pinInputs[pin] = value;
+  pinInputSet[pin] = true;
+}
+
+int hostGetPin(uint8_t pin) {
+  return pin < HOST_PIN_COUNT ? pinOutputs[pin] : LOW;
+}
+
+void hostSetAnalog(uint8_t pin, int value) {
+  if (pin < HOST_PIN_COUNT) analogInputs[pin] = value;
+}
+
+int hostGetAnalogWrite(uint8_t pin) {
+  return pin < HOST_PIN_COUNT ? analogOutputs[pin] : 0;
+}
+
+void hostTriggerInterrupt(uint8_t pin) {
+  if (pin < HOST_PIN_COUNT && isrs[pin]) isrs[pin]();
+}
+
+// String, Print, Stream
+
+void String::trim() {
+  size_t first = text.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    text.clear();
+    return;
+  }
+  size_t last = text.find_last_not_of(" \t\r\n");
+  text = text.substr(first, last - first + 1);
+}
+
+size_t Print::write(const uint8_t* data, size_t length) {
+  size_t n = 0;
+  while (length--) n += write(*data++);
+  return n;
+}
+
+static size_t formatUnsigned(char* out, unsigned long long value, int base) {
+  if (base < 2) base = 10;
+  char digits[66];
+  size_t n = 0;
+  do {
+    int d = value % base;
+    digits[n++] = d < 10 ? '0' + d : 'A' + d - 10;
+    value /= base;
+  } while (value);
+  for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+  return n;
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  char text[66];
+  return write((const uint8_t*)text, formatUnsigned(text, value, base));
+}
+
+size_t Print::print(long long value, int base) {
+  if (base == DEC && value < 0) {
+    size_t n = write('-');
+    return n + print((unsigned long long)-(value + 1) + 1, base);
+  }
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(double value, int digits) {
+  if (isnan(value)) return print("nan");
+  if (isinf(value)) return print("inf");
+  char text[64];
+  int n = snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write((const uint8_t*)text, n > 0 ? (size_t)n : 0);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)text, min((size_t)n, sizeof(text) - 1));
+}
+
+int Stream::timedRead() {
+  uint64_t start = hostTimeUs();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    if (!hostRealTime()) {
+      hostAdvanceUs(timeoutMs * 1000ULL); // Nothing else can arrive meanwhile
+      return -1;
+    }
+    usleep(100);
+  } while (hostTimeUs() - start < timeoutMs * 1000ULL);
+  return -1;
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string text;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    text += (char)c;
+    c = timedRead();
+  }
+  return String(text);
+}
+
+// HardwareSerial
+
+HardwareSerial Serial("Serial", true);
+HardwareSerial Serial1("Serial1");
+HardwareSerial Serial2("Serial2");
+
+HardwareSerial::HardwareSerial(const char* name, bool usb) : name(name), usb(usb) {
+  if (usb) echo = stdout;
+}
+
+HardwareSerial::~HardwareSerial() {
+  if (ptyFd >= 0) close(ptyFd);
+}
+
+void HardwareSerial::begin(unsigned long rate) {
+  baud = usb ? 0 : rate; // USB serial is not paced by a baud rate
+  lastDrainUs = hostTimeUs();
+}
+
+void HardwareSerial::transmitterEnable(uint8_t pin) {
+  dePin = pin;
+  pinMode(pin, OUTPUT);
+  setDe(false);
+}
+
+void HardwareSerial::addMemoryForWrite(void*, size_t size) {
+  txCapacity += size;
+}
+
+void HardwareSerial::setDe(bool high) {
+  uint64_t now = hostTimeUs();
+  if (high && !deHigh) {
+    stats.deAssertions++;
+    deHighSinceUs = now;
+  } else if (!high && deHigh) {
+    uint32_t heldUs = now - deHighSinceUs;
+    if (heldUs > stats.maxDeHighUs) stats.maxDeHighUs = heldUs;
+  }
+  deHigh = high;
+  if (dePin >= 0) digitalWrite(dePin, high ? HIGH : LOW);
+}
+
+// Bytes leave the UART at baud / 10 (8N1); the DE pin drops with the
+// transmit-complete interrupt after the last one
+void HardwareSerial::drain() {
+  uint64_t now = hostTimeUs();
+  if (!baud) {
+    txQueued = 0;
+  } else if (txQueued) {
+    drainCredit += (now - lastDrainUs) * (baud / 10.0) / 1e6;
+    uint32_t sent = (uint32_t)drainCredit;
+    if (sent >= txQueued) {
+      // Back-date the end of transmission to when the last byte finished
+      uint64_t doneUs = now - (uint64_t)((drainCredit - txQueued) * 1e6 / (baud / 10.0));
+      txQueued = 0;
+      drainCredit = 0;
+      if (deHigh) {
+        uint32_t heldUs = doneUs - deHighSinceUs;
+        if (heldUs > stats.maxDeHighUs) stats.maxDeHighUs = heldUs;
+        deHigh = false;
+        if (dePin >= 0) digitalWrite(dePin, LOW);
+      }
+    } else {
+      txQueued -= sent;
+      drainCredit -= sent;
+    }
+  }
+  lastDrainUs = now;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+  drain();
+  if (!txQueued && length && dePin >= 0) setDe(true);
+  if (baud && txQueued + length > txCapacity) {
+    // The Teensy core blocks the caller until the bytes fit
+    stats.writeStalls++;
+    uint32_t excess = txQueued + length - txCapacity;
+    if (realTime) {
+      while (txQueued + length > txCapacity) drain();
+    } else {
+      hostAdvanceUs((excess * 10ULL * 1000000 + baud - 1) / baud);
+      drain();
+      if (txQueued + length > txCapacity) txQueued = txCapacity - length;
+    }
+  }
+  if (baud) txQueued += length;
+  if (txQueued > stats.maxQueuedBytes) stats.maxQueuedBytes = txQueued;
+  stats.txBytes += length;
+  stats.writeCalls++;
+  if (capture) captured.append((const char*)data, length);
+  if (echo) fwrite(data, 1, length, echo);
+  if (ptyFd >= 0) {
+    size_t off = 0;
+    while (off < length) {
+      ssize_t n = ::write(ptyFd, data + off, length - off);
+      if (n <= 0) break; // Nobody reading the pty; drop like a full cable
+      off += n;
+    }
+  }
+  return length;
+}
+
+int HardwareSerial::availableForWrite() {
+  drain();
+  return baud ? (int)(txCapacity - txQueued) : 4096;
+}
+
+void HardwareSerial::flush() {
+  drain();
+  if (!txQueued) return;
+  if (realTime) {
+    while (txQueued) drain();
+    return;
+  }
+  hostAdvanceUs((uint64_t)((txQueued - drainCredit) * 10 * 1e6 / baud) + 1);
+  drain();
+}
+
+void HardwareSerial::pollPty() {
+  if (ptyFd < 0) return;
+  uint8_t buffer[256];
+  ssize_t n;
+  while ((n = ::read(ptyFd, buffer, sizeof(buffer))) > 0) rx.append((const char*)buffer, n);
+}
+
+int HardwareSerial::available() {
+  pollPty();
+  return rx.size() - rxPos;
+}
+
+int HardwareSerial::read() {
+  pollPty();
+  if (rxPos >= rx.size()) return -1;
+  stats.rxBytes++;
+  int c = (uint8_t)rx[rxPos++];
+  if (rxPos == rx.size()) {
+    rx.clear();
+    rxPos = 0;
+  }
+  return c;
+}
+
+int HardwareSerial::peek() {
+  pollPty();
+  return rxPos < rx.size() ? (uint8_t)rx[rxPos] : -1;
+}
+
+void HardwareSerial::hostInject(const void* data, size_t length) {
+  rx.append((const char*)data, length);
+}
+
+void HardwareSerial::hostCapture(bool enabled) {
+  capture = enabled;
+  if (!enabled) captured.clear();
+}
+
+std::string HardwareSerial::hostTakeOutput() {
+  std::string out;
+  out.swap(captured);
+  return out;
+}
+
+void HardwareSerial::hostEcho(FILE* stream) {
+  echo = stream;
+}
+
+bool HardwareSerial::hostOpenPty(char* path, size_t size) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  const char* slave = ptsname(fd);
+  if (!slave) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  snprintf(path, size, "%s", slave);
+  ptyFd = fd;
+  return true;
+}
+
+void HardwareSerial::hostReset() {
+  txQueued = 0;
+  drainCredit = 0;
+  rx.clear();
+  rxPos = 0;
+  captured.clear();
+  deHigh = false;
+  stats = HostSerialStats();
+  lastDrainUs = hostTimeUs();
+}
+
+HostSerialStats HardwareSerial::hostStats() {
+  drain();
+  return stats;
+}
+
+bool HardwareSerial::hostDeHigh() {
+  drain();
+  return deHigh;
+}
@@ -0,0 +1,249 @@
+#include "HostHardware.h"
+#include <mcp_canbus.h>
+#include <vector>
+#include <linux/can.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::vector<HostCanNode*> nodes;
+static HostCanStats stats;
+static uint32_t bitRate = 500000;
+static uint64_t busFreeUs = 0; // End of the last frame on the wire
+
+// Worst-case bits of a standard data frame: 47 fixed bits (including the
+// 3-bit interframe space) plus data, plus one stuff bit per four bits of
+// the stuffed region
+static uint32_t frameBits(uint8_t length) {
+  return 47 + 8 * length + (34 + 8 * length - 1) / 4;
+}
+
+// Puts a frame on the bus after any frame in progress; returns when it ends
+static uint64_t transmit(uint8_t length) {
+  uint32_t bits = frameBits(length);
+  uint64_t start = max(hostTimeUs(), busFreeUs);
+  busFreeUs = start + (uint64_t)bits * 1000000 / bitRate;
+  stats.frames++;
+  stats.bits += bits;
+  return busFreeUs;
+}
+
+static void deliver(HostCanNode* from, const HostCanFrame& frame) {
+  // Copy: a node may attach or detach while receiving
+  std::vector<HostCanNode*> receivers = nodes;
+  for (HostCanNode* node : receivers) {
+    if (node != from) node->canReceive(frame);
+  }
+}
+
+void hostCanAttach(HostCanNode* node) {
+  hostCanDetach(node);
+  nodes.push_back(node);
+}
+
+void hostCanDetach(HostCanNode* node) {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i] == node) {
+      nodes.erase(nodes.begin() + i);
+      return;
+    }
+  }
+}
+
+void hostCanSend(HostCanNode* from, uint32_t id, const uint8_t* data, uint8_t length) {
+  HostCanFrame frame = {};
+  frame.id = id & 0x7FF;
+  frame.length = min(length, (uint8_t)8);
+  memcpy(frame.data, data, frame.length);
+  frame.timeUs = transmit(frame.length);
+  deliver(from, frame);
+}
+
+HostCanStats hostCanStats() {
+  return stats;
+}
+
+void hostCanResetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+// MCP2515 model
+
+class HostMcp2515 : public HostCanNode {
+public:
+  bool present = true;
+  bool started = false;
+  unsigned long masks[2] = {0, 0};
+  unsigned long filters[6] = {0, 0, 0, 0, 0, 0};
+  HostCanFrame rx[2];
+  bool rxFull[2] = {false, false};
+  uint64_t txDoneUs[3] = {0, 0, 0};
+  int intPin = -1;
+
+  bool accepts(uint8_t buffer, uint32_t id) const {
+    uint8_t first = buffer == 0 ? 0 : 2, last = buffer == 0 ? 1 : 5;
+    for (uint8_t f = first; f <= last; f++) {
+      if ((id & masks[buffer]) == (filters[f] & masks[buffer])) return true;
+    }
+    return false;
+  }
+
+  void canReceive(const HostCanFrame& frame) override {
+    if (!started) return;
+    int buffer = -1;
+    if (accepts(0, frame.id)) buffer = rxFull[0] ? 1 : 0; // BUKT rollover
+    else if (accepts(1, frame.id)) buffer = 1;
+    if (buffer < 0) {
+      stats.filtered++;
+      return;
+    }
+    if (rxFull[buffer]) {
+      stats.rxOverflows++;
+      return;
+    }
+    bool intHigh = !rxFull[0] && !rxFull[1];
+    rx[buffer] = frame;
+    rxFull[buffer] = true;
+    // INT falls when the first buffer fills and stays low until both are read
+    if (intHigh && intPin >= 0) hostTriggerInterrupt(intPin);
+  }
+};
+
+static HostMcp2515 controller;
+
+void hostSetCanPresent(bool present) {
+  controller.present = present;
+}
+
+void hostCanSetIntPin(int pin) {
+  controller.intPin = pin;
+}
+
+MCP_CAN::~MCP_CAN() {
+  hostCanDetach(&controller);
+}
+
+uint8_t MCP_CAN::begin(uint8_t speed) {
+  hostChargeUs(50); // Reset and configuration over SPI
+  if (!controller.present) return CAN_FAILINIT;
+  switch (speed) {
+    case CAN_100KBPS: bitRate = 100000; break;
+    case CAN_125KBPS: bitRate = 125000; break;
+    case CAN_250KBPS: bitRate = 250000; break;
+    case CAN_1000KBPS: bitRate = 1000000; break;
+    default: bitRate = 500000;
+  }
+  memset(controller.masks, 0, sizeof(controller.masks));
+  memset(controller.filters, 0, sizeof(controller.filters));
+  controller.rxFull[0] = controller.rxFull[1] = false;
+  controller.started = true;
+  hostCanAttach(&controller);
+  return CAN_OK;
+}
+
+uint8_t MCP_CAN::init_Mask(uint8_t num, uint8_t, unsigned long mask) {
+  hostSpiCharge(cs, 6);
+  if (num > 1) return CAN_FAIL;
+  controller.masks[num] = mask & 0x7FF;
+  return CAN_OK;
+}
+
+uint8_t MCP_CAN::init_Filt(uint8_t num, uint8_t, unsigned long id) {
+  hostSpiCharge(cs, 6);
+  if (num > 5) return CAN_FAIL;
+  controller.filters[num] = id & 0x7FF;
+  return CAN_OK;
+}
+
+uint8_t MCP_CAN::sendMsgBuf(unsigned long id, uint8_t, uint8_t length, const uint8_t* data) {
+  if (!controller.started) return CAN_FAILTX;
+  uint64_t now = hostTimeUs();
+  for (uint8_t i = 0; i < 3; i++) {
+    if (controller.txDoneUs[i] > now) continue;
+    HostCanFrame frame = {};
+    frame.id = id & 0x7FF;
+    frame.length = min(length, (uint8_t)8);
+    memcpy(frame.data, data, frame.length);
+    hostSpiCharge(cs, 6 + frame.length);
+    controller.txDoneUs[i] = frame.timeUs = transmit(frame.length);
+    deliver(&controller, frame);
+    return CAN_OK;
+  }
+  stats.txBufferFull++;
+  return CAN_GETTXBFTIMEOUT;
+}
+
+uint8_t MCP_CAN::checkReceive() {
+  hostSpiCharge(cs, 2);
+  return controller.rxFull[0] || controller.rxFull[1] ? CAN_MSGAVAIL : CAN_NOMSG;
+}
+
+uint8_t MCP_CAN::readMsgBufID(unsigned long* id, unsigned char* length, unsigned char* data) {
+  int buffer = controller.rxFull[0] ? 0 : (controller.rxFull[1] ? 1 : -1);
+  if (buffer < 0) return CAN_NOMSG;
+  const HostCanFrame& frame = controller.rx[buffer];
+  hostSpiCharge(cs, 6 + frame.length);
+  lastId = frame.id;
+  if (id) *id = frame.id;
+  *length = frame.length;
+  memcpy(data, frame.data, frame.length);
+  controller.rxFull[buffer] = false;
+  return CAN_OK;
+}
+
+uint8_t MCP_CAN::readMsgBuf(unsigned char* length, unsigned char* data) {
+  return readMsgBufID(nullptr, length, data);
+}
+
+// SocketCAN bridge: frames on the virtual bus go out on the interface and
+// frames from the interface join the virtual bus
+
+class HostSocketCan : public HostCanNode {
+public:
+  int fd = -1;
+
+  void canReceive(const HostCanFrame& frame) override {
+    struct can_frame out = {};
+    out.can_id = frame.id;
+    out.can_dlc = frame.length;
+    memcpy(out.data, frame.data, frame.length);
+    if (write(fd, &out, sizeof(out)) != (ssize_t)sizeof(out)) {
+      fprintf(stderr, "SocketCAN write failed\n");
+    }
+  }
+};
+
+static HostSocketCan socketNode;
+
+bool hostCanOpenSocket(const char* interface) {
+  int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd < 0) return false;
+  struct ifreq request = {};
+  strncpy(request.ifr_name, interface, IFNAMSIZ - 1);
+  struct sockaddr_can address = {};
+  if (ioctl(fd, SIOCGIFINDEX, &request) < 0) {
+    close(fd);
+    return false;
+  }
+  address.can_family = AF_CAN;
+  address.can_ifindex = request.ifr_ifindex;
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  socketNode.fd = fd;
+  hostCanAttach(&socketNode);
+  return true;
+}
+
+void hostCanPollSocket() {
+  if (socketNode.fd < 0) return;
+  struct can_frame in;
+  while (read(socketNode.fd, &in, sizeof(in)) == (ssize_t)sizeof(in)) {
+    if (in.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) continue; // Standard data frames only
+    hostCanSend(&socketNode, in.can_id, in.data, in.can_dlc);
+  }
+}
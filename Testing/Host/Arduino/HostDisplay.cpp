@@ -0,0 +1,197 @@
+#include "HostHardware.h"
+#include <Adafruit_SSD1306.h>
+
+#define PANEL_WIDTH 128
+#define PANEL_PAGES 8
+
+// SSD1306 panel model: decodes the command stream (addressing windows,
+// commands with arguments) and stores data bytes in horizontal addressing
+// mode, wrapping inside the window like the controller
+
+class HostSsd1306Panel : public HostI2CDevice {
+public:
+  bool present = true;
+  uint8_t ram[PANEL_WIDTH * PANEL_PAGES] = {};
+  uint8_t command[3];
+  uint8_t commandLength = 0;
+  uint8_t columnStart = 0, columnEnd = PANEL_WIDTH - 1;
+  uint8_t pageStart = 0, pageEnd = PANEL_PAGES - 1;
+  uint8_t column = 0, page = 0;
+
+  static uint8_t argumentCount(uint8_t opcode) {
+    switch (opcode) {
+      case 0x21: case 0x22: return 2;
+      case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+      case 0xD5: case 0xD9: case 0xDA: case 0xDB: return 1;
+      default: return 0;
+    }
+  }
+
+  void runCommand() {
+    if (command[0] == 0x21) {
+      columnStart = column = command[1] % PANEL_WIDTH;
+      columnEnd = command[2] % PANEL_WIDTH;
+    } else if (command[0] == 0x22) {
+      pageStart = page = command[1] % PANEL_PAGES;
+      pageEnd = command[2] % PANEL_PAGES;
+    }
+  }
+
+  void commandByte(uint8_t value) {
+    command[commandLength++] = value;
+    if (commandLength > argumentCount(command[0])) {
+      runCommand();
+      commandLength = 0;
+    }
+  }
+
+  void dataByte(uint8_t value) {
+    ram[page * PANEL_WIDTH + column] = value;
+    if (column == columnEnd) {
+      column = columnStart;
+      page = page == pageEnd ? pageStart : page + 1;
+    } else {
+      column = (column + 1) % PANEL_WIDTH;
+    }
+  }
+
+  bool i2cWrite(const uint8_t* data, size_t length, bool) override {
+    if (!present) return false;
+    if (length < 1) return true;
+    bool isData = data[0] & 0x40;
+    for (size_t i = 1; i < length; i++) {
+      if (isData) dataByte(data[i]);
+      else commandByte(data[i]);
+    }
+    return true;
+  }
+
+  size_t i2cRead(uint8_t*, size_t) override {
+    return 0;
+  }
+};
+
+static HostSsd1306Panel panel;
+
+const uint8_t* hostOledPanel() {
+  return panel.ram;
+}
+
+void hostSetOledPresent(bool present) {
+  panel.present = present;
+}
+
+// GFX
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t rw, int16_t rh, uint16_t color) {
+  for (int16_t j = y; j < y + rh; j++) {
+    for (int16_t i = x; i < x + rw; i++) drawPixel(i, j, color);
+  }
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t bw, int16_t bh, uint16_t color) {
+  int16_t rowBytes = (bw + 7) / 8;
+  for (int16_t j = 0; j < bh; j++) {
+    for (int16_t i = 0; i < bw; i++) {
+      if (bitmap[j * rowBytes + i / 8] & (0x80 >> (i & 7))) drawPixel(x + i, y + j, color);
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX = 0;
+    cursorY += 8 * textSize;
+    return 1;
+  }
+  if (c == '\r') return 1;
+  // Placeholder glyph: a deterministic 5x7 pattern per character
+  for (int8_t i = 0; i < 5; i++) {
+    uint8_t bits = (uint8_t)(c * 37 + i * 53) & 0x7F;
+    if (c == ' ') bits = 0;
+    for (int8_t j = 0; j < 7; j++) {
+      if (bits & (1 << j)) fillRect(cursorX + i * textSize, cursorY + j * textSize, textSize, textSize, textColor);
+    }
+  }
+  cursorX += 6 * textSize;
+  return 1;
+}
+
+// SSD1306 driver
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* wire, int8_t, uint32_t clockDuring,
+                                   uint32_t clockAfter)
+    : Adafruit_GFX(w, h), wire(wire), clockDuring(clockDuring), clockAfter(clockAfter) {}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() {
+  free(buffer);
+}
+
+void Adafruit_SSD1306::commands(const uint8_t* bytes, size_t length) {
+  wire->setClock(clockDuring);
+  wire->beginTransmission(address);
+  wire->write((uint8_t)0x00);
+  wire->write(bytes, length);
+  wire->endTransmission();
+  wire->setClock(clockAfter);
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t command) {
+  commands(&command, 1);
+}
+
+bool Adafruit_SSD1306::begin(uint8_t, uint8_t addr) {
+  static bool attached = false;
+  if (!attached) {
+    hostI2CAttach(addr, &panel);
+    attached = true;
+  }
+  address = addr;
+  if (!buffer && !(buffer = (uint8_t*)malloc(w * ((h + 7) / 8)))) return false;
+  clearDisplay();
+  // Display off, memory mode horizontal, charge pump, display on
+  const uint8_t init[] = {0xAE, 0x20, 0x00, 0x8D, 0x14, 0xAF};
+  wire->setClock(clockDuring);
+  wire->beginTransmission(address);
+  wire->write((uint8_t)0x00);
+  wire->write(init, sizeof(init));
+  bool ok = wire->endTransmission() == 0;
+  wire->setClock(clockAfter);
+  return ok;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  if (buffer) memset(buffer, 0, w * ((h + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (!buffer || x < 0 || y < 0 || x >= w || y >= h) return;
+  uint8_t& byte = buffer[x + (y / 8) * w];
+  uint8_t bit = 1 << (y & 7);
+  if (color == SSD1306_WHITE) byte |= bit;
+  else if (color == SSD1306_BLACK) byte &= ~bit;
+  else byte ^= bit;
+}
+
+void Adafruit_SSD1306::display() {
+  if (!buffer) return;
+  const uint8_t window[] = {SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0, (uint8_t)(w - 1)};
+  commands(window, sizeof(window));
+  // Data in Wire-buffer-sized chunks behind a 0x40 control byte
+  wire->setClock(clockDuring);
+  size_t total = w * ((h + 7) / 8);
+  for (size_t sent = 0; sent < total;) {
+    size_t n = min((size_t)WIRE_BUFFER_LENGTH - 1, total - sent);
+    wire->beginTransmission(address);
+    wire->write((uint8_t)0x40);
+    wire->write(buffer + sent, n);
+    wire->endTransmission();
+    sent += n;
+  }
+  wire->setClock(clockAfter);
+}
+
+void Adafruit_SSD1306::dim(bool dim) {
+  const uint8_t contrast[] = {0x81, (uint8_t)(dim ? 0 : 0xCF)};
+  commands(contrast, sizeof(contrast));
+}
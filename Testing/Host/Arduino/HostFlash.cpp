@@ -0,0 +1,269 @@
+#include "HostHardware.h"
+#include <SPIFlash.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SECTOR_COUNT (HOST_FLASH_SIZE / HOST_FLASH_SECTOR)
+
+// Sparse image: a null sector is erased
+static uint8_t* sectors[SECTOR_COUNT];
+static int imageFd = -1;
+static bool present = true;
+static uint64_t busyUntilUs = 0;
+static HostFlashStats stats;
+
+// Power cut state
+static bool cutArmed = false;
+static uint32_t opsBeforeCut = 0;
+static uint32_t cutRandom = 1;
+static bool powerOff = false;
+
+static uint32_t nextRandom() {
+  cutRandom = cutRandom * 1103515245u + 12345u;
+  return cutRandom >> 8;
+}
+
+static uint8_t* sectorFor(uint32_t address) {
+  uint8_t*& sector = sectors[address / HOST_FLASH_SECTOR];
+  if (!sector) {
+    sector = (uint8_t*)malloc(HOST_FLASH_SECTOR);
+    memset(sector, 0xFF, HOST_FLASH_SECTOR);
+  }
+  return sector;
+}
+
+static void writeThrough(uint32_t address, size_t length) {
+  if (imageFd < 0) return;
+  const uint8_t* sector = sectorFor(address);
+  if (pwrite(imageFd, sector + address % HOST_FLASH_SECTOR, length, address) != (ssize_t)length) {
+    fprintf(stderr, "flash image write failed at 0x%06X\n", address);
+  }
+}
+
+static void freeSectors() {
+  for (uint32_t i = 0; i < SECTOR_COUNT; i++) {
+    free(sectors[i]);
+    sectors[i] = nullptr;
+  }
+}
+
+bool hostFlashOpen(const char* path) {
+  if (imageFd >= 0) close(imageFd);
+  imageFd = -1;
+  freeSectors();
+  if (!path) return true;
+  int fd = open(path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) return false;
+  off_t size = lseek(fd, 0, SEEK_END);
+  uint8_t buffer[HOST_FLASH_SECTOR];
+  for (uint32_t i = 0; i < SECTOR_COUNT; i++) {
+    ssize_t n = (off_t)(i + 1) * HOST_FLASH_SECTOR <= size ? pread(fd, buffer, sizeof(buffer), (off_t)i * HOST_FLASH_SECTOR) : 0;
+    if (n == 0) {
+      // Missing (new file): store it erased
+      memset(buffer, 0xFF, sizeof(buffer));
+      if (pwrite(fd, buffer, sizeof(buffer), (off_t)i * HOST_FLASH_SECTOR) != (ssize_t)sizeof(buffer)) {
+        close(fd);
+        return false;
+      }
+      continue;
+    }
+    if (n != (ssize_t)sizeof(buffer)) {
+      close(fd);
+      return false;
+    }
+    bool blank = true;
+    for (size_t j = 0; j < sizeof(buffer) && blank; j++) blank = buffer[j] == 0xFF;
+    if (!blank) memcpy(sectorFor(i * HOST_FLASH_SECTOR), buffer, sizeof(buffer));
+  }
+  imageFd = fd;
+  return true;
+}
+
+void hostFlashErase() {
+  freeSectors();
+  if (imageFd >= 0) {
+    uint8_t buffer[HOST_FLASH_SECTOR];
+    memset(buffer, 0xFF, sizeof(buffer));
+    for (uint32_t i = 0; i < SECTOR_COUNT; i++) {
+      if (pwrite(imageFd, buffer, sizeof(buffer), (off_t)i * HOST_FLASH_SECTOR) != (ssize_t)sizeof(buffer)) break;
+    }
+  }
+  busyUntilUs = 0;
+  hostFlashResetStats();
+}
+
+void hostSetFlashPresent(bool value) {
+  present = value;
+}
+
+HostFlashStats hostFlashStats() {
+  return stats;
+}
+
+void hostFlashResetStats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+void hostFlashReadRaw(uint32_t address, void* data, size_t length) {
+  uint8_t* out = (uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    uint32_t at = (address + i) % HOST_FLASH_SIZE;
+    const uint8_t* sector = sectors[at / HOST_FLASH_SECTOR];
+    out[i] = sector ? sector[at % HOST_FLASH_SECTOR] : 0xFF;
+  }
+}
+
+void hostFlashWriteRaw(uint32_t address, const void* data, size_t length) {
+  const uint8_t* in = (const uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    uint32_t at = (address + i) % HOST_FLASH_SIZE;
+    sectorFor(at)[at % HOST_FLASH_SECTOR] = in[i];
+    writeThrough(at, 1);
+  }
+}
+
+void hostFlashCutPower(uint32_t ops, uint32_t seed) {
+  cutArmed = true;
+  opsBeforeCut = ops;
+  cutRandom = seed ? seed : 1;
+}
+
+void hostFlashPowerOn() {
+  cutArmed = false;
+  powerOff = false;
+  busyUntilUs = 0;
+}
+
+bool hostFlashPowerCut() {
+  return powerOff;
+}
+
+// Returns how much of a program/erase the chip completes: all of it, a
+// torn part (the command the power cut lands on), or nothing after the cut
+static bool powerFor(uint32_t length, uint32_t& done) {
+  done = length;
+  if (powerOff) {
+    stats.ignoredOps++;
+    return false;
+  }
+  if (!cutArmed) return true;
+  if (opsBeforeCut > 0) {
+    opsBeforeCut--;
+    return true;
+  }
+  done = nextRandom() % length;
+  powerOff = true;
+  return true;
+}
+
+// Chip model
+
+static void chipProgram(uint32_t address, const uint8_t* data, uint32_t length) {
+  uint32_t done;
+  if (!powerFor(length, done)) return;
+  uint8_t* sector = sectorFor(address);
+  uint32_t offset = address % HOST_FLASH_SECTOR;
+  for (uint32_t i = 0; i < done; i++) {
+    uint8_t& cell = sector[offset + i];
+    if (data[i] & ~cell) stats.violations++; // Program can only clear bits
+    cell &= data[i];
+  }
+  writeThrough(address, done);
+  stats.programs++;
+  stats.bytesProgrammed += done;
+  busyUntilUs = hostTimeUs() + HOST_FLASH_PROGRAM_US;
+}
+
+static void chipEraseSector(uint32_t address) {
+  address -= address % HOST_FLASH_SECTOR;
+  uint32_t done;
+  if (!powerFor(HOST_FLASH_SECTOR, done)) return;
+  memset(sectorFor(address), 0xFF, done);
+  writeThrough(address, HOST_FLASH_SECTOR);
+  stats.erases++;
+  busyUntilUs = hostTimeUs() + HOST_FLASH_ERASE_US;
+}
+
+// Library
+
+bool SPIFlash::busy() {
+  hostSpiCharge(cs, 2);
+  stats.busyPolls++;
+  return present && hostTimeUs() < busyUntilUs;
+}
+
+// The library polls the status register before every command
+void SPIFlash::waitIdle() {
+  if (!busy()) return;
+  stats.violations++; // The caller blocks here
+  while (busy()) {
+    if (hostRealTime()) usleep(10);
+  }
+}
+
+bool SPIFlash::initialize() {
+  return readDeviceId() == 0xEF40;
+}
+
+uint16_t SPIFlash::readDeviceId() {
+  hostSpiCharge(cs, 4);
+  return present ? 0xEF40 : 0xFFFF;
+}
+
+uint8_t SPIFlash::readStatus() {
+  return busy() ? 0x01 : 0x00;
+}
+
+uint8_t SPIFlash::readByte(uint32_t address) {
+  uint8_t value;
+  readBytes(address, &value, 1);
+  return value;
+}
+
+void SPIFlash::readBytes(uint32_t address, void* buffer, uint16_t length) {
+  waitIdle();
+  hostSpiCharge(cs, 4 + length);
+  if (!present) {
+    memset(buffer, 0xFF, length);
+    return;
+  }
+  hostFlashReadRaw(address, buffer, length);
+  stats.reads++;
+  stats.bytesRead += length;
+}
+
+void SPIFlash::writeBytes(uint32_t address, const void* buffer, uint16_t length) {
+  const uint8_t* data = (const uint8_t*)buffer;
+  while (length > 0 && present) {
+    uint16_t n = min((uint32_t)length, HOST_FLASH_PAGE - address % HOST_FLASH_PAGE);
+    waitIdle();
+    hostSpiCharge(cs, 1 + 4 + n); // Write enable, then page program
+    chipProgram(address % HOST_FLASH_SIZE, data, n);
+    address += n;
+    data += n;
+    length -= n;
+  }
+}
+
+void SPIFlash::blockErase4K(uint32_t address) {
+  if (!present) return;
+  waitIdle();
+  hostSpiCharge(cs, 1 + 4);
+  chipEraseSector(address % HOST_FLASH_SIZE);
+}
+
+void SPIFlash::blockErase32K(uint32_t address) {
+  address -= address % 32768;
+  for (uint32_t i = 0; i < 32768; i += HOST_FLASH_SECTOR) blockErase4K(address + i);
+}
+
+void SPIFlash::blockErase64K(uint32_t address) {
+  address -= address % 65536;
+  for (uint32_t i = 0; i < 65536; i += HOST_FLASH_SECTOR) blockErase4K(address + i);
+}
+
+void SPIFlash::chipErase() {
+  if (!present) return;
+  waitIdle();
+  hostFlashErase();
+}
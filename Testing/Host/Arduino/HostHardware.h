@@ -0,0 +1,185 @@
+#ifndef HOST_HARDWARE_H
+#define HOST_HARDWARE_H
+
+// Controls for the host stand-ins of the Teensy core and the device
+// libraries, used by the host main, the tests and the benchmarks.
+//
+// Time: by default the host clock is virtual. It only moves when the
+// host advances it (hostAdvanceUs, delay) or when a stand-in device spends
+// bus time: an I2C byte costs ~23 us at 400 kHz, a flash page read a few
+// us, a CAN frame its bits at the bit rate. Runs are deterministic and
+// report the bus time the firmware would spend. hostUseRealTime(true)
+// switches to CLOCK_MONOTONIC, e.g. for pty links to real tools.
+
+#include <Arduino.h>
+
+// Clock
+void hostUseRealTime(bool realTime);
+bool hostRealTime();
+uint64_t hostTimeUs();
+void hostAdvanceUs(uint64_t us);   // Virtual clock only
+void hostChargeUs(uint32_t us);    // Bus time spent by a stand-in device, virtual clock only
+
+// Pins
+void hostSetPin(uint8_t pin, int value);       // Level seen by digitalRead()
+int hostGetPin(uint8_t pin);                    // Level last written by digitalWrite()
+void hostSetAnalog(uint8_t pin, int value);    // Value seen by analogRead()
+int hostGetAnalogWrite(uint8_t pin);
+void hostTriggerInterrupt(uint8_t pin);         // Runs the attached ISR, if any
+
+// I2C (Wire). A device is attached at a 7-bit address; an address with no
+// device NACKs. Transfers charge 9 bit times per byte at the Wire clock.
+class HostI2CDevice {
+public:
+  virtual ~HostI2CDevice() {}
+  // Bytes of one write transaction; return false to NACK
+  virtual bool i2cWrite(const uint8_t* data, size_t length, bool stop) = 0;
+  // Fills a read transaction; returns the bytes supplied
+  virtual size_t i2cRead(uint8_t* data, size_t length) = 0;
+};
+
+struct HostBusStats {
+  uint32_t transactions;
+  uint64_t bytes;
+  uint64_t busyUs;
+};
+
+void hostI2CAttach(uint8_t address, HostI2CDevice* device); // nullptr detaches
+HostBusStats hostI2CStats(uint8_t address);
+void hostI2CResetStats();
+
+// SPI devices are modelled at the library level; this accounts their time
+void hostSpiCharge(uint8_t device, uint32_t bytes);
+HostBusStats hostSpiStats(uint8_t device); // Device = its chip-select pin
+void hostSpiResetStats();
+
+// Scripted IMU: the specific force (m/s^2) and angular rate (rad/s) the
+// MPU6500 stand-in measures at a given time. Defaults to level and still.
+typedef void (*HostImuMotion)(uint64_t timeUs, float accel[3], float gyro[3]);
+void hostSetImuMotion(HostImuMotion motion);
+// CSV rows "time_us,ax,ay,az,gx,gy,gz", each held until the next row
+bool hostLoadImuScript(const char* path);
+void hostSetImuPresent(bool present);
+
+// MPU6500 register model on I2C: FIFO fed at the programmed sample rate
+// from the scripted IMU, FIFO_COUNT/FIFO_R_W/INT_STATUS/USER_CTRL
+// behaviour, and overflow that keeps the newest 512 bytes (so records
+// lose alignment, as on the chip).
+struct HostMpu6500Stats {
+  uint32_t recordsQueued;
+  uint32_t recordsLost;   // Overwritten by an overflow
+  uint32_t fifoResets;
+};
+// Stops live sampling and makes the FIFO hold exactly `data`; `overflow`
+// sets the INT_STATUS overflow flag
+void hostMpu6500ReplayFifo(const uint8_t* data, size_t length, bool overflow);
+void hostMpu6500Live(); // Back to sampling the scripted IMU
+HostMpu6500Stats hostMpu6500Stats();
+size_t hostMpu6500FifoBytes();
+
+// ADS1115: per-channel input voltage, conversion timing from the data rate
+void hostSetAdcVoltage(uint8_t channel, float volts);
+void hostSetAdcPresent(bool present);
+// Mux (channel) of every conversion started, oldest first, up to `size`
+size_t hostAdcConversionLog(uint8_t* channels, size_t size);
+void hostAdcClearLog();
+uint32_t hostAdcResultReads();
+
+// MAX31855
+void hostSetTemperature(float celsius); // NAN reads as a fault
+void hostSetThermocouplePresent(bool present);
+
+// SSD1306: the panel model decodes column/page windows and data from the
+// I2C stream, so tests can compare what the panel shows with the framebuffer
+const uint8_t* hostOledPanel(); // SCREEN_WIDTH * SCREEN_HEIGHT / 8 bytes, page-major
+void hostSetOledPresent(bool present);
+
+// W25Q128 NOR flash model. Program only clears bits within a 256-byte
+// page, erase sets a 4 KB sector to 0xFF, and both leave the chip busy for
+// the datasheet typical time. A command issued while the chip is busy
+// blocks in the library until it is idle, and a program that would set
+// bits ANDs them like the silicon; both count as violations.
+struct HostFlashStats {
+  uint32_t reads;
+  uint64_t bytesRead;
+  uint32_t programs;
+  uint64_t bytesProgrammed;
+  uint32_t erases;
+  uint32_t busyPolls;
+  uint32_t violations;   // Command that had to wait for busy, bit set by program
+  uint32_t ignoredOps;   // Program/erase after a power cut
+};
+
+#define HOST_FLASH_SIZE 16777216UL
+#define HOST_FLASH_PAGE 256
+#define HOST_FLASH_SECTOR 4096
+#define HOST_FLASH_PROGRAM_US 700   // tPP typical
+#define HOST_FLASH_ERASE_US 45000   // tSE typical
+
+// Backs the chip with an image file (created erased if missing). Every
+// program/erase is written through, so the image survives the process.
+// nullptr = RAM only. Returns false if the file cannot be used.
+bool hostFlashOpen(const char* path);
+void hostFlashErase();               // Whole chip to 0xFF, stats cleared
+void hostSetFlashPresent(bool present);
+HostFlashStats hostFlashStats();
+void hostFlashResetStats();
+void hostFlashReadRaw(uint32_t address, void* data, size_t length);  // Ignores busy and power
+void hostFlashWriteRaw(uint32_t address, const void* data, size_t length); // Direct image write (corruption)
+// Power cut: the next `ops` program/erase commands complete, the one after
+// is torn (a program stores only a seeded-random prefix of its bytes, an
+// erase leaves a random part of the sector unerased) and later commands
+// are ignored until hostFlashPowerOn()
+void hostFlashCutPower(uint32_t ops, uint32_t seed);
+void hostFlashPowerOn();
+bool hostFlashPowerCut(); // A cut has happened and power is still off
+
+// SD card: files live in a host directory. Writes charge their transfer
+// time: 4-bit SDIO at 50 MHz.
+#define HOST_SD_BYTES_PER_US 25
+void hostSetSdRoot(const char* path); // Default "SD"
+const char* hostSdRoot();
+void hostSetSdPresent(bool present);
+
+// Virtual CAN bus. The firmware's MCP_CAN is one node (with the MCP2515's
+// masks, filters and two RX buffers); tests and tools attach others.
+// Delivery is immediate and each frame charges its worst-case bit time.
+struct HostCanFrame {
+  uint32_t id;
+  uint8_t length;
+  uint8_t data[8];
+  uint64_t timeUs;
+};
+
+class HostCanNode {
+public:
+  virtual ~HostCanNode() {}
+  virtual void canReceive(const HostCanFrame& frame) = 0;
+};
+
+struct HostCanStats {
+  uint32_t frames;
+  uint64_t bits;          // Worst-case bits on the wire, stuff bits included
+  uint32_t filtered;      // Frames the MCP2515 filters rejected
+  uint32_t rxOverflows;   // Frames lost with both MCP2515 RX buffers full
+  uint32_t txBufferFull;  // Sends refused with all three TX buffers pending
+};
+
+void hostCanAttach(HostCanNode* node);
+void hostCanDetach(HostCanNode* node);
+// Sends from a host node to every other node, including the firmware
+void hostCanSend(HostCanNode* from, uint32_t id, const uint8_t* data, uint8_t length);
+HostCanStats hostCanStats();
+void hostCanResetStats();
+void hostSetCanPresent(bool present);
+void hostCanSetIntPin(int pin); // MCP2515 INT wiring, -1 = not connected
+// Bridges the virtual bus to a Linux SocketCAN interface (e.g. vcan0).
+// Call hostCanPollSocket() regularly to bring received frames in.
+bool hostCanOpenSocket(const char* interface);
+void hostCanPollSocket();
+
+// LoRa: packets sent by the firmware, and packets for it to receive
+void hostLoRaInject(const uint8_t* data, size_t length);
+size_t hostLoRaTakePacket(uint8_t* data, size_t size); // Oldest sent packet, 0 if none
+
+#endif
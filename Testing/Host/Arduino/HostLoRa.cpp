@@ -0,0 +1,73 @@
+#include "HostHardware.h"
+#include <LoRa.h>
+#include <deque>
+#include <string>
+
+#define LORA_MAX_PACKET 255
+
+static std::deque<std::string> inbound;
+static std::deque<std::string> outbound;
+static std::string txPacket;
+static std::string rxPacket;
+static size_t rxPos = 0;
+
+void hostLoRaInject(const uint8_t* data, size_t length) {
+  inbound.push_back(std::string((const char*)data, min(length, (size_t)LORA_MAX_PACKET)));
+}
+
+size_t hostLoRaTakePacket(uint8_t* data, size_t size) {
+  if (outbound.empty()) return 0;
+  size_t n = min(size, outbound.front().size());
+  memcpy(data, outbound.front().data(), n);
+  outbound.pop_front();
+  return n;
+}
+
+int LoRaClass::begin(long) {
+  return 1;
+}
+
+int LoRaClass::beginPacket(int implicitHeader) {
+  implicit = implicitHeader;
+  txPacket.clear();
+  return 1;
+}
+
+size_t LoRaClass::write(const uint8_t* data, size_t length) {
+  length = min(length, LORA_MAX_PACKET - txPacket.size());
+  txPacket.append((const char*)data, length);
+  return length;
+}
+
+// Semtech SX127x time on air, 8-symbol preamble, CRC on
+int LoRaClass::endPacket(bool) {
+  double symbolUs = (double)(1UL << spreadingFactor) * 1e6 / bandwidth;
+  int lowRate = symbolUs > 16000 ? 1 : 0;
+  double bits = 8.0 * txPacket.size() - 4 * spreadingFactor + 28 + 16 - (implicit ? 20 : 0);
+  double symbols = ceil(bits / (4.0 * (spreadingFactor - 2 * lowRate))) * codingRate;
+  double airUs = (8 + 4.25) * symbolUs + (8 + max(symbols, 0.0)) * symbolUs;
+  hostChargeUs((uint32_t)airUs);
+  outbound.push_back(txPacket);
+  txPacket.clear();
+  return 1;
+}
+
+int LoRaClass::parsePacket(int) {
+  if (inbound.empty()) return 0;
+  rxPacket = inbound.front();
+  inbound.pop_front();
+  rxPos = 0;
+  return rxPacket.size();
+}
+
+int LoRaClass::available() {
+  return rxPacket.size() - rxPos;
+}
+
+int LoRaClass::read() {
+  return rxPos < rxPacket.size() ? (uint8_t)rxPacket[rxPos++] : -1;
+}
+
+int LoRaClass::peek() {
+  return rxPos < rxPacket.size() ? (uint8_t)rxPacket[rxPos] : -1;
+}
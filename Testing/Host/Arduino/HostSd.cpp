@@ -0,0 +1,131 @@
+#include "HostHardware.h"
+#include <SdFat.h>
+#include <string>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string sdRoot = "SD";
+static bool sdPresent = true;
+
+void hostSetSdRoot(const char* path) {
+  sdRoot = path;
+}
+
+const char* hostSdRoot() {
+  return sdRoot.c_str();
+}
+
+void hostSetSdPresent(bool present) {
+  sdPresent = present;
+}
+
+static std::string sdPath(const char* path) {
+  while (*path == '/') path++;
+  return sdRoot + "/" + path;
+}
+
+bool SdFs::begin(SdioConfig) {
+  if (!sdPresent) return false;
+  return ::mkdir(sdRoot.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+bool SdFs::exists(const char* path) {
+  struct stat info;
+  return sdPresent && stat(sdPath(path).c_str(), &info) == 0;
+}
+
+bool SdFs::remove(const char* path) {
+  return sdPresent && unlink(sdPath(path).c_str()) == 0;
+}
+
+bool SdFs::rename(const char* from, const char* to) {
+  return sdPresent && ::rename(sdPath(from).c_str(), sdPath(to).c_str()) == 0;
+}
+
+bool SdFs::mkdir(const char* path) {
+  return sdPresent && ::mkdir(sdPath(path).c_str(), 0777) == 0;
+}
+
+bool FsFile::open(const char* path, int flags) {
+  close();
+  if (!sdPresent) return false;
+  fd = ::open(sdPath(path).c_str(), flags, 0666);
+  return fd >= 0;
+}
+
+bool FsFile::close() {
+  if (fd < 0) return false;
+  ::close(fd);
+  fd = -1;
+  return true;
+}
+
+uint64_t FsFile::curPosition() {
+  off_t position = fd >= 0 ? lseek(fd, 0, SEEK_CUR) : 0;
+  return position < 0 ? 0 : position;
+}
+
+uint64_t FsFile::fileSize() {
+  struct stat info;
+  return fd >= 0 && fstat(fd, &info) == 0 ? info.st_size : 0;
+}
+
+bool FsFile::seekSet(uint64_t position) {
+  return fd >= 0 && lseek(fd, position, SEEK_SET) == (off_t)position;
+}
+
+bool FsFile::truncate() {
+  return truncate(curPosition());
+}
+
+bool FsFile::truncate(uint64_t length) {
+  if (fd < 0 || ftruncate(fd, length) != 0) return false;
+  if (curPosition() > length) seekSet(length);
+  return true;
+}
+
+bool FsFile::sync() {
+  return fd >= 0; // Writes already reached the host file
+}
+
+int FsFile::available() {
+  uint64_t size = fileSize(), position = curPosition();
+  return position < size ? (int)min(size - position, (uint64_t)0x7FFFFFFF) : 0;
+}
+
+int FsFile::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int FsFile::read(void* buffer, size_t length) {
+  if (fd < 0) return -1;
+  ssize_t n = ::read(fd, buffer, length);
+  return n < 0 ? -1 : (int)n;
+}
+
+int FsFile::peek() {
+  int c = read();
+  if (c >= 0) lseek(fd, -1, SEEK_CUR);
+  return c;
+}
+
+int FsFile::fgets(char* line, int size) {
+  int n = 0;
+  while (n < size - 1) {
+    int c = read();
+    if (c < 0) break;
+    line[n++] = c;
+    if (c == '\n') break;
+  }
+  line[n] = 0;
+  return n;
+}
+
+size_t FsFile::write(const uint8_t* data, size_t length) {
+  if (fd < 0) return 0;
+  hostChargeUs(1 + length / HOST_SD_BYTES_PER_US);
+  ssize_t n = ::write(fd, data, length);
+  return n < 0 ? 0 : n;
+}
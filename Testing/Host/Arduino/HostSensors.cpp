@@ -0,0 +1,499 @@
+#include "HostHardware.h"
+#include <Wire.h>
+#include <FastIMU.h>
+#include <Adafruit_ADS1X15.h>
+#include <Adafruit_MAX31855.h>
+#include <SPI.h>
+#include <vector>
+
+static const float GRAVITY = 9.80665f;
+
+// Scripted IMU
+
+struct ImuScriptRow {
+  uint64_t timeUs;
+  float accel[3];
+  float gyro[3];
+};
+
+static std::vector<ImuScriptRow> imuScript;
+
+static void stillMotion(uint64_t, float accel[3], float gyro[3]) {
+  accel[0] = accel[1] = 0.0f;
+  accel[2] = GRAVITY;
+  gyro[0] = gyro[1] = gyro[2] = 0.0f;
+}
+
+static void scriptMotion(uint64_t timeUs, float accel[3], float gyro[3]) {
+  size_t low = 0, high = imuScript.size();
+  while (high - low > 1) {
+    size_t mid = (low + high) / 2;
+    if (imuScript[mid].timeUs <= timeUs) low = mid;
+    else high = mid;
+  }
+  memcpy(accel, imuScript[low].accel, sizeof(imuScript[low].accel));
+  memcpy(gyro, imuScript[low].gyro, sizeof(imuScript[low].gyro));
+}
+
+static HostImuMotion imuMotion = stillMotion;
+
+void hostSetImuMotion(HostImuMotion motion) {
+  imuMotion = motion ? motion : stillMotion;
+}
+
+bool hostLoadImuScript(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+  std::vector<ImuScriptRow> rows;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    ImuScriptRow row;
+    unsigned long long t;
+    if (sscanf(line, "%llu,%f,%f,%f,%f,%f,%f", &t, &row.accel[0], &row.accel[1], &row.accel[2],
+               &row.gyro[0], &row.gyro[1], &row.gyro[2]) != 7) continue; // Header or comment
+    row.timeUs = t;
+    rows.push_back(row);
+  }
+  fclose(file);
+  if (rows.empty()) return false;
+  imuScript.swap(rows);
+  imuMotion = scriptMotion;
+  return true;
+}
+
+// MPU6500 register model
+
+#define MPU_SMPLRT_DIV 0x19
+#define MPU_CONFIG 0x1A
+#define MPU_GYRO_CONFIG 0x1B
+#define MPU_ACCEL_CONFIG 0x1C
+#define MPU_FIFO_EN 0x23
+#define MPU_INT_STATUS 0x3A
+#define MPU_ACCEL_XOUT_H 0x3B
+#define MPU_USER_CTRL 0x6A
+#define MPU_PWR_MGMT_1 0x6B
+#define MPU_FIFO_COUNTH 0x72
+#define MPU_FIFO_COUNTL 0x73
+#define MPU_FIFO_R_W 0x74
+#define MPU_WHO_AM_I 0x75
+
+#define MPU_FIFO_CAPACITY 512
+#define MPU_RECORD_SIZE 12
+#define MPU_INT_FIFO_OFLOW 0x10
+
+class HostMpu6500 : public HostI2CDevice {
+public:
+  bool present = true;
+  bool live = true;
+  uint8_t regs[128] = {};
+  std::vector<uint8_t> fifo;
+  uint64_t nextSampleUs = 0;
+  bool sampling = false;
+  uint8_t pointer = 0;
+  HostMpu6500Stats stats = {};
+
+  HostMpu6500() { regs[MPU_WHO_AM_I] = 0x70; }
+
+  float accelLsbPerG() const { return 16384.0f / (1 << ((regs[MPU_ACCEL_CONFIG] >> 3) & 3)); }
+  float gyroLsbPerDps() const { return 131.0f / (1 << ((regs[MPU_GYRO_CONFIG] >> 3) & 3)); }
+  uint32_t samplePeriodUs() const { return 1000 * (regs[MPU_SMPLRT_DIV] + 1); }
+  bool fifoEnabled() const { return (regs[MPU_USER_CTRL] & 0x40) && (regs[MPU_FIFO_EN] & 0x78) == 0x78; }
+
+  static void putWord(uint8_t* out, float value) {
+    long raw = lroundf(value);
+    if (raw > 32767) raw = 32767;
+    if (raw < -32768) raw = -32768;
+    out[0] = (uint16_t)raw >> 8;
+    out[1] = (uint16_t)raw & 0xFF;
+  }
+
+  void measure(uint64_t timeUs, uint8_t* accelOut, uint8_t* gyroOut) {
+    float accel[3], gyro[3];
+    imuMotion(timeUs, accel, gyro);
+    for (int axis = 0; axis < 3; axis++) {
+      putWord(accelOut + axis * 2, accel[axis] / GRAVITY * accelLsbPerG());
+      putWord(gyroOut + axis * 2, gyro[axis] * (float)RAD_TO_DEG * gyroLsbPerDps());
+    }
+  }
+
+  void pushRecord(const uint8_t* record) {
+    fifo.insert(fifo.end(), record, record + MPU_RECORD_SIZE);
+    stats.recordsQueued++;
+    if (fifo.size() > MPU_FIFO_CAPACITY) {
+      // The chip keeps writing over the oldest bytes
+      fifo.erase(fifo.begin(), fifo.begin() + (fifo.size() - MPU_FIFO_CAPACITY));
+      regs[MPU_INT_STATUS] |= MPU_INT_FIFO_OFLOW;
+      stats.recordsLost++;
+    }
+  }
+
+  void catchUp() {
+    if (!live) return;
+    bool enabled = fifoEnabled();
+    uint64_t now = hostTimeUs();
+    if (!enabled) {
+      sampling = false;
+      return;
+    }
+    if (!sampling) {
+      sampling = true;
+      nextSampleUs = now + samplePeriodUs();
+      return;
+    }
+    // Anything older than a full FIFO is overwritten anyway
+    uint32_t period = samplePeriodUs();
+    uint64_t backlog = now >= nextSampleUs ? (now - nextSampleUs) / period + 1 : 0;
+    const uint64_t keep = MPU_FIFO_CAPACITY / MPU_RECORD_SIZE + 2;
+    if (backlog > keep) {
+      stats.recordsQueued += backlog - keep;
+      stats.recordsLost += backlog - keep;
+      regs[MPU_INT_STATUS] |= MPU_INT_FIFO_OFLOW;
+      nextSampleUs += (backlog - keep) * period;
+    }
+    while (nextSampleUs <= now) {
+      uint8_t record[MPU_RECORD_SIZE];
+      measure(nextSampleUs, record, record + 6);
+      pushRecord(record);
+      nextSampleUs += period;
+    }
+  }
+
+  bool i2cWrite(const uint8_t* data, size_t length, bool) override {
+    if (!present) return false;
+    catchUp();
+    if (!length) return true;
+    pointer = data[0];
+    for (size_t i = 1; i < length; i++) writeRegister(pointer++, data[i]);
+    return true;
+  }
+
+  void writeRegister(uint8_t reg, uint8_t value) {
+    reg &= 0x7F;
+    if (reg == MPU_USER_CTRL && (value & 0x04)) {
+      fifo.clear();
+      regs[MPU_INT_STATUS] &= ~MPU_INT_FIFO_OFLOW;
+      stats.fifoResets++;
+      value &= ~0x04; // Self-clearing
+    }
+    regs[reg] = value;
+  }
+
+  size_t i2cRead(uint8_t* data, size_t length) override {
+    if (!present) return 0;
+    catchUp();
+    if (pointer == MPU_ACCEL_XOUT_H) {
+      uint8_t block[14] = {};
+      measure(hostTimeUs(), block, block + 8);
+      for (size_t i = 0; i < length; i++) data[i] = i < sizeof(block) ? block[i] : 0;
+      return length;
+    }
+    for (size_t i = 0; i < length; i++) {
+      uint8_t reg = pointer & 0x7F;
+      switch (reg) {
+        case MPU_FIFO_R_W:
+          if (fifo.empty()) {
+            data[i] = 0xFF;
+          } else {
+            data[i] = fifo.front();
+            fifo.erase(fifo.begin());
+          }
+          continue; // The pointer stays on FIFO_R_W
+        case MPU_FIFO_COUNTH: data[i] = (fifo.size() >> 8) & 0x1F; break;
+        case MPU_FIFO_COUNTL: data[i] = fifo.size() & 0xFF; break;
+        case MPU_INT_STATUS:
+          data[i] = regs[reg];
+          regs[reg] &= ~MPU_INT_FIFO_OFLOW; // Cleared on read
+          break;
+        default: data[i] = regs[reg];
+      }
+      pointer++;
+    }
+    return length;
+  }
+};
+
+static HostMpu6500 mpu;
+
+void hostSetImuPresent(bool present) {
+  mpu.present = present;
+}
+
+void hostMpu6500ReplayFifo(const uint8_t* data, size_t length, bool overflow) {
+  mpu.live = false;
+  mpu.fifo.assign(data, data + length);
+  if (overflow) mpu.regs[MPU_INT_STATUS] |= MPU_INT_FIFO_OFLOW;
+  else mpu.regs[MPU_INT_STATUS] &= ~MPU_INT_FIFO_OFLOW;
+}
+
+void hostMpu6500Live() {
+  mpu.live = true;
+  mpu.sampling = false;
+  mpu.fifo.clear();
+}
+
+HostMpu6500Stats hostMpu6500Stats() {
+  return mpu.stats;
+}
+
+size_t hostMpu6500FifoBytes() {
+  mpu.catchUp();
+  return mpu.fifo.size();
+}
+
+// FastIMU driver on the model
+
+static bool imuWrite(uint8_t address, uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+int MPU6500::init(calData cal, uint8_t addr) {
+  static bool attached = false;
+  if (!attached) {
+    hostI2CAttach(addr, &mpu);
+    attached = true;
+  }
+  address = addr;
+  calibration = cal;
+  if (!imuWrite(address, MPU_PWR_MGMT_1, 0x01)) return -1;
+  setAccelRange(16);
+  setGyroRange(2000);
+  return 0;
+}
+
+int MPU6500::setAccelRange(int g) {
+  uint8_t bits = g <= 2 ? 0 : g <= 4 ? 1 : g <= 8 ? 2 : 3;
+  accelLsbPerG = 16384.0f / (1 << bits);
+  return imuWrite(address, MPU_ACCEL_CONFIG, bits << 3) ? 0 : -1;
+}
+
+int MPU6500::setGyroRange(int dps) {
+  uint8_t bits = dps <= 250 ? 0 : dps <= 500 ? 1 : dps <= 1000 ? 2 : 3;
+  gyroLsbPerDps = 131.0f / (1 << bits);
+  return imuWrite(address, MPU_GYRO_CONFIG, bits << 3) ? 0 : -1;
+}
+
+void MPU6500::update() {
+  Wire.beginTransmission(address);
+  Wire.write(MPU_ACCEL_XOUT_H);
+  if (Wire.endTransmission(false) != 0) return;
+  uint8_t block[14];
+  if (Wire.requestFrom(address, (uint8_t)14) != 14) return;
+  for (int i = 0; i < 14; i++) block[i] = Wire.read();
+  float a[3], g[3];
+  for (int axis = 0; axis < 3; axis++) {
+    a[axis] = (int16_t)((block[axis * 2] << 8) | block[axis * 2 + 1]) / accelLsbPerG;
+    g[axis] = (int16_t)((block[8 + axis * 2] << 8) | block[9 + axis * 2]) / gyroLsbPerDps;
+  }
+  accel = {a[0] - calibration.accelBias[0], a[1] - calibration.accelBias[1], a[2] - calibration.accelBias[2]};
+  gyro = {g[0] - calibration.gyroBias[0], g[1] - calibration.gyroBias[1], g[2] - calibration.gyroBias[2]};
+}
+
+void MPU6500::calibrateAccelGyro(calData* cal) {
+  memset(cal, 0, sizeof(*cal));
+  cal->valid = true;
+}
+
+// ADS1115 register model
+
+class HostAds1115 : public HostI2CDevice {
+public:
+  bool present = true;
+  float volts[4] = {};
+  uint8_t pointer = 0;
+  uint16_t config = 0x8583;
+  uint64_t startUs = 0;
+  bool converting = false;
+  int16_t result = 0;
+  std::vector<uint8_t> log;
+  uint32_t resultReads = 0;
+
+  uint32_t periodUs() const {
+    static const uint16_t rates[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    return 1000000UL / rates[(config >> 5) & 7];
+  }
+  bool continuous() const { return !(config & 0x0100); }
+  uint8_t channel() const { return ((config >> 12) & 7) - 4; } // Single-ended muxes only
+
+  int16_t sample() const {
+    static const float fullScale[8] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f, 0.256f, 0.256f};
+    float fs = fullScale[(config >> 9) & 7];
+    float counts = volts[channel() & 3] / fs * 32768.0f;
+    if (counts > 32767) counts = 32767;
+    if (counts < -32768) counts = -32768;
+    return (int16_t)lroundf(counts);
+  }
+
+  // Completes the conversions that have finished by now
+  void update() {
+    if (!converting) return;
+    uint64_t now = hostTimeUs();
+    if (now - startUs < periodUs()) return;
+    result = sample();
+    if (continuous()) {
+      startUs += (now - startUs) / periodUs() * periodUs();
+    } else {
+      converting = false;
+    }
+  }
+
+  bool i2cWrite(const uint8_t* data, size_t length, bool) override {
+    if (!present) return false;
+    update();
+    if (!length) return true;
+    pointer = data[0] & 3;
+    if (length >= 3 && pointer == 1) {
+      config = (data[1] << 8) | data[2];
+      if (continuous() || (config & 0x8000)) {
+        converting = true;
+        startUs = hostTimeUs();
+        log.push_back(channel());
+      }
+    }
+    return true;
+  }
+
+  size_t i2cRead(uint8_t* data, size_t length) override {
+    if (!present) return 0;
+    update();
+    uint16_t value;
+    if (pointer == 0) {
+      value = (uint16_t)result;
+      resultReads++;
+    } else {
+      value = (config & 0x7FFF) | (converting && !continuous() ? 0 : 0x8000);
+    }
+    for (size_t i = 0; i < length; i++) data[i] = i == 0 ? value >> 8 : (i == 1 ? value & 0xFF : 0);
+    return length;
+  }
+};
+
+static HostAds1115 ads1115;
+
+void hostSetAdcVoltage(uint8_t channel, float volts) {
+  if (channel < 4) ads1115.volts[channel] = volts;
+}
+
+void hostSetAdcPresent(bool present) {
+  ads1115.present = present;
+}
+
+size_t hostAdcConversionLog(uint8_t* channels, size_t size) {
+  size_t n = min(size, ads1115.log.size());
+  memcpy(channels, ads1115.log.data(), n);
+  return n;
+}
+
+void hostAdcClearLog() {
+  ads1115.log.clear();
+  ads1115.resultReads = 0;
+}
+
+uint32_t hostAdcResultReads() {
+  return ads1115.resultReads;
+}
+
+bool Adafruit_ADS1115::begin(uint8_t addr) {
+  static bool attached = false;
+  if (!attached) {
+    hostI2CAttach(addr, &ads1115);
+    attached = true;
+  }
+  address = addr;
+  Wire.beginTransmission(address);
+  return Wire.endTransmission() == 0;
+}
+
+void Adafruit_ADS1115::writeRegister(uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.write(value >> 8);
+  Wire.write(value & 0xFF);
+  Wire.endTransmission();
+}
+
+uint16_t Adafruit_ADS1115::readRegister(uint8_t reg) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.endTransmission();
+  if (Wire.requestFrom(address, (uint8_t)2) != 2) return 0;
+  uint16_t high = Wire.read();
+  return (high << 8) | Wire.read();
+}
+
+void Adafruit_ADS1115::startADCReading(uint16_t mux, bool continuous) {
+  uint16_t config = ADS1X15_REG_CONFIG_CQUE_NONE | gain | rate | mux |
+                    (continuous ? ADS1X15_REG_CONFIG_MODE_CONTIN : ADS1X15_REG_CONFIG_MODE_SINGLE) |
+                    ADS1X15_REG_CONFIG_OS_SINGLE;
+  writeRegister(ADS1X15_REG_POINTER_CONFIG, config);
+}
+
+bool Adafruit_ADS1115::conversionComplete() {
+  return (readRegister(ADS1X15_REG_POINTER_CONFIG) & 0x8000) != 0;
+}
+
+int16_t Adafruit_ADS1115::getLastConversionResults() {
+  return (int16_t)readRegister(ADS1X15_REG_POINTER_CONVERT);
+}
+
+int16_t Adafruit_ADS1115::readADC_SingleEnded(uint8_t channel) {
+  if (channel > 3) return 0;
+  static const uint16_t muxes[4] = {ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+                                    ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3};
+  startADCReading(muxes[channel], false);
+  while (!conversionComplete()) delay(1);
+  return getLastConversionResults();
+}
+
+float Adafruit_ADS1115::computeVolts(int16_t counts) {
+  static const float fullScale[6] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f};
+  return counts * fullScale[(gain >> 9) % 6] / 32768.0f;
+}
+
+// MAX31855
+
+static float thermocoupleCelsius = 25.0f;
+static bool thermocouplePresent = true;
+
+void hostSetTemperature(float celsius) {
+  thermocoupleCelsius = celsius;
+}
+
+void hostSetThermocouplePresent(bool present) {
+  thermocouplePresent = present;
+}
+
+bool Adafruit_MAX31855::begin() {
+  return thermocouplePresent;
+}
+
+double Adafruit_MAX31855::readCelsius() {
+  hostSpiCharge(cs, 4);
+  return thermocouplePresent ? thermocoupleCelsius : NAN;
+}
+
+// SPI accounting at 8 MHz, between the 4 and 30 MHz the parts run at
+
+SPIClass SPI;
+
+static HostBusStats spiStats[HOST_PIN_COUNT];
+
+void hostSpiCharge(uint8_t device, uint32_t bytes) {
+  uint32_t us = 1 + bytes; // 1 us chip-select overhead, then ~1 us per byte
+  if (device < HOST_PIN_COUNT) {
+    spiStats[device].transactions++;
+    spiStats[device].bytes += bytes;
+    spiStats[device].busyUs += us;
+  }
+  hostChargeUs(us);
+}
+
+HostBusStats hostSpiStats(uint8_t device) {
+  return device < HOST_PIN_COUNT ? spiStats[device] : HostBusStats();
+}
+
+void hostSpiResetStats() {
+  memset(spiStats, 0, sizeof(spiStats));
+}
@@ -0,0 +1,70 @@
+#include <Wire.h>
+#include "HostHardware.h"
+
+TwoWire Wire;
+
+static HostI2CDevice* devices[128];
+static HostBusStats i2cStats[128];
+
+void hostI2CAttach(uint8_t address, HostI2CDevice* device) {
+  if (address < 128) devices[address] = device;
+}
+
+HostBusStats hostI2CStats(uint8_t address) {
+  return address < 128 ? i2cStats[address] : HostBusStats();
+}
+
+void hostI2CResetStats() {
+  memset(i2cStats, 0, sizeof(i2cStats));
+}
+
+// Start, address byte and stop, plus 9 bit times per data byte
+static uint32_t chargeI2C(uint8_t address, size_t bytes, uint32_t clockHz) {
+  uint32_t us = (uint32_t)(((bytes + 1) * 9 + 2) * 1000000ULL / clockHz);
+  HostBusStats& stats = i2cStats[address & 0x7F];
+  stats.transactions++;
+  stats.bytes += bytes;
+  stats.busyUs += us;
+  hostChargeUs(us);
+  return us;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+  txOverflow = false;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (txLength >= WIRE_BUFFER_LENGTH) {
+    txOverflow = true;
+    return 0;
+  }
+  txBuffer[txLength++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+  size_t n = 0;
+  while (n < length && write(data[n])) n++;
+  return n;
+}
+
+// Return codes as on the Teensy: 1 data too long, 2 address NACK
+uint8_t TwoWire::endTransmission(bool stop) {
+  if (txOverflow) return 1;
+  chargeI2C(txAddress, txLength, clockHz);
+  HostI2CDevice* device = txAddress < 128 ? devices[txAddress] : nullptr;
+  if (!device || !device->i2cWrite(txBuffer, txLength, stop)) return 2;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t length, bool) {
+  rxLength = rxPos = 0;
+  if (length > WIRE_BUFFER_LENGTH) length = WIRE_BUFFER_LENGTH;
+  chargeI2C(address, length, clockHz);
+  HostI2CDevice* device = address < 128 ? devices[address] : nullptr;
+  if (!device) return 0;
+  rxLength = device->i2cRead(rxBuffer, length);
+  return rxLength;
+}
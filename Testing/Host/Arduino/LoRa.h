@@ -0,0 +1,37 @@
+#ifndef LORA_H
+#define LORA_H
+
+// Host stand-in for the sandeepmistry LoRa library. endPacket() blocks for
+// the packet's time on air, as the library does; packets go to the host
+// (hostLoRaTakePacket) and come from it (hostLoRaInject).
+
+#include <Arduino.h>
+
+class LoRaClass : public Stream {
+public:
+  void setPins(int ss, int reset, int dio0) { (void)ss; (void)reset; (void)dio0; }
+  int begin(long frequency);
+  void end() {}
+  void setSyncWord(int) {}
+  void setTxPower(int) {}
+  void setSpreadingFactor(int sf) { spreadingFactor = sf; }
+  void setSignalBandwidth(long bandwidth) { this->bandwidth = bandwidth; }
+  void setCodingRate4(int denominator) { codingRate = denominator; }
+  int beginPacket(int implicitHeader = false);
+  int endPacket(bool async = false);
+  int parsePacket(int size = 0);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+
+private:
+  int spreadingFactor = 7;
+  long bandwidth = 125000;
+  int codingRate = 5;
+  bool implicit = false;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+// Host stand-in for SdFat's RingBuf: an N-byte ring in front of a file.
+// write() fails (and sets the write error) when the ring is full;
+// writeOut() moves bytes from the ring to the file.
+
+#include <Arduino.h>
+
+template <class F, size_t N>
+class RingBuf : public Print {
+public:
+  void begin(F* file) {
+    this->file = file;
+    head = count = 0;
+    writeError = false;
+  }
+  size_t bytesUsed() const { return count; }
+  size_t bytesFree() const { return N - count; }
+  bool getWriteError() const { return writeError; }
+  void clearWriteError() { writeError = false; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (length > bytesFree()) {
+      writeError = true;
+      return 0;
+    }
+    return memcpyIn(data, length);
+  }
+  using Print::write;
+
+  size_t memcpyIn(const void* data, size_t length) {
+    length = min(length, bytesFree());
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) buffer[(head + count + i) % N] = bytes[i];
+    count += length;
+    return length;
+  }
+
+  // Writes up to `length` of the oldest bytes to the file
+  size_t writeOut(size_t length) {
+    length = min(length, count);
+    size_t done = 0;
+    while (file && done < length) {
+      size_t chunk = min(length - done, N - head);
+      size_t n = file->write(buffer + head, chunk);
+      head = (head + n) % N;
+      count -= n;
+      done += n;
+      if (n != chunk) {
+        writeError = true;
+        break;
+      }
+    }
+    return done;
+  }
+
+  bool sync() {
+    writeOut(count);
+    return count == 0 && file && file->sync();
+  }
+
+private:
+  F* file = nullptr;
+  uint8_t buffer[N];
+  size_t head = 0;
+  size_t count = 0;
+  bool writeError = false;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SPI_H
+#define SPI_H
+
+// Host stand-in for the Teensy SPI library. The SPI devices (flash, CAN,
+// thermocouple) are modelled inside their library stand-ins, which charge
+// their transfer time through hostSpiCharge().
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings {
+public:
+  SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0) {
+    (void)clock; (void)bitOrder; (void)dataMode;
+  }
+};
+
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+  void beginTransaction(const SPISettings&) {}
+  void endTransaction() {}
+  void usingInterrupt(int) {}
+  uint8_t transfer(uint8_t) { return 0xFF; }
+  void transfer(void* buffer, size_t length) { memset(buffer, 0xFF, length); }
+};
+
+extern SPIClass SPI;
+
+#endif
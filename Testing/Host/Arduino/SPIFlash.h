@@ -0,0 +1,33 @@
+#ifndef SPIFLASH_H
+#define SPIFLASH_H
+
+// Host stand-in for the LowPowerLab SPIFlash library, on the W25Q128 NOR
+// model in HostFlash.cpp. As in the library, a command issued while the
+// chip is busy waits for it, and writeBytes() splits at page boundaries.
+
+#include <Arduino.h>
+
+class SPIFlash {
+public:
+  explicit SPIFlash(uint8_t csPin, uint16_t jedecId = 0) : cs(csPin) { (void)jedecId; }
+  bool initialize();
+  uint16_t readDeviceId();
+  uint8_t readStatus();
+  bool busy();
+  uint8_t readByte(uint32_t address);
+  void readBytes(uint32_t address, void* buffer, uint16_t length);
+  void writeByte(uint32_t address, uint8_t value) { writeBytes(address, &value, 1); }
+  void writeBytes(uint32_t address, const void* buffer, uint16_t length);
+  void blockErase4K(uint32_t address);
+  void blockErase32K(uint32_t address);
+  void blockErase64K(uint32_t address);
+  void chipErase();
+  void sleep() {}
+  void wakeup() {}
+
+private:
+  void waitIdle();
+  uint8_t cs;
+};
+
+#endif
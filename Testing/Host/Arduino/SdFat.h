@@ -0,0 +1,72 @@
+#ifndef SDFAT_H
+#define SDFAT_H
+
+// Host stand-in for SdFat: files live in the host directory set by
+// hostSetSdRoot() (default "SD"). Writes go straight to the host file, so
+// isBusy() is always false; each charges its transfer time to the
+// virtual clock.
+
+#include <Arduino.h>
+#include <fcntl.h>
+
+#ifndef O_READ
+#define O_READ O_RDONLY
+#endif
+#ifndef O_WRITE
+#define O_WRITE O_WRONLY
+#endif
+
+#define FIFO_SDIO 0
+#define DEDICATED_SPI 1
+
+struct SdioConfig {
+  explicit SdioConfig(int options) : options(options) {}
+  int options;
+};
+
+class FsFile : public Stream {
+public:
+  FsFile() {}
+  FsFile(const FsFile&) = delete;
+  FsFile& operator=(const FsFile&) = delete;
+  ~FsFile() { close(); }
+
+  bool open(const char* path, int flags = O_READ);
+  bool close();
+  bool isOpen() const { return fd >= 0; }
+  operator bool() const { return isOpen(); }
+  bool preAllocate(uint64_t) { return isOpen(); }
+  bool isBusy() { return false; }
+  uint64_t curPosition();
+  uint64_t fileSize();
+  uint64_t size() { return fileSize(); }
+  bool seekSet(uint64_t position);
+  bool truncate();                 // At the current position
+  bool truncate(uint64_t length);
+  void flush() override { sync(); }
+  bool sync();
+
+  int available() override;
+  int read() override;
+  int read(void* buffer, size_t length);
+  int peek() override;
+  int fgets(char* line, int size);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override;
+  size_t write(const void* data, size_t length) { return write((const uint8_t*)data, length); }
+  using Print::write;
+
+private:
+  int fd = -1;
+};
+
+class SdFs {
+public:
+  bool begin(SdioConfig config);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+};
+
+#endif
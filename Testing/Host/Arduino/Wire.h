@@ -0,0 +1,39 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+// Host stand-in for the Teensy Wire library. Transactions go to the
+// HostI2CDevice attached at the address (see HostHardware.h) and charge
+// their bus time to the host clock.
+
+#include <Arduino.h>
+
+#define WIRE_BUFFER_LENGTH 32
+
+class TwoWire : public Stream {
+public:
+  void begin() {}
+  void setClock(uint32_t hz) { clockHz = hz; }
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t length, bool stop = true);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+  int available() override { return rxLength - rxPos; }
+  int read() override { return rxPos < rxLength ? rxBuffer[rxPos++] : -1; }
+  int peek() override { return rxPos < rxLength ? rxBuffer[rxPos] : -1; }
+
+private:
+  uint32_t clockHz = 100000;
+  uint8_t txAddress = 0;
+  uint8_t txBuffer[WIRE_BUFFER_LENGTH];
+  uint8_t txLength = 0;
+  uint8_t rxBuffer[WIRE_BUFFER_LENGTH];
+  uint8_t rxLength = 0;
+  uint8_t rxPos = 0;
+  bool txOverflow = false;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MCP_CANBUS_H
+#define MCP_CANBUS_H
+
+// Host stand-in for the Seeed MCP2515 library. The controller is a node on
+// the virtual CAN bus in HostCan.cpp with the MCP2515's acceptance masks
+// and filters (RXM0 covers RXF0-1, RXM1 RXF2-5), two receive buffers with
+// RXB0 rolling over into RXB1, and three transmit buffers that stay
+// pending until their frame has left the bus. The INT pin is not modelled;
+// the firmware polls checkReceive().
+
+#include <Arduino.h>
+
+#define CAN_OK 0
+#define CAN_FAILINIT 1
+#define CAN_FAILTX 2
+#define CAN_MSGAVAIL 3
+#define CAN_NOMSG 4
+#define CAN_CTRLERROR 5
+#define CAN_GETTXBFTIMEOUT 6
+#define CAN_SENDMSGTIMEOUT 7
+#define CAN_FAIL 0xFF
+
+#define CAN_100KBPS 10
+#define CAN_125KBPS 11
+#define CAN_250KBPS 13
+#define CAN_500KBPS 15
+#define CAN_1000KBPS 18
+
+class MCP_CAN {
+public:
+  explicit MCP_CAN(uint8_t csPin) : cs(csPin) {}
+  ~MCP_CAN();
+  uint8_t begin(uint8_t speed);
+  uint8_t init_Mask(uint8_t num, uint8_t ext, unsigned long mask);
+  uint8_t init_Filt(uint8_t num, uint8_t ext, unsigned long id);
+  uint8_t sendMsgBuf(unsigned long id, uint8_t ext, uint8_t length, const uint8_t* data);
+  uint8_t checkReceive();
+  uint8_t readMsgBuf(unsigned char* length, unsigned char* data);
+  uint8_t readMsgBufID(unsigned long* id, unsigned char* length, unsigned char* data);
+  unsigned long getCanId() { return lastId; }
+  uint8_t isExtendedFrame() { return 0; }
+  uint8_t checkError() { return CAN_OK; }
+
+private:
+  uint8_t cs;
+  unsigned long lastId = 0;
+};
+
+#endif
@@ -0,0 +1,4 @@
+// Builds the sketch's setup() and loop() as a normal translation unit, the
+// way the Arduino builder does: the core header first, then the .ino.
+#include <Arduino.h>
+#include "BlueLily.ino"
@@ -0,0 +1,250 @@
+// Expands a binary flight log (LogFormat.h) to CSV.
+//
+//   bluelily_logconv [--columns DIR] [--check] LOG
+//
+// LOG is FlightLog.bin from the SD card, or FlashLog.img, the raw flash
+// pages the logger copies next to it. Image pages are CRC-checked, and
+// after a missing or corrupt page the decoder picks the stream up again at
+// the next sync marker. By default every record goes to stdout as one CSV
+// line, formatted by logRecordToCsv(). --columns writes one file per record
+// type to DIR instead (IMU.csv, FC.csv, ...), each with a header row taken
+// from the schema in the log header, so every field is a column. --check
+// exits non-zero if the log needed a resync, holds a corrupt page or, for
+// FlightLog.bin, ends in a partial record.
+
+#include "LogFormat.h"
+#include "FlashLog.h"
+#include "Crc.h"
+#include <errno.h>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+struct SchemaField {
+  std::string type; // f32, i16, u8 or str
+  std::string name;
+};
+
+struct SchemaRecord {
+  std::string name;
+  std::vector<SchemaField> fields;
+  FILE* out = nullptr;
+};
+
+struct ConvertStats {
+  uint32_t records = 0;
+  uint32_t resyncs = 0;
+  uint32_t partial = 0; // Segments ending inside a record
+  uint32_t pages = 0;
+  uint32_t badPages = 0;
+  uint32_t gaps = 0;
+};
+
+static std::map<uint8_t, SchemaRecord> schema;
+
+// "1=IMU:f32 ax,f32 ay;2=TEMP:f32 temp;"
+static void parseSchema(const std::string& text) {
+  schema.clear();
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find(';', pos);
+    if (end == std::string::npos) end = text.size();
+    std::string entry = text.substr(pos, end - pos);
+    pos = end + 1;
+    size_t eq = entry.find('='), colon = entry.find(':');
+    if (eq == std::string::npos || colon == std::string::npos || colon < eq) continue;
+    SchemaRecord& record = schema[(uint8_t)atoi(entry.substr(0, eq).c_str())];
+    record.name = entry.substr(eq + 1, colon - eq - 1);
+    record.fields.clear();
+    size_t field = colon + 1;
+    while (field < entry.size()) {
+      size_t comma = entry.find(',', field);
+      if (comma == std::string::npos) comma = entry.size();
+      std::string spec = entry.substr(field, comma - field);
+      size_t space = spec.find(' ');
+      if (space != std::string::npos) record.fields.push_back({spec.substr(0, space), spec.substr(space + 1)});
+      field = comma + 1;
+    }
+  }
+}
+
+static size_t fieldSize(const std::string& type) {
+  return type == "f32" ? 4 : type == "i16" ? 2 : type == "u8" ? 1 : 0;
+}
+
+static void writeColumns(SchemaRecord& record, const LogRecordView& rec) {
+  fprintf(record.out, "%lu", (unsigned long)rec.timestampUs);
+  size_t pos = 0;
+  for (const SchemaField& field : record.fields) {
+    if (field.type == "str") {
+      std::string text((const char*)rec.payload, rec.length);
+      std::string quoted;
+      for (char c : text) quoted += c == '"' ? "\"\"" : std::string(1, c);
+      fprintf(record.out, ",\"%s\"", quoted.c_str());
+      pos = rec.length;
+      continue;
+    }
+    size_t size = fieldSize(field.type);
+    if (!size || pos + size > rec.length) {
+      fprintf(record.out, ",");
+      continue;
+    }
+    if (field.type == "f32") {
+      float value;
+      memcpy(&value, rec.payload + pos, 4);
+      fprintf(record.out, ",%.9g", value);
+    } else if (field.type == "i16") {
+      int16_t value;
+      memcpy(&value, rec.payload + pos, 2);
+      fprintf(record.out, ",%d", value);
+    } else {
+      fprintf(record.out, ",%u", rec.payload[pos]);
+    }
+    pos += size;
+  }
+  fprintf(record.out, "\n");
+}
+
+static bool openColumns(const std::string& dir) {
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+  for (auto& entry : schema) {
+    SchemaRecord& record = entry.second;
+    record.out = fopen((dir + "/" + record.name + ".csv").c_str(), "w");
+    if (!record.out) return false;
+    fprintf(record.out, "time_us");
+    for (const SchemaField& field : record.fields) fprintf(record.out, ",%s", field.name.c_str());
+    fprintf(record.out, "\n");
+  }
+  return true;
+}
+
+// Decodes one contiguous piece of the log stream. An image segment may end
+// anywhere, as a page run stops where the copy or the flash did.
+static void decodeSegment(const uint8_t* data, size_t length, bool columns, bool image, ConvertStats& stats) {
+  LogDecoder decoder;
+  logDecoderReset(decoder);
+  size_t pos = 0;
+  char line[160];
+  while (pos < length) {
+    LogRecordView rec;
+    size_t used = logDecodeRecord(decoder, data + pos, length - pos, rec);
+    if (!used) break;
+    pos += used;
+    if (!rec.tag) continue;
+    stats.records++;
+    auto record = schema.find(rec.tag);
+    if (columns && record != schema.end() && record->second.out) {
+      writeColumns(record->second, rec);
+    } else if (!columns && logRecordToCsv(rec, line, sizeof(line)) > 0) {
+      printf("%s\n", line);
+    }
+  }
+  // Bytes left over are a record cut off by the end
+  if (!image && decoder.synced && pos < length) stats.partial++;
+  stats.resyncs += decoder.resyncs;
+}
+
+// Cuts the image into runs of consecutive valid pages and concatenates the
+// payloads of each run
+static std::vector<std::vector<uint8_t>> pageSegments(const std::vector<uint8_t>& image, ConvertStats& stats) {
+  std::vector<std::vector<uint8_t>> segments;
+  uint32_t lastSequence = 0;
+  bool first = true;
+  for (size_t offset = 0; offset + FLASH_PAGE_SIZE <= image.size(); offset += FLASH_PAGE_SIZE) {
+    const uint8_t* page = image.data() + offset;
+    FlashPageHeader header;
+    memcpy(&header, page, sizeof(header));
+    stats.pages++;
+    const uint8_t* payload = page + FLASH_PAGE_HEADER_SIZE;
+    uint16_t crc = crc16Ccitt((const uint8_t*)&header.sequence, sizeof(header.sequence));
+    if (header.magic != FLASH_PAGE_MAGIC || header.length > FLASH_PAGE_PAYLOAD ||
+        crc16Ccitt(payload, header.length, crc) != header.crc) {
+      stats.badPages++;
+      continue;
+    }
+    if (first || header.sequence != lastSequence + 1) {
+      if (!first) stats.gaps++;
+      segments.emplace_back();
+    }
+    first = false;
+    lastSequence = header.sequence;
+    segments.back().insert(segments.back().end(), payload, payload + header.length);
+  }
+  return segments;
+}
+
+int main(int argc, char** argv) {
+  std::string columnsDir, path;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--columns" && i + 1 < argc) {
+      columnsDir = argv[++i];
+    } else if (arg == "--check") {
+      check = true;
+    } else if (arg[0] != '-' && path.empty()) {
+      path = arg;
+    } else {
+      fprintf(stderr, "usage: %s [--columns DIR] [--check] LOG\n", argv[0]);
+      return 2;
+    }
+  }
+  if (path.empty()) {
+    fprintf(stderr, "usage: %s [--columns DIR] [--check] LOG\n", argv[0]);
+    return 2;
+  }
+
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", path.c_str());
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+
+  ConvertStats stats;
+  std::vector<std::vector<uint8_t>> segments;
+  bool image = false;
+  if (data.size() >= 4 && !memcmp(data.data(), LOG_MAGIC, 4)) {
+    segments.push_back(data);
+  } else if (!data.empty() && data[0] == FLASH_PAGE_MAGIC) {
+    image = true;
+    segments = pageSegments(data, stats);
+  } else {
+    fprintf(stderr, "%s is neither a flight log nor a flash image\n", path.c_str());
+    return 1;
+  }
+
+  // The schema from the log header; a log whose start has been overwritten
+  // falls back to the one this tool was built with
+  parseSchema(LOG_SCHEMA);
+  if (!segments.empty() && segments[0].size() >= 7 && !memcmp(segments[0].data(), LOG_MAGIC, 4)) {
+    const std::vector<uint8_t>& head = segments[0];
+    uint16_t schemaLength = head[5] | (head[6] << 8);
+    if (head[4] != LOG_VERSION) fprintf(stderr, "Log version %u, expected %u\n", head[4], LOG_VERSION);
+    if (7u + schemaLength <= head.size()) {
+      parseSchema(std::string((const char*)head.data() + 7, schemaLength));
+    }
+  }
+  if (!columnsDir.empty() && !openColumns(columnsDir)) {
+    fprintf(stderr, "Cannot write to %s\n", columnsDir.c_str());
+    return 1;
+  }
+
+  for (const std::vector<uint8_t>& segment : segments) {
+    decodeSegment(segment.data(), segment.size(), !columnsDir.empty(), image, stats);
+  }
+  for (auto& entry : schema) {
+    if (entry.second.out) fclose(entry.second.out);
+  }
+
+  fprintf(stderr, "%s: %u records, %u resyncs, %u partial", path.c_str(), stats.records, stats.resyncs, stats.partial);
+  if (stats.pages) fprintf(stderr, "; %u pages, %u bad, %u gaps", stats.pages, stats.badPages, stats.gaps);
+  fprintf(stderr, "\n");
+  if (check && (stats.records == 0 || stats.resyncs || stats.partial || stats.badPages)) return 1;
+  return 0;
+}
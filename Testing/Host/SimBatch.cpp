@@ -0,0 +1,255 @@
+// Flies many simulated flights (ENABLE_SIMULATION build) in parallel and
+// reports the flight controller's detection delays.
+//
+//   bluelily_sim_batch [--flights N] [--jobs J] [--seed S] [--timeout SECONDS]
+//                      [--spike-rate P] [--dropout-rate P] [--csv] [--check]
+//
+// Each flight runs in its own forked process, so the firmware's static
+// state starts fresh and flights use every core. Airframe, motor, ignition
+// time and sensor noise are drawn per flight from --seed, so a batch is
+// reproducible. --check exits non-zero if any flight detects liftoff
+// before ignition, misses liftoff, apogee or landing, or declares landing
+// before touchdown.
+//
+// bluelily_sim_batch links the firmware without RS485, CAN, Bluetooth, HID
+// and ROS2: their text output and bus models took two thirds of a loop in
+// a batch that reads none of it. A flight, one to three and a half
+// simulated minutes at 1 ms per loop, then takes about 80 ms of one core:
+// some 700 flights per minute per core, against about 180 ms (330 per
+// minute) with every module in bluelily_sim_batch_full. Thousands per
+// minute need four cores or more; what is left is the sampler, flight
+// controller, logger and flash log models running every simulated
+// millisecond.
+
+#include <Arduino.h>
+#include "HostHardware.h"
+#include "Hal.h"
+#include "Simulation.h"
+#include "FlightController.h"
+#include <algorithm>
+#include <ftw.h>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+struct FlightResult {
+  SimEventStats events;
+  bool detected[FLIGHT_STATE_COUNT];
+  FlightState lastState; // Where a flight without a landing got stuck
+  SimFlightConfig config;
+  double wallSeconds;
+};
+
+struct BatchOptions {
+  int flights = 100;
+  int jobs = 0;
+  uint32_t seed = 1;
+  double timeoutSeconds = 600;
+  float spikeRate = 0;
+  float dropoutRate = 0;
+  bool csv = false;
+  bool check = false;
+};
+
+static uint32_t rngState;
+
+static float uniform(float low, float high) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return low + (high - low) * ((rngState >> 8) * (1.0f / 16777216.0f));
+}
+
+static SimFlightConfig randomFlight(const BatchOptions& options) {
+  SimFlightConfig config = defaultSimFlightConfig();
+  config.mass = uniform(1.0, 2.5);
+  config.thrust = config.mass * 9.80665f * uniform(5.0, 10.0); // Thrust-to-weight 5-10
+  config.burnTime = uniform(1.2, 2.5); // Apogee above the 50 m the controller requires
+  config.ignitionTime = uniform(6.0, 15.0); // After the 5 s arming delay
+  config.dragArea = uniform(0.002, 0.006);
+  config.chuteDragArea = uniform(0.8, 2.0);
+  config.accelNoise = uniform(0.02, 0.2);
+  config.gyroNoise = uniform(0.002, 0.01);
+  config.spikeRate = options.spikeRate;
+  config.dropoutRate = options.dropoutRate;
+  config.seed = (uint32_t)uniform(1, 1e9);
+  return config;
+}
+
+static double monotonicSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs in the child: boot, replace the default flight, fly until landed
+static FlightResult fly(const SimFlightConfig& config, double timeoutSeconds, const std::string& sdRoot) {
+  hostSetSdRoot(sdRoot.c_str());
+  Serial.hostEcho(nullptr);
+  double start = monotonicSeconds();
+  setup();
+  initSimulation(config); // Restarts the virtual clock at 0 with this flight
+  uint32_t timeoutUs = (uint32_t)(timeoutSeconds * 1e6);
+  while (!getSimEventStats().complete && halMicros() < timeoutUs) {
+    loop();
+    hostAdvanceUs(SIM_STEP_US); // Keeps the device stand-ins in step
+  }
+  FlightResult result;
+  result.events = getSimEventStats();
+  for (uint8_t state = 0; state < FLIGHT_STATE_COUNT; state++) {
+    result.detected[state] = getFlightEventTime((FlightState)state) != 0;
+  }
+  result.lastState = getFlightState();
+  result.config = config;
+  result.wallSeconds = monotonicSeconds() - start;
+  return result;
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+struct Running {
+  pid_t pid;
+  int fd;
+  int index;
+};
+
+static bool runBatch(const BatchOptions& options, std::vector<FlightResult>& results, std::vector<bool>& ok) {
+  char scratch[] = "/tmp/bluelily-sim-XXXXXX";
+  if (!mkdtemp(scratch)) return false;
+  rngState = options.seed ? options.seed : 1;
+  std::vector<SimFlightConfig> configs;
+  for (int i = 0; i < options.flights; i++) configs.push_back(randomFlight(options));
+
+  results.assign(options.flights, FlightResult());
+  ok.assign(options.flights, false);
+  std::vector<Running> running;
+  int next = 0;
+  fflush(stdout);
+  while (next < options.flights || !running.empty()) {
+    while (next < options.flights && (int)running.size() < options.jobs) {
+      int fds[2];
+      if (pipe(fds) != 0) return false;
+      pid_t pid = fork();
+      if (pid < 0) return false;
+      if (pid == 0) {
+        close(fds[0]);
+        FlightResult result = fly(configs[next], options.timeoutSeconds, std::string(scratch) + "/" + std::to_string(next));
+        _exit(write(fds[1], &result, sizeof(result)) == (ssize_t)sizeof(result) ? 0 : 1);
+      }
+      close(fds[1]);
+      running.push_back({pid, fds[0], next++});
+    }
+    int status;
+    pid_t done = wait(&status);
+    for (size_t i = 0; i < running.size(); i++) {
+      if (running[i].pid != done) continue;
+      Running flight = running[i];
+      running.erase(running.begin() + i);
+      FlightResult result;
+      if (read(flight.fd, &result, sizeof(result)) == (ssize_t)sizeof(result) && WIFEXITED(status) &&
+          WEXITSTATUS(status) == 0) {
+        results[flight.index] = result;
+        ok[flight.index] = true;
+      } else {
+        fprintf(stderr, "flight %d: worker failed\n", flight.index);
+      }
+      close(flight.fd);
+      break;
+    }
+  }
+  nftw(scratch, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  return true;
+}
+
+static void printDelays(const char* name, std::vector<double> ms) {
+  if (ms.empty()) {
+    printf("%-8s %8s\n", name, "-");
+    return;
+  }
+  std::sort(ms.begin(), ms.end());
+  double sum = 0;
+  for (double value : ms) sum += value;
+  auto percentile = [&](double p) { return ms[std::min(ms.size() - 1, (size_t)(p * (ms.size() - 1) + 0.5))]; };
+  printf("%-8s %8.1f %8.1f %8.1f %8.1f %8.1f\n", name, sum / ms.size(), ms.front(), percentile(0.5),
+         percentile(0.95), ms.back());
+}
+
+int main(int argc, char** argv) {
+  BatchOptions options;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--flights") && hasValue) options.flights = atoi(argv[++i]);
+    else if (!strcmp(arg, "--jobs") && hasValue) options.jobs = atoi(argv[++i]);
+    else if (!strcmp(arg, "--seed") && hasValue) options.seed = strtoul(argv[++i], nullptr, 0);
+    else if (!strcmp(arg, "--timeout") && hasValue) options.timeoutSeconds = atof(argv[++i]);
+    else if (!strcmp(arg, "--spike-rate") && hasValue) options.spikeRate = atof(argv[++i]);
+    else if (!strcmp(arg, "--dropout-rate") && hasValue) options.dropoutRate = atof(argv[++i]);
+    else if (!strcmp(arg, "--csv")) options.csv = true;
+    else if (!strcmp(arg, "--check")) options.check = true;
+    else {
+      fprintf(stderr, "usage: bluelily_sim_batch [--flights N] [--jobs J] [--seed S] [--timeout SECONDS]\n"
+                      "                          [--spike-rate P] [--dropout-rate P] [--csv] [--check]\n");
+      return 2;
+    }
+  }
+  if (options.jobs <= 0) options.jobs = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+
+  double start = monotonicSeconds();
+  std::vector<FlightResult> results;
+  std::vector<bool> ok;
+  if (!runBatch(options, results, ok)) {
+    perror("bluelily_sim_batch");
+    return 1;
+  }
+  double wall = monotonicSeconds() - start;
+
+  std::vector<double> liftoff, apogee, landing;
+  int falseLiftoffs = 0, failed = 0, touchdowns = 0, earlyLandings = 0;
+  double flightSeconds = 0;
+  if (options.csv) {
+    printf("flight,mass,thrust,burn,ignition,liftoff_ms,apogee_ms,landing_ms,false_liftoff,complete,last_state\n");
+  }
+  for (int i = 0; i < options.flights; i++) {
+    if (!ok[i]) {
+      failed++;
+      continue;
+    }
+    const FlightResult& r = results[i];
+    flightSeconds += r.wallSeconds;
+    if (r.events.falseLiftoff) falseLiftoffs++;
+    if (r.detected[ASCENT]) liftoff.push_back(r.events.liftoffDelayUs / 1000.0);
+    if (r.detected[APOGEE]) apogee.push_back(r.events.apogeeDelayUs / 1000.0);
+    if (r.events.complete) {
+      touchdowns++;
+      landing.push_back(r.events.landingDelayUs / 1000.0);
+      if (r.events.landingDelayUs < 0) earlyLandings++;
+    }
+    if (options.csv) {
+      printf("%d,%.3f,%.1f,%.2f,%.2f,%.1f,%.1f,%.1f,%d,%d,%d\n", i, r.config.mass, r.config.thrust, r.config.burnTime,
+             r.config.ignitionTime, r.events.liftoffDelayUs / 1000.0, r.events.apogeeDelayUs / 1000.0,
+             r.events.landingDelayUs / 1000.0, r.events.falseLiftoff ? 1 : 0, r.events.complete ? 1 : 0, r.lastState);
+    }
+  }
+
+  int flown = options.flights - failed;
+  printf("flights %d, jobs %d, seed %u, %.1f s wall, %.2f flights/s, %.2f s per flight\n", options.flights,
+         options.jobs, options.seed, wall, options.flights / wall, flown ? flightSeconds / flown : 0.0);
+  printf("detected: liftoff %zu, apogee %zu, landing %d of %d (%d before touchdown); false liftoff %d; "
+         "worker failures %d\n", liftoff.size(), apogee.size(), touchdowns, flown, earlyLandings, falseLiftoffs, failed);
+  printf("%-8s %8s %8s %8s %8s %8s\n", "delay ms", "mean", "min", "p50", "p95", "max");
+  printDelays("liftoff", liftoff);
+  printDelays("apogee", apogee);
+  printDelays("landing", landing);
+
+  bool missed = (int)liftoff.size() < flown || (int)apogee.size() < flown || touchdowns < flown;
+  if (options.check && (missed || falseLiftoffs || earlyLandings || failed)) return 1;
+  return 0;
+}
@@ -0,0 +1,142 @@
+// ADS1115 continuous-conversion pipeline against the register model: the
+// mux round-robins over the channels that are due, each channel converts at
+// its ADS1115_CHANNEL_RATES rate and caches only its own results, no
+// updateADC() call holds the bus longer than BUS_ADC_TRANSFER_US, and the
+// ADC stays off the I2C bus while the IMU read is due. Built for the
+// default rates (AdcPipelineTest) and mixed ones (AdcPipelineTestRates).
+// Prints the per-call bus time against a blocking single-shot read.
+
+#include "HostTest.h"
+#include "Bus.h"
+#include "Sensors.h"
+#include <Adafruit_ADS1X15.h>
+
+void setup();
+void loop();
+
+#define STEP_US 100
+#define RUN_US 2000000UL
+#define RAMP_STEPS 1600
+#define CHANNEL_SPAN 0.9f // Volts between channel bases, above the ramp
+
+static const uint16_t rates[4] = ADS1115_CHANNEL_RATES;
+
+struct PipelineRun {
+  uint32_t conversions[4]; // New values seen per channel
+  uint32_t wrongChannel;   // Values from another channel's input
+  uint32_t calls;
+  uint32_t maxCallUs;
+  uint64_t totalCallUs;
+};
+
+// Each input ramps by 4 LSB per step on top of its own base, so every new
+// conversion changes the cached value and its range names the channel
+static float inputVolts(uint8_t channel, uint32_t step) {
+  return 0.2f + channel * CHANNEL_SPAN + 0.0005f * (step % RAMP_STEPS);
+}
+
+static PipelineRun run(uint32_t us) {
+  PipelineRun r = {};
+  int16_t last[4];
+  for (uint8_t ch = 0; ch < 4; ch++) last[ch] = readADC(ch);
+  uint64_t endUs = hostTimeUs() + us;
+  for (uint32_t step = 0; hostTimeUs() < endUs; step++) {
+    for (uint8_t ch = 0; ch < 4; ch++) hostSetAdcVoltage(ch, inputVolts(ch, step));
+    uint64_t start = hostTimeUs();
+    updateADC();
+    uint32_t callUs = hostTimeUs() - start;
+    r.maxCallUs = max(r.maxCallUs, callUs);
+    r.totalCallUs += callUs;
+    r.calls++;
+    for (uint8_t ch = 0; ch < 4; ch++) {
+      int16_t value = readADC(ch);
+      if (value == last[ch]) continue;
+      last[ch] = value;
+      r.conversions[ch]++;
+      float volts = readADCVoltage(ch) - 0.2f;
+      if (volts < ch * CHANNEL_SPAN - 0.01f || volts > (ch + 1) * CHANNEL_SPAN) r.wrongChannel++;
+    }
+    hostAdvanceUs(STEP_US);
+  }
+  return r;
+}
+
+static void sequencing() {
+  run(100000); // Settle onto the rate grid
+  hostAdcClearLog();
+  PipelineRun r = run(RUN_US);
+  CHECK(r.wrongChannel == 0);
+
+  bool equalRates = true;
+  uint32_t total = 0;
+  for (uint8_t ch = 0; ch < 4; ch++) {
+    uint32_t expected = rates[ch] * (RUN_US / 1000000UL);
+    printf("ADC channel %u: %u Hz configured, %u conversions in %lu s\n", ch, rates[ch], r.conversions[ch],
+           RUN_US / 1000000UL);
+    CHECK(r.conversions[ch] + 2 >= expected && r.conversions[ch] <= expected + 2);
+    if (!rates[ch]) CHECK(readADC(ch) == 0); // An off channel is never converted
+    equalRates = equalRates && rates[ch] == rates[0];
+    total += r.conversions[ch];
+  }
+  // One result read per conversion; the mux is written at most once each
+  uint8_t log[4096];
+  size_t logged = hostAdcConversionLog(log, sizeof(log));
+  CHECK(hostAdcResultReads() <= total + 1 && hostAdcResultReads() + 1 >= total);
+  CHECK(logged <= total + 1);
+  for (size_t i = 0; i < logged; i++) CHECK(rates[log[i]] != 0);
+  // With equal rates the mux cycles 0, 1, 2, 3 in order
+  if (equalRates) {
+    uint32_t outOfTurn = 0;
+    for (size_t i = 1; i < logged; i++) outOfTurn += log[i] != (log[i - 1] + 1) % 4;
+    CHECK(outOfTurn == 0);
+    CHECK(logged + 1 >= total);
+  }
+
+  // The cycle budget: the pipeline only ever does one result read and one
+  // mux write, the blocking single-shot read it replaced waits out a
+  // whole conversion
+  Adafruit_ADS1115 singleShot;
+  singleShot.begin(ADS1115_I2C_ADDR);
+  singleShot.setGain(GAIN_ONE);
+  singleShot.setDataRate(ADS1115_DATA_RATE);
+  uint64_t start = hostTimeUs();
+  singleShot.readADC_SingleEnded(0);
+  uint32_t blockingUs = hostTimeUs() - start;
+  printf("ADC bus time per updateADC(): %.1f us mean, %u us max over %u calls; single-shot read %u us\n",
+         (double)r.totalCallUs / r.calls, r.maxCallUs, r.calls, blockingUs);
+  CHECK(r.maxCallUs <= BUS_ADC_TRANSFER_US);
+  CHECK(blockingUs >= 1000000UL / 860);
+  CHECK(r.maxCallUs * 2 < blockingUs);
+}
+
+// While the IMU read is reserved just ahead, the ADC keeps off the bus until
+// the arbiter's starvation limit, then carries on once the IMU is served
+static void imuReservation() {
+  initSensors(); // Back to the pipeline's configuration after the single-shot read
+  run(50000);
+  uint32_t before = hostI2CStats(ADS1115_I2C_ADDR).transactions;
+  for (uint32_t us = 0; us < BUS_STARVATION_US / 2; us += STEP_US) {
+    busReserve(BUS_DEV_IMU, micros() + STEP_US);
+    updateADC();
+    hostAdvanceUs(STEP_US);
+  }
+  CHECK(hostI2CStats(ADS1115_I2C_ADDR).transactions == before);
+
+  busReserve(BUS_DEV_IMU, micros() + 1000000UL);
+  PipelineRun r = run(100000);
+  CHECK(hostI2CStats(ADS1115_I2C_ADDR).transactions > before);
+  uint32_t total = 0;
+  for (uint8_t ch = 0; ch < 4; ch++) total += r.conversions[ch];
+  CHECK(total > 0 && r.wrongChannel == 0);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  initBus();
+  initSensors();
+#if ENABLE_ADS1115
+  sequencing();
+  imuReservation();
+#endif
+  return hostTestResult(rates[0] == rates[3] ? "AdcPipelineTest" : "AdcPipelineTestRates");
+}
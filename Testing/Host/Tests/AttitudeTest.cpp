@@ -0,0 +1,212 @@
+// Madgwick attitude filter on synthetic rotations with known truth: a
+// tilted start is levelled from the first sample, tumbling with exact gyro
+// data tracks the truth, a gyro bias leaves tilt bounded by the gravity
+// correction while yaw drifts at the bias rate, and under thrust the
+// world-frame acceleration matches the truth with gravity removed. Prints
+// the drift and the filter updates per second on the host.
+
+#include "HostTest.h"
+#include "Attitude.h"
+#include "Sensors.h"
+#include "Settings.h"
+#include <chrono>
+
+void setup();
+void loop();
+
+#define IMU_PERIOD_US 10000 // SAMPLE_RATE_IMU_HZ
+#define SUBSTEPS 20         // Truth integration steps per sample
+#define TIMED_UPDATES 2000000
+
+struct Quat {
+  float w, x, y, z;
+};
+
+static Quat multiply(const Quat& a, const Quat& b) {
+  return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+          a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+static Quat normalized(const Quat& q) {
+  float n = sqrtf(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+  return {q.w / n, q.x / n, q.y / n, q.z / n};
+}
+
+// v rotated by q (body to world), or by its inverse
+static void rotate(const Quat& q, const float v[3], float out[3], bool inverse = false) {
+  Quat c = inverse ? Quat{q.w, -q.x, -q.y, -q.z} : q;
+  Quat r = multiply(multiply(c, {0, v[0], v[1], v[2]}), {c.w, -c.x, -c.y, -c.z});
+  out[0] = r.x;
+  out[1] = r.y;
+  out[2] = r.z;
+}
+
+static Quat axisAngle(float x, float y, float z, float angle) {
+  float s = sinf(angle / 2);
+  return {cosf(angle / 2), x * s, y * s, z * s};
+}
+
+static float degrees(float rad) {
+  return rad * 180.0f / (float)M_PI;
+}
+
+// Angle between the true and the estimated up axis in the body frame.
+// atan2 rather than acos: |q| is only held to a few parts per million, which
+// acos near 1 would turn into tenths of a degree.
+static float tiltError(const Quat& truth, const float q[4]) {
+  const float up[3] = {0, 0, 1};
+  float a[3], b[3];
+  rotate(truth, up, a, true);
+  rotate({q[0], q[1], q[2], q[3]}, up, b, true);
+  float cx = a[1] * b[2] - a[2] * b[1], cy = a[2] * b[0] - a[0] * b[2], cz = a[0] * b[1] - a[1] * b[0];
+  return degrees(atan2f(sqrtf(cx * cx + cy * cy + cz * cz), a[0] * b[0] + a[1] * b[1] + a[2] * b[2]));
+}
+
+// Rotation angle from the truth to the estimate
+static float totalError(const Quat& truth, const float q[4]) {
+  Quat d = multiply({truth.w, -truth.x, -truth.y, -truth.z}, {q[0], q[1], q[2], q[3]});
+  return degrees(2 * atan2f(sqrtf(d.x * d.x + d.y * d.y + d.z * d.z), fabsf(d.w)));
+}
+
+static float heading(const Quat& q) {
+  return degrees(atan2f(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z)));
+}
+
+typedef void (*Motion)(float t, float rate[3], float worldAccel[3]);
+
+struct RunResult {
+  float maxTilt;       // deg
+  float maxTotal;      // deg
+  float finalHeading;  // deg, estimate less truth
+  float maxWorldError; // m/s^2
+  float maxNormError;  // |q| - 1
+};
+
+// Integrates the truth and feeds the filter the body-frame samples the IMU
+// would report, plus a constant gyro bias
+static RunResult run(Quat truth, Motion motion, float seconds, const float gyroBias[3], float settleS = 0.0f) {
+  initAttitude();
+  RunResult r = {};
+  const float dt = IMU_PERIOD_US * 1e-6f;
+  uint32_t samples = (uint32_t)(seconds / dt);
+  for (uint32_t i = 0; i <= samples; i++) {
+    float t = i * dt;
+    if (i) {
+      for (int s = 0; s < SUBSTEPS; s++) {
+        float rate[3], unused[3];
+        motion(t - dt + (s + 0.5f) * dt / SUBSTEPS, rate, unused);
+        float angle = sqrtf(rate[0] * rate[0] + rate[1] * rate[1] + rate[2] * rate[2]) * dt / SUBSTEPS;
+        if (angle > 0) {
+          float n = angle / (dt / SUBSTEPS);
+          truth = normalized(multiply(truth, axisAngle(rate[0] / n, rate[1] / n, rate[2] / n, angle)));
+        }
+      }
+    }
+    float rate[3], world[3], specific[3], accel[3], gyro[3];
+    motion(t, rate, world);
+    specific[0] = world[0];
+    specific[1] = world[1];
+    specific[2] = world[2] + STANDARD_GRAVITY;
+    rotate(truth, specific, accel, true);
+    for (int axis = 0; axis < 3; axis++) gyro[axis] = rate[axis] + gyroBias[axis];
+
+    const AttitudeState& state = updateAttitude(i * IMU_PERIOD_US, accel, gyro);
+    float norm = sqrtf(state.q[0] * state.q[0] + state.q[1] * state.q[1] + state.q[2] * state.q[2] +
+                       state.q[3] * state.q[3]);
+    r.maxNormError = fmaxf(r.maxNormError, fabsf(norm - 1.0f));
+    if (t < settleS) continue;
+    r.maxTilt = fmaxf(r.maxTilt, tiltError(truth, state.q));
+    r.maxTotal = fmaxf(r.maxTotal, totalError(truth, state.q));
+    for (int axis = 0; axis < 3; axis++) r.maxWorldError = fmaxf(r.maxWorldError, fabsf(state.worldAccel[axis] - world[axis]));
+    float h = heading({state.q[0], state.q[1], state.q[2], state.q[3]}) - heading(truth);
+    r.finalHeading = h > 180 ? h - 360 : (h < -180 ? h + 360 : h);
+  }
+  return r;
+}
+
+static void still(float, float rate[3], float world[3]) {
+  rate[0] = rate[1] = rate[2] = 0;
+  world[0] = world[1] = world[2] = 0;
+}
+
+// Spinning at 1 rad/s in yaw while rocking 30 degrees in roll and pitch
+static void tumble(float t, float rate[3], float world[3]) {
+  rate[0] = 0.5f * cosf(1.7f * t);
+  rate[1] = 0.4f * sinf(1.3f * t);
+  rate[2] = 1.0f;
+  world[0] = world[1] = world[2] = 0;
+}
+
+// 5 g up with a slow pitch-over, as in a boost
+static void boost(float, float rate[3], float world[3]) {
+  rate[0] = 0;
+  rate[1] = 0.05f;
+  rate[2] = 0;
+  world[0] = world[1] = 0;
+  world[2] = 5 * STANDARD_GRAVITY;
+}
+
+static void print(const char* name, const RunResult& r) {
+  printf("Attitude %-20s tilt %.3f deg, total %.3f deg, heading %+.2f deg, world accel %.3f m/s^2, |q| - 1 %.1e\n",
+         name, r.maxTilt, r.maxTotal, r.finalHeading, r.maxWorldError, r.maxNormError);
+}
+
+static void synthetic() {
+  const float noBias[3] = {0, 0, 0};
+
+  // A 30 degree roll on the pad: levelled from the first sample. The
+  // normalised gradient step never shrinks, so at rest the estimate dithers
+  // by about beta * dt around the truth instead of settling.
+  RunResult tilted = run(axisAngle(1, 0, 0, 0.5236f), still, 5, noBias);
+  print("tilted, still:", tilted);
+  CHECK(tilted.maxTotal < degrees(2 * attitudeBeta * IMU_PERIOD_US * 1e-6f));
+  CHECK(tilted.maxWorldError < 0.05f);
+
+  // Exact gyro data: the filter follows the truth for a minute of tumbling
+  RunResult tumbling = run({1, 0, 0, 0}, tumble, 60, noBias);
+  print("tumbling 60 s:", tumbling);
+  CHECK(tumbling.maxTotal < 1.0f);
+  CHECK(tumbling.maxWorldError < 0.2f);
+  CHECK(tumbling.maxNormError < 1e-5f);
+
+  // A 0.01 rad/s bias on every axis: gravity holds the tilt, yaw is
+  // unobservable and drifts at the bias rate
+  const float bias[3] = {0.01f, 0.01f, 0.01f};
+  RunResult biased = run({1, 0, 0, 0}, still, 60, bias, 5);
+  print("gyro bias, still:", biased);
+  float expectedDrift = degrees(bias[2]) * 60;
+  printf("Attitude yaw drift %.1f deg/min for a %.2f deg/s bias\n", biased.finalHeading, degrees(bias[2]));
+  CHECK(biased.maxTilt < 2.0f);
+  CHECK(fabsf(biased.finalHeading - expectedDrift) < 0.1f * expectedDrift);
+
+  // Under thrust the accelerometer does not see gravity, so the correction
+  // stands aside and the gyro carries the attitude
+  RunResult boosting = run({1, 0, 0, 0}, boost, 3, noBias);
+  print("5 g boost:", boosting);
+  CHECK(boosting.maxTilt < 0.5f);
+  CHECK(boosting.maxWorldError < 0.1f * STANDARD_GRAVITY);
+}
+
+static void throughput() {
+  initAttitude();
+  float accel[3] = {0.1f, -0.2f, STANDARD_GRAVITY}, gyro[3] = {0.01f, 0.02f, 0.03f};
+  auto start = std::chrono::steady_clock::now();
+  float sum = 0;
+  for (uint32_t i = 0; i < TIMED_UPDATES; i++) {
+    accel[0] = -accel[0];
+    sum += updateAttitude(i * IMU_PERIOD_US, accel, gyro).worldAccel[2];
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("Attitude: %.1f M updates/s on the host\n", TIMED_UPDATES / seconds / 1e6);
+  CHECK(isfinite(sum));
+  // Far above the IMU rate even allowing for a much slower target
+  CHECK(TIMED_UPDATES / seconds > 1000.0 * SAMPLE_RATE_IMU_HZ);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  initSettings(); // madgwick_beta
+  synthetic();
+  throughput();
+  return hostTestResult("AttitudeTest");
+}
@@ -0,0 +1,68 @@
+// Boots the firmware on the stand-ins and runs it for a few virtual
+// seconds: every module initializes, the scheduled tasks run, the sampler
+// reads the IMU FIFO and the loggers reach flash and SD. Then a pass of
+// the scheduler runs a task at most once, however far it fell behind.
+
+#include "HostTest.h"
+#include "Scheduler.h"
+#include "Sensors.h"
+#include <sys/stat.h>
+#include <string>
+
+void setup();
+void loop();
+
+static int fastRuns = 0;
+static void fastTask() { fastRuns++; }
+static void slowTask() { hostChargeUs(5000); }
+
+static int taskRuns(const char* name) {
+  for (uint8_t i = 0; i < getTaskCount(); i++) {
+    if (!strcmp(getTaskName(i), name)) return getTaskStats(i).runs;
+  }
+  return -1;
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  Serial.hostCapture(true);
+
+  setup();
+  std::string boot = Serial.hostTakeOutput();
+  CHECK(boot.find("BlueLily Flight Computer Initialized") != std::string::npos);
+  CHECK(boot.find("ERROR") == std::string::npos);
+
+  uint64_t endUs = hostTimeUs() + 3000000;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+
+  CHECK(taskRuns("sampler") > 1000);
+  CHECK(taskRuns("flight") >= 3000 / LOOP_INTERVAL_MS - 1);
+  CHECK(taskRuns("logger") > 1000);
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+  IMUFifoStats fifo = getIMUFifoStats();
+  CHECK(fifo.samples > 2500); // 1 kHz for 3 s, less the boot
+  CHECK(fifo.overflows == 0);
+#endif
+  HostFlashStats flash = hostFlashStats();
+  CHECK(flash.programs > 0);
+  CHECK(flash.violations == 0);
+
+  struct stat info;
+  std::string log = std::string(hostSdRoot()) + "/FlightLog.bin";
+  CHECK(stat(log.c_str(), &info) == 0);
+
+  // After the fast task, the slow one holds the pass for five of its periods
+  initTaskScheduler();
+  addTask("fast", fastTask, 1000, 0, 0);
+  addTask("slow", slowTask, 1000, 0, 1);
+  hostAdvanceUs(1000);
+  runTasks();
+  CHECK(fastRuns == 1 && taskRuns("slow") == 1);
+  runTasks();
+  CHECK(fastRuns == 2 && taskRuns("slow") == 1);
+  return hostTestResult("BootTest");
+}
@@ -0,0 +1,214 @@
+// Bus arbiter on a mock bus: a transfer that would run into a more urgent
+// device's due time is deferred, devices on the other bus or of lower
+// priority never hold it up, and a deferred transfer is granted once it
+// has waited BUS_STARVATION_US. Then a randomised mix of periodic readers
+// and bulk writers checks both properties over many transactions, and the
+// firmware's own statistics after a run on the pad. Prints the worst
+// waits per device.
+
+#include "HostTest.h"
+#include "Bus.h"
+#include "DisplayFlush.h"
+
+void setup();
+void loop();
+
+#define STEP_US 10
+#define MIX_US 20000000ULL
+
+static uint32_t rngState = 2024;
+
+static uint32_t random32() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// The transfer itself: holds the (mock) bus for its duration
+static void transfer(BusDevice device, uint32_t durationUs) {
+  hostChargeUs(durationUs);
+  busEnd(device);
+}
+
+static void ordering() {
+  initBus();
+  uint32_t now = micros();
+
+  // IMU due in 100 us: a 200 us OLED chunk or ADC read must wait, a short
+  // one fits in front of it
+  busReserve(BUS_DEV_IMU, now + 100);
+  CHECK(!busBegin(BUS_DEV_OLED, 200));
+  CHECK(!busBegin(BUS_DEV_ADC, 200));
+  CHECK(busBegin(BUS_DEV_ADC, 50));
+  transfer(BUS_DEV_ADC, 50);
+  // The SPI bus is not held up by an I2C device
+  CHECK(busBegin(BUS_DEV_FLASH, 500));
+  transfer(BUS_DEV_FLASH, 500);
+  // The critical device itself is always granted
+  CHECK(busBegin(BUS_DEV_IMU, 0));
+  busEnd(BUS_DEV_IMU);
+  // Served: its reservation no longer holds anyone up
+  CHECK(busBegin(BUS_DEV_OLED, 200));
+  transfer(BUS_DEV_OLED, 200);
+
+  // On SPI the thermocouple (normal) holds up the flash (bulk), not CAN
+  // (normal), and the flash holds up nobody
+  now = micros();
+  busReserve(BUS_DEV_THERMOCOUPLE, now + 100);
+  busReserve(BUS_DEV_FLASH, now + 10);
+  CHECK(!busBegin(BUS_DEV_FLASH, 200));
+  CHECK(busBegin(BUS_DEV_CAN, 200));
+  transfer(BUS_DEV_CAN, 200);
+  CHECK(busBegin(BUS_DEV_THERMOCOUPLE, 0));
+  busEnd(BUS_DEV_THERMOCOUPLE);
+  CHECK(busBegin(BUS_DEV_FLASH, 200));
+  transfer(BUS_DEV_FLASH, 200);
+
+  // A reserved device's wait runs from its due time
+  resetBusStats();
+  busReserve(BUS_DEV_ADC, micros());
+  hostAdvanceUs(700);
+  CHECK(busBegin(BUS_DEV_ADC, 0));
+  busEnd(BUS_DEV_ADC);
+  CHECK(getBusStats(BUS_DEV_ADC).maxWaitUs == 700);
+}
+
+// The IMU always just about to be due: the OLED retries every step and is
+// granted, counted as forced, once it has waited the starvation bound
+static void starvation() {
+  initBus();
+  uint32_t firstUs = micros(), grantedUs = 0;
+  while (micros() - firstUs < 2 * BUS_STARVATION_US) {
+    busReserve(BUS_DEV_IMU, micros() + 50);
+    if (busBegin(BUS_DEV_OLED, 200)) {
+      grantedUs = micros();
+      busEnd(BUS_DEV_OLED);
+      break;
+    }
+    hostAdvanceUs(STEP_US);
+  }
+  BusDeviceStats oled = getBusStats(BUS_DEV_OLED);
+  CHECK(grantedUs - firstUs >= BUS_STARVATION_US && grantedUs - firstUs < BUS_STARVATION_US + STEP_US);
+  CHECK(oled.forced == 1 && oled.deferrals == BUS_STARVATION_US / STEP_US);
+  CHECK(oled.maxWaitUs == grantedUs - firstUs);
+}
+
+// A device of the mix: periodic ones reserve their next due time
+struct MockDevice {
+  BusDevice device;
+  BusPriority priority; // As Bus.cpp
+  uint32_t periodUs;   // 0 = bulk, wanted at random
+  uint32_t durationUs;
+  uint32_t nextUs;     // Due or wanted
+  bool pending;
+  uint32_t wantedUs;
+  uint32_t maxWaitUs;
+  uint32_t granted;
+};
+
+static void randomMix() {
+  initBus();
+  uint32_t t0 = micros();
+  MockDevice mix[] = {
+    {BUS_DEV_IMU, BUS_CRITICAL, 1000, 60, t0 + 1000},
+    {BUS_DEV_ADC, BUS_NORMAL, 1163, 120, t0 + 500},
+    {BUS_DEV_OLED, BUS_BULK, 0, OLED_CHUNK_BUS_US, t0},
+    {BUS_DEV_THERMOCOUPLE, BUS_NORMAL, 100000, 40, t0 + 300},
+    {BUS_DEV_CAN, BUS_NORMAL, 0, 150, t0},
+    {BUS_DEV_FLASH, BUS_BULK, 0, 280, t0},
+  };
+  const size_t count = sizeof(mix) / sizeof(mix[0]);
+  // Periodic readers reserve their next due time as soon as they are
+  // served, as the sampler does
+  for (size_t i = 0; i < count; i++) {
+    if (mix[i].periodUs) busReserve(mix[i].device, mix[i].nextUs);
+  }
+  // Per bus: the end of the current transfer
+  uint32_t busyUntil[2] = {t0, t0};
+  uint32_t collisions = 0, forcedCollisions = 0;
+
+  while (micros() - t0 < MIX_US) {
+    uint32_t now = micros();
+    for (size_t i = 0; i < count; i++) {
+      MockDevice& d = mix[i];
+      if (!d.pending && (int32_t)(now - d.nextUs) >= 0) {
+        d.pending = true;
+        d.wantedUs = d.nextUs;
+      }
+      // Everything waits for its bus to be free
+      BusId bus = d.device >= BUS_DEV_THERMOCOUPLE ? BUS_SPI : BUS_I2C;
+      if (!d.pending || (int32_t)(now - busyUntil[bus]) < 0) continue;
+      uint32_t forcedBefore = getBusStats(d.device).forced;
+      if (!busBegin(d.device, d.durationUs)) continue;
+      bool forced = getBusStats(d.device).forced != forcedBefore;
+
+      // Did the transfer run into the next due time of a more urgent device?
+      for (size_t j = 0; j < count; j++) {
+        const MockDevice& o = mix[j];
+        BusId otherBus = o.device >= BUS_DEV_THERMOCOUPLE ? BUS_SPI : BUS_I2C;
+        if (j == i || otherBus != bus || !o.periodUs || o.priority >= d.priority) continue;
+        if ((int32_t)(o.nextUs - (now + d.durationUs)) < 0 && (int32_t)(o.nextUs - now) > 0) {
+          collisions += !forced;
+          forcedCollisions += forced;
+        }
+      }
+      busyUntil[bus] = now + d.durationUs;
+      busEnd(d.device); // The mock transfer runs in the background of the clock
+      d.maxWaitUs = max(d.maxWaitUs, now - d.wantedUs);
+      d.granted++;
+      d.pending = false;
+      if (d.periodUs) {
+        d.nextUs += d.periodUs;
+        busReserve(d.device, d.nextUs);
+      } else {
+        d.nextUs = now + 200 + random32() % 5000;
+      }
+    }
+    hostAdvanceUs(STEP_US);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const MockDevice& d = mix[i];
+    printf("Bus mix %-12s %7u transfers, max wait %5u us\n", getBusDeviceName(d.device), d.granted, d.maxWaitUs);
+    CHECK(d.granted > 0);
+    // Nobody waits much past the starvation bound, however busy the bus
+    CHECK(d.maxWaitUs <= BUS_STARVATION_US + 1000 + STEP_US);
+  }
+  printf("Bus mix: %u transfers ran into a more urgent due time, %u of them forced\n", collisions + forcedCollisions,
+         forcedCollisions);
+  // Only the starvation bound lets a transfer overrun a due time
+  CHECK(collisions == 0);
+  // The IMU waits at most for a transfer the starvation bound let through
+  CHECK(mix[0].maxWaitUs <= OLED_CHUNK_BUS_US + STEP_US);
+}
+
+// The firmware on the pad: the worst waits its arbiter saw
+static void firmware() {
+  hostTestUseTempSd();
+  setup();
+  resetBusStats();
+  uint64_t endUs = hostTimeUs() + 10000000ULL;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(STEP_US);
+  }
+  for (uint8_t i = 0; i < BUS_DEVICE_COUNT; i++) {
+    BusDeviceStats s = getBusStats((BusDevice)i);
+    printf("Bus firmware %-12s %6u transactions, %5u deferrals, %3u forced, max wait %5u us, max hold %5u us\n",
+           getBusDeviceName((BusDevice)i), s.transactions, s.deferrals, s.forced, s.maxWaitUs, s.maxHoldUs);
+    CHECK(s.maxWaitUs <= BUS_STARVATION_US + LOOP_INTERVAL_MS * 1000UL);
+  }
+  CHECK(getBusStats(BUS_DEV_IMU).transactions > 0);
+  CHECK(getBusStats(BUS_DEV_ADC).maxHoldUs <= BUS_ADC_TRANSFER_US);
+  CHECK(getBusStats(BUS_DEV_OLED).maxHoldUs <= OLED_CHUNK_BUS_US);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  ordering();
+  starvation();
+  randomMix();
+  firmware();
+  return hostTestResult("BusArbiterTest");
+}
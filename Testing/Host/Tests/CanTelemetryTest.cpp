@@ -0,0 +1,186 @@
+// CAN telemetry from the signal table of CanDbc.h: every signal packs and
+// unpacks to within half a step, saturates at the ends of its range and
+// stays inside its own bits and the message's DLC. Then a node on the
+// virtual bus decodes what the firmware sends for 10 s: each message keeps
+// its cycle time, carries the values the sensors were set to, and the
+// measured bus load stays within the table's worst case and
+// CAN_BUS_LOAD_BUDGET_PERCENT. Prints the cycle times and the load.
+
+#include "HostTest.h"
+#include "CanDbc.h"
+#include "CanTelemetry.h"
+#include "FlightController.h"
+#include <vector>
+
+void setup();
+void loop();
+
+#define RUN_US 10000000ULL
+
+static const float imuAccel[3] = {0.50f, -1.25f, 9.81f};
+static const float imuGyro[3] = {0.010f, -0.020f, 0.300f};
+static const float adcVolts[4] = {0.125f, 1.650f, 3.000f, 0.000f};
+static const float temperature = 21.5f;
+
+static uint32_t random32(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static void still(uint64_t, float accel[3], float gyro[3]) {
+  memcpy(accel, imuAccel, sizeof(imuAccel));
+  memcpy(gyro, imuGyro, sizeof(imuGyro));
+}
+
+static float signalMax(const CanSignal& s) {
+  int64_t raw = s.isSigned ? (1LL << (s.length - 1)) - 1 : (1LL << s.length) - 1;
+  return raw * s.scale + s.offset;
+}
+
+static float signalMin(const CanSignal& s) {
+  int64_t raw = s.isSigned ? -(1LL << (s.length - 1)) : 0;
+  return raw * s.scale + s.offset;
+}
+
+static void packUnpack() {
+  uint32_t seed = 5, outside = 0, overlaps = 0, roundTrips = 0;
+  for (const CanMessageDef& message : BLUELILY_CAN_MESSAGES) {
+    CHECK(message.dlc <= 8 && message.cycleMs > 0);
+    for (uint8_t i = 0; i < message.signalCount; i++) {
+      const CanSignal& s = message.signals[i];
+      outside += s.startBit + s.length > 8 * message.dlc;
+      // All bits of one signal set: no other signal sees them
+      uint8_t data[8] = {};
+      canPackRaw(data, s, 0xFFFFFFFFUL);
+      for (uint8_t j = 0; j < message.signalCount; j++) overlaps += j != i && canUnpackRaw(data, message.signals[j]);
+
+      for (int n = 0; n < 1000; n++) {
+        float value = signalMin(s) + (signalMax(s) - signalMin(s)) * (random32(seed) % 10001) / 10000.0f;
+        canPackSignal(data, s, value);
+        roundTrips += fabsf(canUnpackSignal(data, s) - value) <= s.scale * 0.5f + fabsf(value) * 1e-6f;
+      }
+      canPackSignal(data, s, signalMax(s) * 2 + 1);
+      CHECK(canUnpackSignal(data, s) == signalMax(s));
+      canPackSignal(data, s, signalMin(s) * 2 - 1);
+      CHECK(canUnpackSignal(data, s) == signalMin(s));
+      canPackSignal(data, s, NAN);
+      CHECK(canUnpackSignal(data, s) == signalMin(s));
+    }
+  }
+  uint32_t signals = 0;
+  for (const CanMessageDef& message : BLUELILY_CAN_MESSAGES) signals += message.signalCount;
+  CHECK(outside == 0 && overlaps == 0);
+  CHECK(roundTrips == signals * 1000);
+}
+
+// Decodes the firmware's frames as a logger on the bus would
+class TelemetryNode : public HostCanNode {
+public:
+  std::vector<uint64_t> times[CAN_MSG_COUNT];
+  float maxError[CAN_MSG_COUNT] = {};
+  uint32_t counterSkips = 0, badStates = 0, unknown = 0;
+  int lastCounter = -1;
+
+  void canReceive(const HostCanFrame& frame) override {
+    int index = canFindMessage(frame.id);
+    if (index < 0) {
+      unknown++;
+      return;
+    }
+    const CanMessageDef& message = BLUELILY_CAN_MESSAGES[index];
+    CHECK(frame.length == message.dlc);
+    times[index].push_back(hostTimeUs());
+    float values[8];
+    for (uint8_t i = 0; i < message.signalCount; i++) values[i] = canUnpackSignal(frame.data, message.signals[i]);
+    const float* expected = nullptr;
+    switch (index) {
+      case CAN_MSG_IMU_ACCEL: expected = imuAccel; break;
+      case CAN_MSG_IMU_GYRO: expected = imuGyro; break;
+      case CAN_MSG_TEMP: expected = &temperature; break;
+      case CAN_MSG_ADC: expected = adcVolts; break;
+      case CAN_MSG_STATE:
+        badStates += values[0] != getFlightState();
+        counterSkips += lastCounter >= 0 && (int)values[1] != (lastCounter + 1) % 256;
+        lastCounter = values[1];
+        return;
+    }
+    for (uint8_t i = 0; i < message.signalCount; i++) {
+      maxError[index] = max(maxError[index], fabsf(values[i] - expected[i]));
+    }
+  }
+};
+
+static TelemetryNode node;
+
+static void firmware() {
+  hostTestUseTempSd();
+  hostSetImuMotion(still);
+  hostSetTemperature(temperature);
+  for (uint8_t i = 0; i < 4; i++) hostSetAdcVoltage(i, adcVolts[i]);
+  setup();
+  // Let every sensor produce its first sample
+  uint64_t warmUpUs = hostTimeUs() + 1000000ULL;
+  while (hostTimeUs() < warmUpUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+  hostCanAttach(&node);
+  hostCanResetStats();
+  CanTelemetryStats before = getCanTelemetryStats();
+  uint64_t start = hostTimeUs();
+  uint32_t maxPassUs = 0;
+  while (hostTimeUs() < start + RUN_US) {
+    uint64_t passStart = hostTimeUs();
+    loop();
+    maxPassUs = max(maxPassUs, (uint32_t)(hostTimeUs() - passStart));
+    hostAdvanceUs(10);
+  }
+  hostCanDetach(&node);
+  HostCanStats bus = hostCanStats();
+  CanTelemetryStats after = getCanTelemetryStats();
+
+  // Physical values within half a step, or the sensor's own resolution
+  const float tolerance[CAN_MSG_COUNT] = {0.02f, 0.002f, 0, 0.25f, 0.001f};
+  uint32_t frames = 0;
+  for (uint8_t i = 0; i < CAN_MSG_COUNT; i++) {
+    const CanMessageDef& message = BLUELILY_CAN_MESSAGES[i];
+    const std::vector<uint64_t>& t = node.times[i];
+    uint32_t minUs = UINT32_MAX, maxUs = 0;
+    for (size_t n = 1; n < t.size(); n++) {
+      minUs = min(minUs, (uint32_t)(t[n] - t[n - 1]));
+      maxUs = max(maxUs, (uint32_t)(t[n] - t[n - 1]));
+    }
+    printf("CAN %-12s 0x%03X %5u frames, cycle %4u ms: %6u..%6u us, max error %.4f\n", message.name, message.id,
+           (unsigned)t.size(), message.cycleMs, minUs, maxUs, node.maxError[i]);
+    uint32_t expected = RUN_US / 1000 / message.cycleMs;
+    CHECK(t.size() + 1 >= expected && t.size() <= expected + 1);
+    // On a 1 ms task, off the cycle time by at most a tick and the longest
+    // loop pass that delayed it
+    uint32_t jitterUs = 1000 + maxPassUs;
+    CHECK(minUs + jitterUs >= message.cycleMs * 1000UL && maxUs <= message.cycleMs * 1000UL + jitterUs);
+    CHECK(node.maxError[i] <= tolerance[i]);
+    frames += t.size();
+  }
+  CHECK(node.unknown == 0 && node.badStates == 0 && node.counterSkips == 0);
+  CHECK(after.frames - before.frames == frames && after.late == before.late);
+
+  uint32_t measuredBps = bus.bits * 1000000ULL / RUN_US;
+  printf("CAN telemetry load: %u bit/s measured, %u bit/s worst case, budget %lu bit/s (%u%% of %lu)\n",
+         measuredBps, after.loadBps, CANBUS_BITRATE * CAN_BUS_LOAD_BUDGET_PERCENT / 100, CAN_BUS_LOAD_BUDGET_PERCENT,
+         CANBUS_BITRATE);
+  printf("CAN telemetry: %u sends put off a tick with the TX buffers full, loop pass max %u us\n",
+         after.txFull - before.txFull, maxPassUs);
+  // Nothing lost: a send the controller refused went out on a later tick
+  CHECK(bus.frames == frames && bus.txBufferFull == after.txFull - before.txFull);
+  CHECK(measuredBps <= after.loadBps);
+  CHECK(measuredBps * 100ULL <= (uint64_t)CANBUS_BITRATE * CAN_BUS_LOAD_BUDGET_PERCENT);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  packUnpack();
+  firmware();
+  return hostTestResult("CanTelemetryTest");
+}
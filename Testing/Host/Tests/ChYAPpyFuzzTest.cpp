@@ -0,0 +1,214 @@
+// chYAPpy v1.2 parser: frames of every length round-trip with the payload
+// handed out in place, a stream with bit flips, noise bursts and lost bytes
+// loses only the frames the damage touched and recovers within one
+// maximum frame, and random noise alone never yields a stall. Prints the
+// parse throughput of a clean stream.
+
+#include "HostTest.h"
+#include "ChYAPpy.h"
+#include <chrono>
+#include <vector>
+
+void setup();
+void loop();
+
+#define FUZZ_FRAMES 20000
+#define BENCH_BYTES (64u << 20)
+
+static uint32_t random32(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Frame `index`: its index in the first 4 payload bytes, then bytes derived
+// from it, so a decoded frame can be matched to what was sent
+static size_t makeFrame(uint8_t* out, uint32_t index, uint8_t length) {
+  uint8_t payload[CHYAPPY_MAX_PAYLOAD];
+  memcpy(payload, &index, sizeof(index));
+  for (uint8_t i = sizeof(index); i < length; i++) payload[i] = (uint8_t)(index * 7 + i * 13);
+  return chyappyEncode(out, 'I', index % 4, (uint16_t)index, 'F', payload, length);
+}
+
+static bool genuine(const ChYAPpyFrame& frame, uint32_t& index) {
+  if (frame.length < sizeof(index)) return false;
+  memcpy(&index, frame.payload, sizeof(index));
+  uint8_t expected[CHYAPPY_MAX_FRAME];
+  size_t size = makeFrame(expected, index, frame.length);
+  return size && frame.sensorType == 'I' && frame.seqNum == (uint16_t)index &&
+         !memcmp(expected + 7, frame.payload, frame.length);
+}
+
+static void roundTrip() {
+  ChYAPpyParser parser;
+  chyappyReset(parser);
+  uint8_t out[CHYAPPY_MAX_FRAME];
+  uint8_t payload[CHYAPPY_MAX_PAYLOAD];
+  for (int length = 0; length <= CHYAPPY_MAX_PAYLOAD; length++) {
+    for (int i = 0; i < length; i++) payload[i] = CHYAPPY_START ^ i; // Start bytes inside the payload too
+    size_t size = chyappyEncode(out, 'T', 3, 0x1234 + length, 'S', payload, length);
+    CHECK(size == length + CHYAPPY_OVERHEAD);
+    ChYAPpyFrame frame;
+    for (size_t i = 0; i < size; i++) {
+      bool done = chyappyFeed(parser, out[i], frame);
+      CHECK(done == (i == size - 1));
+    }
+    CHECK(frame.length == length && frame.sensorType == 'T' && frame.sensorId == 3);
+    CHECK(frame.seqNum == 0x1234 + length && frame.payloadType == 'S');
+    CHECK(!memcmp(frame.payload, payload, length) && frame.payload[length] == '\0');
+    // A view into the parser's buffer, not a copy
+    CHECK((const uint8_t*)frame.payload == parser.buffer + 7);
+  }
+  CHECK(chyappyEncode(out, 'T', 0, 0, 'S', payload, CHYAPPY_MAX_PAYLOAD + 1) == 0);
+  CHECK(parser.stats.frames == CHYAPPY_MAX_PAYLOAD + 1);
+  CHECK(parser.stats.crcErrors == 0 && parser.stats.lengthErrors == 0 && parser.stats.droppedBytes == 0);
+
+  // One noise byte ahead of a frame costs nothing but itself
+  size_t size = makeFrame(out, 7, 20);
+  ChYAPpyFrame frame;
+  CHECK(!chyappyFeed(parser, 0x55, frame));
+  uint32_t delivered = 0;
+  for (size_t i = 0; i < size; i++) delivered += chyappyFeed(parser, out[i], frame) ? i + 1 : 0;
+  CHECK(delivered == size);
+  CHECK(parser.stats.droppedBytes == 1);
+}
+
+struct SentFrame {
+  size_t end;   // Stream offset just past the frame
+  bool damaged; // Hit by a bit flip or a lost byte
+};
+
+static void fuzz() {
+  uint32_t seed = 0x2468ACE1;
+  std::vector<uint8_t> stream;
+  std::vector<SentFrame> sent;
+  for (uint32_t index = 0; index < FUZZ_FRAMES; index++) {
+    uint8_t frame[CHYAPPY_MAX_FRAME];
+    size_t size = makeFrame(frame, index, 4 + random32(seed) % (CHYAPPY_MAX_PAYLOAD - 3));
+    bool damaged = false;
+    switch (random32(seed) % 16) {
+    case 0: // Bit flip anywhere, including the start, length and CRC bytes
+      frame[random32(seed) % size] ^= 1 << (random32(seed) % 8);
+      damaged = true;
+      break;
+    case 1: { // Lost byte
+      size_t at = random32(seed) % size;
+      memmove(frame + at, frame + at + 1, size - at - 1);
+      size--;
+      damaged = true;
+      break;
+    }
+    case 2: { // Noise burst ahead of the frame, start bytes likely
+      uint32_t burst = 1 + random32(seed) % 80;
+      for (uint32_t i = 0; i < burst; i++) {
+        uint8_t noise = random32(seed) % 4 ? random32(seed) : CHYAPPY_START;
+        stream.push_back(noise);
+      }
+      break;
+    }
+    }
+    stream.insert(stream.end(), frame, frame + size);
+    sent.push_back({stream.size(), damaged});
+  }
+
+  ChYAPpyParser parser;
+  chyappyReset(parser);
+  std::vector<size_t> deliveredAt(FUZZ_FRAMES, 0);
+  uint32_t spurious = 0;
+  for (size_t i = 0; i < stream.size(); i++) {
+    ChYAPpyFrame frame;
+    uint32_t index;
+    if (!chyappyFeed(parser, stream[i], frame)) continue;
+    if (genuine(frame, index) && index < FUZZ_FRAMES && !deliveredAt[index]) {
+      deliveredAt[index] = i + 1;
+    } else {
+      spurious++;
+    }
+  }
+
+  // Intact frames arrive, late by at most the frame a damaged length byte
+  // made the parser wait for. A chance CRC match on noise (1 in 256 with
+  // CRC-8) can swallow a real frame; that is the only other loss.
+  uint32_t intact = 0, lost = 0, damagedFrames = 0, recoveredLate = 0;
+  for (uint32_t index = 0; index < FUZZ_FRAMES; index++) {
+    if (sent[index].damaged) {
+      damagedFrames++;
+      continue;
+    }
+    intact++;
+    if (!deliveredAt[index]) {
+      lost++;
+      continue;
+    }
+    CHECK(deliveredAt[index] >= sent[index].end);
+    CHECK(deliveredAt[index] - sent[index].end <= CHYAPPY_MAX_FRAME);
+    if (deliveredAt[index] > sent[index].end) recoveredLate++;
+  }
+  printf("chYAPpy fuzz: %u frames, %u damaged, %u intact lost, %u late, %u spurious, %u CRC / %u length errors\n",
+         FUZZ_FRAMES, damagedFrames, lost, recoveredLate, spurious, parser.stats.crcErrors, parser.stats.lengthErrors);
+  CHECK(damagedFrames > FUZZ_FRAMES / 16);
+  CHECK(lost <= spurious);
+  CHECK(lost * 100 < intact);
+  CHECK(parser.stats.crcErrors > 0 && parser.stats.lengthErrors > 0 && parser.stats.droppedBytes > 0);
+}
+
+// Random bytes only: the parser never holds more than one frame's worth
+static void noise() {
+  ChYAPpyParser parser;
+  chyappyReset(parser);
+  uint32_t seed = 99;
+  for (int i = 0; i < 1000000; i++) {
+    ChYAPpyFrame frame;
+    chyappyFeed(parser, random32(seed), frame);
+    CHECK(parser.count <= CHYAPPY_MAX_FRAME);
+  }
+  // Then a clean frame comes through within a frame's worth of bytes
+  uint8_t out[CHYAPPY_MAX_FRAME];
+  size_t size = makeFrame(out, 1, 30);
+  bool found = false;
+  for (int pass = 0; pass < 2 && !found; pass++) {
+    for (size_t i = 0; i < size; i++) {
+      ChYAPpyFrame frame;
+      uint32_t index;
+      if (chyappyFeed(parser, out[i], frame) && genuine(frame, index) && index == 1) found = true;
+    }
+  }
+  CHECK(found);
+}
+
+static void throughput() {
+  std::vector<uint8_t> stream;
+  uint8_t frame[CHYAPPY_MAX_FRAME];
+  for (uint32_t index = 0; stream.size() < (1u << 20); index++) {
+    size_t size = makeFrame(frame, index, 4 + index % (CHYAPPY_MAX_PAYLOAD - 3));
+    stream.insert(stream.end(), frame, frame + size);
+  }
+
+  ChYAPpyParser parser;
+  chyappyReset(parser);
+  uint64_t payloadBytes = 0, streamBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t pass = 0; pass < BENCH_BYTES / stream.size(); pass++) {
+    for (uint8_t byte : stream) {
+      ChYAPpyFrame out;
+      if (chyappyFeed(parser, byte, out)) payloadBytes += out.length;
+    }
+    streamBytes += stream.size();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double mbPerS = streamBytes / seconds / 1e6;
+  printf("chYAPpy parse: %.1f MB/s on the host, %u frames\n", mbPerS, parser.stats.frames);
+  CHECK(payloadBytes * 2 > streamBytes);
+  // Orders of magnitude above the 115200 baud links it serves
+  CHECK(mbPerS > 1.0);
+  CHECK(parser.stats.crcErrors == 0 && parser.stats.droppedBytes == 0);
+}
+
+int main() {
+  roundTrip();
+  fuzz();
+  noise();
+  throughput();
+  return hostTestResult("ChYAPpyFuzzTest");
+}
@@ -0,0 +1,158 @@
+// ConfigStore on the W25Q128 model and the SD directory: commits survive a
+// reboot, a power cut at any flash command of a commit leaves either the
+// old or the new settings (never the defaults), corrupt slots fall back to
+// the SD mirror and are restored, and a legacy settings.txt is migrated.
+
+#include "HostTest.h"
+#include "ConfigStore.h"
+#include "Settings.h"
+#include <string>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static float setting(const char* key) {
+  int id = findSetting(key, strlen(key));
+  CHECK(id >= 0);
+  return id >= 0 ? readSetting(id) : NAN;
+}
+
+static void reboot() {
+  hostFlashPowerOn();
+  initSettings();
+  initConfigStore();
+}
+
+// Runs the commit task at its period until it is idle, or for at most 1 s
+static void runCommit() {
+  for (int i = 0; i < 100 && !configCommitIdle(); i++) {
+    updateConfigStore();
+    hostAdvanceUs(CONFIG_STORE_POLL_MS * 1000UL);
+  }
+}
+
+static void commit(const char* command) {
+  CHECK(applySettingCommand(command) == SETTING_OK);
+  requestConfigCommit();
+  runCommit();
+  CHECK(configCommitIdle());
+}
+
+static std::string sdPath(const char* name) {
+  return std::string(hostSdRoot()) + "/" + name;
+}
+
+static void corruptSlots() {
+  uint8_t garbage[8] = {0};
+  hostFlashWriteRaw(CONFIG_STORE_START + 20, garbage, sizeof(garbage));
+  hostFlashWriteRaw(CONFIG_STORE_START + 4096 + 20, garbage, sizeof(garbage));
+}
+
+static void commitAndReboot() {
+  reboot();
+  CHECK(getConfigStoreStats().generation == 0);
+  CHECK(getConfigStoreStats().slot == -1);
+  CHECK(setting("liftoff_accel") == 10.0f);
+
+  commit("liftoff_accel=30");
+  CHECK(getConfigStoreStats().commits == 1);
+  reboot();
+  CHECK(setting("liftoff_accel") == 30.0f);
+  CHECK(getConfigStoreStats().generation == 1);
+  int8_t firstSlot = getConfigStoreStats().slot;
+  CHECK(firstSlot >= 0);
+  // Two page reads on the SPI bus, not a file parse
+  CHECK(getConfigStoreStats().loadUs < 2000);
+
+  commit("liftoff_accel=31");
+  reboot();
+  CHECK(setting("liftoff_accel") == 31.0f);
+  CHECK(getConfigStoreStats().slot == 1 - firstSlot); // The newest blob is never overwritten
+  CHECK(access(sdPath("config.bin").c_str(), F_OK) == 0);
+}
+
+// Cuts power at each flash command of a commit (erase, program) and after
+// it; the verify read is not a command
+static void powerCuts() {
+  float committed = setting("liftoff_accel");
+  uint32_t cutTrials = 0;
+  for (uint32_t trial = 0; trial < 300; trial++) {
+    float next = 32 + trial % 50;
+    char command[32];
+    snprintf(command, sizeof(command), "liftoff_accel=%g", next);
+    CHECK(applySettingCommand(command) == SETTING_OK);
+    requestConfigCommit();
+    hostFlashCutPower(trial % 3, trial + 1);
+    runCommit();
+    bool cut = hostFlashPowerCut();
+    if (cut) cutTrials++;
+
+    reboot();
+    float loaded = setting("liftoff_accel");
+    CHECK(loaded == next || (cut && loaded == committed));
+    committed = loaded;
+  }
+  CHECK(cutTrials == 200);
+  CHECK(hostFlashStats().violations == 0);
+}
+
+static void sdMirror() {
+  float value = setting("liftoff_accel");
+  uint32_t generation = getConfigStoreStats().generation;
+  corruptSlots();
+  reboot();
+  CHECK(setting("liftoff_accel") == value);
+  CHECK(getConfigStoreStats().slot == -1);
+  // The flash copy is written back from the mirror
+  runCommit();
+  reboot();
+  CHECK(getConfigStoreStats().slot >= 0);
+  CHECK(getConfigStoreStats().generation == generation + 1);
+  CHECK(setting("liftoff_accel") == value);
+
+  // Nothing valid anywhere: defaults
+  corruptSlots();
+  unlink(sdPath("config.bin").c_str());
+  reboot();
+  CHECK(getConfigStoreStats().generation == 0);
+  CHECK(setting("liftoff_accel") == 10.0f);
+}
+
+static void legacyMigration() {
+  corruptSlots();
+  unlink(sdPath("config.bin").c_str());
+  FILE* file = fopen(sdPath("settings.txt").c_str(), "w");
+  CHECK(file != nullptr);
+  if (!file) return;
+  // As the HID wrote it, with Print::println line ends
+  fputs("MAX31855=0\r\nMPU6500=1\r\nCANBUS=1\r\nLoRa=0\r\nBogus=1\r\n", file);
+  fclose(file);
+
+  Serial.hostCapture(true);
+  reboot();
+  CHECK(Serial.hostTakeOutput().find("Config migrated from settings.txt") != std::string::npos);
+  Serial.hostCapture(false);
+  CHECK(setting("en_max31855") == 0);
+  CHECK(setting("en_mpu6500") == 1);
+  CHECK(setting("en_canbus") == 1);
+  CHECK(setting("en_lora") == 0);
+  CHECK(setting("en_sd") == 1); // Not in the file: default
+
+  runCommit();
+  unlink(sdPath("settings.txt").c_str());
+  reboot();
+  CHECK(getConfigStoreStats().generation == 1);
+  CHECK(setting("en_max31855") == 0);
+  CHECK(setting("en_canbus") == 1);
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  commitAndReboot();
+  powerCuts();
+  sdMirror();
+  legacyMigration();
+  return hostTestResult("ConfigStoreTest");
+}
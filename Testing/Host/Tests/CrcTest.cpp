@@ -0,0 +1,173 @@
+// Table-driven CRCs of Crc.h: the standard check values, the same result as
+// the bit-at-a-time loops they replaced for every length and alignment and
+// when continued over several pieces, and a chYAPpy frame byte-identical to
+// a v1.2 frame built by hand. Prints the throughput of the bitwise loop,
+// the byte table and slice-by-4, in bytes per cycle where the host has a
+// cycle counter.
+
+#include "HostTest.h"
+#include "Crc.h"
+#include "ChYAPpy.h"
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+void setup();
+void loop();
+
+#define BENCH_BYTES (16u << 20)
+
+static uint32_t random32(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// The loops Crc.h replaced
+static uint8_t bitwiseCrc8(const uint8_t* data, size_t length, uint8_t crc = 0) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t j = 0; j < 8; j++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+static uint16_t bitwiseCrc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t j = 0; j < 8; j++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static uint32_t bitwiseCrc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t j = 0; j < 8; j++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+  }
+  return ~crc;
+}
+
+// One lookup per byte, as before slice-by-4
+static uint8_t byteTableCrc8(const uint8_t* data, size_t length, uint8_t crc = 0) {
+  while (length--) crc = CRC8_TABLES.t[0][*data++ ^ crc];
+  return crc;
+}
+
+static void checkValues() {
+  const uint8_t* check = (const uint8_t*)"123456789";
+  CHECK(crc8(check, 9) == bitwiseCrc8(check, 9));
+  CHECK(crc8(check, 9) == 0xA2);
+  CHECK(crc16Ccitt(check, 9) == 0x29B1);
+  CHECK(crc32(check, 9) == 0xCBF43926UL);
+  CHECK(crc8(check, 0) == 0 && crc16Ccitt(check, 0) == 0xFFFF && crc32(check, 0) == 0);
+}
+
+// Every length up to a few words from every alignment, then random slices
+// split in two at random
+static void matchesBitwise() {
+  uint8_t buffer[4096];
+  uint32_t seed = 7;
+  for (uint8_t& b : buffer) b = random32(seed);
+  uint32_t mismatches = 0;
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t length = 0; length <= 64; length++) {
+      const uint8_t* data = buffer + offset;
+      mismatches += crc8(data, length) != bitwiseCrc8(data, length);
+      mismatches += crc16Ccitt(data, length) != bitwiseCrc16(data, length);
+      mismatches += crc32(data, length) != bitwiseCrc32(data, length);
+    }
+  }
+  for (int i = 0; i < 100000; i++) {
+    size_t offset = random32(seed) % 2048, length = random32(seed) % 2048, split = random32(seed) % (length + 1);
+    const uint8_t* data = buffer + offset;
+    uint8_t expected8 = bitwiseCrc8(data, length);
+    uint16_t expected16 = bitwiseCrc16(data, length);
+    uint32_t expected32 = bitwiseCrc32(data, length);
+    mismatches += crc8(data, length) != expected8;
+    mismatches += crc8(data + split, length - split, crc8(data, split)) != expected8;
+    mismatches += crc16Ccitt(data + split, length - split, crc16Ccitt(data, split)) != expected16;
+    mismatches += crc32(data + split, length - split, crc32(data, split)) != expected32;
+  }
+  printf("CRC: %u mismatches against the bitwise loops\n", mismatches);
+  CHECK(mismatches == 0);
+}
+
+// A v1.2 frame assembled byte by byte with the old CRC
+static void frameIdentical() {
+  const uint8_t payload[] = "12.5,0.25,-9.81";
+  const uint8_t length = sizeof(payload) - 1;
+  uint8_t expected[CHYAPPY_MAX_FRAME] = {CHYAPPY_START, length, 'I', 2, 0x12, 0x34, 'T'};
+  memcpy(expected + 7, payload, length);
+  expected[7 + length] = bitwiseCrc8(expected + 1, length + 6);
+
+  uint8_t frame[CHYAPPY_MAX_FRAME];
+  size_t size = chyappyEncode(frame, 'I', 2, 0x1234, 'T', payload, length);
+  CHECK(size == (size_t)length + 8);
+  CHECK(!memcmp(frame, expected, length + 8));
+}
+
+struct Speed {
+  double bytesPerNs;
+  double bytesPerCycle; // 0 without a cycle counter
+};
+
+template <typename Crc>
+static Speed measure(const std::vector<uint8_t>& data, Crc crc) {
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+#if HAVE_CYCLE_COUNTER
+  uint64_t startCycles = __rdtsc();
+#endif
+  for (size_t done = 0; done < BENCH_BYTES; done += data.size()) sink = sink + crc(data.data(), data.size());
+  Speed s = {};
+#if HAVE_CYCLE_COUNTER
+  s.bytesPerCycle = (double)BENCH_BYTES / (__rdtsc() - startCycles);
+#endif
+  s.bytesPerNs = BENCH_BYTES / (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9);
+  return s;
+}
+
+static void print(const char* name, const Speed& s) {
+  printf("CRC %-22s %6.3f bytes/ns", name, s.bytesPerNs);
+  if (s.bytesPerCycle > 0) printf(", %6.3f bytes/cycle", s.bytesPerCycle);
+  printf("\n");
+}
+
+static void throughput() {
+  // A 4 KB flash page's worth, rather than one short frame, so the loop
+  // overhead does not hide the per-byte cost
+  std::vector<uint8_t> data(4096);
+  uint32_t seed = 11;
+  for (uint8_t& b : data) b = random32(seed);
+
+  Speed bitwise8 = measure(data, [](const uint8_t* d, size_t n) { return (uint32_t)bitwiseCrc8(d, n); });
+  Speed table8 = measure(data, [](const uint8_t* d, size_t n) { return (uint32_t)byteTableCrc8(d, n); });
+  Speed slice8 = measure(data, [](const uint8_t* d, size_t n) { return (uint32_t)crc8(d, n); });
+  Speed bitwise16 = measure(data, [](const uint8_t* d, size_t n) { return (uint32_t)bitwiseCrc16(d, n); });
+  Speed table16 = measure(data, [](const uint8_t* d, size_t n) { return (uint32_t)crc16Ccitt(d, n); });
+  Speed table32 = measure(data, [](const uint8_t* d, size_t n) { return crc32(d, n); });
+  print("CRC-8 bitwise:", bitwise8);
+  print("CRC-8 byte table:", table8);
+  print("CRC-8 slice-by-4:", slice8);
+  print("CRC-16 bitwise:", bitwise16);
+  print("CRC-16 table:", table16);
+  print("CRC-32 table:", table32);
+
+  CHECK(table8.bytesPerNs > bitwise8.bytesPerNs * 2);
+  CHECK(slice8.bytesPerNs > table8.bytesPerNs);
+  CHECK(table16.bytesPerNs > bitwise16.bytesPerNs * 2);
+}
+
+int main() {
+  checkValues();
+  matchesBitwise();
+  frameIdentical();
+  throughput();
+  return hostTestResult("CrcTest");
+}
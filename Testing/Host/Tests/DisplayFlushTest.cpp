@@ -0,0 +1,173 @@
+// Incremental SSD1306 transfer: a frame sends only the changed column span
+// of each page, in chunks of at most OLED_CHUNK_BYTES that each fit the bus
+// slot the OLED task reserves, the panel ends up showing the framebuffer,
+// and nothing is sent while the IMU read is due. Then the firmware's own
+// screens over a minute, screensaver included. Prints the bytes per frame
+// through a counting transport against a full display() transfer.
+
+#include "HostTest.h"
+#include "DisplayFlush.h"
+#include "Bus.h"
+#include "FlightController.h"
+#include <Adafruit_SSD1306.h>
+
+void setup();
+void loop();
+
+#define FULL_FRAME_BYTES (OLED_PAGES * (6 + SCREEN_WIDTH)) // Every page a span of all columns
+
+extern Adafruit_SSD1306 display; // HID.cpp
+static Adafruit_SSD1306 oled(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1, 400000UL, 400000UL); // As HID.cpp
+
+// Host backend: counts what the transfer sends, then passes it on to the
+// panel model so the result can be compared too
+static uint32_t commandBytes, dataBytes, maxDataPerCall;
+
+static void countCommand(const uint8_t* bytes, uint8_t length) {
+  commandBytes += length;
+  Wire.beginTransmission(SCREEN_ADDRESS);
+  Wire.write((uint8_t)0x00);
+  Wire.write(bytes, length);
+  Wire.endTransmission();
+}
+
+static void countData(const uint8_t* bytes, uint8_t length) {
+  dataBytes += length;
+  maxDataPerCall = max(maxDataPerCall, (uint32_t)length);
+  Wire.beginTransmission(SCREEN_ADDRESS);
+  Wire.write((uint8_t)0x40);
+  Wire.write(bytes, length);
+  Wire.endTransmission();
+}
+
+struct FrameResult {
+  uint32_t bytes;   // Command and data
+  uint32_t calls;   // updateDisplayFlush() calls until idle
+  uint32_t maxCallUs;
+  bool panelMatches;
+};
+
+static FrameResult sendFrame() {
+  FrameResult r = {};
+  commandBytes = dataBytes = 0;
+  displayFlushFrame();
+  while (!displayFlushIdle() && r.calls < 1000) {
+    uint64_t start = hostTimeUs();
+    updateDisplayFlush();
+    r.maxCallUs = max(r.maxCallUs, (uint32_t)(hostTimeUs() - start));
+    r.calls++;
+    hostAdvanceUs(OLED_FLUSH_PERIOD_US);
+  }
+  r.bytes = commandBytes + dataBytes;
+  r.panelMatches = !memcmp(hostOledPanel(), oled.getBuffer(), OLED_PAGES * SCREEN_WIDTH);
+  CHECK(r.bytes == getDisplayFlushStats().lastFrameBytes);
+  return r;
+}
+
+static void print(const char* name, const FrameResult& r) {
+  printf("OLED %-22s %5u bytes in %3u calls, %4u us max per call\n", name, r.bytes, r.calls, r.maxCallUs);
+}
+
+static void frames() {
+  CHECK(oled.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS));
+  oled.clearDisplay();
+  // What display() costs: the whole buffer in one blocking transfer
+  uint64_t start = hostTimeUs();
+  uint32_t before = hostI2CStats(SCREEN_ADDRESS).bytes;
+  oled.display();
+  uint32_t fullBytes = hostI2CStats(SCREEN_ADDRESS).bytes - before;
+  uint32_t fullUs = hostTimeUs() - start;
+  printf("OLED display(): %u bytes, %u us blocking\n", fullBytes, fullUs);
+  initDisplayFlush(oled.getBuffer());
+  setDisplayTransport({countCommand, countData});
+  maxDataPerCall = 0;
+
+  FrameResult same = sendFrame();
+  print("unchanged:", same);
+  CHECK(same.bytes == 0 && same.panelMatches);
+
+  oled.drawPixel(70, 33, SSD1306_WHITE);
+  FrameResult pixel = sendFrame();
+  print("one pixel:", pixel);
+  CHECK(pixel.bytes == 6 + 1 && pixel.panelMatches);
+
+  // A menu cursor moving one line: two short spans
+  oled.setTextSize(1);
+  oled.setCursor(10, 20);
+  oled.print("> Sensors");
+  sendFrame();
+  oled.fillRect(10, 20, 12, 8, SSD1306_BLACK);
+  oled.setCursor(10, 30);
+  oled.print(">");
+  FrameResult cursor = sendFrame();
+  print("menu cursor:", cursor);
+  CHECK(cursor.bytes <= 3 * (6 + 12) && cursor.panelMatches);
+
+  // Every byte changes: the worst case is a full frame plus its windows
+  for (int16_t y = 0; y < SCREEN_HEIGHT; y++) {
+    for (int16_t x = 0; x < SCREEN_WIDTH; x++) oled.drawPixel(x, y, SSD1306_INVERSE);
+  }
+  FrameResult full = sendFrame();
+  print("every pixel:", full);
+  CHECK(full.bytes == FULL_FRAME_BYTES && full.panelMatches);
+  CHECK(full.calls >= OLED_PAGES * ((SCREEN_WIDTH + OLED_CHUNK_BYTES - 1) / OLED_CHUNK_BYTES));
+
+  // Each call holds the bus no longer than the slot it reserves, far less
+  // than display() blocks for
+  CHECK(maxDataPerCall <= OLED_CHUNK_BYTES);
+  CHECK(full.maxCallUs <= OLED_CHUNK_BUS_US);
+  CHECK(full.maxCallUs * 10 < fullUs);
+
+  // Nothing goes out while the IMU read is reserved just ahead
+  oled.fillRect(0, 0, SCREEN_WIDTH, 8, SSD1306_INVERSE);
+  displayFlushFrame();
+  uint32_t sent = commandBytes + dataBytes;
+  for (int i = 0; i < 20; i++) {
+    busReserve(BUS_DEV_IMU, micros() + 100);
+    updateDisplayFlush();
+    hostAdvanceUs(50);
+  }
+  CHECK(commandBytes + dataBytes == sent && !displayFlushIdle());
+  busReserve(BUS_DEV_IMU, micros() + 1000000UL);
+  FrameResult deferred = sendFrame();
+  CHECK(deferred.panelMatches);
+  resetDisplayTransport();
+}
+
+// The firmware's menu and then its screensaver, with the default transport
+static void firmwareScreens() {
+  hostTestUseTempSd();
+  setup();
+  armDelayMs = 600000; // Stay in IDLE, where the menu and screensaver are drawn
+  DisplayFlushStats atBoot = getDisplayFlushStats();
+  uint32_t maxPassUs = 0;
+  uint64_t endUs = hostTimeUs() + 60000000ULL;
+  while (hostTimeUs() < endUs) {
+    uint64_t start = hostTimeUs();
+    loop();
+    maxPassUs = max(maxPassUs, (uint32_t)(hostTimeUs() - start));
+    hostAdvanceUs(10);
+  }
+  DisplayFlushStats s = getDisplayFlushStats();
+  uint32_t frames = s.frames - atBoot.frames;
+  printf("OLED firmware: %u frames in 60 s, %.0f bytes per frame, %u max; loop pass max %u us\n", frames,
+         frames ? (double)(s.totalBytes - atBoot.totalBytes) / frames : 0.0, s.maxFrameBytes, maxPassUs);
+  CHECK(frames > 100);
+  CHECK(s.maxFrameBytes <= FULL_FRAME_BYTES);
+  // The screensaver moves a rocket and little else
+  CHECK(s.totalBytes - atBoot.totalBytes < frames * (FULL_FRAME_BYTES / 4));
+  // Redraws wait for the previous frame, so once idle the panel is current
+  while (!displayFlushIdle()) {
+    loop();
+    hostAdvanceUs(10);
+  }
+  CHECK(!memcmp(hostOledPanel(), display.getBuffer(), OLED_PAGES * SCREEN_WIDTH));
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  initBus();
+  frames();
+  firmwareScreens();
+  return hostTestResult("DisplayFlushTest");
+}
@@ -0,0 +1,233 @@
+// Vertical Kalman estimator against synthetic flights with known truth: it
+// learns a constant accelerometer bias on the pad, tracks a boost, coast
+// and parachute descent from noisy, biased acceleration alone, tracks it
+// closely when a barometer is fused, and uses the sample timestamps rather
+// than a nominal rate, so jittered and faster sampling give the same answer.
+// Prints the errors and the host time per update.
+//
+//   EstimatorTest [imu.csv]
+//
+// With an IMU recording in the hostLoadImuScript() format (body frame, time
+// in us) it also runs the recording through the attitude filter and the
+// estimator and prints the apogee and the final altitude; there is no truth
+// to check those against.
+
+#include "HostTest.h"
+#include "Attitude.h"
+#include "Estimator.h"
+#include "Sensors.h"
+#include <chrono>
+#include <vector>
+
+void setup();
+void loop();
+
+#define PAD_S 10.0f
+#define BOOST_S 2.0f
+#define BOOST_ACCEL 70.0f    // m/s^2, gravity removed
+#define DRAG_K 0.0008f       // 1/m, coast drag per unit v^2
+#define CHUTE_DELAY_S 1.0f   // After apogee
+#define DESCENT_RATE 6.0f    // m/s under the parachute
+#define ACCEL_BIAS 0.3f      // m/s^2, vertical accelerometer bias
+#define ACCEL_NOISE 0.3f     // m/s^2 standard deviation
+#define BARO_NOISE 1.0f      // m standard deviation
+#define BARO_PERIOD_US 50000 // 20 Hz
+#define TIMED_UPDATES 1000000
+
+struct TruthPoint {
+  uint32_t timeUs;
+  float altitude;
+  float velocity;
+  float accel; // Kinematic vertical acceleration, what the estimator is fed
+};
+
+struct FlightErrors {
+  float maxAltitudeError;  // m, in flight
+  float apogeeError;       // m, estimated apogee less the true one
+  float apogeeTimeError;   // s, estimated less true
+  float landedAltitude;    // m, estimate once down
+  float biasError;         // m/s^2 at liftoff
+};
+
+static uint32_t rngState;
+
+static float gaussian() {
+  // Sum of 12 uniforms: close enough to normal for a noise model
+  float sum = 0.0f;
+  for (int i = 0; i < 12; i++) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    sum += (rngState >> 8) * (1.0f / 16777216.0f);
+  }
+  return sum - 6.0f;
+}
+
+// Ground truth integrated at 100 us from the pad to touchdown
+static std::vector<TruthPoint> makeFlight() {
+  std::vector<TruthPoint> truth;
+  const float dt = 100e-6f;
+  float h = 0.0f, v = 0.0f, t = 0.0f, apogeeT = -1.0f;
+  for (uint32_t step = 0;; step++) {
+    t = step * dt;
+    float flightT = t - PAD_S;
+    float a = 0.0f;
+    if (flightT < 0.0f) {
+      a = 0.0f;
+    } else if (flightT < BOOST_S) {
+      a = BOOST_ACCEL;
+    } else if (apogeeT < 0.0f || t < apogeeT + CHUTE_DELAY_S) {
+      a = -STANDARD_GRAVITY - DRAG_K * v * fabsf(v);
+      if (apogeeT < 0.0f && v <= 0.0f) apogeeT = t;
+    } else {
+      a = -STANDARD_GRAVITY + STANDARD_GRAVITY / (DESCENT_RATE * DESCENT_RATE) * v * v;
+    }
+    if (flightT > BOOST_S && h <= 0.0f) break;
+    truth.push_back({(uint32_t)(t * 1e6f + 0.5f), h, v, a});
+    v += a * dt;
+    h += v * dt;
+  }
+  return truth;
+}
+
+// Feeds the estimator samples `periodUs` apart, each moved by up to
+// `jitterUs` with its true timestamp, as the sampler does
+static FlightErrors fly(const std::vector<TruthPoint>& truth, uint32_t periodUs, uint32_t jitterUs, bool baro,
+                        uint32_t seed) {
+  rngState = seed;
+  initEstimator();
+  FlightErrors e = {};
+  float trueApogee = 0.0f, trueApogeeS = 0.0f, estApogee = -1e9f, estApogeeS = 0.0f;
+  uint32_t nextBaroUs = 0;
+  const uint32_t stepUs = truth[1].timeUs - truth[0].timeUs;
+  for (uint32_t nominal = 0;; nominal += periodUs) {
+    int32_t jitter = jitterUs ? (int32_t)(gaussian() * jitterUs / 3) : 0;
+    uint32_t index = (uint32_t)max<int64_t>(0, (int64_t)nominal + jitter) / stepUs;
+    if (index >= truth.size()) break;
+    const TruthPoint& p = truth[index];
+    bool onPad = p.timeUs < PAD_S * 1e6f;
+    estimatorPredict(p.timeUs, p.accel + ACCEL_BIAS + ACCEL_NOISE * gaussian());
+    if (onPad) {
+      estimatorPadUpdate();
+      e.biasError = getEstimatorState().accelBias - ACCEL_BIAS;
+    }
+    if (baro && (int32_t)(p.timeUs - nextBaroUs) >= 0) {
+      estimatorUpdateBaro(p.altitude + BARO_NOISE * gaussian());
+      nextBaroUs += BARO_PERIOD_US;
+    }
+    EstimatorState s = getEstimatorState();
+    if (!onPad) e.maxAltitudeError = max(e.maxAltitudeError, fabsf(s.altitude - p.altitude));
+    if (p.altitude > trueApogee) {
+      trueApogee = p.altitude;
+      trueApogeeS = p.timeUs * 1e-6f;
+    }
+    if (s.altitude > estApogee) {
+      estApogee = s.altitude;
+      estApogeeS = p.timeUs * 1e-6f;
+    }
+    e.landedAltitude = s.altitude;
+  }
+  e.apogeeError = estApogee - trueApogee;
+  e.apogeeTimeError = estApogeeS - trueApogeeS;
+  return e;
+}
+
+static void print(const char* name, const FlightErrors& e) {
+  printf("Estimator %-22s apogee %+6.2f m %+5.2f s, max altitude error %6.2f m, landed at %+7.2f m, bias error %+.3f\n",
+         name, e.apogeeError, e.apogeeTimeError, e.maxAltitudeError, e.landedAltitude, e.biasError);
+}
+
+static void synthetic() {
+  std::vector<TruthPoint> truth = makeFlight();
+  float apogee = 0.0f;
+  for (const TruthPoint& p : truth) apogee = max(apogee, p.altitude);
+  printf("Synthetic flight: %.0f m apogee, %.0f s\n", apogee, truth.back().timeUs * 1e-6f);
+
+  FlightErrors imuOnly = fly(truth, 10000, 0, false, 1);
+  FlightErrors jittered = fly(truth, 10000, 3000, false, 1);
+  FlightErrors fast = fly(truth, 2500, 0, false, 1);
+  FlightErrors fused = fly(truth, 10000, 3000, true, 1);
+  print("100 Hz:", imuOnly);
+  print("100 Hz, 3 ms jitter:", jittered);
+  print("400 Hz:", fast);
+  print("100 Hz jittered + baro:", fused);
+
+  // The bias is learned on the pad
+  for (const FlightErrors* e : {&imuOnly, &jittered, &fast, &fused}) CHECK(fabsf(e->biasError) < 0.05f);
+
+  // Acceleration alone finds apogee to within a few percent and a fraction
+  // of a second; the error grows only through the long descent
+  CHECK(fabsf(imuOnly.apogeeError) < 0.03f * apogee);
+  CHECK(fabsf(imuOnly.apogeeTimeError) < 0.3f);
+  // Measured dt: jitter and rate change the answer by no more than a
+  // different noise draw does
+  CHECK(fabsf(jittered.apogeeError - imuOnly.apogeeError) < 0.02f * apogee);
+  CHECK(fabsf(fast.apogeeError - imuOnly.apogeeError) < 0.02f * apogee);
+  CHECK(fabsf(jittered.apogeeTimeError) < 0.3f && fabsf(fast.apogeeTimeError) < 0.3f);
+
+  // With the barometer the whole flight stays within a few sigma
+  CHECK(fused.maxAltitudeError < 5 * BARO_NOISE);
+  CHECK(fabsf(fused.apogeeError) < 3 * BARO_NOISE);
+  CHECK(fabsf(fused.landedAltitude) < 3 * BARO_NOISE);
+  CHECK(fused.maxAltitudeError < imuOnly.maxAltitudeError);
+}
+
+static void cost() {
+  initEstimator();
+  float accel = 0.0f;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < TIMED_UPDATES; i++) {
+    estimatorPredict(i * 10000, accel);
+    accel = -accel + 0.001f;
+  }
+  double predictNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                     TIMED_UPDATES;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < TIMED_UPDATES; i++) estimatorUpdateBaro((float)(i & 7));
+  double baroNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                  TIMED_UPDATES;
+  EstimatorState s = getEstimatorState();
+  printf("Estimator host time: predict %.1f ns, baro update %.1f ns\n", predictNs, baroNs);
+  CHECK(isfinite(s.altitude) && isfinite(s.velocity) && isfinite(s.accelBias));
+}
+
+// A recorded flight in the IMU script format, run as the sampler would
+static void recording(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    hostTestFailures++;
+    return;
+  }
+  initAttitude();
+  initEstimator();
+  char line[256];
+  float apogee = 0.0f;
+  uint32_t apogeeUs = 0, samples = 0;
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long long t;
+    float accel[3], gyro[3];
+    if (sscanf(line, "%llu,%f,%f,%f,%f,%f,%f", &t, &accel[0], &accel[1], &accel[2], &gyro[0], &gyro[1], &gyro[2]) != 7) {
+      continue;
+    }
+    const AttitudeState& attitude = updateAttitude((uint32_t)t, accel, gyro);
+    estimatorPredict((uint32_t)t, attitude.worldAccel[2]);
+    EstimatorState s = getEstimatorState();
+    if (s.altitude > apogee) {
+      apogee = s.altitude;
+      apogeeUs = t;
+    }
+    samples++;
+  }
+  fclose(file);
+  printf("%s: %u samples, apogee %.1f m at %.2f s, final altitude %.1f m\n", path, samples, apogee, apogeeUs * 1e-6f,
+         getEstimatorState().altitude);
+  CHECK(samples > 0);
+}
+
+int main(int argc, char** argv) {
+  synthetic();
+  cost();
+  if (argc > 1) recording(argv[1]);
+  return hostTestResult("EstimatorTest");
+}
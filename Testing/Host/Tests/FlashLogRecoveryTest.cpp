@@ -0,0 +1,152 @@
+// FlashLog on the W25Q128 model: the write head is recovered at boot after
+// clean shutdowns, power cuts that tear a program or an erase, and blank
+// holes in the log, and appending afterwards never programs over data. The
+// chip image is file-backed, so a reboot also goes through the image file.
+
+#include "FlashLogTest.h"
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static void cleanRestart() {
+  uint32_t pages = 3 * FLASH_PAGES_PER_SECTOR + 5; // Ends mid-sector
+  appendPages(pages);
+  flushFlashLog();
+  uint32_t next = flashLogNextSequence();
+
+  reboot();
+  CHECK(flashLogNextSequence() == next);
+  CHECK(getFlashLogStats().recoveredPages == next - flashLogOldestSequence());
+  CHECK(getFlashLogStats().voidedPages == 0);
+  uint32_t lastRecord = 0;
+  CHECK(checkLog(lastRecord) == next - flashLogOldestSequence());
+  CHECK(lastRecord == nextRecord - 1);
+}
+
+// Reopening the image file is a reboot with the flash contents on disk
+static void imageSurvivesProcess(const char* path) {
+  flushFlashLog();
+  uint32_t next = flashLogNextSequence();
+  CHECK(hostFlashOpen(path));
+  reboot();
+  CHECK(flashLogNextSequence() == next);
+}
+
+// Cuts power after `ops` program/erase commands of an append, reboots and
+// appends again. Nothing programmed before the torn command may be lost
+// and nothing after recovery may program over non-erased bits.
+static void powerCut(uint32_t ops, uint32_t seed) {
+  uint32_t before = flashLogNextSequence();
+  hostFlashCutPower(ops, seed);
+  while (!hostFlashPowerCut()) appendPages(1);
+  appendPages(2); // The firmware keeps running until the supply is gone
+
+  reboot();
+  FlashLogStats stats = getFlashLogStats();
+  CHECK(stats.voidedPages <= FLASH_PAGES_PER_SECTOR);
+  // The page being programmed at the cut may be torn, none before it
+  CHECK(flashLogNextSequence() + 1 >= sequenceAtCut);
+  CHECK(flashLogNextSequence() >= before);
+  uint32_t lastRecord = 0;
+  CHECK(checkLog(lastRecord) + voidedPages == flashLogNextSequence() - flashLogOldestSequence());
+
+  uint32_t resumed = flashLogNextSequence();
+  appendPages(FLASH_PAGES_PER_SECTOR + 3); // Crosses into a sector the cut may have torn
+  flushFlashLog();
+  CHECK(flashLogNextSequence() == resumed + FLASH_PAGES_PER_SECTOR + 3);
+  CHECK(hostFlashStats().violations == 0);
+
+  reboot();
+  CHECK(flashLogNextSequence() == resumed + FLASH_PAGES_PER_SECTOR + 3);
+  CHECK(getFlashLogStats().voidedPages == 0);
+  lastRecord = 0;
+  checkLog(lastRecord);
+  CHECK(lastRecord == nextRecord - 1);
+}
+
+// Blank pages in the middle of the log (programs that never happened).
+// The search may stop at the hole or find the real head past it; either
+// way the hole reads as missing, the pages before it stay intact and
+// appending works. Returns the recovered head relative to the hole.
+static int32_t blankHole(uint32_t holeOffset, uint32_t holeLength) {
+  flushFlashLog();
+  uint32_t start = flashLogNextSequence();
+  appendPages(4 * FLASH_PAGES_PER_SECTOR);
+  flushFlashLog();
+  uint32_t hole = start + holeOffset;
+  uint8_t blank[FLASH_PAGE_SIZE];
+  memset(blank, 0xFF, sizeof(blank));
+  for (uint32_t sequence = hole; sequence < hole + holeLength; sequence++) {
+    hostFlashWriteRaw(FLASH_LOG_START + (sequence % FLASH_LOG_PAGES) * FLASH_PAGE_SIZE, blank, sizeof(blank));
+  }
+
+  reboot();
+  uint8_t page[FLASH_PAGE_SIZE];
+  CHECK(readFlashLogPage(hole, page) < 0);
+  CHECK(flashLogNextSequence() >= hole);
+  int32_t head = flashLogNextSequence() - hole;
+  for (uint32_t sequence = start; sequence < hole; sequence++) {
+    CHECK(readFlashLogPage(sequence, page) == FLASH_PAGE_PAYLOAD);
+  }
+  uint32_t lastRecord = 0;
+  checkLog(lastRecord);
+
+  uint32_t resumed = flashLogNextSequence();
+  appendPages(2 * FLASH_PAGES_PER_SECTOR);
+  flushFlashLog();
+  CHECK(hostFlashStats().violations == 0);
+  reboot();
+  CHECK(flashLogNextSequence() == resumed + 2 * FLASH_PAGES_PER_SECTOR);
+  lastRecord = 0;
+  checkLog(lastRecord);
+  CHECK(lastRecord == nextRecord - 1);
+  return head;
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  char path[] = "/tmp/bluelily-flash-XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  CHECK(hostFlashOpen(path));
+
+  CHECK(initFlashLog());
+  CHECK(flashLogNextSequence() == 0);
+  CHECK(getFlashLogStats().recoveredPages == 0);
+  cleanRestart();
+  imageSurvivesProcess(path);
+
+  // Each cut point lands on a different command: page programs, the
+  // erase-ahead and the programs that follow it
+  for (uint32_t ops = 0; ops < 2 * FLASH_PAGES_PER_SECTOR + 4; ops++) powerCut(ops, ops + 1);
+  imageSurvivesProcess(path);
+
+  // Single pages the search steps over
+  CHECK(blankHole(FLASH_PAGES_PER_SECTOR + 7, 1) > 0);     // Mid-log, in a full sector
+  CHECK(blankHole(4 * FLASH_PAGES_PER_SECTOR - 3, 1) > 0); // In the last sector, valid pages after it
+  CHECK(blankHole(1, 1) > 0);
+  // A gap too long to step over: the head is recovered at the gap and the
+  // stray pages past it are erased before the log reaches them again
+  CHECK(blankHole(8, 3 * FLASH_PAGES_PER_SECTOR + 6) == 0);
+
+  // A new log starts at the next multiple of the region; the pages of the
+  // old one left past its head never pass for part of it
+  clearFlashLog();
+  uint32_t start = flashLogNextSequence();
+  CHECK(start % FLASH_LOG_PAGES == 0);
+  uint32_t firstRecord = nextRecord;
+  appendPages(FLASH_PAGES_PER_SECTOR + 1);
+  flushFlashLog();
+  reboot();
+  CHECK(flashLogOldestSequence() == start);
+  CHECK(flashLogNextSequence() == start + FLASH_PAGES_PER_SECTOR + 1);
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint32_t record;
+  CHECK(readFlashLogPage(start, page) == FLASH_PAGE_PAYLOAD);
+  CHECK(recordIntact(page + FLASH_PAGE_HEADER_SIZE, record) && record == firstRecord);
+
+  unlink(path);
+  return hostTestResult("FlashLogRecoveryTest");
+}
@@ -0,0 +1,89 @@
+#ifndef FLASH_LOG_TEST_H
+#define FLASH_LOG_TEST_H
+
+// Shared by the FlashLog tests: a checkable page stream, the background
+// writer on the host clock, and reboots on the W25Q128 model.
+
+#include "HostTest.h"
+#include "FlashLog.h"
+
+// Every page carries one record: its index in the test stream, then bytes
+// derived from it, so any page read back can be checked on its own.
+static uint32_t nextRecord = 0;
+static uint32_t voidedPages = 0; // By every recovery so far
+
+static void fillRecord(uint32_t record, uint8_t* payload) {
+  memcpy(payload, &record, sizeof(record));
+  for (uint16_t i = sizeof(record); i < FLASH_PAGE_PAYLOAD; i++) payload[i] = (uint8_t)(record * 31 + i);
+}
+
+static bool recordIntact(const uint8_t* payload, uint32_t& record) {
+  uint8_t expected[FLASH_PAGE_PAYLOAD];
+  memcpy(&record, payload, sizeof(record));
+  fillRecord(record, expected);
+  return !memcmp(payload, expected, FLASH_PAGE_PAYLOAD);
+}
+
+// Write head when the power cut hit, torn page included
+static uint32_t sequenceAtCut = 0;
+
+// Runs the background writer for `us`; each update issues at most one
+// flash command
+static void runWriter(uint64_t us) {
+  uint64_t endUs = hostTimeUs() + us;
+  while (hostTimeUs() < endUs) {
+    bool cut = hostFlashPowerCut();
+    updateFlashLog();
+    if (!cut && hostFlashPowerCut()) sequenceAtCut = flashLogNextSequence();
+    hostAdvanceUs(100);
+  }
+}
+
+// Appends `pages` full pages at the logger's ~27 KB/s, one every 10 ms
+static void appendPages(uint32_t pages) {
+  uint8_t payload[FLASH_PAGE_PAYLOAD];
+  for (uint32_t i = 0; i < pages; i++) {
+    fillRecord(nextRecord++, payload);
+    flashLogWrite(payload, sizeof(payload));
+    runWriter(10000);
+  }
+}
+
+static void reboot() {
+  hostFlashPowerOn();
+  CHECK(initFlashLog());
+  voidedPages += getFlashLogStats().voidedPages;
+}
+
+// Every page of the recovered log is either intact and in stream order, or
+// missing; returns the readable pages and the last record seen
+static uint32_t checkLog(uint32_t& lastRecord) {
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint32_t readable = 0;
+  bool first = true;
+  for (uint32_t sequence = flashLogOldestSequence(); sequence < flashLogNextSequence(); sequence++) {
+    if (readFlashLogPage(sequence, page) != FLASH_PAGE_PAYLOAD) continue;
+    uint32_t record;
+    CHECK(recordIntact(page + FLASH_PAGE_HEADER_SIZE, record));
+    CHECK(first || record > lastRecord);
+    lastRecord = record;
+    first = false;
+    readable++;
+  }
+  return readable;
+}
+
+// Void pages in the retained log, left by this or an earlier recovery
+static uint32_t countVoidPages() {
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint32_t count = 0;
+  for (uint32_t sequence = flashLogOldestSequence(); sequence < flashLogNextSequence(); sequence++) {
+    hostFlashReadRaw(FLASH_LOG_START + (sequence % FLASH_LOG_PAGES) * FLASH_PAGE_SIZE, page, sizeof(page));
+    bool zero = true;
+    for (uint16_t i = 0; i < FLASH_PAGE_SIZE && zero; i++) zero = page[i] == 0;
+    if (zero) count++;
+  }
+  return count;
+}
+
+#endif
@@ -0,0 +1,109 @@
+// The circular FlashLog on a 64 KB region (FLASH_LOG_SIZE is set by the
+// firmware variant): the head wraps and erases the oldest sector ahead of
+// itself, recovery finds the previous lap behind the erased zone, and
+// power cuts around the wrap lose at most the torn page, or the old
+// sector a torn erase was clearing.
+
+#include "FlashLogTest.h"
+
+void setup();
+void loop();
+
+static_assert(FLASH_LOG_CIRCULAR, "Build against the circular firmware variant");
+
+// Pages the circular log keeps at least: the region less the head sector
+// and the sectors erased ahead of it
+#define RETAINED_PAGES (FLASH_LOG_PAGES - (FLASH_ERASE_AHEAD_SECTORS + 1) * FLASH_PAGES_PER_SECTOR)
+
+// Every page of the retained log is intact or void; returns the last record
+static uint32_t checkWindow() {
+  uint32_t lastRecord = 0;
+  CHECK(checkLog(lastRecord) + countVoidPages() == flashLogNextSequence() - flashLogOldestSequence());
+  CHECK(flashLogNextSequence() - flashLogOldestSequence() <= FLASH_LOG_PAGES);
+  return lastRecord;
+}
+
+static void wrapLaps() {
+  appendPages(3 * FLASH_LOG_PAGES + FLASH_LOG_PAGES / 2);
+  flushFlashLog();
+  FlashLogStats stats = getFlashLogStats();
+  CHECK(stats.wraps == 3);
+  CHECK(stats.bytesDropped == 0);
+  CHECK(hostFlashStats().violations == 0);
+  uint32_t next = flashLogNextSequence();
+  uint32_t oldest = flashLogOldestSequence();
+  CHECK(next == 3 * FLASH_LOG_PAGES + FLASH_LOG_PAGES / 2);
+  CHECK(next - oldest >= RETAINED_PAGES);
+  uint32_t lastRecord = 0;
+  CHECK(checkLog(lastRecord) == next - oldest);
+  CHECK(lastRecord == nextRecord - 1);
+
+  // The previous lap past the erased zone is part of the recovered log
+  reboot();
+  CHECK(flashLogNextSequence() == next);
+  CHECK(flashLogOldestSequence() <= oldest);
+  CHECK(flashLogNextSequence() - flashLogOldestSequence() >= RETAINED_PAGES);
+  CHECK(getFlashLogStats().voidedPages == 0);
+  checkWindow();
+}
+
+// Reboots with the head at every few pages of a lap, so the erased zone
+// sits at the start of the region, straddles it and follows it
+static void rebootAroundTheLap() {
+  for (uint32_t i = 0; i < FLASH_LOG_PAGES / 7 + 8; i++) {
+    appendPages(7);
+    flushFlashLog();
+    uint32_t next = flashLogNextSequence();
+    reboot();
+    CHECK(flashLogNextSequence() == next);
+    CHECK(flashLogNextSequence() - flashLogOldestSequence() >= RETAINED_PAGES);
+    CHECK(checkWindow() == nextRecord - 1);
+  }
+  CHECK(hostFlashStats().violations == 0);
+}
+
+// Cuts power after `ops` commands while the head runs round the region
+static void powerCut(uint32_t ops, uint32_t seed) {
+  hostFlashCutPower(ops, seed);
+  while (!hostFlashPowerCut()) appendPages(1);
+  appendPages(2); // The firmware keeps running until the supply is gone
+
+  reboot();
+  CHECK(flashLogNextSequence() + 1 >= sequenceAtCut);
+  // A torn erase ahead of the head costs the sector it was erasing
+  CHECK(flashLogNextSequence() - flashLogOldestSequence() >= RETAINED_PAGES - FLASH_PAGES_PER_SECTOR);
+  checkWindow();
+
+  uint32_t resumed = flashLogNextSequence();
+  appendPages(FLASH_PAGES_PER_SECTOR + 3);
+  flushFlashLog();
+  CHECK(hostFlashStats().violations == 0);
+  reboot();
+  CHECK(flashLogNextSequence() == resumed + FLASH_PAGES_PER_SECTOR + 3);
+  CHECK(getFlashLogStats().voidedPages == 0);
+  checkWindow();
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  CHECK(initFlashLog());
+  wrapLaps();
+
+  // Each cut is followed by a sector and a bit of logging, so the head
+  // passes the wrap several times with void pages left in older laps
+  uint32_t laps = flashLogNextSequence() / FLASH_LOG_PAGES;
+  for (uint32_t ops = 0; ops < 2 * FLASH_PAGES_PER_SECTOR + 4; ops++) powerCut(ops, ops + 101);
+  CHECK(flashLogNextSequence() / FLASH_LOG_PAGES >= laps + 2);
+  rebootAroundTheLap();
+
+  // A cleared circular log skips a lap, so the old one is not taken for
+  // its previous lap
+  clearFlashLog();
+  uint32_t start = flashLogNextSequence();
+  appendPages(FLASH_PAGES_PER_SECTOR + 1);
+  flushFlashLog();
+  reboot();
+  CHECK(flashLogOldestSequence() == start);
+  CHECK(flashLogNextSequence() == start + FLASH_PAGES_PER_SECTOR + 1);
+  return hostTestResult("FlashLogWrapTest");
+}
@@ -0,0 +1,134 @@
+// Flash-to-SD offload latency: a first boot without a card leaves a large
+// backlog of log pages in flash, as a landing used to. On the next boot the
+// copy catches up in the background: no call spends more than
+// FLASH_SYNC_BUDGET_US plus one page copy, the loop keeps every sensor
+// period, each page reaches the image once, and once caught up the copy
+// only trails the write head. Prints the worst loop pass while catching up
+// and once caught up, and what copying the backlog in one go would stall.
+
+#include "HostTest.h"
+#include "FlashLog.h"
+#include "Logger.h"
+#include "Sampler.h"
+#include "Bus.h"
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+#define BACKLOG_US 30000000ULL
+#define CAUGHT_UP_US 5000000ULL
+
+struct LoopTiming {
+  uint32_t passes;
+  uint32_t maxPassUs;
+};
+
+// Loop passes back to back, as on the target, until `done` or `us` are up
+template <typename Done>
+static LoopTiming runLoop(uint64_t us, Done done) {
+  LoopTiming t = {};
+  uint64_t endUs = hostTimeUs() + us;
+  while (hostTimeUs() < endUs && !done()) {
+    uint64_t start = hostTimeUs();
+    loop();
+    t.maxPassUs = max(t.maxPassUs, (uint32_t)(hostTimeUs() - start));
+    t.passes++;
+    hostAdvanceUs(10);
+  }
+  return t;
+}
+
+// The first boot logs to flash only
+static void makeBacklog(const char* flashPath) {
+  CHECK(hostFlashOpen(flashPath));
+  hostSetSdPresent(false);
+  setup();
+  runLoop(BACKLOG_US, [] { return false; });
+}
+
+static uint32_t missedSamples() {
+  SamplerStats stats = getSamplerStats();
+  uint32_t missed = 0;
+  for (uint8_t type = 0; type < SAMPLE_TYPE_COUNT; type++) missed += stats.missed[type];
+  return missed;
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  char flashPath[] = "/tmp/bluelily-flash-XXXXXX";
+  int fd = mkstemp(flashPath);
+  CHECK(fd >= 0);
+  close(fd);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    hostTestFailures = 0;
+    makeBacklog(flashPath);
+    _exit(hostTestFailures ? 1 : 0);
+  }
+  int status = 0;
+  CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  CHECK(hostFlashOpen(flashPath));
+  setup();
+  uint32_t backlog = getFlashSyncProgress().pendingPages;
+  uint32_t startSequence = flashLogNextSequence() - backlog;
+
+  // Catching up
+  loop(); // Counts the sample periods setup() took as missed
+  uint32_t missedAtBoot = missedSamples();
+  uint64_t start = hostTimeUs();
+  LoopTiming catchingUp = runLoop(BACKLOG_US, [] { return getFlashSyncProgress().pendingPages <= 2; });
+  uint64_t catchUpUs = hostTimeUs() - start;
+  FlashSyncProgress progress = getFlashSyncProgress();
+  uint32_t missedCatchingUp = missedSamples() - missedAtBoot;
+
+  // Caught up: only the pages written meanwhile are copied
+  LoopTiming caughtUp = runLoop(CAUGHT_UP_US, [] { return false; });
+  FlashSyncProgress after = getFlashSyncProgress();
+  uint32_t written = flashLogNextSequence() - startSequence;
+
+  // One page copy, as updateFlashSync() does it, with the bus free
+  uint8_t page[FLASH_PAGE_SIZE];
+  runLoop(100000, [] { return false; });
+  while (!flashLogIdle()) hostAdvanceUs(10);
+  uint64_t pageStart = hostTimeUs();
+  CHECK(busBegin(BUS_DEV_FLASH, BUS_FLASH_PAGE_US));
+  CHECK(readFlashLogPage(startSequence, page) >= 0);
+  busEnd(BUS_DEV_FLASH);
+  uint32_t pageUs = hostTimeUs() - pageStart + 1 + FLASH_PAGE_SIZE / HOST_SD_BYTES_PER_US; // And the SD write
+
+  printf("Flash sync backlog: %u pages copied in %.2f s over %u loop passes\n", backlog, catchUpUs * 1e-6,
+         catchingUp.passes);
+  printf("Flash sync max per call: %u us (budget %u us, one page %u us)\n", progress.maxTickUs,
+         FLASH_SYNC_BUDGET_US, pageUs);
+  printf("Loop pass max: %u us catching up, %u us caught up; copying the backlog at once: %.1f ms\n",
+         catchingUp.maxPassUs, caughtUp.maxPassUs, backlog * pageUs / 1000.0);
+
+  CHECK(backlog > 1000);
+  CHECK(progress.pendingPages <= 2 && after.pendingPages <= 2);
+  CHECK(progress.skippedPages == 0);
+  // The copy yields once the budget is spent, so a call overruns it by at
+  // most the page it started last
+  CHECK(progress.maxTickUs <= FLASH_SYNC_BUDGET_US + pageUs);
+  CHECK(catchingUp.maxPassUs <= caughtUp.maxPassUs + FLASH_SYNC_BUDGET_US + pageUs);
+  CHECK(catchingUp.maxPassUs < LOOP_INTERVAL_MS * 1000UL);
+  CHECK(missedCatchingUp == 0);
+  // Every page once: no re-copy of what is already on the card
+  CHECK(after.copiedPages + after.pendingPages == written);
+  closeLogger();
+  struct stat info;
+  CHECK(stat((std::string(hostSdRoot()) + "/FlashLog.img").c_str(), &info) == 0);
+  CHECK(info.st_size == (off_t)getFlashSyncProgress().copiedPages * FLASH_PAGE_SIZE);
+  CHECK(hostFlashStats().violations == 0);
+
+  unlink(flashPath);
+  return hostTestResult("FlashSyncLatencyTest");
+}
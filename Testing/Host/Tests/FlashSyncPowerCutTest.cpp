@@ -0,0 +1,158 @@
+// Power cuts against the whole logger: each boot runs the firmware in a
+// child process on the same flash image and SD directory, cuts the flash
+// supply after a random number of commands and dies there. Between boots
+// the tail of FlashLog.img is cut back, as if the card had not committed
+// it. The last boot catches the sync up; the SD image must then hold every
+// readable flash page exactly once, in order and byte for byte.
+
+#include "HostTest.h"
+#include "FlashLog.h"
+#include "Logger.h"
+#include "Crc.h"
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+#define BOOTS 10
+
+static uint32_t random32(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static void runFor(uint64_t us) {
+  uint64_t endUs = hostTimeUs() + us;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+}
+
+// One boot up to the power cut, in its own process
+static void bootAndCut(const char* flashPath, uint32_t seed) {
+  CHECK(hostFlashOpen(flashPath));
+  setup();
+  runFor(1000000 + random32(seed) % 2000000);
+  hostFlashCutPower(random32(seed) % 200, seed);
+  uint64_t endUs = hostTimeUs() + 5000000;
+  while (!hostFlashPowerCut() && hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+  CHECK(hostFlashPowerCut());
+  runFor(20000); // Until the supply is gone
+}
+
+// Drops up to three pages and a partial one from the end of the image
+static void tearImage(const std::string& path, uint32_t& seed) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) return;
+  uint64_t cut = random32(seed) % (3 * FLASH_PAGE_SIZE + FLASH_PAGE_SIZE / 2);
+  CHECK(truncate(path.c_str(), info.st_size > (off_t)cut ? info.st_size - cut : 0) == 0);
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+  std::vector<uint8_t> data;
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return data;
+  uint8_t buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + n);
+  fclose(f);
+  return data;
+}
+
+// `synced`: the sync cursor when the copy stopped
+static void checkImage(const std::string& path, uint32_t synced) {
+  std::vector<uint8_t> image = readFile(path);
+  CHECK(image.size() % FLASH_PAGE_SIZE == 0);
+
+  size_t offset = 0;
+  bool first = true;
+  uint32_t previous = 0;
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint32_t imagePages = 0, matched = 0;
+  for (; offset + FLASH_PAGE_SIZE <= image.size(); offset += FLASH_PAGE_SIZE) {
+    const uint8_t* raw = image.data() + offset;
+    FlashPageHeader header;
+    memcpy(&header, raw, sizeof(header));
+    CHECK(header.magic == FLASH_PAGE_MAGIC && header.length <= FLASH_PAGE_PAYLOAD);
+    uint16_t crc = crc16Ccitt((const uint8_t*)&header.sequence, sizeof(header.sequence));
+    CHECK(crc16Ccitt(raw + FLASH_PAGE_HEADER_SIZE, header.length, crc) == header.crc);
+    CHECK(first || header.sequence > previous); // No page copied twice
+    first = false;
+    previous = header.sequence;
+    imagePages++;
+
+    if (header.sequence >= flashLogOldestSequence() && header.sequence < flashLogNextSequence()) {
+      CHECK(readFlashLogPage(header.sequence, page) >= 0);
+      CHECK(!memcmp(page, raw, FLASH_PAGE_SIZE));
+      matched++;
+    }
+  }
+
+  // Every readable page of the log up to the cursor made it to the image
+  uint32_t readable = 0, later = 0;
+  for (uint32_t sequence = flashLogOldestSequence(); sequence < flashLogNextSequence(); sequence++) {
+    if (readFlashLogPage(sequence, page) < 0) continue;
+    if (sequence < synced) readable++;
+    else later++;
+  }
+  CHECK(readable > 0);
+  CHECK(matched == readable || matched == readable + later);
+  CHECK(imagePages >= readable);
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  char flashPath[] = "/tmp/bluelily-flash-XXXXXX";
+  int fd = mkstemp(flashPath);
+  CHECK(fd >= 0);
+  close(fd);
+  std::string imagePath = std::string(hostSdRoot()) + "/FlashLog.img";
+
+  uint32_t seed = 12345;
+  for (int boot = 0; boot < BOOTS; boot++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      hostTestFailures = 0;
+      bootAndCut(flashPath, seed + boot);
+      _exit(hostTestFailures ? 1 : 0);
+    }
+    int status = 0;
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    tearImage(imagePath, seed);
+  }
+
+  // The last boot runs without a cut until the copy has caught up to the
+  // page or two it trails the write head by
+  CHECK(hostFlashOpen(flashPath));
+  Serial.hostCapture(true);
+  setup();
+  std::string boot = Serial.hostTakeOutput();
+  CHECK(boot.find("W25Q128 log recovered") != std::string::npos);
+  uint64_t endUs = hostTimeUs() + 60000000;
+  do {
+    runFor(100000);
+  } while (getFlashSyncProgress().pendingPages > 2 && hostTimeUs() < endUs);
+  FlashSyncProgress progress = getFlashSyncProgress();
+  CHECK(progress.pendingPages <= 2);
+  CHECK(progress.copiedPages > 0);
+  uint32_t synced = flashLogNextSequence() - progress.pendingPages;
+  closeLogger();
+  CHECK(hostFlashStats().violations == 0);
+  checkImage(imagePath, synced);
+
+  unlink(flashPath);
+  return hostTestResult("FlashSyncPowerCutTest");
+}
@@ -0,0 +1,105 @@
+// Flight-mode HID policy under bus contention: the same firmware, with
+// somebody turning the menu knob all the time, first on the pad in IDLE
+// and then through a boost and coast. In flight the panel is redrawn only
+// on state changes, the knob is not polled and the LEDs show the state, so
+// the OLED's share of the I2C bus drops to almost nothing and the IMU and
+// ADC reads wait no longer than on the pad. Prints the OLED bus time and
+// the worst IMU and ADC wait of both windows.
+
+#include "HostTest.h"
+#include "Bus.h"
+#include "FlightController.h"
+#include "Sensors.h"
+
+void setup();
+void loop();
+
+#define WINDOW_US 3000000ULL
+#define IGNITION_US 8000000ULL
+#define BURN_US 3000000ULL
+#define BOOST_ACCEL 60.0f // m/s^2 on top of gravity
+
+static const uint8_t ledPins[4] = {LED_1_PIN, LED_2_PIN, LED_3_PIN, LED_4_PIN};
+
+// Upright on the pad, a boost, then coasting in free fall
+static void flight(uint64_t timeUs, float accel[3], float gyro[3]) {
+  accel[0] = accel[1] = 0.0f;
+  if (timeUs < IGNITION_US) accel[2] = STANDARD_GRAVITY;
+  else if (timeUs < IGNITION_US + BURN_US) accel[2] = STANDARD_GRAVITY + BOOST_ACCEL;
+  else accel[2] = 0.0f;
+  gyro[0] = gyro[1] = gyro[2] = 0.0f;
+}
+
+struct Window {
+  uint32_t oledBusyUs;
+  uint32_t oledTransactions;
+  uint32_t imuMaxWaitUs;
+  uint32_t adcMaxWaitUs;
+  uint32_t potTurns;
+};
+
+// Loop passes with the knob swept end to end every 200 ms
+static Window run(uint64_t us) {
+  Window w = {};
+  HostBusStats oled = hostI2CStats(SCREEN_ADDRESS);
+  resetBusStats();
+  uint64_t endUs = hostTimeUs() + us;
+  int lastPot = -1;
+  while (hostTimeUs() < endUs) {
+    int pot = (int)(hostTimeUs() / 1000 % 200) * 1023 / 199;
+    hostSetAnalog(POT_PIN, pot);
+    if (pot / 100 != lastPot / 100) w.potTurns++;
+    lastPot = pot;
+    loop();
+    hostAdvanceUs(10);
+  }
+  w.oledBusyUs = hostI2CStats(SCREEN_ADDRESS).busyUs - oled.busyUs;
+  w.oledTransactions = hostI2CStats(SCREEN_ADDRESS).transactions - oled.transactions;
+  w.imuMaxWaitUs = getBusStats(BUS_DEV_IMU).maxWaitUs;
+  w.adcMaxWaitUs = getBusStats(BUS_DEV_ADC).maxWaitUs;
+  return w;
+}
+
+static void print(const char* name, const Window& w) {
+  printf("HID %-14s OLED %6.1f ms/s of I2C in %5u transactions; IMU wait max %4u us, ADC wait max %4u us\n",
+         name, w.oledBusyUs / 1000.0 / (WINDOW_US / 1e6), w.oledTransactions, w.imuMaxWaitUs, w.adcMaxWaitUs);
+}
+
+static bool ledsShow(uint8_t pattern) {
+  for (uint8_t i = 0; i < 4; i++) {
+    if (hostGetPin(ledPins[i]) != ((pattern >> i) & 1 ? HIGH : LOW)) return false;
+  }
+  return true;
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  hostSetImuMotion(flight);
+  setup();
+  armDelayMs = IGNITION_US / 1000 - 2000; // Armed 2 s before ignition
+
+  // On the pad the menu follows the knob
+  run(500000);
+  Window pad = run(WINDOW_US);
+  CHECK(getFlightState() == IDLE);
+  CHECK(ledsShow(0x8));
+
+  // Boost and coast, the knob still turning
+  while (hostTimeUs() < IGNITION_US + 200000) run(100000);
+  CHECK(getFlightState() == ASCENT);
+  Window inFlight = run(WINDOW_US);
+  FlightState state = getFlightState();
+  CHECK(state == ASCENT || state == APOGEE || state == DESCENT);
+  CHECK(ledsShow(state == ASCENT ? 0x1 : state == APOGEE ? 0x3 : 0x6));
+
+  print("pad (IDLE):", pad);
+  print("in flight:", inFlight);
+  CHECK(pad.potTurns > 0 && inFlight.potTurns > 0);
+  CHECK(pad.oledTransactions > 100);
+  // Only state changes are drawn, each at most a frame
+  CHECK(inFlight.oledBusyUs * 20 < pad.oledBusyUs);
+  CHECK(inFlight.imuMaxWaitUs <= pad.imuMaxWaitUs);
+  CHECK(inFlight.adcMaxWaitUs <= pad.adcMaxWaitUs);
+  return hostTestResult("HidFlightTest");
+}
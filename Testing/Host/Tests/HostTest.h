@@ -0,0 +1,33 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Minimal checks for the host tests: a failed CHECK prints its location
+// and the test exits non-zero from hostTestResult().
+
+#include <Arduino.h>
+#include "HostHardware.h"
+#include <stdlib.h>
+
+static int hostTestFailures = 0;
+
+#define CHECK(condition)                                                         \
+  do {                                                                           \
+    if (!(condition)) {                                                          \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      hostTestFailures++;                                                        \
+    }                                                                            \
+  } while (0)
+
+// A fresh directory for the SD card of one test
+inline void hostTestUseTempSd() {
+  static char path[] = "/tmp/bluelily-sd-XXXXXX";
+  if (mkdtemp(path)) hostSetSdRoot(path);
+}
+
+inline int hostTestResult(const char* name) {
+  if (hostTestFailures) fprintf(stderr, "%s: %d check(s) failed\n", name, hostTestFailures);
+  else printf("%s: ok\n", name);
+  return hostTestFailures ? 1 : 0;
+}
+
+#endif
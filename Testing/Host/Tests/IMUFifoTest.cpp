@@ -0,0 +1,174 @@
+// MPU6500 FIFO driver against the register model: parseIMUFifo() scaling
+// and framing, burst draining of replayed FIFO contents, the per-call cap,
+// timestamps, and overflow recovery both replayed and live.
+
+#include "HostTest.h"
+#include "Sensors.h"
+#include <vector>
+
+void setup();
+void loop();
+
+#define PERIOD_US (1000000UL / MPU6500_FIFO_RATE_HZ)
+
+static void putWord(std::vector<uint8_t>& out, int16_t value) {
+  out.push_back((uint16_t)value >> 8);
+  out.push_back(value & 0xFF);
+}
+
+// Record i: accel (i, -i, 2048) LSB, gyro (164, -164, 10 * i) LSB
+static std::vector<uint8_t> makeRecords(int count) {
+  std::vector<uint8_t> data;
+  for (int i = 0; i < count; i++) {
+    putWord(data, i);
+    putWord(data, -i);
+    putWord(data, 2048);
+    putWord(data, 164);
+    putWord(data, -164);
+    putWord(data, 10 * i);
+  }
+  return data;
+}
+
+static bool near(float a, float b) {
+  return fabsf(a - b) <= 1e-4f * fmaxf(1.0f, fabsf(b));
+}
+
+static void parser() {
+  std::vector<uint8_t> data = makeRecords(5);
+  IMUSample samples[8];
+  CHECK(parseIMUFifo(data.data(), data.size(), samples, 8, 1000, PERIOD_US) == 5);
+  const float lsbToMs2 = STANDARD_GRAVITY / 2048.0f;
+  const float lsbToRads = DEG_TO_RAD / 16.4f;
+  for (int i = 0; i < 5; i++) {
+    CHECK(samples[i].timestampUs == 1000 + i * PERIOD_US);
+    CHECK(near(samples[i].accel[0], i * lsbToMs2));
+    CHECK(near(samples[i].accel[1], -i * lsbToMs2));
+    CHECK(near(samples[i].accel[2], STANDARD_GRAVITY)); // 2048 LSB = 1 g at ±16 g
+    CHECK(near(samples[i].gyro[0], 10.0f * DEG_TO_RAD)); // 164 LSB = 10 dps at ±2000 dps
+    CHECK(near(samples[i].gyro[1], -10.0f * DEG_TO_RAD));
+    CHECK(near(samples[i].gyro[2], 10 * i * lsbToRads));
+  }
+
+  // A partial trailing record is ignored, and the caller's limit holds
+  CHECK(parseIMUFifo(data.data(), data.size() - 1, samples, 8, 0, PERIOD_US) == 4);
+  CHECK(parseIMUFifo(data.data(), data.size(), samples, 3, 0, PERIOD_US) == 3);
+  CHECK(parseIMUFifo(data.data(), MPU6500_FIFO_RECORD_SIZE - 1, samples, 8, 0, PERIOD_US) == 0);
+
+  // Full-scale words keep their sign
+  std::vector<uint8_t> extreme;
+  for (int16_t word : {32767, -32768, 0, -32768, 32767, -1}) putWord(extreme, word);
+  CHECK(parseIMUFifo(extreme.data(), extreme.size(), samples, 1, 0, PERIOD_US) == 1);
+  CHECK(near(samples[0].accel[0], 32767 * lsbToMs2));
+  CHECK(near(samples[0].accel[1], -32768 * lsbToMs2));
+  CHECK(near(samples[0].gyro[2], -1 * lsbToRads));
+}
+
+// The driver output is the parser output less a constant calibration
+// bias per axis
+static void checkAgainstParser(const IMUSample* read, const std::vector<uint8_t>& data, int first, int count) {
+  std::vector<IMUSample> parsed(first + count);
+  parseIMUFifo(data.data(), data.size(), parsed.data(), first + count, 0, PERIOD_US);
+  for (int i = 0; i < count; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      CHECK(near(parsed[first + i].accel[axis] - read[i].accel[axis], parsed[first].accel[axis] - read[0].accel[axis]));
+      CHECK(near(parsed[first + i].gyro[axis] - read[i].gyro[axis], parsed[first].gyro[axis] - read[0].gyro[axis]));
+    }
+  }
+}
+
+static void replay() {
+  IMUSample samples[MPU6500_FIFO_MAX_SAMPLES];
+  std::vector<uint8_t> data = makeRecords(40);
+  hostMpu6500ReplayFifo(data.data(), data.size(), false);
+  IMUFifoStats before = getIMUFifoStats();
+  HostBusStats busBefore = hostI2CStats(0x68);
+
+  // Capped at 10 records per call; the rest stays queued
+  uint32_t start = micros();
+  CHECK(readIMUBatch(samples, 10) == 10);
+  uint32_t end = micros();
+  CHECK(hostMpu6500FifoBytes() == 30 * MPU6500_FIFO_RECORD_SIZE);
+  checkAgainstParser(samples, data, 0, 10);
+  // Timestamps count back from the newest record, sampled at the read
+  for (int i = 1; i < 10; i++) CHECK(samples[i].timestampUs - samples[i - 1].timestampUs == PERIOD_US);
+  uint32_t newest = samples[0].timestampUs + 39 * PERIOD_US;
+  CHECK(newest - start <= end - start);
+
+  CHECK(readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES) == 30);
+  CHECK(hostMpu6500FifoBytes() == 0);
+  checkAgainstParser(samples, data, 10, 30);
+  CHECK(readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES) == 0);
+
+  // Bursts of MPU6500_FIFO_BURST_BYTES: 5 + 15 for 10 + 30 records
+  const int perBurst = MPU6500_FIFO_BURST_BYTES / MPU6500_FIFO_RECORD_SIZE;
+  IMUFifoStats after = getIMUFifoStats();
+  CHECK(after.samples - before.samples == 40);
+  CHECK(after.bursts - before.bursts == (uint32_t)((10 + perBurst - 1) / perBurst + (30 + perBurst - 1) / perBurst));
+  // Fewer bus transactions than polling, which takes a register write and
+  // a read per sample
+  HostBusStats bus = hostI2CStats(0x68);
+  CHECK(bus.transactions - busBefore.transactions < 2 * 40);
+}
+
+static void replayedOverflow() {
+  IMUSample samples[MPU6500_FIFO_MAX_SAMPLES];
+  // An overflowed FIFO holds the newest 512 bytes: not record aligned
+  std::vector<uint8_t> data = makeRecords(43);
+  data.erase(data.begin(), data.begin() + (data.size() - MPU6500_FIFO_SIZE));
+  uint32_t overflows = getIMUFifoStats().overflows;
+  uint32_t resets = hostMpu6500Stats().fifoResets;
+  hostMpu6500ReplayFifo(data.data(), data.size(), true);
+  CHECK(readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES) == 0); // Misaligned data is dropped
+  CHECK(getIMUFifoStats().overflows == overflows + 1);
+  CHECK(hostMpu6500Stats().fifoResets == resets + 1);
+  CHECK(hostMpu6500FifoBytes() == 0);
+
+  // Aligned again after the reset
+  std::vector<uint8_t> clean = makeRecords(3);
+  hostMpu6500ReplayFifo(clean.data(), clean.size(), false);
+  CHECK(readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES) == 3);
+  checkAgainstParser(samples, clean, 0, 3);
+}
+
+static void liveOverflow() {
+  IMUSample samples[MPU6500_FIFO_MAX_SAMPLES];
+  hostMpu6500Live();
+  delay(20);
+  while (readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES)) {}
+
+  // 42 records fill the FIFO: 100 ms without a drain overflows it
+  uint32_t overflows = getIMUFifoStats().overflows;
+  delay(100);
+  CHECK(readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES) == 0);
+  CHECK(hostMpu6500Stats().recordsLost > 0);
+  CHECK(getIMUFifoStats().overflows == overflows + 1);
+
+  // Draining at the sampler rate keeps up: nothing is lost, and all but
+  // the records of the last drain interval have been read
+  uint32_t got = 0;
+  uint32_t lost = hostMpu6500Stats().recordsLost;
+  uint32_t start = micros();
+  for (int i = 0; i < 100; i++) {
+    delay(1000 / SAMPLE_RATE_IMU_HZ);
+    got += readIMUBatch(samples, MPU6500_FIFO_MAX_SAMPLES);
+  }
+  uint32_t produced = (micros() - start) / PERIOD_US;
+  CHECK(got <= produced && got + 2 * 1000 / SAMPLE_RATE_IMU_HZ >= produced);
+  CHECK(hostMpu6500Stats().recordsLost == lost);
+  CHECK(getIMUFifoStats().overflows == overflows + 1);
+  // Level and still: about 1 g on Z after the calibration
+  CHECK(fabsf(samples[0].accel[2] - STANDARD_GRAVITY) < 0.5f);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  parser();
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+  initSensors();
+  replay();
+  replayedOverflow();
+  liveOverflow();
+#endif
+  return hostTestResult("IMUFifoTest");
+}
@@ -0,0 +1,221 @@
+// CAN transport against a virtual ISO-TP peer: the running firmware takes
+// settings longer than one frame, answers PARAMS and streams its flash log
+// page by page, honours the peer's block size and STmin, and recovers
+// when the peer goes quiet mid-transfer. Prints the log download rate.
+
+#include "HostTest.h"
+#include "CanTransport.h"
+#include "FlashLog.h"
+#include "Settings.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+// A host tool on the bus: requests on CAN_CONFIG_ID, replies on
+// CAN_RESPONSE_ID
+struct TracedFrame {
+  uint64_t timeUs; // Handed to the sender's controller; it may then wait for the bus
+  bool fromPeer;
+  uint8_t type;    // Protocol control byte
+};
+
+class IsoTpPeer : public HostCanNode {
+public:
+  IsoTpLink link;
+  std::deque<std::string> messages;
+  std::vector<TracedFrame> trace;
+  uint32_t responseFrames = 0;
+  bool silent = false; // Drop replies without answering, as if unplugged
+
+  void canReceive(const HostCanFrame& frame) override {
+    if (frame.id != CAN_RESPONSE_ID || silent) return;
+    responseFrames++;
+    trace.push_back({hostTimeUs(), false, frame.data[0]});
+    if (isoTpReceiveFrame(link, frame.data, frame.length, hostTimeUs())) {
+      messages.push_back(std::string((const char*)link.rxBuffer, link.rxLength));
+    }
+  }
+};
+
+static IsoTpPeer peer;
+
+static bool peerSendFrame(const uint8_t* data, uint8_t length) {
+  hostCanSend(&peer, CAN_CONFIG_ID, data, length);
+  peer.trace.push_back({hostTimeUs(), true, data[0]});
+  return true;
+}
+
+static void runFor(uint64_t us) {
+  uint64_t endUs = hostTimeUs() + us;
+  while (hostTimeUs() < endUs) {
+    loop();
+    isoTpPoll(peer.link, hostTimeUs(), 3);
+    hostAdvanceUs(10);
+  }
+}
+
+// Runs until the peer has a message, at most `timeoutUs`
+static bool nextMessage(std::string& message, uint64_t timeoutUs = 500000) {
+  uint64_t endUs = hostTimeUs() + timeoutUs;
+  while (peer.messages.empty() && hostTimeUs() < endUs) runFor(100);
+  if (peer.messages.empty()) return false;
+  message = peer.messages.front();
+  peer.messages.pop_front();
+  return true;
+}
+
+static bool request(const char* text, std::string& reply) {
+  peer.messages.clear();
+  return isoTpSend(peer.link, text, strlen(text), hostTimeUs()) && nextMessage(reply);
+}
+
+static void longSetting() {
+  std::string reply;
+  // 21 bytes: a first frame and two consecutive frames
+  CHECK(request("liftoff_accel=25.125", reply));
+  CHECK(reply == "ACK");
+  int id = findSetting("liftoff_accel", strlen("liftoff_accel"));
+  CHECK(id >= 0 && readSetting(id) == 25.125f);
+  CHECK(request("liftoff_accel=banana", reply) && reply == "NACK - Invalid format");
+
+  std::string tooLong = "liftoff_accel=" + std::string(CONFIG_BUFFER_SIZE, '1');
+  CHECK(request(tooLong.c_str(), reply) && reply == "NACK - Too long");
+}
+
+static void params() {
+  std::string reply;
+  CHECK(request("PARAMS", reply));
+  CHECK(reply.size() > 8); // Segmented
+  CHECK(reply.find("liftoff_accel=25.125") != std::string::npos);
+  size_t lines = 0;
+  for (char c : reply) lines += c == '\n';
+  CHECK(lines >= 10);
+}
+
+// The log from its oldest page while the logger keeps writing: every page
+// arrives in order and matches flash, and LOG,STOP is acknowledged between
+// pages. The logger writes faster than CAN carries, so the download is
+// stopped rather than run to LOG,END.
+static void logDownload() {
+  runFor(2000000); // Let the logger fill some pages
+  uint32_t frames = peer.responseFrames;
+  uint64_t startUs = hostTimeUs();
+  peer.messages.clear();
+  CHECK(isoTpSend(peer.link, "LOG", 3, hostTimeUs()));
+  std::vector<std::string> pages;
+  uint64_t endUs = hostTimeUs() + 10000000;
+  while (pages.size() < 200 && hostTimeUs() < endUs) {
+    runFor(100);
+    for (; !peer.messages.empty(); peer.messages.pop_front()) pages.push_back(peer.messages.front());
+  }
+  uint64_t downloadUs = hostTimeUs() - startUs;
+  CHECK(pages.size() >= 200);
+
+  // Compared with flash afterwards: a read now would wait out the logger's
+  // erases with the firmware stopped
+  uint32_t mismatched = 0, next = flashLogOldestSequence();
+  for (const std::string& message : pages) {
+    CHECK(message.size() == FLASH_PAGE_SIZE);
+    FlashPageHeader header;
+    memcpy(&header, message.data(), sizeof(header));
+    uint8_t page[FLASH_PAGE_SIZE];
+    if (header.sequence != next || readFlashLogPage(header.sequence, page) < 0 ||
+        memcmp(page, message.data(), FLASH_PAGE_SIZE)) {
+      mismatched++;
+    }
+    next = header.sequence + 1;
+  }
+  CHECK(mismatched == 0);
+
+  // Payload rate against what the bus can carry in 8-byte frames (7 bytes
+  // each, 135 worst-case bits). The transport refills the TX buffers every
+  // pass, but not while the sampler drains the IMU FIFO (about a third of
+  // the time at 100 Hz), and shares the bus with the telemetry.
+  double seconds = downloadUs / 1e6;
+  double bytesPerS = pages.size() * FLASH_PAGE_SIZE / seconds;
+  double busBytesPerS = 7.0 * CANBUS_BITRATE / 135;
+  printf("CAN log download: %u pages in %.2f s, %.0f B/s = %.0f%% of the bus payload rate, %u frames\n",
+         (unsigned)pages.size(),
+         seconds, bytesPerS, 100 * bytesPerS / busBytesPerS, peer.responseFrames - frames);
+  CHECK(bytesPerS > 0.45 * busBytesPerS);
+
+  // The ACK follows at most the page in flight, then no more pages
+  CHECK(isoTpSend(peer.link, "LOG,STOP", 8, hostTimeUs()));
+  std::string reply;
+  uint32_t after = 0;
+  while (nextMessage(reply) && reply.size() == FLASH_PAGE_SIZE) after++;
+  CHECK(reply == "ACK");
+  CHECK(after <= 1);
+  runFor(100000);
+  CHECK(peer.messages.empty());
+  CHECK(getCanTransportStats().timeouts == 0);
+}
+
+// The peer asks for blocks of 4 frames at least 2 ms apart: no block is
+// longer, and frames within a block are sent with the gap. A frame that
+// waits for the bus behind another arrives late, which the sender cannot
+// help, so the gap is taken between send requests.
+static void flowControl() {
+  isoTpInit(peer.link, peerSendFrame, 4, 2, 1000000);
+  peer.trace.clear();
+  std::string reply;
+  CHECK(request("PARAMS", reply));
+  CHECK(reply.size() > 4 * 7 * 2); // Several blocks
+
+  uint32_t blockFrames = 0, longBlocks = 0, tooClose = 0, blocks = 0;
+  uint64_t lastUs = 0;
+  for (const TracedFrame& frame : peer.trace) {
+    if (frame.fromPeer) {
+      if ((frame.type & 0xF0) == ISOTP_FLOW_CONTROL) {
+        blockFrames = 0;
+        blocks++;
+      }
+      continue;
+    }
+    if ((frame.type & 0xF0) != ISOTP_CONSECUTIVE) continue;
+    if (blockFrames > 0 && frame.timeUs - lastUs < 2000) tooClose++;
+    if (++blockFrames > 4) longBlocks++;
+    lastUs = frame.timeUs;
+  }
+  CHECK(blocks > 2);
+  CHECK(longBlocks == 0);
+  CHECK(tooClose == 0);
+  isoTpInit(peer.link, peerSendFrame, 0, 0, 1000000);
+}
+
+// The peer stops answering in the middle of a long reply: the firmware
+// gives up after ISOTP_TIMEOUT_MS and then serves the next request
+static void peerSilent() {
+  uint32_t timeouts = getCanTransportStats().timeouts;
+  isoTpInit(peer.link, peerSendFrame, 1, 0, 1000000); // Flow control after every frame
+  peer.messages.clear();
+  CHECK(isoTpSend(peer.link, "PARAMS", 6, hostTimeUs()));
+  runFor(3000);
+  peer.silent = true;
+  runFor(ISOTP_TIMEOUT_MS * 1000UL + 100000);
+  CHECK(getCanTransportStats().timeouts == timeouts + 1);
+  peer.silent = false;
+
+  isoTpInit(peer.link, peerSendFrame, 0, 0, 1000000);
+  std::string reply;
+  CHECK(request("liftoff_accel=24", reply) && reply == "ACK");
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  setup();
+  isoTpInit(peer.link, peerSendFrame, 0, 0, 1000000);
+  hostCanAttach(&peer);
+
+  longSetting();
+  params();
+  logDownload();
+  flowControl();
+  peerSilent();
+  CHECK(getCanTransportStats().overflows == 0);
+  return hostTestResult("IsoTpPeerTest");
+}
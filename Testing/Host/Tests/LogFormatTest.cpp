@@ -0,0 +1,374 @@
+// Binary flight log format: records of every type round-trip with their
+// timestamps, a corrupted stream loses only what lies before the next sync
+// marker, and against the text path it replaced (snprintf CSV lines, three
+// strlen() calls and a CR/LF per record) it writes fewer bytes in less
+// time. Then the running firmware's FlightLog.bin decodes cleanly. Prints
+// the bytes and host time per record of both paths.
+//
+//   LogFormatTest [DIR]
+//
+// With DIR the firmware's FlightLog.bin and FlashLog.img are copied there
+// for the bluelily_logconv test.
+
+#include "HostTest.h"
+#include "LogFormat.h"
+#include "Logger.h"
+#include "Config.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+#define ROUND_TRIP_RECORDS 20000
+#define CORRUPTIONS 200
+#define BENCH_SECONDS 600
+
+static uint32_t rngState = 12345;
+
+static uint32_t random32() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+struct TestRecord {
+  uint8_t tag;
+  uint32_t timestampUs;
+  uint8_t payload[LOG_MAX_TEXT];
+  uint8_t length;
+};
+
+// Record `index`: a tag in turn and a payload derived from the index, so a
+// decoded record can be matched to what was encoded
+static TestRecord makeRecord(uint32_t index, uint32_t timestampUs) {
+  static const uint8_t tags[] = {LOG_TAG_IMU, LOG_TAG_IMU, LOG_TAG_ADC, LOG_TAG_TEMP, LOG_TAG_FLIGHT, LOG_TAG_TEXT};
+  TestRecord r;
+  r.tag = tags[index % sizeof(tags)];
+  r.timestampUs = timestampUs;
+  if (r.tag == LOG_TAG_TEXT) {
+    r.length = snprintf((char*)r.payload, sizeof(r.payload), "event %u", index);
+  } else {
+    r.length = logPayloadSize(r.tag);
+    for (uint8_t i = 0; i < r.length; i++) r.payload[i] = (uint8_t)(index * 31 + i * 7);
+    memcpy(r.payload, &index, min<size_t>(sizeof(index), r.length));
+  }
+  return r;
+}
+
+static std::vector<uint8_t> encode(const std::vector<TestRecord>& records) {
+  std::vector<uint8_t> stream(LOG_HEADER_SIZE);
+  logEncodeHeader(stream.data());
+  LogEncoder encoder;
+  logEncoderReset(encoder);
+  for (const TestRecord& r : records) {
+    uint8_t buffer[LOG_MAX_RECORD_SIZE];
+    size_t size = logEncodeRecord(encoder, buffer, r.tag, r.timestampUs, r.payload, r.length);
+    stream.insert(stream.end(), buffer, buffer + size);
+  }
+  return stream;
+}
+
+static bool matches(const LogRecordView& rec, const TestRecord& r) {
+  return rec.tag == r.tag && rec.timestampUs == r.timestampUs && rec.length == r.length &&
+         !memcmp(rec.payload, r.payload, r.length);
+}
+
+static std::vector<TestRecord> makeRecords(uint32_t count) {
+  std::vector<TestRecord> records;
+  uint32_t timestampUs = 1000;
+  for (uint32_t i = 0; i < count; i++) {
+    // Mostly short steps, some long gaps and a wrap of the 32-bit clock
+    uint32_t step = random32() % 8 ? random32() % 2000 : random32() % 50000000;
+    timestampUs += step;
+    records.push_back(makeRecord(i, timestampUs));
+  }
+  return records;
+}
+
+static void roundTrip() {
+  std::vector<TestRecord> records = makeRecords(ROUND_TRIP_RECORDS);
+  std::vector<uint8_t> stream = encode(records);
+  CHECK(!memcmp(stream.data(), LOG_MAGIC, 4) && stream[4] == LOG_VERSION);
+
+  LogDecoder decoder;
+  logDecoderReset(decoder);
+  size_t pos = LOG_HEADER_SIZE;
+  uint32_t decoded = 0, wrong = 0;
+  while (pos < stream.size()) {
+    LogRecordView rec;
+    size_t used = logDecodeRecord(decoder, stream.data() + pos, stream.size() - pos, rec);
+    if (!used) break;
+    pos += used;
+    if (!rec.tag) continue;
+    if (decoded >= records.size() || !matches(rec, records[decoded])) wrong++;
+    decoded++;
+  }
+  CHECK(pos == stream.size());
+  CHECK(decoded == ROUND_TRIP_RECORDS && wrong == 0);
+  CHECK(decoder.resyncs == 0);
+
+  // Fed a byte at a time, as from a serial link, the result is the same
+  logDecoderReset(decoder);
+  std::vector<uint8_t> pending;
+  uint32_t streamed = 0;
+  for (size_t i = LOG_HEADER_SIZE; i < stream.size(); i++) {
+    pending.push_back(stream[i]);
+    for (;;) {
+      LogRecordView rec;
+      size_t used = logDecodeRecord(decoder, pending.data(), pending.size(), rec);
+      if (!used) break;
+      if (rec.tag && streamed < records.size() && matches(rec, records[streamed])) streamed++;
+      pending.erase(pending.begin(), pending.begin() + used);
+    }
+  }
+  CHECK(streamed == ROUND_TRIP_RECORDS);
+}
+
+// Byte flips through the stream: every record from the first sync marker
+// after a hit onwards decodes exactly, and decoding never stalls
+static void corruption() {
+  std::vector<TestRecord> records = makeRecords(ROUND_TRIP_RECORDS);
+  std::vector<uint8_t> stream = encode(records);
+  std::vector<size_t> hits;
+  for (int i = 0; i < CORRUPTIONS; i++) {
+    size_t at = LOG_HEADER_SIZE + random32() % (stream.size() - LOG_HEADER_SIZE);
+    stream[at] ^= 1 << (random32() % 8);
+    hits.push_back(at);
+  }
+
+  LogDecoder decoder;
+  logDecoderReset(decoder);
+  size_t pos = LOG_HEADER_SIZE;
+  uint32_t good = 0, spurious = 0;
+  std::vector<bool> seen(records.size(), false);
+  while (pos < stream.size()) {
+    LogRecordView rec;
+    size_t used = logDecodeRecord(decoder, stream.data() + pos, stream.size() - pos, rec);
+    if (!used) break;
+    pos += used;
+    if (!rec.tag) continue;
+    uint32_t index = 0;
+    memcpy(&index, rec.payload, min<size_t>(sizeof(index), rec.length));
+    if (rec.tag == LOG_TAG_TEXT) sscanf((const char*)rec.payload, "event %u", &index);
+    if (index < records.size() && matches(rec, records[index]) && !seen[index]) {
+      seen[index] = true;
+      good++;
+    } else {
+      spurious++;
+    }
+  }
+  CHECK(stream.size() - pos < LOG_MAX_RECORD_SIZE);
+
+  // At most the records up to the next sync marker are lost per hit
+  uint32_t lost = records.size() - good;
+  printf("Log corruption: %d byte flips, %u of %u records lost (%.1f per hit), %u spurious, %u resyncs\n",
+         CORRUPTIONS, lost, ROUND_TRIP_RECORDS, (double)lost / CORRUPTIONS, spurious, decoder.resyncs);
+  CHECK(lost <= (uint32_t)CORRUPTIONS * (LOG_SYNC_INTERVAL + 1));
+  CHECK(lost >= CORRUPTIONS / 2);
+  CHECK(decoder.resyncs > 0);
+}
+
+// The sample mix of a flight, as the logger sees it
+struct Mix {
+  uint32_t imuHz, tempHz, adcHz, flightHz;
+};
+
+static const Mix flightMix = {
+#if ENABLE_MPU6500 && MPU6500_USE_FIFO
+  MPU6500_FIFO_RATE_HZ,
+#else
+  SAMPLE_RATE_IMU_HZ,
+#endif
+  SAMPLE_RATE_TEMP_HZ, SAMPLE_RATE_ADC_HZ, 1000 / LOOP_INTERVAL_MS};
+
+struct PathResult {
+  uint64_t bytes;
+  uint32_t records;
+  double ns;
+};
+
+// Calls `write(tag, timeUs, i)` for every record of BENCH_SECONDS of the mix
+template <typename Write>
+static PathResult runPath(Write write, std::vector<uint8_t>& sink) {
+  PathResult result = {};
+  sink.clear();
+  const uint32_t tickUs = 1000000 / flightMix.imuHz;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < BENCH_SECONDS * flightMix.imuHz; tick++) {
+    uint32_t timeUs = tick * tickUs;
+    write(LOG_TAG_IMU, timeUs, tick);
+    if (tick % (flightMix.imuHz / flightMix.tempHz) == 0) write(LOG_TAG_TEMP, timeUs, tick);
+    if (tick % (flightMix.imuHz / flightMix.adcHz) == 0) write(LOG_TAG_ADC, timeUs, tick);
+    if (tick % (flightMix.imuHz / flightMix.flightHz) == 0) write(LOG_TAG_FLIGHT, timeUs, tick);
+  }
+  result.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  result.bytes = sink.size();
+  return result;
+}
+
+static float wave(uint32_t i, int axis) {
+  return 9.80665f * sinf(0.001f * i + axis) + 0.01f * axis;
+}
+
+// The text path before the binary format: one snprintf'd line per record,
+// then logData()'s flash write with its three strlen() calls and a CR/LF
+static void textLog(std::vector<uint8_t>& sink, const char* line) {
+  size_t address = sink.size();
+  if (address < sink.capacity() - strlen(line) - 2) {
+    sink.insert(sink.end(), line, line + strlen(line));
+    address += strlen(line);
+    sink.push_back('\r');
+    sink.push_back('\n');
+  }
+  (void)address;
+}
+
+static void throughput() {
+  std::vector<uint8_t> sink;
+  sink.reserve(256u << 20);
+  uint32_t records = 0;
+
+  PathResult text = runPath([&](uint8_t tag, uint32_t timeUs, uint32_t i) {
+    char line[128];
+    switch (tag) {
+      case LOG_TAG_IMU:
+        snprintf(line, sizeof(line), "IMU,%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", (unsigned long)timeUs, wave(i, 0),
+                 wave(i, 1), wave(i, 2), wave(i, 3) * 0.1f, wave(i, 4) * 0.1f, wave(i, 5) * 0.1f);
+        break;
+      case LOG_TAG_TEMP:
+        snprintf(line, sizeof(line), "TEMP,%lu,%.2f", (unsigned long)timeUs, 20.0f + wave(i, 0));
+        break;
+      case LOG_TAG_ADC:
+        snprintf(line, sizeof(line), "ADC,%lu,%d,%d,%d,%d", (unsigned long)timeUs, (int)(i & 0x7FFF), 1000, 2000, 3000);
+        break;
+      default:
+        snprintf(line, sizeof(line), "FC,%lu,%.2f,%.2f,%.2f,%.2f,%d,%d", (unsigned long)timeUs, 20.0f + wave(i, 0),
+                 wave(i, 1), wave(i, 2) * 10, wave(i, 3) * 100, 2, (int)(i & 0x7FFF));
+    }
+    textLog(sink, line);
+    records++;
+  }, sink);
+  text.records = records;
+
+  LogEncoder encoder;
+  logEncoderReset(encoder);
+  records = 0;
+  PathResult binary = runPath([&](uint8_t tag, uint32_t timeUs, uint32_t i) {
+    uint8_t buffer[LOG_MAX_RECORD_SIZE];
+    size_t size = 0;
+    switch (tag) {
+      case LOG_TAG_IMU: {
+        LogImuRecord r = {{wave(i, 0), wave(i, 1), wave(i, 2)}, {wave(i, 3) * 0.1f, wave(i, 4) * 0.1f, wave(i, 5) * 0.1f}};
+        size = logEncodeRecord(encoder, buffer, tag, timeUs, &r, sizeof(r));
+        break;
+      }
+      case LOG_TAG_TEMP: {
+        LogTempRecord r = {20.0f + wave(i, 0)};
+        size = logEncodeRecord(encoder, buffer, tag, timeUs, &r, sizeof(r));
+        break;
+      }
+      case LOG_TAG_ADC: {
+        LogAdcRecord r = {{(int16_t)(i & 0x7FFF), 1000, 2000, 3000}};
+        size = logEncodeRecord(encoder, buffer, tag, timeUs, &r, sizeof(r));
+        break;
+      }
+      default: {
+        LogFlightRecord r = {2, wave(i, 3) * 100, wave(i, 2) * 10, wave(i, 1), 20.0f + wave(i, 0), (int16_t)(i & 0x7FFF)};
+        size = logEncodeRecord(encoder, buffer, tag, timeUs, &r, sizeof(r));
+      }
+    }
+    if (sink.size() + size < sink.capacity()) sink.insert(sink.end(), buffer, buffer + size);
+    records++;
+  }, sink);
+  binary.records = records;
+
+  double seconds = BENCH_SECONDS;
+  printf("Log text path:   %.1f bytes/record, %.0f ns/record, %.1f KB/s of log\n", (double)text.bytes / text.records,
+         text.ns / text.records, text.bytes / seconds / 1024);
+  printf("Log binary path: %.1f bytes/record, %.0f ns/record, %.1f KB/s of log\n", (double)binary.bytes / binary.records,
+         binary.ns / binary.records, binary.bytes / seconds / 1024);
+  CHECK(text.records == binary.records);
+  CHECK(binary.bytes * 2 < text.bytes);
+  CHECK(binary.ns < text.ns);
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  uint8_t chunk[65536];
+  size_t n;
+  data.clear();
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+  return true;
+}
+
+static void copyFile(const std::string& from, const std::string& to) {
+  std::vector<uint8_t> data;
+  FILE* out = fopen(to.c_str(), "wb");
+  CHECK(readFile(from, data) && out);
+  if (out) {
+    fwrite(data.data(), 1, data.size(), out);
+    fclose(out);
+  }
+}
+
+// The firmware's own log after a few seconds on the pad
+static void firmwareLog(const char* copyDir) {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  setup();
+  uint64_t endUs = hostTimeUs() + 3000000;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+  closeLogger();
+
+  std::string root = hostSdRoot();
+  std::vector<uint8_t> log;
+  CHECK(readFile(root + "/FlightLog.bin", log));
+  CHECK(log.size() > LOG_HEADER_SIZE && !memcmp(log.data(), LOG_MAGIC, 4));
+  CHECK(log.size() > LOG_HEADER_SIZE && !memcmp(log.data() + 7, LOG_SCHEMA, sizeof(LOG_SCHEMA) - 1));
+
+  LogDecoder decoder;
+  logDecoderReset(decoder);
+  size_t pos = LOG_HEADER_SIZE;
+  uint32_t counts[6] = {0}, backwards = 0, lastImuUs = 0;
+  while (pos < log.size()) {
+    LogRecordView rec;
+    size_t used = logDecodeRecord(decoder, log.data() + pos, log.size() - pos, rec);
+    if (!used) break;
+    pos += used;
+    if (!rec.tag) continue;
+    if (rec.tag < 6) counts[rec.tag]++;
+    if (rec.tag == LOG_TAG_IMU) {
+      if (counts[LOG_TAG_IMU] > 1 && rec.timestampUs < lastImuUs) backwards++;
+      lastImuUs = rec.timestampUs;
+    }
+  }
+  printf("Firmware log: %zu bytes, %u IMU, %u TEMP, %u ADC, %u FC, %u TEXT records\n", log.size(),
+         counts[LOG_TAG_IMU], counts[LOG_TAG_TEMP], counts[LOG_TAG_ADC], counts[LOG_TAG_FLIGHT], counts[LOG_TAG_TEXT]);
+  CHECK(pos == log.size());
+  CHECK(decoder.resyncs == 0 && backwards == 0);
+  CHECK(counts[LOG_TAG_IMU] > 2 * flightMix.imuHz);
+  CHECK(counts[LOG_TAG_TEMP] > 2 * flightMix.tempHz);
+  CHECK(counts[LOG_TAG_ADC] > 2 * flightMix.adcHz);
+  CHECK(counts[LOG_TAG_FLIGHT] > 2 * flightMix.flightHz);
+
+  if (copyDir) {
+    copyFile(root + "/FlightLog.bin", std::string(copyDir) + "/FlightLog.bin");
+    copyFile(root + "/FlashLog.img", std::string(copyDir) + "/FlashLog.img");
+  }
+}
+
+int main(int argc, char** argv) {
+  roundTrip();
+  corruption();
+  throughput();
+  firmwareLog(argc > 1 ? argv[1] : nullptr);
+  return hostTestResult("LogFormatTest");
+}
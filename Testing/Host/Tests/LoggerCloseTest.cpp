@@ -0,0 +1,37 @@
+// closeLogger() at LANDED: the flash log's partly filled page is
+// programmed whether or not the build has an SD card, so the last records
+// of the flight are in flash. Built for the default (LoggerCloseTest) and
+// the SD-less (LoggerCloseTestNoSd) variant.
+
+#include "HostTest.h"
+#include "FlashLog.h"
+#include "Logger.h"
+
+void setup();
+void loop();
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  setup();
+  uint64_t endUs = hostTimeUs() + 1000000ULL;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+
+  uint32_t before = flashLogNextSequence();
+  closeLogger();
+  uint32_t after = flashLogNextSequence();
+  CHECK(after > before);
+  CHECK(flashLogIdle());
+
+  // The last page is the padded-out partial one
+  uint8_t page[FLASH_PAGE_SIZE];
+  int16_t length = readFlashLogPage(after - 1, page);
+  printf("Logger close: %u page(s) programmed by closeLogger(), last page %d of %u payload bytes\n",
+         after - before, length, FLASH_PAGE_PAYLOAD);
+  CHECK(length > 0 && length < FLASH_PAGE_PAYLOAD);
+  CHECK(hostFlashStats().violations == 0);
+  return hostTestResult(ENABLE_SD ? "LoggerCloseTest" : "LoggerCloseTestNoSd");
+}
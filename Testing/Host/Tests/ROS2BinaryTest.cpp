@@ -0,0 +1,158 @@
+// ROS2 bridge wire formats: IMU samples published as CSV text and as
+// binary frames both decode back to the published values, the frames
+// resynchronise after text lines and corrupt bytes, and a binary sample
+// takes fewer link bytes, one write() and less encode time than CSV.
+
+#include "HostTest.h"
+#include "ROS2Bridge.h"
+#include "Settings.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+#define SAMPLES 200
+#define TIMED_SAMPLES 20000
+
+static void sampleValues(int i, float values[6]) {
+  for (int axis = 0; axis < 6; axis++) values[axis] = (axis < 3 ? 9.80665f : 0.5f) * sinf(0.01f * i + axis) + 0.001f * axis;
+}
+
+static void publishSample(int i) {
+  float v[6];
+  sampleValues(i, v);
+  publishIMU(v[0], v[1], v[2], v[3], v[4], v[5]);
+}
+
+static void publishSamples(int count) {
+  for (int i = 0; i < count; i++) {
+    publishSample(i);
+    hostAdvanceUs(ROS2_PUBLISH_RATE_MS * 1000UL);
+  }
+}
+
+// IMU,timestamp,seq,ax,ay,az,gx,gy,gz with six decimals
+static uint32_t decodeCsv(const std::string& text, uint32_t& firstSeq) {
+  uint32_t count = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos) end = text.size();
+    std::string line = text.substr(pos, end - pos);
+    pos = end + 1;
+    unsigned long ms, seq;
+    float v[6], expected[6];
+    if (sscanf(line.c_str(), "IMU,%lu,%lu,%f,%f,%f,%f,%f,%f", &ms, &seq, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 8) continue;
+    if (count == 0) firstSeq = seq;
+    CHECK(seq == firstSeq + count);
+    sampleValues(count, expected);
+    for (int axis = 0; axis < 6; axis++) CHECK(fabsf(v[axis] - expected[axis]) <= 1e-6f);
+    count++;
+  }
+  return count;
+}
+
+static uint32_t decodeBinary(const std::string& bytes, ROS2FrameDecoder& decoder, uint32_t startUs, int first = 0) {
+  uint32_t count = 0;
+  for (char c : bytes) {
+    if (!ros2DecodeByte(decoder, (uint8_t)c)) continue;
+    const ROS2FrameHeader* header = ros2FrameHeader(decoder);
+    CHECK(header->type == ROS2_IMU);
+    CHECK(header->length == sizeof(ROS2ImuPayload));
+    ROS2ImuPayload imu;
+    memcpy(&imu, ros2FramePayload(decoder), sizeof(imu));
+    // Binary frames carry the floats bit for bit, and the time in us
+    float expected[6];
+    sampleValues(first + count, expected);
+    CHECK(!memcmp(imu.accel, expected, sizeof(imu.accel)));
+    CHECK(!memcmp(imu.gyro, expected + 3, sizeof(imu.gyro)));
+    CHECK(header->timestampUs - startUs == (first + count) * ROS2_PUBLISH_RATE_MS * 1000UL);
+    count++;
+  }
+  return count;
+}
+
+static void roundTrip(size_t& csvBytes, size_t& binaryBytes) {
+  // CSV, switched by command as the ROS2 node does
+  Serial.hostInject("CMD,FORMAT,CSV\n");
+  receiveROS2Commands();
+  Serial.hostTakeOutput();
+  uint32_t writes = Serial.hostStats().writeCalls;
+  publishSamples(SAMPLES);
+  CHECK(Serial.hostStats().writeCalls - writes > 9 * SAMPLES);
+  std::string csv = Serial.hostTakeOutput();
+  uint32_t firstSeq = 0;
+  CHECK(decodeCsv(csv, firstSeq) == SAMPLES);
+  csvBytes = csv.size();
+
+  Serial.hostInject("CMD,FORMAT,BIN\n");
+  receiveROS2Commands();
+  Serial.hostTakeOutput();
+  uint32_t startUs = micros();
+  writes = Serial.hostStats().writeCalls;
+  publishSamples(SAMPLES);
+  CHECK(Serial.hostStats().writeCalls - writes == SAMPLES); // One write() per frame
+  std::string binary = Serial.hostTakeOutput();
+  CHECK(binary.size() == SAMPLES * (ROS2_FRAME_HEADER_SIZE + sizeof(ROS2ImuPayload) + ROS2_FRAME_CRC_SIZE));
+  binaryBytes = binary.size();
+
+  ROS2FrameDecoder decoder;
+  ros2DecoderReset(decoder);
+  CHECK(decodeBinary(binary, decoder, startUs) == SAMPLES);
+  CHECK(decoder.crcErrors == 0 && decoder.lengthErrors == 0);
+
+  // Sequence numbers carry on from the CSV samples
+  const ROS2FrameHeader* last = ros2FrameHeader(decoder);
+  CHECK(last->seq == firstSeq + 2 * SAMPLES - 1);
+}
+
+// Text on the link and a corrupted frame cost only the frame they hit
+static void resync() {
+  uint32_t startUs = micros();
+  publishSamples(3);
+  std::string binary = Serial.hostTakeOutput();
+  size_t frame = binary.size() / 3;
+  binary[frame + ROS2_FRAME_HEADER_SIZE + 5] ^= 0x40; // Payload bit flip in the second frame
+  std::string stream = "# Ready\r\nACK,12,FORMAT,BIN\r\n" + binary.substr(0, 2 * frame) + "# Ready\r\n" + binary.substr(2 * frame);
+
+  ROS2FrameDecoder decoder;
+  ros2DecoderReset(decoder);
+  uint32_t decoded = decodeBinary(stream.substr(0, stream.size() - frame), decoder, startUs);
+  CHECK(decoded == 1);
+  CHECK(decoder.crcErrors == 1);
+  CHECK(decodeBinary(stream.substr(stream.size() - frame), decoder, startUs, 2) == 1);
+}
+
+// Host CPU time per sample for each format, with the output discarded
+static double encodeNs(bool binary) {
+  setROS2BinaryMode(binary);
+  Serial.hostCapture(false);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < TIMED_SAMPLES; i++) publishSample(i);
+  auto end = std::chrono::steady_clock::now();
+  Serial.hostCapture(true);
+  return std::chrono::duration<double, std::nano>(end - start).count() / TIMED_SAMPLES;
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  Serial.hostCapture(true);
+  initSettings();
+  initROS2Bridge();
+  CHECK(Serial.hostTakeOutput().find("# Ready") != std::string::npos);
+
+  size_t csvBytes = 0, binaryBytes = 0;
+  roundTrip(csvBytes, binaryBytes);
+  resync();
+
+  double csvNs = encodeNs(false);
+  double binaryNs = encodeNs(true);
+  printf("ROS2 IMU sample: CSV %.1f bytes, %.0f ns; binary %.1f bytes, %.0f ns\n", (double)csvBytes / SAMPLES,
+         csvNs, (double)binaryBytes / SAMPLES, binaryNs);
+  // A CSV sample takes close to twice the link time of a frame
+  CHECK(binaryBytes * 3 < csvBytes * 2);
+  CHECK(binaryNs < csvNs);
+  return hostTestResult("ROS2BinaryTest");
+}
@@ -0,0 +1,142 @@
+// Queued RS485 transmit on the host UART model: sendRS485() returns without
+// waiting for the line, DE rises with the first byte and falls once the
+// last one has left the UART, back-to-back frames share one DE assertion,
+// the bytes on the wire parse back into the frames sent, and a full TX
+// buffer drops whole frames instead of stalling the caller. Prints the
+// time a call takes against the old raise-DE/write/flush sequence.
+
+#include "HostTest.h"
+#include "ChYAPpy.h"
+#include "Communication.h"
+
+void setup();
+void loop();
+
+#define BYTE_US (10 * 1000000.0 / RS485_BAUD) // 8N1
+#define BURST_FRAMES 5
+#define TX_CAPACITY (64 + RS485_TX_BUFFER_SIZE) // The UART's own buffer and the memory added for writes
+
+static const char* const payload = "12.345,-0.250,9.810,101325.0,21.50,00042"; // 40 bytes
+
+static bool deHigh() {
+  return hostGetPin(RS485_TX_EN_PIN) == HIGH;
+}
+
+static void waitIdle() {
+  while (Serial2.availableForWrite() < TX_CAPACITY) hostAdvanceUs(10);
+  hostAdvanceUs(10);
+}
+
+// One frame: the call does not wait for the line, DE covers the frame
+static uint32_t singleFrame(size_t& frameSize) {
+  HostSerialStats before = Serial2.hostStats();
+  uint64_t start = hostTimeUs();
+  sendRS485('T', 1, 1, payload);
+  uint32_t callUs = hostTimeUs() - start;
+  frameSize = Serial2.hostStats().txBytes - before.txBytes;
+  CHECK(frameSize == strlen(payload) + CHYAPPY_OVERHEAD);
+  CHECK(deHigh());
+
+  uint32_t frameUs = frameSize * BYTE_US;
+  hostAdvanceUs(frameUs - 2 * BYTE_US);
+  CHECK(Serial2.hostDeHigh() && deHigh());
+  hostAdvanceUs(2 * BYTE_US + 10);
+  CHECK(!Serial2.hostDeHigh() && !deHigh());
+  HostSerialStats after = Serial2.hostStats();
+  CHECK(after.deAssertions == before.deAssertions + 1);
+  CHECK(after.maxDeHighUs >= frameUs && after.maxDeHighUs <= frameUs + 2);
+  CHECK(after.writeStalls == before.writeStalls);
+  return callUs;
+}
+
+// What sendChYAPpyV12() used to do with the same frame
+static uint32_t blockingFrame() {
+  uint8_t frame[CHYAPPY_MAX_FRAME];
+  size_t size = chyappyEncode(frame, 'T', 1, 1, PAYLOAD_TYPE_STRING, payload, strlen(payload));
+  uint64_t start = hostTimeUs();
+  delayMicroseconds(10);
+  Serial2.write(frame, size);
+  Serial2.flush();
+  delayMicroseconds(10);
+  return hostTimeUs() - start;
+}
+
+// Frames queued while the previous one is still going out
+static void burst() {
+  HostSerialStats before = Serial2.hostStats();
+  uint64_t start = hostTimeUs();
+  for (uint16_t i = 0; i < BURST_FRAMES; i++) {
+    sendRS485('T', 1, 100 + i, payload);
+    hostAdvanceUs(200);
+  }
+  waitIdle();
+  HostSerialStats after = Serial2.hostStats();
+  uint32_t bytes = after.txBytes - before.txBytes;
+  printf("RS485 burst: %u frames, %u bytes under %u DE assertion(s), DE high %u us\n", BURST_FRAMES, bytes,
+         after.deAssertions - before.deAssertions, after.maxDeHighUs);
+  CHECK(after.deAssertions == before.deAssertions + 1);
+  CHECK(after.maxDeHighUs >= (uint32_t)(bytes * BYTE_US) && after.maxDeHighUs <= bytes * BYTE_US + 2);
+  CHECK(hostTimeUs() - start < bytes * BYTE_US + 100);
+}
+
+// Everything on the wire parses back, in order
+static void wireContents() {
+  std::string wire = Serial2.hostTakeOutput();
+  ChYAPpyParser parser;
+  chyappyReset(parser);
+  uint32_t frames = 0;
+  uint16_t lastSeq = 0;
+  for (char c : wire) {
+    ChYAPpyFrame frame;
+    if (!chyappyFeed(parser, (uint8_t)c, frame)) continue;
+    CHECK(frame.sensorType == 'T' && frame.length == strlen(payload) && !memcmp(frame.payload, payload, frame.length));
+    CHECK(frames == 0 || frame.seqNum > lastSeq);
+    lastSeq = frame.seqNum;
+    frames++;
+  }
+  CHECK(frames == 1 + BURST_FRAMES);
+  CHECK(parser.stats.crcErrors == 0 && parser.stats.droppedBytes == 0);
+}
+
+// Far more than the buffer holds at once: whole frames are dropped
+static void overflow(size_t frameSize) {
+  RS485TxStats before = getRS485TxStats();
+  HostSerialStats serialBefore = Serial2.hostStats();
+  uint64_t start = hostTimeUs();
+  for (uint16_t i = 0; i < 2 * TX_CAPACITY / frameSize; i++) sendRS485('T', 1, i, payload);
+  uint32_t callsUs = hostTimeUs() - start;
+  RS485TxStats after = getRS485TxStats();
+  HostSerialStats serialAfter = Serial2.hostStats();
+  uint32_t sent = after.frames - before.frames, dropped = after.dropped - before.dropped;
+  printf("RS485 overflow: %u frames queued, %u dropped, deepest queue %u bytes, worst latency %u us\n", sent,
+         dropped, after.maxQueuedBytes, after.maxLatencyUs);
+  CHECK(sent == TX_CAPACITY / frameSize && dropped > 0);
+  CHECK(serialAfter.writeStalls == serialBefore.writeStalls && callsUs == 0);
+  CHECK((serialAfter.txBytes - serialBefore.txBytes) % frameSize == 0);
+  CHECK(after.maxQueuedBytes <= TX_CAPACITY && after.maxQueuedBytes > TX_CAPACITY - frameSize);
+  CHECK(after.maxLatencyUs <= after.maxQueuedBytes * BYTE_US && after.maxLatencyUs >= after.maxQueuedBytes * (BYTE_US - 1));
+  waitIdle();
+}
+
+int main() {
+  hostTestUseTempSd();
+  Serial.hostEcho(nullptr);
+  setup();
+  waitIdle();
+  Serial2.hostCapture(true);
+  Serial2.hostTakeOutput();
+
+  size_t frameSize = 0;
+  uint32_t queuedUs = singleFrame(frameSize);
+  burst();
+  wireContents();
+  Serial2.hostCapture(false);
+  uint32_t blockingUs = blockingFrame();
+  waitIdle();
+  printf("RS485 %u-byte frame: sendRS485() %u us, blocking write and flush %u us\n", (unsigned)frameSize, queuedUs,
+         blockingUs);
+  CHECK(queuedUs * 100 < blockingUs);
+  CHECK(blockingUs >= frameSize * BYTE_US);
+  overflow(frameSize);
+  return hostTestResult("Rs485TxTest");
+}
@@ -0,0 +1,238 @@
+// Sampling engine on a simulated sensor backend: every sensor is read once
+// per period at its configured rate, all consumers of the ring see the same
+// samples, a late loop skips whole periods instead of bursting reads, and a
+// consumer that falls behind has exactly its lost samples counted. The ring
+// is also run with a producer and consumers on separate threads. Prints the
+// ring and sampler throughput.
+
+#include "HostTest.h"
+#include "Sampler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+void setup();
+void loop();
+
+#define RUN_US 10000000UL
+#define THREAD_ITEMS 2000000
+#define CONSUMERS 2
+
+static uint32_t imuReads = 0, tempReads = 0, adcReads = 0;
+
+// A level, still board: 1 g on Z, a slow ramp on the ADC channels
+static void simIMU(float& ax, float& ay, float& az, float& gx, float& gy, float& gz) {
+  imuReads++;
+  ax = 0.0f;
+  ay = 0.0f;
+  az = STANDARD_GRAVITY;
+  gx = gy = gz = 0.0f;
+}
+
+static float simTemperature() {
+  tempReads++;
+  return 21.5f;
+}
+
+static int16_t simADC(uint8_t channel) {
+  adcReads++;
+  return (int16_t)(channel * 1000 + adcReads / 4);
+}
+
+static const SamplerBackend simBackend = {simIMU, simTemperature, simADC, nullptr};
+
+static void resetCounts() {
+  imuReads = tempReads = adcReads = 0;
+  initSampler();
+}
+
+// Ring semantics on a small ring: late cursors see only new items, a
+// consumer that falls behind skips to the oldest retained item
+static void ring() {
+  static SampleRing<uint32_t, 8> small;
+  small.reset();
+  SampleCursor early, late;
+  small.openCursor(early);
+  for (uint32_t i = 0; i < 5; i++) small.push(i);
+  small.openCursor(late);
+  uint32_t value;
+  CHECK(!small.read(late, value));
+  for (uint32_t i = 0; i < 5; i++) CHECK(small.read(early, value) && value == i);
+
+  for (uint32_t i = 5; i < 25; i++) small.push(i);
+  uint32_t first = 0, count = 0;
+  while (small.read(late, value)) {
+    if (!count) first = value;
+    count++;
+  }
+  CHECK(count == 8 && first == 17);
+  CHECK(late.dropped == 20 - 8);
+  CHECK(small.readAt(24, value) && value == 24);
+  CHECK(!small.readAt(16, value)); // Overwritten
+}
+
+// A sample-sized item whose words all derive from its index, so a torn
+// copy is detectable
+struct TestItem {
+  uint32_t index;
+  uint32_t words[13];
+};
+
+static void ringThreads() {
+  static SampleRing<TestItem, SAMPLE_RING_CAPACITY> shared;
+  shared.reset();
+  std::atomic<bool> done(false);
+  uint32_t read[CONSUMERS] = {0}, dropped[CONSUMERS] = {0}, torn[CONSUMERS] = {0}, disorder[CONSUMERS] = {0};
+
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < CONSUMERS; c++) {
+    consumers.emplace_back([&, c] {
+      SampleCursor cursor = {0, 0};
+      TestItem item;
+      uint32_t expected = 0;
+      for (;;) {
+        bool finished = done.load(std::memory_order_acquire);
+        while (shared.read(cursor, item)) {
+          for (uint32_t w = 0; w < 13; w++) torn[c] += item.words[w] != item.index * (w + 1);
+          if (item.index < expected) disorder[c]++;
+          expected = item.index + 1;
+          read[c]++;
+        }
+        if (finished) break;
+        std::this_thread::yield();
+      }
+      dropped[c] = cursor.dropped;
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < THREAD_ITEMS; i++) {
+    TestItem item;
+    item.index = i;
+    for (uint32_t w = 0; w < 13; w++) item.words[w] = i * (w + 1);
+    shared.push(item);
+    if (i % 64 == 63) std::this_thread::yield(); // Let the consumers in on a single core
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  done.store(true, std::memory_order_release);
+  for (std::thread& consumer : consumers) consumer.join();
+
+  printf("Sample ring: %.1f M pushes/s of %u-byte items;", THREAD_ITEMS / seconds / 1e6, (unsigned)sizeof(TestItem));
+  for (int c = 0; c < CONSUMERS; c++) printf(" consumer %d read %u, dropped %u;", c, read[c], dropped[c]);
+  printf("\n");
+  for (int c = 0; c < CONSUMERS; c++) {
+    CHECK(torn[c] == 0);
+    CHECK(disorder[c] == 0);
+    CHECK(read[c] > 0);
+    // Every item is either read or counted as dropped
+    CHECK(read[c] + dropped[c] == THREAD_ITEMS);
+  }
+}
+
+// A 1 ms loop: every sensor at its rate, one bus read per published sample,
+// on the fixed grid, and the same stream for every consumer
+static void rates() {
+  resetCounts();
+  SampleCursor flight, bridge;
+  openSampleCursor(flight);
+  openSampleCursor(bridge);
+  uint32_t imuSamples = 0, gridErrors = 0, mismatched = 0, lastImuUs = 0;
+  for (uint32_t t = 0; t < RUN_US; t += 1000) {
+    updateSampler();
+    SensorSample a, b;
+    while (readSample(flight, a)) {
+      if (!readSample(bridge, b) || memcmp(&a, &b, sizeof(a))) mismatched++;
+      if (a.type != SAMPLE_IMU) continue;
+      if (imuSamples && a.timestampUs - lastImuUs != 1000000UL / SAMPLE_RATE_IMU_HZ) gridErrors++;
+      lastImuUs = a.timestampUs;
+      imuSamples++;
+    }
+    hostAdvanceUs(1000);
+  }
+  SamplerStats stats = getSamplerStats();
+  CHECK(stats.samples[SAMPLE_IMU] == RUN_US / (1000000UL / SAMPLE_RATE_IMU_HZ));
+  CHECK(stats.samples[SAMPLE_TEMP] == RUN_US / (1000000UL / SAMPLE_RATE_TEMP_HZ));
+  CHECK(stats.samples[SAMPLE_ADC] == RUN_US / (1000000UL / SAMPLE_RATE_ADC_HZ));
+  for (uint8_t type = 0; type < SAMPLE_TYPE_COUNT; type++) CHECK(stats.missed[type] == 0);
+  CHECK(imuReads == stats.samples[SAMPLE_IMU]);
+  CHECK(tempReads == stats.samples[SAMPLE_TEMP]);
+  CHECK(adcReads == 4 * stats.samples[SAMPLE_ADC]);
+  CHECK(imuSamples == stats.samples[SAMPLE_IMU]);
+  CHECK(gridErrors == 0 && mismatched == 0);
+  CHECK(flight.dropped == 0 && bridge.dropped == 0);
+
+  SensorSample latest;
+  CHECK(latestSample(SAMPLE_TEMP, latest) && latest.temperature == 21.5f);
+  CHECK(latestSample(SAMPLE_IMU, latest) && fabsf(latest.imu.worldAccel[2]) < 0.5f); // Gravity removed
+}
+
+// A 35 ms loop: one read per pass and the periods in between counted as
+// missed, so reads plus misses cover the run
+static void lateLoop() {
+  resetCounts();
+  const uint32_t loopUs = 35000;
+  uint32_t passes = 0;
+  for (uint32_t t = 0; t < RUN_US; t += loopUs) {
+    updateSampler();
+    hostAdvanceUs(loopUs);
+    passes++;
+  }
+  SamplerStats stats = getSamplerStats();
+  printf("Sampler at a %u ms loop: IMU %u read, %u missed; ADC %u read, %u missed\n", loopUs / 1000,
+         stats.samples[SAMPLE_IMU], stats.missed[SAMPLE_IMU], stats.samples[SAMPLE_ADC], stats.missed[SAMPLE_ADC]);
+  CHECK(stats.samples[SAMPLE_IMU] == passes); // No catch-up bursts
+  CHECK(imuReads == passes);
+  for (uint8_t type = 0; type < SAMPLE_TYPE_COUNT; type++) {
+    uint32_t periods = RUN_US / (1000000UL / (type == SAMPLE_IMU ? SAMPLE_RATE_IMU_HZ
+                                              : type == SAMPLE_TEMP ? SAMPLE_RATE_TEMP_HZ : SAMPLE_RATE_ADC_HZ));
+    uint32_t covered = stats.samples[type] + stats.missed[type];
+    CHECK(covered + 2 >= periods && covered <= periods + 2);
+  }
+}
+
+// A consumer that reads every 4 s loses exactly what the ring cannot hold;
+// a consumer reading every loop loses nothing. Prints host time per pass.
+static void slowConsumer() {
+  resetCounts();
+  SampleCursor fast, slow;
+  openSampleCursor(fast);
+  openSampleCursor(slow);
+  uint32_t fastRead = 0, slowRead = 0;
+  SensorSample sample;
+  std::chrono::duration<double, std::nano> busy(0);
+  uint32_t passes = 0;
+  for (uint32_t t = 0; t < RUN_US; t += 1000) {
+    auto start = std::chrono::steady_clock::now();
+    updateSampler();
+    busy += std::chrono::steady_clock::now() - start;
+    passes++;
+    while (readSample(fast, sample)) fastRead++;
+    if (t % 4000000 == 0) {
+      while (readSample(slow, sample)) slowRead++;
+    }
+    hostAdvanceUs(1000);
+  }
+  while (readSample(slow, sample)) slowRead++;
+
+  SamplerStats stats = getSamplerStats();
+  uint32_t published = 0;
+  for (uint8_t type = 0; type < SAMPLE_TYPE_COUNT; type++) published += stats.samples[type];
+  printf("Sampler: %.0f ns host time per pass, %u published; slow consumer read %u, dropped %u\n",
+         busy.count() / passes, published, slowRead, slow.dropped);
+  CHECK(fastRead == published && fast.dropped == 0);
+  CHECK(slowRead + slow.dropped == published);
+  CHECK(slow.dropped > 0);
+  CHECK(slowRead >= SAMPLE_RING_CAPACITY);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  ring();
+  ringThreads();
+  setSamplerBackend(simBackend);
+  rates();
+  lateLoop();
+  slowConsumer();
+  return hostTestResult("SamplerTest");
+}
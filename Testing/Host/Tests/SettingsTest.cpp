@@ -0,0 +1,209 @@
+// Settings registry: every key is found by the compile-time perfect hash
+// and nothing else is, a command writes the live variable a module reads
+// (and re-times the ROS2 task through its apply hook), and bad, unknown
+// and out-of-range values are refused with the variable left alone, also
+// through the config command path. Prints the lookup and apply cost
+// against the strcmp scan and sscanf parse the registry replaced.
+
+#include "HostTest.h"
+#include "Settings.h"
+#include "Configurator.h"
+#include "FlightController.h"
+#include "ROS2Bridge.h"
+#include "Actuation.h"
+#include "Scheduler.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+#define BENCH_ROUNDS 200000
+
+static uint32_t random32(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static int find(const char* key) {
+  return findSetting(key, strlen(key));
+}
+
+static void lookup() {
+  uint8_t count = getSettingCount();
+  CHECK(count > 0);
+  for (uint8_t id = 0; id < count; id++) {
+    const SettingDef* def = getSetting(id);
+    CHECK(def && def->value && def->owner && def->min <= def->defaultValue && def->defaultValue <= def->max);
+    CHECK(find(def->key) == id);
+    // Prefixes, extensions and one changed letter are not keys
+    std::string key = def->key;
+    CHECK(find(key.substr(0, key.size() - 1).c_str()) < 0);
+    CHECK(find((key + "x").c_str()) < 0);
+    key[0] ^= 0x20;
+    CHECK(find(key.c_str()) < 0);
+  }
+  CHECK(getSetting(count) == nullptr);
+  CHECK(find("") < 0 && find("=") < 0);
+
+  // Random strings never match
+  uint32_t seed = 3, falseHits = 0;
+  for (int i = 0; i < 100000; i++) {
+    char key[16];
+    size_t length = 1 + random32(seed) % 15;
+    for (size_t c = 0; c < length; c++) key[c] = 'a' + random32(seed) % 26;
+    int id = findSetting(key, length);
+    falseHits += id >= 0 && (strlen(getSetting(id)->key) != length || memcmp(getSetting(id)->key, key, length));
+  }
+  CHECK(falseHits == 0);
+}
+
+// A command lands in the variable the module reads, or is refused
+static void apply() {
+  initSettings();
+  CHECK(liftoffAccelThreshold == 10.0f && armDelayMs == 5000 && actuatorMaxPwm == 255);
+  CHECK(applySettingCommand("liftoff_accel=22.5") == SETTING_OK && liftoffAccelThreshold == 22.5f);
+  CHECK(applySettingCommand("arm_delay_ms=1500") == SETTING_OK && armDelayMs == 1500);
+  CHECK(applySettingCommand("act_max_pwm=100") == SETTING_OK && actuatorMaxPwm == 100);
+
+  CHECK(applySettingCommand("liftoff_accel=101") == SETTING_OUT_OF_RANGE && liftoffAccelThreshold == 22.5f);
+  CHECK(applySettingCommand("liftoff_accel=nan") == SETTING_OUT_OF_RANGE && liftoffAccelThreshold == 22.5f);
+  CHECK(applySettingCommand("liftoff_accel=fast") == SETTING_BAD_VALUE && liftoffAccelThreshold == 22.5f);
+  CHECK(applySettingCommand("liftoff_accel=") == SETTING_BAD_VALUE);
+  CHECK(applySettingCommand("arm_delay_ms=1.5") == SETTING_BAD_VALUE && armDelayMs == 1500);
+  CHECK(applySettingCommand("act_max_pwm=256") == SETTING_OUT_OF_RANGE && actuatorMaxPwm == 100);
+  CHECK(applySettingCommand("liftoff_accel") == SETTING_BAD_VALUE);
+  CHECK(applySettingCommand("no_such_key=1") == SETTING_UNKNOWN_KEY);
+  CHECK(setSetting(getSettingCount(), 1) == SETTING_UNKNOWN_KEY);
+
+  // Every setting reads back what was set, at its own type
+  for (uint8_t id = 0; id < getSettingCount(); id++) {
+    const SettingDef* def = getSetting(id);
+    CHECK(setSetting(id, def->max) == SETTING_OK && readSetting(id) == def->max);
+    CHECK(setSetting(id, def->defaultValue) == SETTING_OK && readSetting(id) == def->defaultValue);
+  }
+}
+
+// Through the firmware: the reply goes back on RS485, and the ROS2 task
+// runs at the new rate
+static void firmware() {
+  hostTestUseTempSd();
+  setup();
+  armDelayMs = 600000;
+  Serial2.hostCapture(true);
+  Serial2.hostTakeOutput();
+  handleConfigCommand(METHOD_RS485, SENSOR_TYPE_CONFIG, 1, 7, PAYLOAD_TYPE_STRING, "landing_dv=3.5");
+  handleConfigCommand(METHOD_RS485, SENSOR_TYPE_CONFIG, 1, 8, PAYLOAD_TYPE_STRING, "landing_dv=9999");
+  handleConfigCommand(METHOD_RS485, SENSOR_TYPE_CONFIG, 1, 9, PAYLOAD_TYPE_STRING, "ros2_rate_ms=100");
+  for (int i = 0; i < 100; i++) {
+    loop();
+    hostAdvanceUs(100);
+  }
+  std::string replies = Serial2.hostTakeOutput();
+  CHECK(landingImpactVelocity == 3.5f && ros2PublishRateMs == 100);
+  CHECK(replies.find("ACK") != std::string::npos && replies.find("NACK - Out of range") != std::string::npos);
+  CHECK(replies.find("ACK") < replies.find("NACK"));
+
+  int8_t ros2 = -1;
+  for (uint8_t i = 0; i < getTaskCount(); i++) {
+    if (!strcmp(getTaskName(i), "ros2")) ros2 = i;
+  }
+  CHECK(ros2 >= 0);
+  if (ros2 < 0) return;
+  uint32_t runs = getTaskStats(ros2).runs;
+  uint64_t endUs = hostTimeUs() + 2000000ULL;
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostAdvanceUs(10);
+  }
+  runs = getTaskStats(ros2).runs - runs;
+  printf("Settings: ros2 task ran %u times in 2 s at ros2_rate_ms=100\n", runs);
+  CHECK(runs >= 19 && runs <= 21);
+}
+
+// The Configurator before the registry: KEY=VALUE strings, found by strcmp
+struct OldSetting {
+  char key[16];
+  char value[32];
+};
+
+static int oldFind(const OldSetting* table, uint8_t count, const char* key) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(table[i].key, key) == 0) return i;
+  }
+  return -1;
+}
+
+static bool oldApply(OldSetting* table, uint8_t count, const char* command) {
+  char key[16], value[32];
+  if (sscanf(command, "%15[^=]=%31s", key, value) != 2) return false;
+  int id = oldFind(table, count, key);
+  if (id < 0) return false;
+  strncpy(table[id].value, value, sizeof(table[id].value));
+  return true;
+}
+
+template <typename Op>
+static double nsPer(uint32_t ops, Op op) {
+  auto start = std::chrono::steady_clock::now();
+  op();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+static void benchmark() {
+  uint8_t count = getSettingCount();
+  std::vector<OldSetting> old(count);
+  std::vector<std::string> commands;
+  for (uint8_t id = 0; id < count; id++) {
+    const SettingDef* def = getSetting(id);
+    snprintf(old[id].key, sizeof(old[id].key), "%s", def->key);
+    snprintf(old[id].value, sizeof(old[id].value), "%g", def->defaultValue);
+    commands.push_back(std::string(def->key) + "=" + old[id].value);
+  }
+  uint32_t ops = BENCH_ROUNDS * count;
+  volatile int sink = 0;
+
+  double hashNs = nsPer(ops, [&] {
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t id = 0; id < count; id++) sink = sink + findSetting(getSetting(id)->key, strlen(getSetting(id)->key));
+    }
+  });
+  double scanNs = nsPer(ops, [&] {
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t id = 0; id < count; id++) sink = sink + oldFind(old.data(), count, getSetting(id)->key);
+    }
+  });
+  double textNs = nsPer(ops, [&] {
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t id = 0; id < count; id++) sink = sink + applySettingCommand(commands[id].c_str());
+    }
+  });
+  double typedNs = nsPer(ops, [&] {
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t id = 0; id < count; id++) sink = sink + setSetting(id, getSetting(id)->defaultValue);
+    }
+  });
+  double oldApplyNs = nsPer(ops, [&] {
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+      for (uint8_t id = 0; id < count; id++) sink = sink + oldApply(old.data(), count, commands[id].c_str());
+    }
+  });
+  printf("Settings over %u keys: lookup %.1f ns hashed, %.1f ns strcmp scan\n", count, hashNs, scanNs);
+  printf("Settings apply: %.1f ns typed, %.1f ns from text, %.1f ns sscanf and scan into strings\n", typedNs, textNs,
+         oldApplyNs);
+  CHECK(hashNs < scanNs);
+  CHECK(typedNs < textNs);
+  CHECK(textNs < oldApplyNs);
+}
+
+int main() {
+  Serial.hostEcho(nullptr);
+  lookup();
+  apply();
+  firmware();
+  benchmark();
+  return hostTestResult("SettingsTest");
+}
@@ -0,0 +1,101 @@
+// Runs the firmware on the host stand-ins (see Arduino/HostHardware.h).
+//
+//   bluelily_host [--seconds N] [--step US] [--flash PATH] [--sd DIR]
+//                 [--imu CSV] [--pty] [--can IFACE] [--realtime] [--stats]
+//
+// By default time is virtual: each loop() pass costs --step microseconds
+// of CPU time plus whatever bus time the stand-ins charge, so runs are
+// deterministic and faster than real time.
+
+#include <Arduino.h>
+#include "HostHardware.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static void usage() {
+  fprintf(stderr,
+          "usage: bluelily_host [--seconds N] [--step US] [--flash PATH] [--sd DIR]\n"
+          "                     [--imu CSV] [--pty] [--can IFACE] [--realtime] [--stats]\n");
+}
+
+static void openPty(HardwareSerial& port) {
+  char path[64];
+  if (port.hostOpenPty(path, sizeof(path))) fprintf(stderr, "%s on %s\n", port.hostName(), path);
+  else fprintf(stderr, "%s: cannot open a pty\n", port.hostName());
+}
+
+int main(int argc, char** argv) {
+  double seconds = 10;
+  uint32_t stepUs = 10;
+  const char* flashPath = nullptr;
+  const char* imuPath = nullptr;
+  const char* canInterface = nullptr;
+  bool pty = false;
+  bool realTime = false;
+  bool stats = false;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--seconds") && hasValue) seconds = atof(argv[++i]);
+    else if (!strcmp(arg, "--step") && hasValue) stepUs = atoi(argv[++i]);
+    else if (!strcmp(arg, "--flash") && hasValue) flashPath = argv[++i];
+    else if (!strcmp(arg, "--sd") && hasValue) hostSetSdRoot(argv[++i]);
+    else if (!strcmp(arg, "--imu") && hasValue) imuPath = argv[++i];
+    else if (!strcmp(arg, "--can") && hasValue) canInterface = argv[++i];
+    else if (!strcmp(arg, "--pty")) pty = true;
+    else if (!strcmp(arg, "--realtime")) realTime = true;
+    else if (!strcmp(arg, "--stats")) stats = true;
+    else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (flashPath && !hostFlashOpen(flashPath)) {
+    fprintf(stderr, "cannot open flash image %s\n", flashPath);
+    return 1;
+  }
+  if (imuPath && !hostLoadImuScript(imuPath)) {
+    fprintf(stderr, "cannot load IMU script %s\n", imuPath);
+    return 1;
+  }
+  if (canInterface && !hostCanOpenSocket(canInterface)) {
+    fprintf(stderr, "cannot open CAN interface %s\n", canInterface);
+    return 1;
+  }
+  if (pty) {
+    Serial.hostEcho(nullptr);
+    openPty(Serial);
+    openPty(Serial1);
+    openPty(Serial2);
+  }
+  hostUseRealTime(realTime);
+
+  uint64_t endUs = hostTimeUs() + (uint64_t)(seconds * 1e6);
+  setup();
+  while (hostTimeUs() < endUs) {
+    loop();
+    hostCanPollSocket();
+    if (realTime) usleep(stepUs);
+    else hostAdvanceUs(stepUs);
+  }
+
+  if (stats) {
+    printTaskStats();
+#if ENABLE_PROFILER
+    printProfile();
+#endif
+    HostFlashStats flash = hostFlashStats();
+    printf("FLASH,%u programs,%u erases,%u reads,%u violations\n", flash.programs, flash.erases, flash.reads,
+           flash.violations);
+    HostCanStats can = hostCanStats();
+    printf("CAN,%u frames,%u filtered,%u rx overflows,%u tx full\n", can.frames, can.filtered, can.rxOverflows,
+           can.txBufferFull);
+  }
+  return 0;
+}